@@ -763,6 +763,82 @@ gboolean xfpm_brightness_set_level (XfpmBrightness *brightness, gint32 level)
   return ret;
 }
 
+#ifdef ENABLE_POLKIT
+static void
+xfpm_brightness_helper_set_level_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  GTask *task = G_TASK (user_data);
+  GError *error = NULL;
+
+  if ( g_subprocess_wait_check_finish (G_SUBPROCESS (source_object), res, &error) )
+    g_task_return_boolean (task, TRUE);
+  else
+    g_task_return_error (task, error);
+
+  g_object_unref (task);
+}
+#endif
+
+/*
+ * Same as xfpm_brightness_set_level, but the helper runs without
+ * blocking the main loop. XRandR is a plain X request, it completes
+ * right away.
+ */
+void xfpm_brightness_set_level_async (XfpmBrightness *brightness, gint32 level, GCancellable *cancellable,
+                                      GAsyncReadyCallback callback, gpointer user_data)
+{
+  GTask *task;
+
+  task = g_task_new (brightness, cancellable, callback, user_data);
+
+  if ( brightness->priv->xrandr_has_hw )
+  {
+    if ( xfpm_brightness_xrandr_set_level (brightness, brightness->priv->output, level) )
+      g_task_return_boolean (task, TRUE);
+    else
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "Failed to set the brightness level to %i", level);
+  }
+#ifdef ENABLE_POLKIT
+  else if ( brightness->priv->helper_has_hw )
+  {
+    GSubprocess *subprocess;
+    GError *error = NULL;
+    gchar *value = g_strdup_printf ("%i", level);
+
+    subprocess = g_subprocess_new (G_SUBPROCESS_FLAGS_NONE, &error,
+                                   "pkexec", SBINDIR "/xfpm-power-backlight-helper",
+                                   "--set-brightness", value, NULL);
+    g_free (value);
+
+    if ( subprocess != NULL )
+    {
+      /* the task is released by the callback */
+      g_subprocess_wait_check_async (subprocess, cancellable,
+                                     xfpm_brightness_helper_set_level_cb, task);
+      g_object_unref (subprocess);
+      return;
+    }
+
+    g_task_return_error (task, error);
+  }
+#endif
+  else
+  {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                             "No brightness control available");
+  }
+
+  g_object_unref (task);
+}
+
+gboolean xfpm_brightness_set_level_finish (XfpmBrightness *brightness, GAsyncResult *result, GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, brightness), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
 gboolean xfpm_brightness_set_step_count (XfpmBrightness *brightness, guint32 count, gboolean exponential)
 {
   gboolean ret = FALSE;
@@ -22,6 +22,7 @@
 #define __XFPM_BRIGHTNESS_H
 
 #include <glib-object.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
@@ -57,6 +58,14 @@ gboolean          xfpm_brightness_get_level       (XfpmBrightness *brightness,
                                                    gint32         *level);
 gboolean          xfpm_brightness_set_level       (XfpmBrightness *brightness,
                                                    gint32          level);
+void              xfpm_brightness_set_level_async (XfpmBrightness *brightness,
+                                                   gint32          level,
+                                                   GCancellable   *cancellable,
+                                                   GAsyncReadyCallback callback,
+                                                   gpointer        user_data);
+gboolean          xfpm_brightness_set_level_finish(XfpmBrightness *brightness,
+                                                   GAsyncResult   *result,
+                                                   GError        **error);
 gboolean          xfpm_brightness_set_step_count  (XfpmBrightness *brightness,
                                                    guint32         count,
                                                    gboolean        exponential);
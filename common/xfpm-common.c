@@ -44,6 +44,21 @@ xfpm_string_to_bool (const gchar *string)
   return FALSE;
 }
 
+/* Contents of a small sysfs attribute, stripped, or NULL */
+gchar *
+xfpm_sysfs_read (const gchar *dir, const gchar *name)
+{
+  gchar *filename;
+  gchar *contents = NULL;
+
+  filename = g_build_filename (dir, name, NULL);
+  if ( g_file_get_contents (filename, &contents, NULL, NULL) )
+    g_strstrip (contents);
+  g_free (filename);
+
+  return contents;
+}
+
 GtkBuilder
 *xfpm_builder_new_from_string (const gchar *ui, GError **error)
 {
@@ -34,6 +34,8 @@ GdkPixbuf      *xfpm_icon_load                  (const gchar *icon_name,
                                                  gint         size);
 const gchar    *xfpm_bool_to_string             (gboolean     value) G_GNUC_PURE;
 gboolean        xfpm_string_to_bool             (const gchar *string) G_GNUC_PURE;
+gchar          *xfpm_sysfs_read                 (const gchar *dir,
+                                                 const gchar *name) G_GNUC_MALLOC;
 GtkBuilder     *xfpm_builder_new_from_string    (const gchar *file,
                                                  GError     **error);
 void            xfpm_preferences                (void);
@@ -85,6 +85,45 @@ G_BEGIN_DECLS
 #define SHOW_PANEL_LABEL                     "show-panel-label"
 #define SHOW_PRESENTATION_INDICATOR          "show-presentation-indicator"
 
+#define PROFILE_ON_AC                        "profile-on-ac"
+#define PROFILE_ON_BATTERY                   "profile-on-battery"
+#define PROFILE_ON_CRITICAL                  "profile-on-critical"
+#define PROFILE_ON_HOT                       "profile-on-hot"
+
+#define WORKLOAD_INHIBIT                     "workload-inhibit"
+#define WORKLOAD_CPU_PRESSURE                "workload-cpu-pressure"
+#define WORKLOAD_IO_PRESSURE                 "workload-io-pressure"
+#define WORKLOAD_LOAD_AVERAGE                "workload-load-average"
+#define WORKLOAD_NETWORK_RATE                "workload-network-rate"
+
+#define CPU_GOVERNOR_ON_AC                   "cpu-governor-on-ac"
+#define CPU_GOVERNOR_ON_BATTERY              "cpu-governor-on-battery"
+#define CPU_EPP_ON_AC                        "cpu-epp-on-ac"
+#define CPU_EPP_ON_BATTERY                   "cpu-epp-on-battery"
+#define CPU_MAX_FREQ_ON_AC                   "cpu-max-freq-on-ac"
+#define CPU_MAX_FREQ_ON_BATTERY              "cpu-max-freq-on-battery"
+
+#define RUNTIME_PM_ON_AC                     "runtime-pm-on-ac"
+#define RUNTIME_PM_ON_BATTERY                "runtime-pm-on-battery"
+#define RUNTIME_PM_AUTOSUSPEND_DELAY         "runtime-pm-autosuspend-delay"
+#define RUNTIME_PM_DENY_LIST                 "runtime-pm-deny-list"
+
+#define HIBERNATE_IMAGE_TUNING               "hibernate-image-tuning"
+#define HIBERNATE_KEEP_CACHE                 "hibernate-keep-cache"
+
+#define SUSPEND_THEN_HIBERNATE               "suspend-then-hibernate"
+#define SUSPEND_THEN_HIBERNATE_INTERVAL      "suspend-then-hibernate-interval"
+
+#define SHORT_SLEEP_THRESHOLD                "short-sleep-threshold"
+
+#define THERMAL_HOT_TEMPERATURE              "thermal-hot-temperature"
+#define THERMAL_HYSTERESIS                   "thermal-hysteresis"
+#define THERMAL_ACTIONS                      "thermal-actions"
+#define THERMAL_BRIGHTNESS_STEPS             "thermal-brightness-steps"
+
+#define METRICS_TEXTFILE                     "metrics-textfile"
+#define METRICS_INTERVAL                     "metrics-interval"
+
 G_END_DECLS
 
 #endif /* __XFPM_CONFIG_H */
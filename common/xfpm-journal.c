@@ -0,0 +1,282 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "xfpm-journal.h"
+
+#define RECORD_OFFSET(i)  ((off_t) (sizeof (XfpmJournalHeader) + (i) * sizeof (XfpmJournalRecord)))
+
+G_STATIC_ASSERT (sizeof (XfpmJournalRecord) == 32);
+
+static const gchar *event_names[XFPM_JOURNAL_N_EVENTS] =
+{
+  "none",
+  "started",
+  "lid",
+  "ac",
+  "battery-level",
+  "idle",
+  "inhibit-added",
+  "inhibit-removed",
+  "sleep-request",
+  "sleep-blocked",
+  "suspend",
+  "hibernate",
+  "resume",
+  "critical-action",
+};
+
+/* The daemon's journal, opened on the first event */
+static gchar             *journal_path = NULL;
+static gint               journal_fd = -1;
+static guint              journal_next = 0;
+static gboolean           journal_broken = FALSE;
+
+static gboolean
+xfpm_journal_header_is_valid (const XfpmJournalHeader *header)
+{
+  return memcmp (header->magic, XFPM_JOURNAL_MAGIC, sizeof (header->magic)) == 0 &&
+         header->version == XFPM_JOURNAL_VERSION &&
+         header->record_size == sizeof (XfpmJournalRecord);
+}
+
+/*
+ * Takes @path. Records are written with pwrite rather than through a
+ * mapping, a full disk or someone truncating the file is then an error
+ * and not a SIGBUS in the daemon.
+ */
+static gboolean
+xfpm_journal_open (gchar *path)
+{
+  XfpmJournalHeader header;
+  struct stat st;
+  gint fd;
+
+  fd = g_open (path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if ( fd < 0 )
+  {
+    g_free (path);
+    return FALSE;
+  }
+
+  if ( fstat (fd, &st) != 0 )
+    goto error;
+
+  /* A new file, or one from another version that we start over */
+  if ( st.st_size < (off_t) sizeof (header) ||
+       pread (fd, &header, sizeof (header), 0) != sizeof (header) ||
+       !xfpm_journal_header_is_valid (&header) )
+  {
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, XFPM_JOURNAL_MAGIC, sizeof (header.magic));
+    header.version = XFPM_JOURNAL_VERSION;
+    header.record_size = sizeof (XfpmJournalRecord);
+
+    if ( ftruncate (fd, 0) != 0 ||
+         pwrite (fd, &header, sizeof (header), 0) != sizeof (header) )
+      goto error;
+
+    st.st_size = sizeof (header);
+  }
+
+  /* A record cut short by a crash gets overwritten */
+  journal_next = (st.st_size - sizeof (header)) / sizeof (XfpmJournalRecord);
+  journal_fd = fd;
+  journal_path = path;
+
+  return TRUE;
+
+error:
+  close (fd);
+  g_free (path);
+  return FALSE;
+}
+
+static void
+xfpm_journal_close (void)
+{
+  if ( journal_fd >= 0 )
+  {
+    close (journal_fd);
+    journal_fd = -1;
+  }
+
+  g_clear_pointer (&journal_path, g_free);
+}
+
+static gboolean
+xfpm_journal_rotate (void)
+{
+  gchar *path;
+  gchar *old;
+
+  path = g_strdup (journal_path);
+  xfpm_journal_close ();
+
+  old = g_strconcat (path, ".1", NULL);
+  g_rename (path, old);
+  g_free (old);
+
+  return xfpm_journal_open (path);
+}
+
+/**
+ * xfpm_journal_log:
+ * @value: meaning depends on @event, e.g. 1 for a closed lid
+ * @detail: a short name, cut at XFPM_JOURNAL_DETAIL_SIZE, or %NULL
+ *
+ * Appends an event to the journal of the power manager. Failing to
+ * write is reported once and the journal is off from then on.
+ **/
+void
+xfpm_journal_log (XfpmJournalEvent event, gint32 value, const gchar *detail)
+{
+  XfpmJournalRecord record;
+
+  if ( journal_broken )
+    return;
+
+  if ( journal_fd < 0 )
+  {
+    gchar *path;
+    gchar *dir;
+
+    path = xfpm_journal_get_path ();
+    dir = g_path_get_dirname (path);
+
+    if ( g_mkdir_with_parents (dir, 0700) != 0 || !xfpm_journal_open (g_strdup (path)) )
+    {
+      g_warning ("Unable to open the journal %s: %s", path, g_strerror (errno));
+      journal_broken = TRUE;
+    }
+
+    g_free (dir);
+    g_free (path);
+
+    if ( journal_broken )
+      return;
+  }
+
+  if ( journal_next >= XFPM_JOURNAL_CAPACITY && !xfpm_journal_rotate () )
+  {
+    g_warning ("Unable to rotate the journal: %s", g_strerror (errno));
+    journal_broken = TRUE;
+    return;
+  }
+
+  memset (&record, 0, sizeof (record));
+  record.time = g_get_real_time ();
+  record.event = event;
+  record.value = value;
+  if ( detail != NULL )
+    strncpy (record.detail, detail, sizeof (record.detail));
+
+  if ( pwrite (journal_fd, &record, sizeof (record), RECORD_OFFSET (journal_next)) != sizeof (record) )
+  {
+    g_warning ("Unable to write to the journal %s: %s", journal_path, g_strerror (errno));
+    xfpm_journal_close ();
+    journal_broken = TRUE;
+    return;
+  }
+
+  journal_next++;
+}
+
+gchar *
+xfpm_journal_get_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "xfce4-power-manager", "journal", NULL);
+}
+
+/**
+ * xfpm_journal_read:
+ * @func: called for every record in order, return %FALSE to stop
+ *
+ * Returns: %FALSE with @error set if @path isn't a journal
+ **/
+gboolean
+xfpm_journal_read (const gchar *path, XfpmJournalFunc func, gpointer user_data, GError **error)
+{
+  const XfpmJournalHeader *header;
+  const XfpmJournalRecord *records;
+  gchar *contents;
+  gsize length;
+  gsize n;
+  gsize i;
+
+  /* A copy, the daemon may be appending */
+  if ( !g_file_get_contents (path, &contents, &length, error) )
+    return FALSE;
+
+  header = (const XfpmJournalHeader *) contents;
+
+  if ( length < sizeof (XfpmJournalHeader) || !xfpm_journal_header_is_valid (header) )
+  {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                 "%s is not a power manager journal", path);
+    g_free (contents);
+    return FALSE;
+  }
+
+  records = (const XfpmJournalRecord *) (header + 1);
+  n = (length - sizeof (XfpmJournalHeader)) / sizeof (XfpmJournalRecord);
+
+  for ( i = 0; i < n && records[i].time != 0; i++ )
+    if ( !func (&records[i], user_data) )
+      break;
+
+  g_free (contents);
+
+  return TRUE;
+}
+
+const gchar *
+xfpm_journal_event_to_string (XfpmJournalEvent event)
+{
+  if ( event >= XFPM_JOURNAL_N_EVENTS )
+    return "unknown";
+
+  return event_names[event];
+}
+
+/* XFPM_JOURNAL_NONE for a name we don't know */
+XfpmJournalEvent
+xfpm_journal_event_from_string (const gchar *name)
+{
+  guint i;
+
+  for ( i = 1; i < XFPM_JOURNAL_N_EVENTS; i++ )
+    if ( g_strcmp0 (event_names[i], name) == 0 )
+      return i;
+
+  return XFPM_JOURNAL_NONE;
+}
@@ -0,0 +1,93 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __XFPM_JOURNAL_H
+#define __XFPM_JOURNAL_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * The journal is a header followed by fixed size records, each event
+ * is a single pwrite at the end. A full journal is renamed to
+ * journal.1 and a new one is started.
+ */
+
+#define XFPM_JOURNAL_MAGIC          "XFPMJRNL"
+#define XFPM_JOURNAL_VERSION        1
+#define XFPM_JOURNAL_CAPACITY       4096
+#define XFPM_JOURNAL_DETAIL_SIZE    16
+
+typedef enum
+{
+  XFPM_JOURNAL_NONE = 0,
+  XFPM_JOURNAL_STARTED,
+  XFPM_JOURNAL_LID,
+  XFPM_JOURNAL_AC,
+  XFPM_JOURNAL_BATTERY_LEVEL,
+  XFPM_JOURNAL_IDLE,
+  XFPM_JOURNAL_INHIBIT_ADDED,
+  XFPM_JOURNAL_INHIBIT_REMOVED,
+  XFPM_JOURNAL_SLEEP_REQUEST,
+  XFPM_JOURNAL_SLEEP_BLOCKED,
+  XFPM_JOURNAL_SUSPEND,
+  XFPM_JOURNAL_HIBERNATE,
+  XFPM_JOURNAL_RESUME,
+  XFPM_JOURNAL_CRITICAL_ACTION,
+  XFPM_JOURNAL_N_EVENTS
+} XfpmJournalEvent;
+
+typedef struct
+{
+  gchar                 magic[8];
+  guint32               version;
+  guint32               record_size;
+} XfpmJournalHeader;
+
+/* 32 bytes, @detail is not nul terminated when full */
+typedef struct
+{
+  gint64                time;
+  guint16               event;
+  guint16               reserved;
+  gint32                value;
+  gchar                 detail[XFPM_JOURNAL_DETAIL_SIZE];
+} XfpmJournalRecord;
+
+typedef gboolean (*XfpmJournalFunc)         (const XfpmJournalRecord *record,
+                                             gpointer                 user_data);
+
+void              xfpm_journal_log          (XfpmJournalEvent  event,
+                                             gint32            value,
+                                             const gchar      *detail);
+
+gchar            *xfpm_journal_get_path     (void) G_GNUC_MALLOC;
+gboolean          xfpm_journal_read         (const gchar      *path,
+                                             XfpmJournalFunc   func,
+                                             gpointer          user_data,
+                                             GError          **error);
+
+const gchar      *xfpm_journal_event_to_string   (XfpmJournalEvent  event);
+XfpmJournalEvent  xfpm_journal_event_from_string (const gchar      *name);
+
+G_END_DECLS
+
+#endif /* __XFPM_JOURNAL_H */
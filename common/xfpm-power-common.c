@@ -161,6 +161,16 @@ is_display_device (UpClient *upower, UpDevice *device)
 
 gchar*
 get_device_icon_name (UpClient *upower, UpDevice *device)
+{
+  return get_device_icon_name_full (device,
+                                    up_client_get_lid_is_present (upower),
+                                    up_client_get_on_battery (upower));
+}
+
+/* Same as get_device_icon_name, for callers that only have a copy of the
+ * UPower state, like the panel plugin */
+gchar*
+get_device_icon_name_full (UpDevice *device, gboolean lid_is_present, gboolean on_battery)
 {
   gchar *icon_name = NULL;
   gchar *icon_suffix;
@@ -215,8 +225,8 @@ get_device_icon_name (UpClient *upower, UpDevice *device)
     icon_name = g_strdup (XFPM_COMPUTER_ICON);
   /* As UPower does not tell us whether a system is a desktop or a laptop we
      decide this based on whether there is a battery and/or a a lid */
-  else if (!up_client_get_lid_is_present (upower) &&
-           !up_client_get_on_battery (upower) &&
+  else if (!lid_is_present &&
+           !on_battery &&
            g_strcmp0 (upower_icon, "battery-missing-symbolic") == 0)
     icon_name = g_strdup (XFPM_AC_ADAPTER_ICON);
   else if ( g_strcmp0 (upower_icon, "") != 0 )
@@ -227,6 +237,12 @@ get_device_icon_name (UpClient *upower, UpDevice *device)
 
 gchar*
 get_device_description (UpClient *upower, UpDevice *device)
+{
+  return get_device_description_full (device, is_display_device (upower, device));
+}
+
+gchar*
+get_device_description_full (UpDevice *device, gboolean is_display_device)
 {
   gchar *tip = NULL;
   gchar *est_time_str = NULL;
@@ -249,7 +265,7 @@ get_device_description (UpClient *upower, UpDevice *device)
                 "online", &online,
                  NULL);
 
-  if (is_display_device (upower, device))
+  if (is_display_device)
   {
     g_free (vendor);
     vendor = g_strdup (_("Computer"));
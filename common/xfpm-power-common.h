@@ -50,5 +50,10 @@ gchar       *get_device_icon_name             (UpClient *upower,
                                                UpDevice *device);
 gchar       *get_device_description           (UpClient *upower,
                                                UpDevice *device);
+gchar       *get_device_icon_name_full        (UpDevice *device,
+                                               gboolean  lid_is_present,
+                                               gboolean  on_battery);
+gchar       *get_device_description_full      (UpDevice *device,
+                                               gboolean  is_display_device);
 
 #endif /* XFPM_UPOWER_COMMON */
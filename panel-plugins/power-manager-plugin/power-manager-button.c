@@ -37,11 +37,9 @@
 #include "common/xfpm-config.h"
 #include "common/xfpm-icons.h"
 #include "common/xfpm-power-common.h"
-#include "common/xfpm-brightness.h"
 #include "common/xfpm-debug.h"
-#ifdef XFPM_SYSTRAY
-#include "src/xfpm-inhibit.h"
-#endif
+#include "src/xfpm-rapl.h"
+#include "src/xfpm-state.h"
 
 #include "power-manager-button.h"
 #include "scalemenuitem.h"
@@ -53,24 +51,59 @@
 #define PANEL_DEFAULT_ICON_SYMBOLIC ("battery-full-charged-symbolic")
 #define PRESENTATION_MODE_ICON ("x-office-presentation-symbolic")
 
+/* Size of the device icons in the menu */
+#define DEVICE_ICON_SIZE (32)
+/* The charge overlay is drawn in steps of this many percent */
+#define CHARGE_BUCKET_SIZE (5)
+#define CHARGE_BUCKET_NONE (-1)
+#define CHARGE_BUCKET_UNKNOWN (-2)
+/* Upper bound for the icon cache, it is emptied when full */
+#define ICON_CACHE_MAX_ENTRIES (128)
+
+/* Processes listed in the menu, and seconds between two refreshes
+ * while it is open */
+#define MENU_CONSUMERS_COUNT (3)
+#define CONSUMERS_REFRESH_INTERVAL (5)
+
+typedef struct BatteryDevice BatteryDevice;
+
 struct PowerManagerButtonPrivate
 {
 #ifdef XFCE_PLUGIN
   XfcePanelPlugin *plugin;
-  GDBusProxy      *inhibit_proxy;
+  /* org.xfce.Power.Manager of the running daemon */
+  GDBusProxy      *manager_proxy;
 #else
-  XfpmInhibit     *inhibit;
+  XfpmState       *state;
 #endif
 
   XfconfChannel   *channel;
 
-  UpClient        *upower;
+  /* Everything below comes from the daemon's state, see xfpm-state.h,
+   * the serial is the one of the last snapshot or delta applied */
+  guint64          state_serial;
+  gboolean         state_synced;
+  gboolean         on_battery;
+  gboolean         lid_is_present;
 
   /* A list of BatteryDevices  */
   GList           *devices;
+  /* object path -> its link in devices */
+  GHashTable      *device_index;
 
-  /* The left-click popup menu, if one is being displayed */
+  /* The left-click popup menu, built the first time it is shown and
+   * then patched in place when devices or inhibitors change */
   GtkWidget       *menu;
+  GtkWidget       *device_separator;
+  GtkWidget       *inhibitor_separator;
+  /* The processes using the most power go below this one */
+  GtkWidget       *consumer_separator;
+  GList           *consumer_items;
+  guint            consumers_refresh_id;
+  /* Menu items of the applications inhibiting power management */
+  GList           *inhibitor_items;
+  /* Last known list of those applications */
+  gchar          **inhibitors;
 
   /* The actual panel icon image */
   GtkWidget       *panel_icon_image;
@@ -87,8 +120,20 @@ struct PowerManagerButtonPrivate
   /* Upower 0.99 has a display device that can be used for the
    * panel image and tooltip description */
   UpDevice        *display_device;
+  gchar           *display_device_path;
+  /* What the panel icon, tooltip and label show, only looked
+   * up again when devices come and go */
+  BatteryDevice   *display_battery_device;
+
+  /* Watts of the CPU energy counters pseudo device, -1 if unknown */
+  gdouble          cpu_rate;
+  gdouble          cpu_core_rate;
+  gdouble          cpu_uncore_rate;
 
-  XfpmBrightness  *brightness;
+  /* Backlight level as last published by the daemon, a maximum
+   * of 0 means there is no backlight to control */
+  gint32           brightness_level;
+  gint32           brightness_max;
 
   /* display brightness slider widget */
   GtkWidget       *range;
@@ -100,26 +145,57 @@ struct PowerManagerButtonPrivate
    * editor if desired.
    */
   gint32           brightness_min_level;
+  /* The setting it was computed from, -1 = auto */
+  gint32           brightness_min_level_setting;
 
   gint             show_panel_label;
   gboolean         presentation_mode;
   gboolean         show_presentation_indicator;
 
-  /* filter range value changed events for snappier UI feedback */
+  /* Slider moves are written at most every SET_LEVEL_TIMEOUT, one at
+   * a time, and only the latest position is kept while waiting */
   guint            set_level_timeout;
+  gint32           pending_level;       /* -1 when there is nothing to write */
+  gboolean         write_in_flight;
+  guint            writes_issued;
+  guint            writes_dropped;
+
+  /* Device changes are applied once per frame, or from an idle
+   * callback when the button isn't mapped (systray) */
+  guint            refresh_tick_id;
+  guint            refresh_idle_id;
 };
 
+/* What a device shows on screen, two equal digests give the same
+ * icon, tooltip and label */
 typedef struct
 {
-  GdkPixbuf   *pix;               /* Icon */
+  guint        type;
+  guint        state;
+  gboolean     present;
+  gboolean     online;
+  gint         half_percent;      /* the label truncates, the tooltip rounds */
+  guint        minutes_to_empty;
+  guint        minutes_to_full;
+  guint        strings_hash;      /* icon name, vendor and model */
+} DeviceDigest;
+
+struct BatteryDevice
+{
+  PowerManagerButton *button;     /* The button showing the device */
+  cairo_surface_t *surface;       /* Icon with the charge overlay, from the icon cache */
+  gchar       *icon_name;         /* Icon name the surface was rendered from */
+  gint         charge_bucket;     /* Charge overlay the surface was rendered with */
+  gint         scale;             /* Scale factor the surface was rendered for */
   GtkWidget   *img;               /* Icon image in the menu */
   gchar       *details;           /* Description of the device + state */
   gchar       *object_path;       /* UpDevice object path */
-  UpDevice    *device;            /* Pointer to the UpDevice */
+  UpDevice    *device;            /* UpDevice mirroring the daemon's copy */
   gulong       changed_signal_id; /* device changed callback id */
-  gulong       expose_signal_id;  /* expose-event callback id */
   GtkWidget   *menu_item;         /* The device's item on the menu (if shown) */
-} BatteryDevice;
+  DeviceDigest digest;            /* What is currently shown for the device */
+  gboolean     dirty;             /* Changed since the last refresh */
+};
 
 typedef enum
 {
@@ -141,11 +217,10 @@ static guint __signals[SIG_N_SIGNALS] = { 0, };
 G_DEFINE_TYPE_WITH_PRIVATE (PowerManagerButton, power_manager_button, GTK_TYPE_TOGGLE_BUTTON)
 
 static void       power_manager_button_finalize                         (GObject *object);
+static void       power_manager_button_destroy                          (GtkWidget *widget);
+static void       power_manager_button_unmap                            (GtkWidget *widget);
 static GList*     find_device_in_list                                   (PowerManagerButton *button,
                                                                          const gchar *object_path);
-static gboolean   power_manager_button_device_icon_draw                 (GtkWidget *img,
-                                                                         cairo_t *cr,
-                                                                         gpointer userdata);
 static void       power_manager_button_set_icon                         (PowerManagerButton *button);
 static void       power_manager_button_set_label                        (PowerManagerButton *button,
                                                                          gdouble percentage,
@@ -160,11 +235,18 @@ static gboolean   power_manager_button_menu_add_device                  (PowerMa
                                                                          gboolean append);
 static void       increase_brightness                                   (PowerManagerButton *button);
 static void       decrease_brightness                                   (PowerManagerButton *button);
-static void       battery_device_remove_pix                             (BatteryDevice *battery_device);
+static void       battery_device_clear_icon                             (BatteryDevice *battery_device);
+static void       power_manager_button_menu_update_separators           (PowerManagerButton *button);
+static void       power_manager_button_set_inhibitors                   (PowerManagerButton *button,
+                                                                         const gchar **inhibitors);
+static void       set_brightness_min_level                              (PowerManagerButton *button,
+                                                                         gint32 new_brightness_level);
+static void       power_manager_button_menu_update_consumers            (PowerManagerButton *button,
+                                                                         GVariant *reply);
 
 
 static BatteryDevice*
-get_display_device (PowerManagerButton *button)
+find_display_device (PowerManagerButton *button)
 {
   GList *item = NULL;
   gdouble highest_percentage = 0;
@@ -172,11 +254,9 @@ get_display_device (PowerManagerButton *button)
 
   TRACE("entering");
 
-  g_return_val_if_fail (POWER_MANAGER_IS_BUTTON(button), NULL);
-
-  if (button->priv->display_device)
+  if (button->priv->display_device_path)
   {
-    item = find_device_in_list (button, up_device_get_object_path (button->priv->display_device));
+    item = find_device_in_list (button, button->priv->display_device_path);
     if (item)
     {
       return item->data;
@@ -214,29 +294,37 @@ get_display_device (PowerManagerButton *button)
   return display_device;
 }
 
-static GList*
-find_device_in_list (PowerManagerButton *button, const gchar *object_path)
+/* Called when devices are added or removed, or UPower's display
+ * device changes */
+static void
+power_manager_button_update_display_device (PowerManagerButton *button)
 {
   GList *item = NULL;
 
-  TRACE("entering");
+  if (button->priv->display_device_path)
+    item = find_device_in_list (button, button->priv->display_device_path);
 
-  g_return_val_if_fail ( POWER_MANAGER_IS_BUTTON(button), NULL );
+  button->priv->display_device = item != NULL ? ((BatteryDevice *) item->data)->device : NULL;
+  button->priv->display_battery_device = find_display_device (button);
+}
 
-  for (item = g_list_first (button->priv->devices); item != NULL; item = g_list_next (item))
-  {
-    BatteryDevice *battery_device = item->data;
-    if (battery_device == NULL)
-    {
-      DBG("!battery_device");
-      continue;
-    }
+static BatteryDevice*
+get_display_device (PowerManagerButton *button)
+{
+  g_return_val_if_fail (POWER_MANAGER_IS_BUTTON(button), NULL);
 
-    if (g_strcmp0 (battery_device->object_path, object_path) == 0)
-      return item;
-  }
+  return button->priv->display_battery_device;
+}
+
+static GList*
+find_device_in_list (PowerManagerButton *button, const gchar *object_path)
+{
+  g_return_val_if_fail ( POWER_MANAGER_IS_BUTTON(button), NULL );
+
+  if (object_path == NULL)
+    return NULL;
 
-  return NULL;
+  return g_hash_table_lookup (button->priv->device_index, object_path);
 }
 
 static void
@@ -253,10 +341,34 @@ power_manager_button_set_icon (PowerManagerButton *button)
   g_signal_emit (button, __signals[SIG_ICON_NAME_CHANGED], 0);
 }
 
+/* What the CPU draws, NULL if the daemon has no energy counters */
+static gchar *
+get_cpu_power_text (PowerManagerButton *button)
+{
+  if (button->priv->cpu_rate < 0)
+    return NULL;
+
+  if (button->priv->cpu_core_rate >= 0 && button->priv->cpu_uncore_rate >= 0)
+    return g_strdup_printf (_("CPU power: %.1f W (cores %.1f W, uncore %.1f W)"),
+                            button->priv->cpu_rate,
+                            button->priv->cpu_core_rate,
+                            button->priv->cpu_uncore_rate);
+
+  if (button->priv->cpu_core_rate >= 0)
+    return g_strdup_printf (_("CPU power: %.1f W (cores %.1f W)"),
+                            button->priv->cpu_rate,
+                            button->priv->cpu_core_rate);
+
+  return g_strdup_printf (_("CPU power: %.1f W"), button->priv->cpu_rate);
+}
+
 static void
 power_manager_button_set_tooltip (PowerManagerButton *button)
 {
   BatteryDevice *display_device = get_display_device (button);
+  const gchar *details;
+  gchar *cpu_power;
+  gchar *text;
 
   TRACE("entering");
 
@@ -266,28 +378,35 @@ power_manager_button_set_tooltip (PowerManagerButton *button)
     return;
   }
 
-  if (button->priv->tooltip != NULL)
-  {
-    g_free (button->priv->tooltip);
-    button->priv->tooltip = NULL;
-  }
+  /* Odds are this is a desktop without any batteries attached */
+  if (display_device && display_device->details)
+    details = display_device->details;
+  else
+    details = _("Display battery levels for attached devices");
 
-  if (display_device)
+  cpu_power = get_cpu_power_text (button);
+  if (cpu_power != NULL)
+    text = g_strconcat (details, "\n", cpu_power, NULL);
+  else
+    text = g_strdup (details);
+  g_free (cpu_power);
+
+  /* Nothing to do if the text didn't change */
+  if (g_strcmp0 (button->priv->tooltip, text) == 0)
   {
-    /* if we have something, display it */
-    if( display_device->details )
-    {
-      button->priv->tooltip = g_strdup(display_device->details);
-      gtk_widget_set_tooltip_markup (GTK_WIDGET (button), display_device->details);
-      /* Tooltip changed! */
-      g_signal_emit (button, __signals[SIG_TOOLTIP_CHANGED], 0);
-      return;
-    }
+    g_free (text);
+    return;
   }
 
-  /* Odds are this is a desktop without any batteries attached */
-  button->priv->tooltip = g_strdup (_("Display battery levels for attached devices"));
-  gtk_widget_set_tooltip_text (GTK_WIDGET (button), button->priv->tooltip);
+  g_free (button->priv->tooltip);
+  button->priv->tooltip = text;
+
+  /* the device details are markup */
+  if (display_device && display_device->details)
+    gtk_widget_set_tooltip_markup (GTK_WIDGET (button), button->priv->tooltip);
+  else
+    gtk_widget_set_tooltip_text (GTK_WIDGET (button), button->priv->tooltip);
+
   /* Tooltip changed! */
   g_signal_emit (button, __signals[SIG_TOOLTIP_CHANGED], 0);
 }
@@ -340,140 +459,254 @@ power_manager_button_set_label (PowerManagerButton *button, gdouble percentage,
   else if (button->priv->show_panel_label == 3)
     label_string = g_strdup_printf ("(%s, %d%%)", remaining_time, (int) percentage);
 
-  gtk_label_set_text (GTK_LABEL (button->priv->panel_label), label_string);
+  /* Avoid a relayout if the text is the same */
+  if (g_strcmp0 (gtk_label_get_text (GTK_LABEL (button->priv->panel_label)),
+                 label_string != NULL ? label_string : "") != 0)
+    gtk_label_set_text (GTK_LABEL (button->priv->panel_label), label_string);
 
   g_free (label_string);
   g_free (remaining_time);
 }
 
-static gboolean
-power_manager_button_device_icon_draw (GtkWidget *img, cairo_t *cr, gpointer userdata)
+/*
+ * Device icons with their charge overlay, rendered once and shared by
+ * all the buttons in this process. An entry is keyed by icon name, size,
+ * scale factor and charge bucket, so redrawing a device whose icon and
+ * charge bucket didn't change costs nothing. The cache is emptied when
+ * the icon theme or a scale factor changes.
+ */
+static GHashTable *icon_cache = NULL;
+
+static void
+icon_cache_clear (void)
 {
-  UpDevice *device = NULL;
-  guint type = 0, state = 0;
-  gdouble percentage;
-  gint height, width;
-  gdouble min_height = 2;
-  PangoLayout *layout = NULL;
-  PangoRectangle ink_extent, log_extent;
-  GtkAllocation allocation;
+  if (icon_cache != NULL)
+    g_hash_table_remove_all (icon_cache);
+}
 
-  TRACE("entering");
+static void
+icon_cache_theme_changed_cb (GtkIconTheme *icon_theme, gpointer user_data)
+{
+  DBG("icon theme changed, emptying the icon cache");
+  icon_cache_clear ();
+}
 
-  /* sanity checks */
-  if (!img || !GTK_IS_WIDGET (img))
-    return FALSE;
+static void
+icon_cache_init (void)
+{
+  if (icon_cache != NULL)
+    return;
 
-  if (UP_IS_DEVICE (userdata))
-  {
-    device = UP_DEVICE(userdata);
+  icon_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                      g_free, (GDestroyNotify) cairo_surface_destroy);
 
-    g_object_get (device,
-                  "kind", &type,
-                  "state", &state,
-                  "percentage", &percentage,
-                  NULL);
+  /* Connected before any button does, so buttons re-render from an empty cache */
+  g_signal_connect (gtk_icon_theme_get_default (), "changed",
+                    G_CALLBACK (icon_cache_theme_changed_cb), NULL);
+}
 
-    /* Don't draw the progressbar for Battery */
-    if (type == UP_DEVICE_KIND_BATTERY)
-      return FALSE;
-  }
+static void
+icon_cache_draw_charge (cairo_t *cr, gint size, gint bucket)
+{
+  gdouble percentage = bucket * CHARGE_BUCKET_SIZE;
+  gdouble min_height = 2;
+
+  /* Draw the trough of the progressbar */
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_line_width (cr, 1.0);
+  cairo_rectangle (cr, size - 3.5, 1.5, 5, size - 2);
+  cairo_set_source_rgb (cr, 0.87, 0.87, 0.87);
+  cairo_fill_preserve (cr);
+  cairo_set_source_rgb (cr, 0.53, 0.54, 0.52);
+  cairo_stroke (cr);
+
+  /* Draw the fill of the progressbar
+     Use red below 5%, yellow below 20%, green for 100% and blue for the rest.
+     The colours change on bucket edges, the percentage is only the bucket's lower end */
+  cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+
+  if ((size * (percentage / 100)) > min_height)
+     min_height = (size - 3) * (percentage / 100);
+
+  cairo_rectangle (cr, size - 3, size - min_height - 1, 4, min_height);
+  if (bucket < 5 / CHARGE_BUCKET_SIZE)
+      cairo_set_source_rgb (cr, 0.94, 0.16, 0.16);
+  else if (bucket < 20 / CHARGE_BUCKET_SIZE)
+      cairo_set_source_rgb (cr, 0.93, 0.83, 0.0);
+  else if (bucket < 100 / CHARGE_BUCKET_SIZE)
+      cairo_set_source_rgb (cr, 0.2, 0.4, 0.64);
   else
+      cairo_set_source_rgb (cr, 0.45, 0.82, 0.08);
+  cairo_fill (cr);
+
+  cairo_rectangle (cr, size - 2.5, 2.5, 3, size - 4);
+  cairo_set_source_rgba (cr, 1.0, 1.0, 1.0, 0.75);
+  cairo_stroke (cr);
+}
+
+static void
+icon_cache_draw_unknown (cairo_t *cr, gint size)
+{
+  PangoLayout *layout;
+  PangoFontDescription *font_desc;
+  PangoRectangle ink_extent, log_extent;
+
+  /* Draw a bubble with a question mark for devices with unknown state */
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_line_width (cr, 1.0);
+  cairo_arc(cr, size - 4.5, 6.5, 6, 0, 2*3.14159);
+  cairo_set_source_rgb (cr, 0.2, 0.54, 0.9);
+  cairo_fill_preserve (cr);
+  cairo_set_source_rgb (cr, 0.1, 0.37, 0.6);
+  cairo_stroke (cr);
+
+  layout = pango_cairo_create_layout (cr);
+  pango_layout_set_text (layout, "?", -1);
+  font_desc = pango_font_description_from_string ("Sans Bold 9");
+  pango_layout_set_font_description (layout, font_desc);
+  pango_font_description_free (font_desc);
+  pango_layout_get_pixel_extents (layout, &ink_extent, &log_extent);
+  cairo_move_to (cr, (size - 5.5) - (log_extent.width / 2), 5.5 - (log_extent.height / 2));
+  cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+  cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+  pango_cairo_show_layout (cr, layout);
+
+  g_object_unref (layout);
+}
+
+static cairo_surface_t *
+icon_cache_render (const gchar *icon_name, gint size, gint scale, gint bucket)
+{
+  GdkPixbuf *pix;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = gdk_window_create_similar_image_surface (NULL, CAIRO_FORMAT_ARGB32,
+                                                     size * scale, size * scale, scale);
+  cr = cairo_create (surface);
+
+  pix = gtk_icon_theme_load_icon_for_scale (gtk_icon_theme_get_default (),
+                                            icon_name,
+                                            size,
+                                            scale,
+                                            GTK_ICON_LOOKUP_USE_BUILTIN | GTK_ICON_LOOKUP_FORCE_SIZE,
+                                            NULL);
+  if (pix != NULL)
   {
-    /* If the UpDevice hasn't fully updated yet it then we'll want
-     * a question mark for sure. */
-    state = UP_DEVICE_STATE_UNKNOWN;
+    cairo_save (cr);
+    cairo_scale (cr, 1.0 / scale, 1.0 / scale);
+    gdk_cairo_set_source_pixbuf (cr, pix, 0, 0);
+    cairo_paint (cr);
+    cairo_restore (cr);
+    g_object_unref (pix);
   }
 
-  gtk_widget_get_allocation (img, &allocation);
+  if (bucket == CHARGE_BUCKET_UNKNOWN)
+    icon_cache_draw_unknown (cr, size);
+  else if (bucket != CHARGE_BUCKET_NONE)
+    icon_cache_draw_charge (cr, size, bucket);
 
-  width = allocation.width;
-  height = allocation.height;
+  cairo_destroy (cr);
 
-  if (state != UP_DEVICE_STATE_UNKNOWN)
-  {
-    /* Draw the trough of the progressbar */
-    cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
-    cairo_set_line_width (cr, 1.0);
-    cairo_rectangle (cr, width - 3.5, allocation.y + 1.5, 5, height - 2);
-    cairo_set_source_rgb (cr, 0.87, 0.87, 0.87);
-    cairo_fill_preserve (cr);
-    cairo_set_source_rgb (cr, 0.53, 0.54, 0.52);
-    cairo_stroke (cr);
+  return surface;
+}
 
-    /* Draw the fill of the progressbar
-       Use yellow for 20% and below, green for 100%, red for 5% and below and blue for the rest */
-    cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+/* Returns a new reference to the cached surface */
+static cairo_surface_t *
+icon_cache_lookup (const gchar *icon_name, gint size, gint scale, gint bucket)
+{
+  cairo_surface_t *surface;
+  gchar *key;
 
-    if ((height * (percentage / 100)) > min_height)
-       min_height = (height - 3) * (percentage / 100);
+  icon_cache_init ();
 
-    cairo_rectangle (cr, width - 3, allocation.y + height - min_height - 1, 4, min_height);
-    if (percentage > 5 && percentage < 20)
-        cairo_set_source_rgb (cr, 0.93, 0.83, 0.0);
-    else if (percentage > 20 && percentage < 100)
-        cairo_set_source_rgb (cr, 0.2, 0.4, 0.64);
-    else if (percentage == 100)
-        cairo_set_source_rgb (cr, 0.45, 0.82, 0.08);
-    else
-        cairo_set_source_rgb (cr, 0.94, 0.16, 0.16);
-    cairo_fill (cr);
+  key = g_strdup_printf ("%s:%d:%d:%d", icon_name, size, scale, bucket);
+  surface = g_hash_table_lookup (icon_cache, key);
 
-    cairo_rectangle (cr, width - 2.5, allocation.y + 2.5, 3, height - 4);
-    cairo_set_source_rgba (cr, 1.0, 1.0, 1.0, 0.75);
-    cairo_stroke (cr);
+  if (surface == NULL)
+  {
+    if (g_hash_table_size (icon_cache) >= ICON_CACHE_MAX_ENTRIES)
+      icon_cache_clear ();
+
+    surface = icon_cache_render (icon_name, size, scale, bucket);
+    g_hash_table_insert (icon_cache, key, surface);
   }
   else
   {
-    /* Draw a bubble with a question mark for devices with unknown state */
-    cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
-    cairo_set_line_width (cr, 1.0);
-    cairo_arc(cr, width - 4.5, allocation.y + 6.5, 6, 0, 2*3.14159);
-    cairo_set_source_rgb (cr, 0.2, 0.54, 0.9);
-    cairo_fill_preserve (cr);
-    cairo_set_source_rgb (cr, 0.1, 0.37, 0.6);
-    cairo_stroke (cr);
-
-    layout = gtk_widget_create_pango_layout (GTK_WIDGET (img), "?");
-    pango_layout_set_font_description (layout, pango_font_description_from_string ("Sans Bold 9"));
-    pango_layout_get_pixel_extents (layout, &ink_extent, &log_extent);
-    cairo_move_to (cr, (width - 5.5) - (log_extent.width / 2), (allocation.y + 5.5) - (log_extent.height / 2));
-    cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
-    pango_cairo_show_layout (cr, layout);
+    g_free (key);
   }
 
-  if (layout)
-    g_object_unref (layout);
+  return cairo_surface_reference (surface);
+}
 
-  return FALSE;
+/* Which charge overlay to draw on top of the device icon */
+static gint
+get_device_charge_bucket (UpDevice *device)
+{
+  guint type = 0, state = 0;
+  gdouble percentage = 0;
+
+  /* If the UpDevice hasn't fully updated yet it then we'll want
+   * a question mark for sure. */
+  if (!UP_IS_DEVICE (device))
+    return CHARGE_BUCKET_UNKNOWN;
+
+  g_object_get (device,
+                "kind", &type,
+                "state", &state,
+                "percentage", &percentage,
+                NULL);
+
+  /* Don't draw the progressbar for Battery */
+  if (type == UP_DEVICE_KIND_BATTERY)
+    return CHARGE_BUCKET_NONE;
+
+  if (state == UP_DEVICE_STATE_UNKNOWN)
+    return CHARGE_BUCKET_UNKNOWN;
+
+  return CLAMP ((gint) (percentage / CHARGE_BUCKET_SIZE), 0, 100 / CHARGE_BUCKET_SIZE);
+}
+
+static void
+battery_device_set_icon (BatteryDevice *battery_device, const gchar *icon_name, gint bucket, gint scale)
+{
+  g_free (battery_device->icon_name);
+  battery_device->icon_name = g_strdup (icon_name);
+  battery_device->charge_bucket = bucket;
+  battery_device->scale = scale;
+
+  if (battery_device->surface != NULL)
+    cairo_surface_destroy (battery_device->surface);
+
+  battery_device->surface = icon_cache_lookup (icon_name, DEVICE_ICON_SIZE, scale, bucket);
+
+  /* The menu image, if shown, just gets the new surface */
+  if (battery_device->img != NULL)
+    gtk_image_set_from_surface (GTK_IMAGE (battery_device->img), battery_device->surface);
 }
 
 
 static void
-power_manager_button_update_device_icon_and_details (PowerManagerButton *button, UpDevice *device)
+power_manager_button_update_device_icon_and_details (PowerManagerButton *button, BatteryDevice *battery_device)
 {
-  GList          *item;
-  BatteryDevice  *battery_device;
+  UpDevice       *device = battery_device->device;
   BatteryDevice  *display_device;
-  const gchar    *object_path = up_device_get_object_path(device);
   gchar          *details;
   gchar          *icon_name;
-  GdkPixbuf      *pix = NULL;
-
-  XFPM_DEBUG("entering for %s", object_path);
-
-  if (!POWER_MANAGER_IS_BUTTON (button))
-    return;
+  gint            bucket;
+  gint            scale;
 
-  item = find_device_in_list (button, object_path);
+  XFPM_DEBUG("entering for %s", battery_device->object_path);
 
-  if (item == NULL)
+  if (!POWER_MANAGER_IS_BUTTON (button) || !UP_IS_DEVICE (device))
     return;
 
-  battery_device = item->data;
-
-  icon_name = get_device_icon_name (button->priv->upower, device);
-  details = get_device_description (button->priv->upower, device);
+  icon_name = get_device_icon_name_full (device,
+                                         button->priv->lid_is_present,
+                                         button->priv->on_battery);
+  details = get_device_description_full (device,
+                                         g_strcmp0 (battery_device->object_path,
+                                                    button->priv->display_device_path) == 0);
 
   /* If UPower doesn't give us an icon, just use the default */
   if (g_strcmp0(icon_name, "") == 0)
@@ -486,35 +719,46 @@ power_manager_button_update_device_icon_and_details (PowerManagerButton *button,
   if (icon_name == NULL)
     icon_name = g_strdup (PANEL_DEFAULT_ICON);
 
-  pix = gtk_icon_theme_load_icon (gtk_icon_theme_get_default (),
-                                  icon_name,
-                                  32,
-                                  GTK_ICON_LOOKUP_USE_BUILTIN,
-                                  NULL);
-
   if (battery_device->details)
     g_free (battery_device->details);
 
   battery_device->details = details;
 
-  /* If we had an image before, remove it and the callback */
-  battery_device_remove_pix(battery_device);
+  /* Only render again if what the icon shows changed */
+  bucket = get_device_charge_bucket (device);
+  scale = gtk_widget_get_scale_factor (GTK_WIDGET (button));
 
-  battery_device->pix = pix;
+  if (battery_device->surface == NULL
+      || bucket != battery_device->charge_bucket
+      || scale != battery_device->scale
+      || g_strcmp0 (icon_name, battery_device->icon_name) != 0)
+  {
+    battery_device_set_icon (battery_device, icon_name, bucket, scale);
+  }
 
   /* Get the display device, which may now be this one */
   display_device = get_display_device (button);
   if (battery_device == display_device)
   {
+    gchar *panel_icon_name;
+
     DBG("this is the display device, updating");
-    /* update the icon */
-    g_free (button->priv->panel_icon_name);
+    /* update the icon if it changed */
 #ifdef XFCE_PLUGIN
-    button->priv->panel_icon_name = g_strdup_printf ("%s-%s", icon_name, "symbolic");
+    panel_icon_name = g_strdup_printf ("%s-%s", icon_name, "symbolic");
 #else
-    button->priv->panel_icon_name = g_strdup (icon_name);
+    panel_icon_name = g_strdup (icon_name);
 #endif
-    power_manager_button_set_icon (button);
+    if (g_strcmp0 (panel_icon_name, button->priv->panel_icon_name) != 0)
+    {
+      g_free (button->priv->panel_icon_name);
+      button->priv->panel_icon_name = panel_icon_name;
+      power_manager_button_set_icon (button);
+    }
+    else
+    {
+      g_free (panel_icon_name);
+    }
     /* update the tooltip */
     power_manager_button_set_tooltip (button);
     /* update the label */
@@ -524,35 +768,175 @@ power_manager_button_update_device_icon_and_details (PowerManagerButton *button,
 
   /* If the menu is being displayed, update it */
   if (button->priv->menu && battery_device->menu_item)
-  {
     gtk_menu_item_set_label (GTK_MENU_ITEM (battery_device->menu_item), details);
+}
 
-    /* update the image, keep track of the signal ids and the img
-     * so we can disconnect it later */
-    battery_device->img = gtk_image_new_from_pixbuf (battery_device->pix);
+static void
+get_device_digest (UpDevice *device, DeviceDigest *digest)
+{
+  gdouble percentage = 0;
+  guint64 time_to_empty = 0, time_to_full = 0;
+  gchar *icon_name = NULL, *vendor = NULL, *model = NULL;
 
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-    gtk_image_menu_item_set_image(GTK_IMAGE_MENU_ITEM(battery_device->menu_item), battery_device->img);
-G_GNUC_END_IGNORE_DEPRECATIONS
-    battery_device->expose_signal_id = g_signal_connect_after (G_OBJECT (battery_device->img),
-                                                               "draw",
-                                                               G_CALLBACK (power_manager_button_device_icon_draw),
-                                                               device);
+  /* zeroed padding, digests are compared with memcmp */
+  memset (digest, 0, sizeof (DeviceDigest));
+
+  g_object_get (device,
+                "kind", &digest->type,
+                "state", &digest->state,
+                "is-present", &digest->present,
+                "online", &digest->online,
+                "percentage", &percentage,
+                "time-to-empty", &time_to_empty,
+                "time-to-full", &time_to_full,
+                "icon-name", &icon_name,
+                "vendor", &vendor,
+                "model", &model,
+                NULL);
+
+  /* Same rounding as the label and the description */
+  digest->half_percent = (gint) (percentage * 2);
+  digest->minutes_to_empty = (guint) ((time_to_empty / 60.0) + 0.5);
+  digest->minutes_to_full = (guint) ((time_to_full / 60.0) + 0.5);
+
+  digest->strings_hash = g_str_hash (icon_name != NULL ? icon_name : "");
+  digest->strings_hash = digest->strings_hash * 31 + g_str_hash (vendor != NULL ? vendor : "");
+  digest->strings_hash = digest->strings_hash * 31 + g_str_hash (model != NULL ? model : "");
+
+  g_free (icon_name);
+  g_free (vendor);
+  g_free (model);
+}
+
+/* Refreshes everything shown for the device, unless its digest says
+ * nothing visible changed since the last time */
+static void
+power_manager_button_refresh_device (PowerManagerButton *button, BatteryDevice *battery_device)
+{
+  DeviceDigest digest;
+
+  battery_device->dirty = FALSE;
+
+  if (!UP_IS_DEVICE (battery_device->device))
+    return;
+
+  get_device_digest (battery_device->device, &digest);
+
+  if (memcmp (&digest, &battery_device->digest, sizeof (DeviceDigest)) == 0)
+    return;
+
+  battery_device->digest = digest;
+  power_manager_button_update_device_icon_and_details (button, battery_device);
+}
+
+static void
+power_manager_button_refresh_dirty_devices (PowerManagerButton *button)
+{
+  GList *item;
+
+  for (item = g_list_first (button->priv->devices); item != NULL; item = g_list_next (item))
+  {
+    BatteryDevice *battery_device = item->data;
+
+    if (battery_device->dirty)
+      power_manager_button_refresh_device (button, battery_device);
   }
 }
 
+static gboolean
+power_manager_button_refresh_tick_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data)
+{
+  PowerManagerButton *button = POWER_MANAGER_BUTTON (widget);
+
+  button->priv->refresh_tick_id = 0;
+  power_manager_button_refresh_dirty_devices (button);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+power_manager_button_refresh_idle_cb (gpointer user_data)
+{
+  PowerManagerButton *button = POWER_MANAGER_BUTTON (user_data);
+
+  button->priv->refresh_idle_id = 0;
+  power_manager_button_refresh_dirty_devices (button);
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
-device_changed_cb (UpDevice *device, GParamSpec *pspec, PowerManagerButton *button)
+power_manager_button_queue_refresh (PowerManagerButton *button)
 {
-    power_manager_button_update_device_icon_and_details (button, device);
+  if (button->priv->refresh_tick_id != 0 || button->priv->refresh_idle_id != 0)
+    return;
+
+  /* UPower sends a notify per property, apply them all at the next frame */
+  if (gtk_widget_get_mapped (GTK_WIDGET (button)))
+    button->priv->refresh_tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (button),
+                                                                  power_manager_button_refresh_tick_cb,
+                                                                  NULL, NULL);
+  else
+    button->priv->refresh_idle_id = g_idle_add (power_manager_button_refresh_idle_cb, button);
 }
 
 static void
-power_manager_button_add_device (UpDevice *device, PowerManagerButton *button)
+power_manager_button_unmap (GtkWidget *widget)
+{
+  PowerManagerButton *button = POWER_MANAGER_BUTTON (widget);
+
+  GTK_WIDGET_CLASS (power_manager_button_parent_class)->unmap (widget);
+
+  /* The frame clock stops with the widget, a pending tick would never
+   * run and hold back every later refresh, finish it from an idle */
+  if (button->priv->refresh_tick_id != 0)
+  {
+    gtk_widget_remove_tick_callback (widget, button->priv->refresh_tick_id);
+    button->priv->refresh_tick_id = 0;
+    power_manager_button_queue_refresh (button);
+  }
+}
+
+static void
+device_changed_cb (UpDevice *device, GParamSpec *pspec, BatteryDevice *battery_device)
+{
+  battery_device->dirty = TRUE;
+  power_manager_button_queue_refresh (battery_device->button);
+}
+
+/* Render all the device icons again, after the cache was emptied */
+static void
+power_manager_button_reload_device_icons (PowerManagerButton *button)
+{
+  GList *item;
+
+  for (item = g_list_first (button->priv->devices); item != NULL; item = g_list_next (item))
+  {
+    BatteryDevice *battery_device = item->data;
+
+    battery_device_clear_icon (battery_device);
+    power_manager_button_update_device_icon_and_details (button, battery_device);
+  }
+}
+
+static void
+icon_theme_changed_cb (GtkIconTheme *icon_theme, PowerManagerButton *button)
+{
+  power_manager_button_reload_device_icons (button);
+}
+
+static void
+scale_factor_changed_cb (PowerManagerButton *button, GParamSpec *pspec, gpointer user_data)
+{
+  icon_cache_clear ();
+  power_manager_button_reload_device_icons (button);
+}
+
+static void
+power_manager_button_add_device (PowerManagerButton *button, const gchar *object_path, UpDevice *device)
 {
   BatteryDevice *battery_device;
   guint type = 0;
-  const gchar *object_path = up_device_get_object_path(device);
   gulong signal_id;
 
   XFPM_DEBUG("entering for %s", object_path);
@@ -570,52 +954,54 @@ power_manager_button_add_device (UpDevice *device, PowerManagerButton *button)
                 "kind", &type,
                 NULL);
 
-  signal_id = g_signal_connect (device, "notify", G_CALLBACK (device_changed_cb), button);
+  signal_id = g_signal_connect (device, "notify", G_CALLBACK (device_changed_cb), battery_device);
 
   /* populate the struct */
+  battery_device->button = button;
   battery_device->object_path = g_strdup (object_path);
   battery_device->changed_signal_id = signal_id;
   battery_device->device = g_object_ref(device);
 
-  /* add it to the list */
+  /* add it to the list and the index */
   button->priv->devices = g_list_append (button->priv->devices, battery_device);
+  g_hash_table_insert (button->priv->device_index,
+                       battery_device->object_path,
+                       g_list_last (button->priv->devices));
+
+  /* It may be the display device the daemon told us about */
+  power_manager_button_update_display_device (button);
 
   /* Add the icon and description for the device */
-  power_manager_button_update_device_icon_and_details (button, device);
+  get_device_digest (device, &battery_device->digest);
+  power_manager_button_update_device_icon_and_details (button, battery_device);
 
-  /* If the menu is being shown, add this new device to it */
+  /* If the menu was already built, add this new device to it */
   if (button->priv->menu)
   {
     power_manager_button_menu_add_device (button, battery_device, FALSE);
+    power_manager_button_menu_update_separators (button);
   }
 }
 
-/* This function unrefs the pix and img from the battery device and
- * disconnects the expose-event callback on the img.
+/* This function drops the icon of the battery device, the menu
+ * image is owned by the menu item.
  */
 static void
-battery_device_remove_pix (BatteryDevice *battery_device)
+battery_device_clear_icon (BatteryDevice *battery_device)
 {
   TRACE("entering");
 
   if (battery_device == NULL)
     return;
 
-  if (G_IS_OBJECT (battery_device->pix))
+  if (battery_device->surface != NULL)
   {
-    if (GTK_IS_WIDGET (battery_device->img))
-    {
-      if (battery_device->expose_signal_id != 0)
-      {
-          g_signal_handler_disconnect (battery_device->img, battery_device->expose_signal_id);
-          battery_device->expose_signal_id = 0;
-      }
-      g_object_unref (battery_device->img);
-      battery_device->img = NULL;
-    }
-    g_object_unref (battery_device->pix);
-    battery_device->pix = NULL;
+    cairo_surface_destroy (battery_device->surface);
+    battery_device->surface = NULL;
   }
+
+  g_free (battery_device->icon_name);
+  battery_device->icon_name = NULL;
 }
 
 static void
@@ -624,14 +1010,19 @@ remove_battery_device (PowerManagerButton *button, BatteryDevice *battery_device
   g_return_if_fail (POWER_MANAGER_IS_BUTTON (button));
   g_return_if_fail (battery_device != NULL);
 
-  /* If it is being shown in the menu, remove it */
+  /* If it is in the menu, remove it */
   if (battery_device->menu_item && button->priv->menu)
+  {
     gtk_container_remove (GTK_CONTAINER (button->priv->menu), battery_device->menu_item);
+    battery_device->menu_item = NULL;
+    battery_device->img = NULL;
+    power_manager_button_menu_update_separators (button);
+  }
 
   g_free (battery_device->details);
   g_free (battery_device->object_path);
 
-  battery_device_remove_pix (battery_device);
+  battery_device_clear_icon (battery_device);
 
   if (battery_device->device != NULL && UP_IS_DEVICE(battery_device->device))
   {
@@ -647,6 +1038,26 @@ remove_battery_device (PowerManagerButton *button, BatteryDevice *battery_device
   g_free (battery_device);
 }
 
+/* Takes the published rates, or NULL when the pseudo device is gone */
+static void
+power_manager_button_set_cpu_power (PowerManagerButton *button, GVariant *props)
+{
+  if (props == NULL)
+  {
+    button->priv->cpu_rate = -1;
+    button->priv->cpu_core_rate = -1;
+    button->priv->cpu_uncore_rate = -1;
+  }
+  else
+  {
+    g_variant_lookup (props, XFPM_RAPL_ENERGY_RATE, "d", &button->priv->cpu_rate);
+    g_variant_lookup (props, XFPM_RAPL_CORE_ENERGY_RATE, "d", &button->priv->cpu_core_rate);
+    g_variant_lookup (props, XFPM_RAPL_UNCORE_ENERGY_RATE, "d", &button->priv->cpu_uncore_rate);
+  }
+
+  power_manager_button_set_tooltip (button);
+}
+
 static void
 power_manager_button_remove_device (PowerManagerButton *button, const gchar *object_path)
 {
@@ -655,6 +1066,12 @@ power_manager_button_remove_device (PowerManagerButton *button, const gchar *obj
 
   TRACE("entering for %s", object_path);
 
+  if (g_strcmp0 (object_path, XFPM_STATE_RAPL_DEVICE) == 0)
+  {
+    power_manager_button_set_cpu_power (button, NULL);
+    return;
+  }
+
   item = find_device_in_list (button, object_path);
 
   if (item == NULL)
@@ -662,124 +1079,567 @@ power_manager_button_remove_device (PowerManagerButton *button, const gchar *obj
 
   battery_device = item->data;
 
-  /* Remove its resources */
+  /* unlink it first, the key belongs to the battery device */
+  g_hash_table_remove (button->priv->device_index, object_path);
+  button->priv->devices = g_list_delete_link (button->priv->devices, item);
+
+  /* Remove its resources and free the battery device */
   remove_battery_device (button, battery_device);
 
-  /* remove it item and free the battery device */
-  button->priv->devices = g_list_delete_link (button->priv->devices, item);
+  power_manager_button_update_display_device (button);
+}
+
+static void
+power_manager_button_remove_all_devices (PowerManagerButton *button)
+{
+  TRACE("entering");
+
+  g_return_if_fail (POWER_MANAGER_IS_BUTTON (button));
+
+  while (button->priv->devices != NULL)
+  {
+    BatteryDevice *battery_device = button->priv->devices->data;
+
+    /* Unlinked first, the menu separators look at the remaining ones */
+    g_hash_table_remove (button->priv->device_index, battery_device->object_path);
+    button->priv->devices = g_list_delete_link (button->priv->devices, button->priv->devices);
+    remove_battery_device (button, battery_device);
+  }
+
+  power_manager_button_update_display_device (button);
+}
+
+/* Copies the published properties onto our UpDevice, which keeps them
+ * as offline properties and notifies as if UPower had changed them */
+static void
+device_set_props (UpDevice *device, GVariant *props)
+{
+  GVariantIter iter;
+  const gchar *name;
+  GVariant *value;
+
+  g_object_freeze_notify (G_OBJECT (device));
+
+  g_variant_iter_init (&iter, props);
+  while (g_variant_iter_next (&iter, "{&sv}", &name, &value))
+  {
+    GValue gvalue = G_VALUE_INIT;
+
+    if (g_object_class_find_property (G_OBJECT_GET_CLASS (device), name) != NULL)
+    {
+      g_dbus_gvariant_to_gvalue (value, &gvalue);
+      g_object_set_property (G_OBJECT (device), name, &gvalue);
+      g_value_unset (&gvalue);
+    }
+
+    g_variant_unref (value);
+  }
+
+  g_object_thaw_notify (G_OBJECT (device));
+}
+
+static void
+power_manager_button_update_device (PowerManagerButton *button, const gchar *object_path, GVariant *props)
+{
+  GList *item;
+  UpDevice *device;
+
+  /* Not a battery, only shown in the tooltip */
+  if (g_strcmp0 (object_path, XFPM_STATE_RAPL_DEVICE) == 0)
+  {
+    power_manager_button_set_cpu_power (button, props);
+    return;
+  }
+
+  item = find_device_in_list (button, object_path);
+
+  if (item != NULL)
+  {
+    /* device_changed_cb takes it from here */
+    device_set_props (((BatteryDevice *) item->data)->device, props);
+    return;
+  }
+
+  device = g_object_new (UP_TYPE_DEVICE, NULL);
+  device_set_props (device, props);
+  power_manager_button_add_device (button, object_path, device);
+  g_object_unref (device);
+}
+
+static void
+power_manager_button_set_brightness (PowerManagerButton *button, gint32 level, gint32 max_level)
+{
+  gboolean had_hw = button->priv->brightness_max > 0;
+
+  button->priv->brightness_level = level;
+
+  if (max_level != button->priv->brightness_max)
+  {
+    button->priv->brightness_max = max_level;
+    set_brightness_min_level (button, button->priv->brightness_min_level_setting);
+
+    /* The slider comes and goes with the backlight, build the menu again */
+    if (had_hw != (max_level > 0) && button->priv->menu != NULL)
+      gtk_widget_destroy (button->priv->menu);
+  }
+
+  /* Don't fight the user while the slider is being moved */
+  if (button->priv->range != NULL && button->priv->set_level_timeout == 0)
+    gtk_range_set_value (GTK_RANGE (button->priv->range), level);
+}
+
+/* Applies a snapshot, or a delta on top of what we have */
+static void
+power_manager_button_apply_state (PowerManagerButton *button, GVariant *state, gboolean snapshot)
+{
+  GVariant *devices = NULL;
+  GVariant *removed = NULL;
+  const gchar **inhibitors;
+  const gchar *object_path;
+  gboolean refresh_all = FALSE;
+  gboolean has_level, has_max_level;
+  gboolean b;
+  gint32 level, max_level;
+
+  if (g_variant_lookup (state, XFPM_STATE_ON_BATTERY, "b", &b) && b != button->priv->on_battery)
+  {
+    button->priv->on_battery = b;
+    refresh_all = TRUE;
+  }
+
+  if (g_variant_lookup (state, XFPM_STATE_LID_IS_PRESENT, "b", &b) && b != button->priv->lid_is_present)
+  {
+    button->priv->lid_is_present = b;
+    refresh_all = TRUE;
+  }
+
+  /* Before the devices, so a new display device is recognized when added */
+  if (g_variant_lookup (state, XFPM_STATE_DISPLAY_DEVICE, "&o", &object_path)
+      && g_strcmp0 (object_path, button->priv->display_device_path) != 0)
+  {
+    g_free (button->priv->display_device_path);
+    button->priv->display_device_path = g_strdup (object_path);
+
+    power_manager_button_update_display_device (button);
+    refresh_all = TRUE;
+  }
+
+  g_variant_lookup (state, XFPM_STATE_DEVICES, "@a{oa{sv}}", &devices);
+
+  if (g_variant_lookup (state, XFPM_STATE_REMOVED_DEVICES, "@ao", &removed))
+  {
+    GVariantIter iter;
+
+    g_variant_iter_init (&iter, removed);
+    while (g_variant_iter_next (&iter, "&o", &object_path))
+      power_manager_button_remove_device (button, object_path);
+
+    g_variant_unref (removed);
+  }
+
+  /* A snapshot lists every device, drop the ones that went away */
+  if (snapshot)
+  {
+    GList *item, *next;
+
+    for (item = button->priv->devices; item != NULL; item = next)
+    {
+      BatteryDevice *battery_device = item->data;
+      GVariant *props = NULL;
+
+      next = item->next;
+
+      if (devices != NULL)
+        props = g_variant_lookup_value (devices, battery_device->object_path, G_VARIANT_TYPE_VARDICT);
+
+      if (props != NULL)
+        g_variant_unref (props);
+      else
+        power_manager_button_remove_device (button, battery_device->object_path);
+    }
+
+    if (button->priv->cpu_rate >= 0)
+    {
+      GVariant *props = NULL;
+
+      if (devices != NULL)
+        props = g_variant_lookup_value (devices, XFPM_STATE_RAPL_DEVICE, G_VARIANT_TYPE_VARDICT);
+
+      if (props != NULL)
+        g_variant_unref (props);
+      else
+        power_manager_button_set_cpu_power (button, NULL);
+    }
+  }
+
+  if (devices != NULL)
+  {
+    GVariantIter iter;
+    GVariant *props;
+
+    g_variant_iter_init (&iter, devices);
+    while (g_variant_iter_next (&iter, "{&o@a{sv}}", &object_path, &props))
+    {
+      power_manager_button_update_device (button, object_path, props);
+      g_variant_unref (props);
+    }
+
+    g_variant_unref (devices);
+  }
+
+  level = button->priv->brightness_level;
+  max_level = button->priv->brightness_max;
+  has_level = g_variant_lookup (state, XFPM_STATE_BRIGHTNESS, "i", &level);
+  has_max_level = g_variant_lookup (state, XFPM_STATE_BRIGHTNESS_MAX, "i", &max_level);
+  if (has_level || has_max_level)
+    power_manager_button_set_brightness (button, level, max_level);
+
+  if (g_variant_lookup (state, XFPM_STATE_INHIBITORS, "^a&s", &inhibitors))
+  {
+    power_manager_button_set_inhibitors (button, inhibitors);
+    g_free (inhibitors);
+  }
+
+  /* Presentation mode is left to the xfconf binding */
+
+  /* The icons and descriptions depend on the power source and the lid */
+  if (refresh_all)
+  {
+    GList *item;
+
+    for (item = g_list_first (button->priv->devices); item != NULL; item = g_list_next (item))
+      power_manager_button_update_device_icon_and_details (button, item->data);
+  }
+}
+
+#ifdef XFCE_PLUGIN
+static void
+get_state_cb (GObject *source_object,
+              GAsyncResult *res,
+              gpointer user_data)
+{
+  GError *error = NULL;
+  GVariant *reply;
+  PowerManagerButton *button = POWER_MANAGER_BUTTON (user_data);
+
+  reply = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+
+  if (reply != NULL)
+  {
+    GVariant *state;
+    guint32 version;
+    guint64 serial;
+
+    g_variant_get (reply, "(ut@a{sv})", &version, &serial, &state);
+
+    if (version != XFPM_STATE_VERSION)
+    {
+      g_warning ("The power manager daemon publishes state version %u, expected %u",
+                 version, XFPM_STATE_VERSION);
+    }
+    else
+    {
+      power_manager_button_apply_state (button, state, TRUE);
+      button->priv->state_serial = serial;
+      button->priv->state_synced = TRUE;
+    }
+
+    g_variant_unref (state);
+    g_variant_unref (reply);
+  }
+  else
+  {
+    g_warning ("failed calling GetState: %s", error->message);
+    g_clear_error (&error);
+  }
+
+  g_object_unref (button);
 }
 
 static void
-device_added_cb (UpClient *upower, UpDevice *device, PowerManagerButton *button)
+power_manager_button_get_state (PowerManagerButton *button)
 {
-  power_manager_button_add_device (device, button);
+  button->priv->state_synced = FALSE;
+
+  g_dbus_proxy_call (button->priv->manager_proxy,
+                     "GetState",
+                     g_variant_new ("()"),
+                     G_DBUS_CALL_FLAGS_NONE,
+                     -1,
+                     NULL,
+                     get_state_cb,
+                     g_object_ref (button));
 }
 
-static void
-device_removed_cb (UpClient *upower, const gchar *object_path, PowerManagerButton *button)
-{
-  power_manager_button_remove_device (button, object_path);
+static void
+manager_proxy_signal_cb (GDBusProxy *proxy,
+                         const gchar *sender_name,
+                         const gchar *signal_name,
+                         GVariant *parameters,
+                         PowerManagerButton *button)
+{
+  GVariant *changes;
+  guint64 serial;
+
+  if (g_strcmp0 (signal_name, "StateChanged") != 0
+      || !g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(ta{sv})")))
+    return;
+
+  /* The snapshot we are waiting for will include it */
+  if (!button->priv->state_synced)
+    return;
+
+  g_variant_get (parameters, "(t@a{sv})", &serial, &changes);
+
+  if (serial == button->priv->state_serial + 1)
+  {
+    power_manager_button_apply_state (button, changes, FALSE);
+    button->priv->state_serial = serial;
+  }
+  else if (serial > button->priv->state_serial)
+  {
+    XFPM_DEBUG ("Missed state changes (%" G_GUINT64_FORMAT " after %" G_GUINT64_FORMAT "), resyncing",
+                serial, button->priv->state_serial);
+    power_manager_button_get_state (button);
+  }
+
+  g_variant_unref (changes);
+}
+
+static void
+manager_proxy_owner_changed_cb (GDBusProxy *proxy,
+                                GParamSpec *pspec,
+                                PowerManagerButton *button)
+{
+  gchar *owner = g_dbus_proxy_get_name_owner (proxy);
+
+  if (owner != NULL)
+  {
+    power_manager_button_get_state (button);
+  }
+  else
+  {
+    /* Without the daemon there is nothing we can show or control */
+    button->priv->state_synced = FALSE;
+    button->priv->state_serial = 0;
+    power_manager_button_remove_all_devices (button);
+    power_manager_button_set_brightness (button, 0, 0);
+    power_manager_button_set_inhibitors (button, NULL);
+    power_manager_button_set_tooltip (button);
+  }
+
+  g_free (owner);
+}
+
+static void
+manager_proxy_ready_cb (GObject *source_object,
+                        GAsyncResult *res,
+                        gpointer user_data)
+{
+  GError *error = NULL;
+  PowerManagerButton *button = POWER_MANAGER_BUTTON (user_data);
+
+  button->priv->manager_proxy = g_dbus_proxy_new_for_bus_finish (res, &error);
+  if (error != NULL)
+  {
+    g_warning ("error getting the power manager proxy: %s", error->message);
+    g_clear_error (&error);
+  }
+  else
+  {
+    g_signal_connect (button->priv->manager_proxy, "g-signal",
+                      G_CALLBACK (manager_proxy_signal_cb), button);
+    g_signal_connect (button->priv->manager_proxy, "notify::g-name-owner",
+                      G_CALLBACK (manager_proxy_owner_changed_cb), button);
+    manager_proxy_owner_changed_cb (button->priv->manager_proxy, NULL, button);
+  }
+
+  g_object_unref (button);
+}
+#else
+static void
+state_changed_cb (XfpmState *state,
+                  guint64 serial,
+                  GVariant *changes,
+                  PowerManagerButton *button)
+{
+  /* Same process, nothing can get lost on the way */
+  power_manager_button_apply_state (button, changes, FALSE);
+  button->priv->state_serial = serial;
+}
+#endif
+
+/* Mirrors the daemon's state from now on */
+static void
+power_manager_button_connect_state (PowerManagerButton *button)
+{
+#ifdef XFCE_PLUGIN
+  g_dbus_proxy_new_for_bus (G_BUS_TYPE_SESSION,
+                            G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
+                            NULL,
+                            "org.xfce.PowerManager",
+                            "/org/xfce/PowerManager",
+                            "org.xfce.Power.Manager",
+                            NULL,
+                            manager_proxy_ready_cb,
+                            g_object_ref (button));
+#else
+  GVariant *state;
+
+  button->priv->state = xfpm_state_new ();
+  g_signal_connect (button->priv->state, "state-changed",
+                    G_CALLBACK (state_changed_cb), button);
+
+  state = xfpm_state_get_snapshot (button->priv->state, &button->priv->state_serial);
+  power_manager_button_apply_state (button, state, TRUE);
+  button->priv->state_synced = TRUE;
+  g_variant_unref (state);
+#endif
+}
+
+/* Brightness is changed by the daemon, which publishes the new level */
+static void
+power_manager_button_step_brightness (PowerManagerButton *button, gboolean up)
+{
+#ifdef XFCE_PLUGIN
+  if (button->priv->manager_proxy == NULL)
+    return;
+
+  g_dbus_proxy_call (button->priv->manager_proxy,
+                     "StepBrightness",
+                     g_variant_new ("(b)", up),
+                     G_DBUS_CALL_FLAGS_NONE,
+                     -1,
+                     NULL, NULL, NULL);
+#else
+  xfpm_state_step_brightness (button->priv->state, up);
+#endif
 }
 
-
 static void
-power_manager_button_add_all_devices (PowerManagerButton *button)
+request_brightness_cb (GObject *source_object,
+                       GAsyncResult *res,
+                       gpointer user_data)
 {
-  GPtrArray *array = NULL;
-  guint i;
-
-  button->priv->display_device = up_client_get_display_device (button->priv->upower);
-  power_manager_button_add_device (button->priv->display_device, button);
+  PowerManagerButton *button = POWER_MANAGER_BUTTON (user_data);
+  GError *error = NULL;
+#ifdef XFCE_PLUGIN
+  GVariant *reply;
 
-#if UP_CHECK_VERSION(0, 99, 8)
-  array = up_client_get_devices2 (button->priv->upower);
+  reply = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+  if (reply != NULL)
+    g_variant_unref (reply);
 #else
-  array = up_client_get_devices (button->priv->upower);
+  xfpm_state_set_brightness_finish (XFPM_STATE (source_object), res, &error);
 #endif
 
-  if (array)
+  if (error != NULL)
   {
-    for (i = 0; i < array->len; i++)
-    {
-      UpDevice *device = g_ptr_array_index (array, i);
-
-      power_manager_button_add_device (device, button);
-    }
-    g_ptr_array_free (array, TRUE);
+    XFPM_DEBUG ("Failed to set the brightness: %s", error->message);
+    g_error_free (error);
   }
+
+  /* Next one can go */
+  button->priv->write_in_flight = FALSE;
+
+  g_object_unref (button);
 }
 
 static void
-power_manager_button_remove_all_devices (PowerManagerButton *button)
+power_manager_button_request_brightness (PowerManagerButton *button, gint32 level)
 {
-  GList *item = NULL;
-
-  TRACE("entering");
-
-  g_return_if_fail (POWER_MANAGER_IS_BUTTON (button));
-
-  for (item = g_list_first (button->priv->devices); item != NULL; item = g_list_next (item))
-  {
-    BatteryDevice *battery_device = item->data;
-    if (battery_device == NULL)
-    {
-      DBG("!battery_device");
-      continue;
-    }
+#ifdef XFCE_PLUGIN
+  if (button->priv->manager_proxy == NULL)
+    return;
 
-    /* Remove its resources */
-    remove_battery_device (button, battery_device);
-  }
+  button->priv->write_in_flight = TRUE;
+  g_dbus_proxy_call (button->priv->manager_proxy,
+                     "SetBrightness",
+                     g_variant_new ("(i)", level),
+                     G_DBUS_CALL_FLAGS_NONE,
+                     -1,
+                     NULL,
+                     request_brightness_cb,
+                     g_object_ref (button));
+#else
+  button->priv->write_in_flight = TRUE;
+  xfpm_state_set_brightness (button->priv->state, level,
+                             request_brightness_cb, g_object_ref (button));
+#endif
 }
 
+#ifdef XFCE_PLUGIN
 static void
-brightness_up (PowerManagerButton *button)
+get_top_consumers_cb (GObject *source_object,
+                      GAsyncResult *res,
+                      gpointer user_data)
 {
-  gint32 level;
-  gint32 max_level;
-
-  xfpm_brightness_get_level (button->priv->brightness, &level);
-  max_level = xfpm_brightness_get_max_level (button->priv->brightness);
+  PowerManagerButton *button = POWER_MANAGER_BUTTON (user_data);
+  GError *error = NULL;
+  GVariant *reply;
 
-  if ( level < max_level )
+  reply = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+  if (reply != NULL)
   {
-    increase_brightness (button);
+    power_manager_button_menu_update_consumers (button, reply);
+    g_variant_unref (reply);
+  }
+  else
+  {
+    XFPM_DEBUG ("GetTopConsumers failed: %s", error->message);
+    g_error_free (error);
   }
+
+  g_object_unref (button);
 }
+#endif
 
-static void
-brightness_down (PowerManagerButton *button)
+/* The daemon keeps sampling for a while after each request */
+static gboolean
+power_manager_button_request_consumers (gpointer user_data)
 {
-  gint32 level;
-  xfpm_brightness_get_level (button->priv->brightness, &level);
+  PowerManagerButton *button = POWER_MANAGER_BUTTON (user_data);
+#ifdef XFCE_PLUGIN
+  if (button->priv->manager_proxy == NULL)
+    return TRUE;
 
-  if ( level > button->priv->brightness_min_level )
-  {
-    decrease_brightness (button);
-  }
+  g_dbus_proxy_call (button->priv->manager_proxy,
+                     "GetTopConsumers",
+                     g_variant_new ("(u)", MENU_CONSUMERS_COUNT),
+                     G_DBUS_CALL_FLAGS_NONE,
+                     -1,
+                     NULL,
+                     get_top_consumers_cb,
+                     g_object_ref (button));
+#else
+  GVariant *reply;
+
+  reply = g_variant_ref_sink (xfpm_state_get_top_consumers (button->priv->state, MENU_CONSUMERS_COUNT));
+  power_manager_button_menu_update_consumers (button, reply);
+  g_variant_unref (reply);
+#endif
+
+  return TRUE;
 }
 
 static gboolean
 power_manager_button_scroll_event (GtkWidget *widget, GdkEventScroll *ev)
 {
-  gboolean hw_found;
   PowerManagerButton *button;
 
   button = POWER_MANAGER_BUTTON (widget);
 
-  hw_found = xfpm_brightness_has_hw (button->priv->brightness);
-
-  if (!hw_found)
+  if (button->priv->brightness_max <= 0)
     return FALSE;
 
   if (ev->direction == GDK_SCROLL_UP)
   {
-    brightness_up (button);
+    increase_brightness (button);
     return TRUE;
   }
   else if (ev->direction == GDK_SCROLL_DOWN)
   {
-    brightness_down (button);
+    decrease_brightness (button);
     return TRUE;
   }
   return FALSE;
@@ -788,7 +1648,10 @@ power_manager_button_scroll_event (GtkWidget *widget, GdkEventScroll *ev)
 static void
 set_brightness_min_level (PowerManagerButton *button, gint32 new_brightness_level)
 {
-  gint32 max_level = xfpm_brightness_get_max_level (button->priv->brightness);
+  gint32 max_level = button->priv->brightness_max;
+
+  /* kept to compute it again once the maximum is known */
+  button->priv->brightness_min_level_setting = new_brightness_level;
 
   /* sanity check */
   if (new_brightness_level > max_level)
@@ -807,7 +1670,7 @@ set_brightness_min_level (PowerManagerButton *button, gint32 new_brightness_leve
   DBG("button->priv->brightness_min_level : %d", button->priv->brightness_min_level);
 
   /* update the range if it's being shown */
-  if (button->priv->range)
+  if (button->priv->range && max_level > 0)
   {
     gtk_range_set_range (GTK_RANGE (button->priv->range), button->priv->brightness_min_level, max_level);
   }
@@ -892,6 +1755,8 @@ power_manager_button_class_init (PowerManagerButtonClass *klass)
   object_class->set_property = power_manager_button_set_property;
   object_class->get_property = power_manager_button_get_property;
 
+  widget_class->destroy = power_manager_button_destroy;
+  widget_class->unmap = power_manager_button_unmap;
   widget_class->button_press_event = power_manager_button_press_event;
   widget_class->scroll_event = power_manager_button_scroll_event;
 
@@ -948,24 +1813,6 @@ power_manager_button_class_init (PowerManagerButtonClass *klass)
 #undef XFPM_PARAM_FLAGS
 }
 
-#ifdef XFCE_PLUGIN
-static void
-inhibit_proxy_ready_cb (GObject *source_object,
-                        GAsyncResult *res,
-                        gpointer user_data)
-{
-  GError *error = NULL;
-  PowerManagerButton *button = POWER_MANAGER_BUTTON (user_data);
-
-  button->priv->inhibit_proxy = g_dbus_proxy_new_finish (res, &error);
-  if (error != NULL)
-  {
-    g_warning ("error getting inhibit proxy: %s", error->message);
-    g_clear_error (&error);
-  }
-}
-#endif
-
 static void
 power_manager_button_init (PowerManagerButton *button)
 {
@@ -984,11 +1831,13 @@ power_manager_button_init (PowerManagerButton *button)
 #endif
   gtk_widget_set_name (GTK_WIDGET (button), "xfce4-power-manager-plugin");
 
-  button->priv->brightness = xfpm_brightness_new ();
-  xfpm_brightness_setup (button->priv->brightness);
   button->priv->set_level_timeout = 0;
+  button->priv->pending_level = -1;
+  button->priv->cpu_rate = -1;
+  button->priv->cpu_core_rate = -1;
+  button->priv->cpu_uncore_rate = -1;
+  button->priv->device_index = g_hash_table_new (g_str_hash, g_str_equal);
 
-  button->priv->upower  = up_client_new ();
   if ( !xfconf_init (&error) )
   {
     g_critical ("xfconf_init failed: %s\n", error->message);
@@ -999,20 +1848,6 @@ power_manager_button_init (PowerManagerButton *button)
     button->priv->channel = xfconf_channel_get (XFPM_CHANNEL);
   }
 
-#ifdef XFCE_PLUGIN
-  g_dbus_proxy_new (g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL),
-                    G_DBUS_PROXY_FLAGS_NONE,
-                    NULL,
-                    "org.freedesktop.PowerManagement",
-                    "/org/freedesktop/PowerManagement/Inhibit",
-                    "org.freedesktop.PowerManagement.Inhibit",
-                    NULL,
-                    inhibit_proxy_ready_cb,
-                    button);
-#else
-  button->priv->inhibit = xfpm_inhibit_new ();
-#endif
-
   /* Sane defaults for the systray and panel icon */
 #ifdef XFCE_PLUGIN
   button->priv->panel_icon_name = g_strdup (PANEL_DEFAULT_ICON_SYMBOLIC);
@@ -1033,8 +1868,22 @@ power_manager_button_init (PowerManagerButton *button)
   /* Intercept scroll events */
   gtk_widget_add_events (GTK_WIDGET (button), GDK_SCROLL_MASK);
 
-  g_signal_connect (button->priv->upower, "device-added", G_CALLBACK (device_added_cb), button);
-  g_signal_connect (button->priv->upower, "device-removed", G_CALLBACK (device_removed_cb), button);
+  /* The icon cache has to see a theme change before we do */
+  icon_cache_init ();
+  g_signal_connect (gtk_icon_theme_get_default (), "changed", G_CALLBACK (icon_theme_changed_cb), button);
+  g_signal_connect (button, "notify::scale-factor", G_CALLBACK (scale_factor_changed_cb), NULL);
+}
+
+static void
+power_manager_button_destroy (GtkWidget *widget)
+{
+  PowerManagerButton *button = POWER_MANAGER_BUTTON (widget);
+
+  /* The menu lives as long as the button */
+  if (button->priv->menu != NULL)
+    gtk_widget_destroy (button->priv->menu);
+
+  GTK_WIDGET_CLASS (power_manager_button_parent_class)->destroy (widget);
 }
 
 static void
@@ -1054,12 +1903,39 @@ power_manager_button_finalize (GObject *object)
     button->priv->set_level_timeout = 0;
   }
 
-  g_signal_handlers_disconnect_by_data (button->priv->upower, button);
+  if (button->priv->refresh_idle_id != 0)
+    g_source_remove (button->priv->refresh_idle_id);
+
+  if (button->priv->refresh_tick_id != 0)
+    gtk_widget_remove_tick_callback (GTK_WIDGET (button), button->priv->refresh_tick_id);
+
+  if (button->priv->consumers_refresh_id != 0)
+    g_source_remove (button->priv->consumers_refresh_id);
+
+  g_signal_handlers_disconnect_by_data (gtk_icon_theme_get_default (), button);
+  if (button->priv->channel != NULL)
+    g_signal_handlers_disconnect_by_data (button->priv->channel, button);
 
   power_manager_button_remove_all_devices (button);
+  g_hash_table_destroy (button->priv->device_index);
+
+  g_strfreev (button->priv->inhibitors);
+  g_free (button->priv->display_device_path);
 
 #ifdef XFCE_PLUGIN
+  if (button->priv->manager_proxy != NULL)
+  {
+    g_signal_handlers_disconnect_by_data (button->priv->manager_proxy, button);
+    g_object_unref (button->priv->manager_proxy);
+  }
+
   g_object_unref (button->priv->plugin);
+#else
+  if (button->priv->state != NULL)
+  {
+    g_signal_handlers_disconnect_by_data (button->priv->state, button);
+    g_object_unref (button->priv->state);
+  }
 #endif
 
   G_OBJECT_CLASS (power_manager_button_parent_class)->finalize (object);
@@ -1089,6 +1965,7 @@ power_manager_button_new (void)
                           G_OBJECT (button), PRESENTATION_MODE);
   xfconf_g_property_bind (button->priv->channel, XFPM_PROPERTIES_PREFIX SHOW_PRESENTATION_INDICATOR, G_TYPE_BOOLEAN,
                           G_OBJECT (button), SHOW_PRESENTATION_INDICATOR);
+
   return GTK_WIDGET (button);
 }
 
@@ -1244,8 +2121,8 @@ power_manager_button_show (PowerManagerButton *button)
   power_manager_button_update_label (button, button->priv->display_device);
   power_manager_button_set_tooltip (button);
 
-  /* Add all the devcies currently attached to the system */
-  power_manager_button_add_all_devices (button);
+  /* Get the devices, backlight and inhibitors from the daemon */
+  power_manager_button_connect_state (button);
 }
 
 static void
@@ -1302,19 +2179,44 @@ power_manager_button_update_label (PowerManagerButton *button, UpDevice *device)
 }
 
 static void
-menu_destroyed_cb(GtkMenuShell *menu, gpointer user_data)
+menu_deactivate_cb(GtkMenuShell *menu, gpointer user_data)
 {
   PowerManagerButton *button = POWER_MANAGER_BUTTON (user_data);
 
   TRACE("entering");
 
-  /* menu destroyed, range slider is gone */
-  button->priv->range = NULL;
-
-  /* untoggle panel icon */
+  /* untoggle panel icon, the menu is kept for the next time */
   gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON(button), FALSE);
 
-  gtk_menu_detach (GTK_MENU (button->priv->menu));
+  if (button->priv->consumers_refresh_id != 0)
+  {
+    g_source_remove (button->priv->consumers_refresh_id);
+    button->priv->consumers_refresh_id = 0;
+  }
+}
+
+static void
+menu_destroyed_cb(GtkWidget *menu, gpointer user_data)
+{
+  PowerManagerButton *button = POWER_MANAGER_BUTTON (user_data);
+
+  TRACE("entering");
+
+  /* menu destroyed, range slider is gone */
+  button->priv->range = NULL;
+  button->priv->device_separator = NULL;
+  button->priv->inhibitor_separator = NULL;
+  g_list_free (button->priv->inhibitor_items);
+  button->priv->inhibitor_items = NULL;
+  button->priv->consumer_separator = NULL;
+  g_list_free (button->priv->consumer_items);
+  button->priv->consumer_items = NULL;
+
+  if (button->priv->consumers_refresh_id != 0)
+  {
+    g_source_remove (button->priv->consumers_refresh_id);
+    button->priv->consumers_refresh_id = 0;
+  }
 
   button->priv->menu = NULL;
 }
@@ -1332,6 +2234,7 @@ menu_item_destroyed_cb(GtkWidget *object, gpointer user_data)
     if (battery_device->menu_item == object)
     {
       battery_device->menu_item = NULL;
+      battery_device->img = NULL;
       return;
     }
   }
@@ -1386,19 +2289,14 @@ G_GNUC_END_IGNORE_DEPRECATIONS
   /* Make the menu item be bold and multi-line */
   label = gtk_bin_get_child (GTK_BIN (mi));
   gtk_label_set_use_markup (GTK_LABEL (label), TRUE);
-  /* add the image */
-  battery_device->img = gtk_image_new_from_pixbuf (battery_device->pix);
-  g_object_ref (battery_device->img);
+  /* add the image, it is updated in place when the device changes */
+  battery_device->img = gtk_image_new_from_surface (battery_device->surface);
 G_GNUC_BEGIN_IGNORE_DEPRECATIONS
   gtk_image_menu_item_set_image(GTK_IMAGE_MENU_ITEM(mi), battery_device->img);
 G_GNUC_END_IGNORE_DEPRECATIONS
   /* keep track of the menu item in the battery_device so we can update it */
   battery_device->menu_item = mi;
   g_signal_connect(G_OBJECT (mi), "destroy", G_CALLBACK (menu_item_destroyed_cb), button);
-  battery_device->expose_signal_id = g_signal_connect_after (G_OBJECT (battery_device->img),
-                                                             "draw",
-                                                             G_CALLBACK (power_manager_button_device_icon_draw),
-                                                             battery_device->device);
 
   /* Active calls xfpm settings with the device's id to display details */
   g_signal_connect(G_OBJECT(mi), "activate", G_CALLBACK(menu_item_activate_cb), button);
@@ -1413,8 +2311,8 @@ G_GNUC_END_IGNORE_DEPRECATIONS
   return TRUE;
 }
 
-static void
-add_inhibitor_to_menu (PowerManagerButton *button, const gchar *text)
+static GtkWidget *
+inhibitor_menu_item_new (const gchar *text)
 {
   GtkWidget *mi, *img;
 
@@ -1435,158 +2333,206 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 
   gtk_widget_set_can_focus (mi, FALSE);
   gtk_widget_show (mi);
-  gtk_menu_shell_append (GTK_MENU_SHELL(button->priv->menu), mi);
   g_free (label);
+
+  return mi;
 }
 
-#ifdef XFCE_PLUGIN
 static void
-display_inhibitors (PowerManagerButton *button, GtkWidget *menu)
+power_manager_button_menu_update_separators (PowerManagerButton *button)
 {
-  GtkWidget *separator_mi;
-  gboolean needs_seperator = FALSE;
+  GList *item;
+  gboolean has_devices = FALSE;
 
-  g_return_if_fail (POWER_MANAGER_IS_BUTTON (button));
-  g_return_if_fail (GTK_IS_MENU (menu));
+  if (button->priv->menu == NULL)
+    return;
 
-  if (button->priv->inhibit_proxy)
+  for (item = g_list_first (button->priv->devices); item != NULL; item = g_list_next (item))
   {
-    GVariant *reply;
-    GError   *error = NULL;
-
-    reply = g_dbus_proxy_call_sync (button->priv->inhibit_proxy,
-                                    "GetInhibitors",
-                                    g_variant_new ("()"),
-                                    G_DBUS_CALL_FLAGS_NONE,
-                                    1000,
-                                    NULL,
-                                    &error);
+    BatteryDevice *battery_device = item->data;
 
-    if (reply != NULL)
+    if (battery_device->menu_item != NULL)
     {
-      GVariantIter *iter;
-      gchar        *value;
+      has_devices = TRUE;
+      break;
+    }
+  }
 
-      g_variant_get (reply, "(as)", &iter);
+  gtk_widget_set_visible (button->priv->device_separator, has_devices);
+  gtk_widget_set_visible (button->priv->consumer_separator,
+                          button->priv->consumer_items != NULL);
+  gtk_widget_set_visible (button->priv->inhibitor_separator,
+                          button->priv->inhibitor_items != NULL
+                          || button->priv->consumer_items != NULL);
+}
 
-      if (g_variant_iter_n_children (iter) > 0)
-      {
-        needs_seperator = TRUE;
-      }
+/* Replaces the inhibitor items, they go right above their separator */
+static void
+power_manager_button_menu_update_inhibitors (PowerManagerButton *button)
+{
+  GList *children, *item;
+  gint position;
+  guint i;
 
-      /* Add the list of programs to the menu */
-      while (g_variant_iter_next (iter, "s", &value))
-      {
-        add_inhibitor_to_menu (button, value);
-      }
-      g_variant_iter_free (iter);
-      g_variant_unref (reply);
+  if (button->priv->menu == NULL)
+    return;
 
-    } else {
-      g_warning ("failed calling GetInhibitors: %s", error->message);
-      g_clear_error (&error);
-    }
+  for (item = button->priv->inhibitor_items; item != NULL; item = item->next)
+    gtk_widget_destroy (item->data);
+  g_list_free (button->priv->inhibitor_items);
+  button->priv->inhibitor_items = NULL;
 
-    if (needs_seperator)
-    {
-      /* add a separator */
-      separator_mi = gtk_separator_menu_item_new ();
-      gtk_widget_show (separator_mi);
-      gtk_menu_shell_append (GTK_MENU_SHELL (menu), separator_mi);
-    }
+  children = gtk_container_get_children (GTK_CONTAINER (button->priv->menu));
+  position = g_list_index (children, button->priv->inhibitor_separator);
+  g_list_free (children);
+
+  for (i = 0; button->priv->inhibitors != NULL && button->priv->inhibitors[i] != NULL; i++)
+  {
+    GtkWidget *mi = inhibitor_menu_item_new (button->priv->inhibitors[i]);
+
+    gtk_menu_shell_insert (GTK_MENU_SHELL (button->priv->menu), mi, position++);
+    button->priv->inhibitor_items = g_list_prepend (button->priv->inhibitor_items, mi);
   }
+
+  power_manager_button_menu_update_separators (button);
 }
-#else
+
+static GtkWidget *
+consumer_menu_item_new (const gchar *text, gboolean markup)
+{
+  GtkWidget *mi;
+
+  mi = gtk_menu_item_new_with_label (text);
+  gtk_label_set_use_markup (GTK_LABEL (gtk_bin_get_child (GTK_BIN (mi))), markup);
+  g_signal_connect (mi, "activate", G_CALLBACK (xfpm_preferences), NULL);
+  gtk_widget_show (mi);
+
+  return mi;
+}
+
+/* Replaces the consumer items with the (da(usdd)) of GetTopConsumers,
+ * they go right below their separator */
 static void
-display_inhibitors (PowerManagerButton *button, GtkWidget *menu)
+power_manager_button_menu_update_consumers (PowerManagerButton *button, GVariant *reply)
 {
-  guint i;
-  GtkWidget *separator_mi;
-  const gchar **inhibitors;
+  GList *children, *item;
+  GVariantIter *iter;
+  const gchar *name;
+  guint32 pid;
+  gdouble power, cpu, watts;
+  gint position;
+
+  if (button->priv->menu == NULL)
+    return;
 
-  g_return_if_fail (POWER_MANAGER_IS_BUTTON (button));
-  g_return_if_fail (GTK_IS_MENU (menu));
+  for (item = button->priv->consumer_items; item != NULL; item = item->next)
+    gtk_widget_destroy (item->data);
+  g_list_free (button->priv->consumer_items);
+  button->priv->consumer_items = NULL;
+
+  children = gtk_container_get_children (GTK_CONTAINER (button->priv->menu));
+  position = g_list_index (children, button->priv->consumer_separator) + 1;
+  g_list_free (children);
+
+  g_variant_get (reply, "(da(usdd))", &power, &iter);
 
-  inhibitors = xfpm_inhibit_get_inhibit_list (button->priv->inhibit);
-  if (inhibitors != NULL && inhibitors[0] != NULL)
+  /* Empty until the daemon has sampled twice */
+  if (g_variant_iter_n_children (iter) > 0)
   {
-    for (i=0; inhibitors[i] != NULL; i++)
-    {
-      add_inhibitor_to_menu (button, inhibitors[i]);
-    }
+    GtkWidget *mi = consumer_menu_item_new (_("<b>Top power consumers</b>"), TRUE);
+
+    gtk_menu_shell_insert (GTK_MENU_SHELL (button->priv->menu), mi, position++);
+    button->priv->consumer_items = g_list_prepend (button->priv->consumer_items, mi);
+  }
 
-    /* add a separator */
-    separator_mi = gtk_separator_menu_item_new ();
-    gtk_widget_show (separator_mi);
-    gtk_menu_shell_append (GTK_MENU_SHELL (menu), separator_mi);
+  while (g_variant_iter_next (iter, "(u&sdd)", &pid, &name, &cpu, &watts))
+  {
+    GtkWidget *mi;
+    gchar *label;
+
+    if (watts >= 0)
+      label = g_strdup_printf (_("%s: %.1f W"), name, watts);
+    else
+      label = g_strdup_printf (_("%s: %.0f%% CPU"), name, cpu);
+
+    mi = consumer_menu_item_new (label, FALSE);
+    gtk_menu_shell_insert (GTK_MENU_SHELL (button->priv->menu), mi, position++);
+    button->priv->consumer_items = g_list_prepend (button->priv->consumer_items, mi);
+    g_free (label);
   }
 
-  g_free (inhibitors);
+  g_variant_iter_free (iter);
+
+  power_manager_button_menu_update_separators (button);
 }
-#endif
 
 static void
-decrease_brightness (PowerManagerButton *button)
+power_manager_button_set_inhibitors (PowerManagerButton *button, const gchar **inhibitors)
 {
-  gint32 level;
+  g_strfreev (button->priv->inhibitors);
+  button->priv->inhibitors = g_strdupv ((gchar **) inhibitors);
+
+  power_manager_button_menu_update_inhibitors (button);
+}
 
+/* The slider follows when the daemon publishes the new level */
+static void
+decrease_brightness (PowerManagerButton *button)
+{
   TRACE("entering");
 
-  if ( !xfpm_brightness_has_hw (button->priv->brightness) )
+  if (button->priv->brightness_max <= 0)
     return;
 
-  xfpm_brightness_get_level (button->priv->brightness, &level);
-
-  if ( level > button->priv->brightness_min_level )
-  {
-    xfpm_brightness_down (button->priv->brightness, &level);
-    if (button->priv->range)
-      gtk_range_set_value (GTK_RANGE (button->priv->range), level);
-  }
+  if (button->priv->brightness_level > button->priv->brightness_min_level)
+    power_manager_button_step_brightness (button, FALSE);
 }
 
 static void
 increase_brightness (PowerManagerButton *button)
 {
-  gint32 level, max_level;
-
   TRACE("entering");
 
-  if (!xfpm_brightness_has_hw (button->priv->brightness))
+  if (button->priv->brightness_max <= 0)
     return;
 
-  max_level = xfpm_brightness_get_max_level (button->priv->brightness);
-  xfpm_brightness_get_level (button->priv->brightness, &level);
+  if (button->priv->brightness_level < button->priv->brightness_max)
+    power_manager_button_step_brightness (button, TRUE);
+}
 
-  if (level < max_level)
-  {
-    xfpm_brightness_up (button->priv->brightness, &level);
-    if (button->priv->range)
-      gtk_range_set_value (GTK_RANGE (button->priv->range), level);
-  }
+/* Sends the latest slider position, unless a write is still going on */
+static void
+brightness_write_pending (PowerManagerButton *button)
+{
+  gint32 level = button->priv->pending_level;
+
+  if (level < 0 || button->priv->write_in_flight)
+    return;
+
+  button->priv->pending_level = -1;
+
+  if (level == button->priv->brightness_level)
+    return;
+
+  button->priv->writes_issued++;
+  power_manager_button_request_brightness (button, level);
 }
 
 static gboolean
 brightness_set_level_with_timeout (PowerManagerButton *button)
 {
-  gint32 range_level, hw_level;
-
   TRACE("entering");
 
-  range_level = (gint32) gtk_range_get_value (GTK_RANGE (button->priv->range));
+  brightness_write_pending (button);
 
-  xfpm_brightness_get_level (button->priv->brightness, &hw_level);
+  /* Keep ticking until the slider is left alone and the last write is done */
+  if (button->priv->pending_level >= 0 || button->priv->write_in_flight)
+    return TRUE;
 
-  if (hw_level != range_level)
-  {
-    xfpm_brightness_set_level (button->priv->brightness, range_level);
-  }
+  XFPM_DEBUG ("Brightness slider: %u writes issued, %u dropped",
+              button->priv->writes_issued, button->priv->writes_dropped);
 
-  if (button->priv->set_level_timeout)
-  {
-    g_source_remove(button->priv->set_level_timeout);
-    button->priv->set_level_timeout = 0;
-  }
+  button->priv->set_level_timeout = 0;
 
   return FALSE;
 }
@@ -1594,11 +2540,27 @@ brightness_set_level_with_timeout (PowerManagerButton *button)
 static void
 range_value_changed_cb (PowerManagerButton *button, GtkWidget *widget)
 {
+  gint32 range_level;
+
   TRACE("entering");
 
+  range_level = (gint32) gtk_range_get_value (GTK_RANGE (button->priv->range));
+
+  /* The slider following the published level */
+  if (button->priv->pending_level < 0 && range_level == button->priv->brightness_level)
+    return;
+
+  /* Replaced before it was sent */
+  if (button->priv->pending_level >= 0)
+    button->priv->writes_dropped++;
+
+  button->priv->pending_level = range_level;
+
   if (button->priv->set_level_timeout)
     return;
 
+  /* The first move goes out right away, the following ones at a fixed rate */
+  brightness_write_pending (button);
   button->priv->set_level_timeout =
     g_timeout_add (SET_LEVEL_TIMEOUT,
                    (GSourceFunc) brightness_set_level_with_timeout, button);
@@ -1631,8 +2593,8 @@ range_show_cb (GtkWidget *widget, PowerManagerButton *button)
 #endif
 
   TRACE("entering");
-  /* Release these grabs as they will cause a lockup if pkexec is called
-   * for the brightness helper */
+  /* Release these grabs, pkexec may have to show an authentication
+   * dialog for the brightness helper */
   if (pointer)
   {
 #if !GTK_CHECK_VERSION (3, 20, 0)
@@ -1654,80 +2616,44 @@ power_manager_button_toggle_presentation_mode (GtkMenuItem *mi, GtkSwitch *sw)
 }
 
 
-void
-power_manager_button_show_menu (PowerManagerButton *button)
+/* Builds the menu with everything that is known right now, from
+ * then on it is kept up to date by the device and inhibitor callbacks */
+static void
+power_manager_button_menu_build (PowerManagerButton *button)
 {
   GtkWidget *menu, *mi, *img = NULL;
   GtkWidget *box, *label, *sw;
-  GdkScreen *gscreen;
   GList *item;
-  gboolean show_separator_flag = FALSE;
-  gint32 max_level, current_level = 0;
 
   TRACE("entering");
 
-  g_return_if_fail (POWER_MANAGER_IS_BUTTON (button));
-
-  if (gtk_widget_has_screen (GTK_WIDGET (button)))
-      gscreen = gtk_widget_get_screen(GTK_WIDGET(button));
-  else
-      gscreen = gdk_display_get_default_screen(gdk_display_get_default());
-
   menu = gtk_menu_new ();
-  gtk_menu_set_screen(GTK_MENU(menu), gscreen);
-  /* keep track of the menu while it's being displayed */
   button->priv->menu = menu;
-  g_signal_connect(GTK_MENU_SHELL(menu), "deactivate", G_CALLBACK(menu_destroyed_cb), button);
+  g_signal_connect(GTK_MENU_SHELL(menu), "deactivate", G_CALLBACK(menu_deactivate_cb), button);
+  g_signal_connect(menu, "destroy", G_CALLBACK(menu_destroyed_cb), button);
   gtk_menu_attach_to_widget (GTK_MENU (menu), GTK_WIDGET (button), NULL);
 
   for (item = g_list_first (button->priv->devices); item != NULL; item = g_list_next (item))
   {
     BatteryDevice *battery_device = item->data;
 
-    if (power_manager_button_menu_add_device (button, battery_device, TRUE))
-    {
-      /* If we add an item to the menu, show the separator */
-      show_separator_flag = TRUE;
-    }
+    power_manager_button_menu_add_device (button, battery_device, TRUE);
   }
 
-  if (show_separator_flag)
-  {
-    /* separator */
-    mi = gtk_separator_menu_item_new ();
-    gtk_widget_show (mi);
-    gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
-  }
+  /* separator, only visible while there are devices above it */
+  button->priv->device_separator = gtk_separator_menu_item_new ();
+  gtk_menu_shell_append (GTK_MENU_SHELL (menu), button->priv->device_separator);
 
   /* Display brightness slider - show if there's hardware support for it */
-  if ( xfpm_brightness_has_hw (button->priv->brightness) )
+  if (button->priv->brightness_max > 0)
   {
-    max_level = xfpm_brightness_get_max_level (button->priv->brightness);
-
-    /* Setup brightness steps */
-    guint brightness_step_count =
-      xfconf_channel_get_uint (button->priv->channel,
-                               XFPM_PROPERTIES_PREFIX BRIGHTNESS_STEP_COUNT,
-                               10);
-    gboolean brightness_exponential =
-      xfconf_channel_get_bool (button->priv->channel,
-                               XFPM_PROPERTIES_PREFIX BRIGHTNESS_EXPONENTIAL,
-                               FALSE);
-    xfpm_brightness_set_step_count (button->priv->brightness,
-                                    brightness_step_count,
-                                    brightness_exponential);
-
-    mi = scale_menu_item_new_with_range (button->priv->brightness_min_level, max_level, 1);
+    mi = scale_menu_item_new_with_range (button->priv->brightness_min_level, button->priv->brightness_max, 1);
 
     scale_menu_item_set_description_label (SCALE_MENU_ITEM (mi), _("<b>Display brightness</b>"));
 
-    /* range slider */
+    /* range slider, its value is set each time the menu is shown */
     button->priv->range = scale_menu_item_get_scale (SCALE_MENU_ITEM (mi));
 
-    /* update the slider to the current brightness level */
-    xfpm_brightness_get_level (button->priv->brightness, &current_level);
-    gtk_range_set_value (GTK_RANGE (button->priv->range), current_level);
-
     g_signal_connect_swapped (mi, "value-changed", G_CALLBACK (range_value_changed_cb), button);
     g_signal_connect (mi, "scroll-event", G_CALLBACK (range_scroll_cb), button);
     g_signal_connect (menu, "show", G_CALLBACK (range_show_cb), button);
@@ -1766,8 +2692,13 @@ G_GNUC_END_IGNORE_DEPRECATIONS
   gtk_widget_show_all (mi);
   gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
 
-  /* Show any applications currently inhibiting now */
-  display_inhibitors (button, menu);
+  /* Processes using the most power, filled in while the menu is open */
+  button->priv->consumer_separator = gtk_separator_menu_item_new ();
+  gtk_menu_shell_append (GTK_MENU_SHELL (menu), button->priv->consumer_separator);
+
+  /* Applications currently inhibiting go above this separator */
+  button->priv->inhibitor_separator = gtk_separator_menu_item_new ();
+  gtk_menu_shell_append (GTK_MENU_SHELL (menu), button->priv->inhibitor_separator);
 
   /* Power manager settings */
   mi = gtk_menu_item_new_with_mnemonic (_("_Power manager settings..."));
@@ -1775,8 +2706,44 @@ G_GNUC_END_IGNORE_DEPRECATIONS
   gtk_menu_shell_append (GTK_MENU_SHELL(menu), mi);
   g_signal_connect (G_OBJECT(mi), "activate", G_CALLBACK(xfpm_preferences), NULL);
 
+  /* Show any applications currently inhibiting, this also sets the
+   * visibility of both separators */
+  power_manager_button_menu_update_inhibitors (button);
+}
+
+void
+power_manager_button_show_menu (PowerManagerButton *button)
+{
+  GdkScreen *gscreen;
+
+  TRACE("entering");
+
+  g_return_if_fail (POWER_MANAGER_IS_BUTTON (button));
+
+  if (button->priv->menu == NULL)
+    power_manager_button_menu_build (button);
+
+  if (gtk_widget_has_screen (GTK_WIDGET (button)))
+      gscreen = gtk_widget_get_screen(GTK_WIDGET(button));
+  else
+      gscreen = gdk_display_get_default_screen(gdk_display_get_default());
+
+  gtk_menu_set_screen(GTK_MENU(button->priv->menu), gscreen);
+
+  /* the brightness keys may have changed the level since the last time */
+  if (button->priv->range)
+    gtk_range_set_value (GTK_RANGE (button->priv->range), button->priv->brightness_level);
+
+  if (button->priv->consumers_refresh_id == 0)
+  {
+    power_manager_button_request_consumers (button);
+    button->priv->consumers_refresh_id =
+      g_timeout_add_seconds (CONSUMERS_REFRESH_INTERVAL,
+                             power_manager_button_request_consumers, button);
+  }
+
 #if GTK_CHECK_VERSION (3, 22, 0)
-  gtk_menu_popup_at_widget (GTK_MENU (menu),
+  gtk_menu_popup_at_widget (GTK_MENU (button->priv->menu),
                             GTK_WIDGET (button),
 #ifdef XFCE_PLUGIN
                             xfce_panel_plugin_get_orientation (button->priv->plugin) == GTK_ORIENTATION_VERTICAL
@@ -1789,7 +2756,7 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 #endif
                             NULL);
 #else
-  gtk_menu_popup (GTK_MENU (menu),
+  gtk_menu_popup (GTK_MENU (button->priv->menu),
                   NULL,
                   NULL,
 #ifdef XFCE_PLUGIN
@@ -1808,6 +2775,6 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 
 #ifdef XFCE_PLUGIN
   xfce_panel_plugin_register_menu (button->priv->plugin,
-                                   GTK_MENU (menu));
+                                   GTK_MENU (button->priv->menu));
 #endif
 }
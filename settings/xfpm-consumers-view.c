@@ -0,0 +1,297 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <gtk/gtk.h>
+
+#include <libxfce4util/libxfce4util.h>
+
+#include "xfpm-debug.h"
+
+#include "xfpm-consumers-view.h"
+
+/* Seconds between two refreshes, the daemon samples every 5 */
+#define REFRESH_INTERVAL      5
+/* Processes listed */
+#define CONSUMERS_COUNT       15
+
+enum
+{
+  COL_NAME,
+  COL_PID,
+  COL_CPU,
+  COL_POWER,
+  N_COLUMNS
+};
+
+struct _XfpmConsumersViewPrivate
+{
+  GDBusConnection *bus;
+  GCancellable    *cancellable;
+  gboolean         call_in_flight;
+  guint            refresh_id;
+
+  GtkListStore    *store;
+  GtkWidget       *power_label;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (XfpmConsumersView, xfpm_consumers_view, GTK_TYPE_BOX)
+
+static void
+xfpm_consumers_view_fetch_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  XfpmConsumersView *view;
+  GError *error = NULL;
+  GVariant *reply;
+  GVariantIter *iter;
+  GtkTreeIter tree_iter;
+  const gchar *name;
+  guint32 pid;
+  gdouble power, cpu, watts;
+  gchar *text;
+
+  reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object), res, &error);
+
+  if ( reply == NULL )
+  {
+    /* The widget is gone */
+    if ( g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED) )
+    {
+      g_error_free (error);
+      return;
+    }
+
+    view = XFPM_CONSUMERS_VIEW (user_data);
+    view->priv->call_in_flight = FALSE;
+
+    XFPM_DEBUG ("GetTopConsumers failed: %s", error->message);
+    g_error_free (error);
+
+    gtk_list_store_clear (view->priv->store);
+    gtk_label_set_text (GTK_LABEL (view->priv->power_label),
+                        _("The power manager is not running."));
+    return;
+  }
+
+  view = XFPM_CONSUMERS_VIEW (user_data);
+  view->priv->call_in_flight = FALSE;
+
+  g_variant_get (reply, "(da(usdd))", &power, &iter);
+
+  if ( g_variant_iter_n_children (iter) == 0 )
+    text = g_strdup (_("Measuring, the list fills in after a few seconds."));
+  else if ( power >= 0 )
+    text = g_strdup_printf (_("The system draws %.1f W, this is how it is shared out:"), power);
+  else
+    text = g_strdup (_("The power draw can't be measured on this system, processes are "
+                       "ranked by their processor, wakeup and disk activity:"));
+
+  gtk_label_set_text (GTK_LABEL (view->priv->power_label), text);
+  g_free (text);
+
+  gtk_list_store_clear (view->priv->store);
+
+  while ( g_variant_iter_next (iter, "(u&sdd)", &pid, &name, &cpu, &watts) )
+  {
+    gchar *cpu_text = g_strdup_printf ("%.1f %%", cpu);
+    gchar *power_text = watts >= 0 ? g_strdup_printf ("%.2f W", watts) : g_strdup ("-");
+
+    gtk_list_store_insert_with_values (view->priv->store, &tree_iter, -1,
+                                       COL_NAME, name,
+                                       COL_PID, pid,
+                                       COL_CPU, cpu_text,
+                                       COL_POWER, power_text,
+                                       -1);
+    g_free (cpu_text);
+    g_free (power_text);
+  }
+
+  g_variant_iter_free (iter);
+  g_variant_unref (reply);
+}
+
+static gboolean
+xfpm_consumers_view_fetch (gpointer user_data)
+{
+  XfpmConsumersView *view = XFPM_CONSUMERS_VIEW (user_data);
+
+  /* A slow daemon doesn't get more calls piled up */
+  if ( view->priv->bus == NULL || view->priv->call_in_flight )
+    return TRUE;
+
+  view->priv->call_in_flight = TRUE;
+
+  g_dbus_connection_call (view->priv->bus,
+                          "org.xfce.PowerManager",
+                          "/org/xfce/PowerManager",
+                          "org.xfce.Power.Manager",
+                          "GetTopConsumers",
+                          g_variant_new ("(u)", CONSUMERS_COUNT),
+                          G_VARIANT_TYPE ("(da(usdd))"),
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1,
+                          view->priv->cancellable,
+                          xfpm_consumers_view_fetch_cb,
+                          view);
+
+  return TRUE;
+}
+
+/* The daemon only samples while asked, so only while we are on screen */
+static void
+xfpm_consumers_view_map (GtkWidget *widget)
+{
+  XfpmConsumersView *view = XFPM_CONSUMERS_VIEW (widget);
+
+  GTK_WIDGET_CLASS (xfpm_consumers_view_parent_class)->map (widget);
+
+  if ( view->priv->refresh_id == 0 )
+  {
+    xfpm_consumers_view_fetch (view);
+    view->priv->refresh_id = g_timeout_add_seconds (REFRESH_INTERVAL,
+                                                    xfpm_consumers_view_fetch,
+                                                    view);
+  }
+}
+
+static void
+xfpm_consumers_view_unmap (GtkWidget *widget)
+{
+  XfpmConsumersView *view = XFPM_CONSUMERS_VIEW (widget);
+
+  if ( view->priv->refresh_id != 0 )
+  {
+    g_source_remove (view->priv->refresh_id);
+    view->priv->refresh_id = 0;
+  }
+
+  GTK_WIDGET_CLASS (xfpm_consumers_view_parent_class)->unmap (widget);
+}
+
+static void
+xfpm_consumers_view_dispose (GObject *object)
+{
+  XfpmConsumersView *view = XFPM_CONSUMERS_VIEW (object);
+
+  if ( view->priv->refresh_id != 0 )
+  {
+    g_source_remove (view->priv->refresh_id);
+    view->priv->refresh_id = 0;
+  }
+
+  if ( view->priv->cancellable != NULL )
+  {
+    g_cancellable_cancel (view->priv->cancellable);
+    g_clear_object (&view->priv->cancellable);
+  }
+
+  g_clear_object (&view->priv->bus);
+  g_clear_object (&view->priv->store);
+
+  G_OBJECT_CLASS (xfpm_consumers_view_parent_class)->dispose (object);
+}
+
+static void
+xfpm_consumers_view_class_init (XfpmConsumersViewClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+  object_class->dispose = xfpm_consumers_view_dispose;
+
+  widget_class->map = xfpm_consumers_view_map;
+  widget_class->unmap = xfpm_consumers_view_unmap;
+}
+
+static void
+xfpm_consumers_view_add_column (GtkWidget *tree_view, const gchar *title, gint column, gboolean numeric)
+{
+  GtkCellRenderer *renderer;
+  GtkTreeViewColumn *col;
+
+  renderer = gtk_cell_renderer_text_new ();
+  if ( numeric )
+    g_object_set (renderer, "xalign", 1.0, NULL);
+
+  col = gtk_tree_view_column_new_with_attributes (title, renderer, "text", column, NULL);
+  gtk_tree_view_column_set_expand (col, !numeric);
+  gtk_tree_view_append_column (GTK_TREE_VIEW (tree_view), col);
+}
+
+static void
+xfpm_consumers_view_init (XfpmConsumersView *view)
+{
+  GtkWidget *scrolled, *tree_view;
+  GError *error = NULL;
+
+  view->priv = xfpm_consumers_view_get_instance_private (view);
+
+  gtk_orientable_set_orientation (GTK_ORIENTABLE (view), GTK_ORIENTATION_VERTICAL);
+  gtk_box_set_spacing (GTK_BOX (view), 6);
+  gtk_container_set_border_width (GTK_CONTAINER (view), 12);
+
+  view->priv->cancellable = g_cancellable_new ();
+  view->priv->store = gtk_list_store_new (N_COLUMNS,
+                                          G_TYPE_STRING,  /* COL_NAME */
+                                          G_TYPE_UINT,    /* COL_PID */
+                                          G_TYPE_STRING,  /* COL_CPU */
+                                          G_TYPE_STRING); /* COL_POWER */
+
+  view->priv->power_label = gtk_label_new (NULL);
+  gtk_label_set_xalign (GTK_LABEL (view->priv->power_label), 0.0);
+  gtk_label_set_line_wrap (GTK_LABEL (view->priv->power_label), TRUE);
+  gtk_box_pack_start (GTK_BOX (view), view->priv->power_label, FALSE, FALSE, 0);
+
+  tree_view = gtk_tree_view_new_with_model (GTK_TREE_MODEL (view->priv->store));
+  xfpm_consumers_view_add_column (tree_view, _("Process"), COL_NAME, FALSE);
+  xfpm_consumers_view_add_column (tree_view, _("PID"), COL_PID, TRUE);
+  xfpm_consumers_view_add_column (tree_view, _("Processor"), COL_CPU, TRUE);
+  xfpm_consumers_view_add_column (tree_view, _("Power"), COL_POWER, TRUE);
+
+  scrolled = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled),
+                                  GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+  gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (scrolled), GTK_SHADOW_IN);
+  gtk_container_add (GTK_CONTAINER (scrolled), tree_view);
+  gtk_box_pack_start (GTK_BOX (view), scrolled, TRUE, TRUE, 0);
+
+  view->priv->bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  if ( error != NULL )
+  {
+    g_warning ("Unable to connect to the session bus: %s", error->message);
+    g_error_free (error);
+  }
+}
+
+/**
+ * xfpm_consumers_view_new:
+ *
+ * The processes using the most power, as estimated by the daemon.
+ * The list is only refreshed while the widget is mapped.
+ **/
+GtkWidget *
+xfpm_consumers_view_new (void)
+{
+  return g_object_new (XFPM_TYPE_CONSUMERS_VIEW, NULL);
+}
@@ -0,0 +1,55 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __XFPM_CONSUMERS_VIEW_H
+#define __XFPM_CONSUMERS_VIEW_H
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define XFPM_TYPE_CONSUMERS_VIEW            (xfpm_consumers_view_get_type())
+#define XFPM_CONSUMERS_VIEW(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), XFPM_TYPE_CONSUMERS_VIEW, XfpmConsumersView))
+#define XFPM_IS_CONSUMERS_VIEW(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj), XFPM_TYPE_CONSUMERS_VIEW))
+
+typedef struct _XfpmConsumersView         XfpmConsumersView;
+typedef struct _XfpmConsumersViewClass    XfpmConsumersViewClass;
+typedef struct _XfpmConsumersViewPrivate  XfpmConsumersViewPrivate;
+
+struct _XfpmConsumersView
+{
+  GtkBox                       parent;
+  XfpmConsumersViewPrivate    *priv;
+};
+
+struct _XfpmConsumersViewClass
+{
+  GtkBoxClass    parent_class;
+};
+
+
+GType                xfpm_consumers_view_get_type     (void) G_GNUC_CONST;
+GtkWidget           *xfpm_consumers_view_new          (void);
+
+
+G_END_DECLS
+
+#endif /* __XFPM_CONSUMERS_VIEW_H */
@@ -0,0 +1,577 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include <gtk/gtk.h>
+#include <upower.h>
+
+#include <libxfce4util/libxfce4util.h>
+
+#include "xfpm-debug.h"
+
+#include "xfpm-device-history.h"
+
+/* Fetched first so that something shows up right away */
+#define RECENT_TIMESPAN       (60 * 60)
+/* Most points UPower is asked for, we downsample them ourselves */
+#define HISTORY_RESOLUTION    (G_MAXUINT16)
+#define CHART_HEIGHT          (120)
+#define CHART_PADDING         (6)
+
+typedef struct
+{
+  gdouble x;        /* seconds since the epoch */
+  gdouble y;
+} HistoryPoint;
+
+struct _XfpmDeviceHistoryPrivate
+{
+  UpDevice        *device;
+  gchar           *object_path;
+  gchar           *history_type;
+  guint            timespan;
+
+  GDBusConnection *bus;
+  GCancellable    *cancellable;
+  gboolean         fetch_started;
+  guint            fetch_timespan;   /* of the GetHistory call in flight */
+  gboolean         fetch_done;
+
+  /* Everything received, oldest first */
+  GArray          *points;
+  /* LTTB of the visible points, one per pixel of plotted_width */
+  GArray          *plotted;
+  gint             plotted_width;
+
+  gulong           notify_id;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (XfpmDeviceHistory, xfpm_device_history, GTK_TYPE_DRAWING_AREA)
+
+static void
+xfpm_device_history_fetch (XfpmDeviceHistory *history, guint timespan);
+
+
+static gint
+history_point_compare (gconstpointer a, gconstpointer b)
+{
+  const HistoryPoint *pa = a, *pb = b;
+
+  return (pa->x > pb->x) - (pa->x < pb->x);
+}
+
+/*
+ * Largest-Triangle-Three-Buckets: keeps the first and last point and,
+ * from each bucket in between, the point making the largest triangle
+ * with the previously kept point and the average of the next bucket.
+ * Peaks and drops survive, unlike with plain averaging.
+ */
+static GArray *
+history_downsample_lttb (const HistoryPoint *data, guint n, guint threshold)
+{
+  GArray *out;
+  gdouble every;
+  guint a = 0;
+  guint i, j;
+
+  out = g_array_sized_new (FALSE, FALSE, sizeof (HistoryPoint), MIN (n, threshold));
+
+  if ( threshold >= n || threshold < 3 )
+  {
+    g_array_append_vals (out, data, n);
+    return out;
+  }
+
+  every = (gdouble) (n - 2) / (threshold - 2);
+
+  g_array_append_val (out, data[0]);
+
+  for ( i = 0; i < threshold - 2; i++ )
+  {
+    gdouble avg_x = 0, avg_y = 0;
+    gdouble max_area = -1;
+    guint avg_start, avg_end, range_start, range_end;
+    guint next_a = 0;
+
+    /* Average of the next bucket */
+    avg_start = (guint) floor ((i + 1) * every) + 1;
+    avg_end = MIN ((guint) floor ((i + 2) * every) + 1, n);
+
+    for ( j = avg_start; j < avg_end; j++ )
+    {
+      avg_x += data[j].x;
+      avg_y += data[j].y;
+    }
+    if ( avg_end > avg_start )
+    {
+      avg_x /= avg_end - avg_start;
+      avg_y /= avg_end - avg_start;
+    }
+
+    /* The point of this bucket making the largest triangle */
+    range_start = (guint) floor (i * every) + 1;
+    range_end = (guint) floor ((i + 1) * every) + 1;
+
+    for ( j = range_start; j < range_end; j++ )
+    {
+      gdouble area = fabs ((data[a].x - avg_x) * (data[j].y - data[a].y)
+                           - (data[a].x - data[j].x) * (avg_y - data[a].y));
+
+      if ( area > max_area )
+      {
+        max_area = area;
+        next_a = j;
+      }
+    }
+
+    g_array_append_val (out, data[next_a]);
+    a = next_a;
+  }
+
+  g_array_append_val (out, data[n - 1]);
+
+  return out;
+}
+
+static void
+xfpm_device_history_invalidate (XfpmDeviceHistory *history)
+{
+  if ( history->priv->plotted != NULL )
+  {
+    g_array_unref (history->priv->plotted);
+    history->priv->plotted = NULL;
+  }
+
+  gtk_widget_queue_draw (GTK_WIDGET (history));
+}
+
+/* Adds points in any order, replacing the ones at the same time */
+static void
+xfpm_device_history_merge (XfpmDeviceHistory *history, const HistoryPoint *data, guint n)
+{
+  GArray *points = history->priv->points;
+  guint i, kept = 0;
+
+  g_array_append_vals (points, data, n);
+  g_array_sort (points, history_point_compare);
+
+  for ( i = 0; i < points->len; i++ )
+  {
+    if ( kept > 0 && g_array_index (points, HistoryPoint, kept - 1).x == g_array_index (points, HistoryPoint, i).x )
+      g_array_index (points, HistoryPoint, kept - 1) = g_array_index (points, HistoryPoint, i);
+    else
+      g_array_index (points, HistoryPoint, kept++) = g_array_index (points, HistoryPoint, i);
+  }
+  g_array_set_size (points, kept);
+
+  xfpm_device_history_invalidate (history);
+}
+
+static void
+xfpm_device_history_fetch_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  XfpmDeviceHistory *history;
+  GError *error = NULL;
+  GVariant *reply;
+  GVariantIter *iter;
+  GArray *data;
+  guint32 time, state;
+  gdouble value;
+
+  reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object), res, &error);
+
+  if ( reply == NULL )
+  {
+    /* The widget is gone */
+    if ( g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED) )
+    {
+      g_error_free (error);
+      return;
+    }
+
+    history = XFPM_DEVICE_HISTORY (user_data);
+    XFPM_DEBUG ("GetHistory %s failed for %s: %s", history->priv->history_type,
+                history->priv->object_path, error->message);
+    g_error_free (error);
+
+    history->priv->fetch_done = TRUE;
+    gtk_widget_queue_draw (GTK_WIDGET (history));
+    return;
+  }
+
+  history = XFPM_DEVICE_HISTORY (user_data);
+
+  g_variant_get (reply, "(a(udu))", &iter);
+  data = g_array_sized_new (FALSE, FALSE, sizeof (HistoryPoint), g_variant_iter_n_children (iter));
+
+  while ( g_variant_iter_next (iter, "(udu)", &time, &value, &state) )
+  {
+    HistoryPoint point = { time, value };
+
+    if ( state != UP_DEVICE_STATE_UNKNOWN )
+      g_array_append_val (data, point);
+  }
+
+  g_variant_iter_free (iter);
+  g_variant_unref (reply);
+
+  XFPM_DEBUG ("GetHistory %s returned %u points over %us for %s", history->priv->history_type,
+              data->len, history->priv->fetch_timespan, history->priv->object_path);
+
+  xfpm_device_history_merge (history, (HistoryPoint *) data->data, data->len);
+  g_array_unref (data);
+
+  /* The recent part is drawn, now get the rest */
+  if ( history->priv->fetch_timespan < history->priv->timespan )
+    xfpm_device_history_fetch (history, history->priv->timespan);
+  else
+    history->priv->fetch_done = TRUE;
+}
+
+static void
+xfpm_device_history_fetch (XfpmDeviceHistory *history, guint timespan)
+{
+  history->priv->fetch_timespan = timespan;
+
+  g_dbus_connection_call (history->priv->bus,
+                          "org.freedesktop.UPower",
+                          history->priv->object_path,
+                          "org.freedesktop.UPower.Device",
+                          "GetHistory",
+                          g_variant_new ("(suu)", history->priv->history_type, timespan, HISTORY_RESOLUTION),
+                          G_VARIANT_TYPE ("(a(udu))"),
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1,
+                          history->priv->cancellable,
+                          xfpm_device_history_fetch_cb,
+                          history);
+}
+
+/* New values are plotted as they come, without asking UPower again */
+static void
+xfpm_device_history_notify_cb (UpDevice *device, GParamSpec *pspec, XfpmDeviceHistory *history)
+{
+  HistoryPoint point;
+  gdouble value = 0;
+  GArray *points = history->priv->points;
+
+  if ( !history->priv->fetch_started )
+    return;
+
+  g_object_get (device, pspec->name, &value, NULL);
+
+  point.x = g_get_real_time () / G_USEC_PER_SEC;
+  point.y = value;
+
+  if ( points->len > 0 && g_array_index (points, HistoryPoint, points->len - 1).x >= point.x )
+    return;
+
+  g_array_append_val (points, point);
+  xfpm_device_history_invalidate (history);
+}
+
+/* Nothing is fetched for pages that are never looked at, the first
+ * of the map and the bus connection starts it */
+static void
+xfpm_device_history_start_fetch (XfpmDeviceHistory *history)
+{
+  if ( history->priv->fetch_started
+       || history->priv->bus == NULL
+       || !gtk_widget_get_mapped (GTK_WIDGET (history)) )
+    return;
+
+  history->priv->fetch_started = TRUE;
+  xfpm_device_history_fetch (history, MIN (RECENT_TIMESPAN, history->priv->timespan));
+}
+
+static void
+xfpm_device_history_bus_ready_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  XfpmDeviceHistory *history;
+  GDBusConnection *bus;
+  GError *error = NULL;
+
+  bus = g_bus_get_finish (res, &error);
+
+  if ( bus == NULL )
+  {
+    /* The widget is gone */
+    if ( g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED) )
+    {
+      g_error_free (error);
+      return;
+    }
+
+    g_warning ("Unable to connect to the system bus: %s", error->message);
+    g_error_free (error);
+
+    /* Nothing will come, don't draw it as loading */
+    history = XFPM_DEVICE_HISTORY (user_data);
+    history->priv->fetch_done = TRUE;
+    gtk_widget_queue_draw (GTK_WIDGET (history));
+    return;
+  }
+
+  history = XFPM_DEVICE_HISTORY (user_data);
+  history->priv->bus = bus;
+
+  xfpm_device_history_start_fetch (history);
+}
+
+static void
+xfpm_device_history_map (GtkWidget *widget)
+{
+  GTK_WIDGET_CLASS (xfpm_device_history_parent_class)->map (widget);
+
+  xfpm_device_history_start_fetch (XFPM_DEVICE_HISTORY (widget));
+}
+
+static void
+xfpm_device_history_draw_text (GtkWidget *widget, cairo_t *cr, const gchar *text, gdouble x, gdouble y)
+{
+  PangoLayout *layout;
+
+  layout = gtk_widget_create_pango_layout (widget, text);
+  cairo_move_to (cr, x, y);
+  pango_cairo_show_layout (cr, layout);
+  g_object_unref (layout);
+}
+
+static gboolean
+xfpm_device_history_draw (GtkWidget *widget, cairo_t *cr)
+{
+  XfpmDeviceHistory *history = XFPM_DEVICE_HISTORY (widget);
+  GtkStyleContext *context;
+  GdkRGBA color;
+  GArray *points = history->priv->points;
+  const HistoryPoint *visible;
+  gboolean is_charge;
+  gdouble now, start, y_max;
+  gdouble plot_x, plot_y, plot_w, plot_h;
+  guint first, n, i;
+  gint width, height;
+
+  width = gtk_widget_get_allocated_width (widget);
+  height = gtk_widget_get_allocated_height (widget);
+  context = gtk_widget_get_style_context (widget);
+
+  gtk_render_background (context, cr, 0, 0, width, height);
+  gtk_render_frame (context, cr, 0, 0, width, height);
+  gtk_style_context_get_color (context, gtk_widget_get_state_flags (widget), &color);
+
+  is_charge = g_strcmp0 (history->priv->history_type, XFPM_DEVICE_HISTORY_CHARGE) == 0;
+
+  plot_x = CHART_PADDING;
+  plot_y = CHART_PADDING;
+  plot_w = MAX (1, width - 2 * CHART_PADDING);
+  plot_h = MAX (1, height - 2 * CHART_PADDING);
+
+  /* Grid */
+  cairo_set_line_width (cr, 1.0);
+  cairo_set_source_rgba (cr, color.red, color.green, color.blue, 0.15);
+  for ( i = 1; i < 4; i++ )
+  {
+    gdouble y = floor (plot_y + plot_h * i / 4) + 0.5;
+
+    cairo_move_to (cr, plot_x, y);
+    cairo_line_to (cr, plot_x + plot_w, y);
+  }
+  cairo_stroke (cr);
+
+  cairo_set_source_rgba (cr, color.red, color.green, color.blue, 0.7);
+  xfpm_device_history_draw_text (widget, cr, is_charge ? _("Charge") : _("Rate"), plot_x + 2, plot_y);
+
+  /* Only what falls within the timespan is plotted */
+  now = g_get_real_time () / G_USEC_PER_SEC;
+  start = now - history->priv->timespan;
+
+  for ( first = 0; first < points->len; first++ )
+    if ( g_array_index (points, HistoryPoint, first).x >= start )
+      break;
+
+  n = points->len - first;
+
+  if ( n < 2 )
+  {
+    if ( history->priv->fetch_done )
+      xfpm_device_history_draw_text (widget, cr, _("No history available"),
+                                     plot_x + 2, plot_y + plot_h / 2);
+    return FALSE;
+  }
+
+  visible = &g_array_index (points, HistoryPoint, first);
+
+  if ( history->priv->plotted == NULL || history->priv->plotted_width != (gint) plot_w )
+  {
+    if ( history->priv->plotted != NULL )
+      g_array_unref (history->priv->plotted);
+
+    history->priv->plotted = history_downsample_lttb (visible, n, (guint) plot_w);
+    history->priv->plotted_width = (gint) plot_w;
+  }
+
+  if ( is_charge )
+  {
+    y_max = 100;
+  }
+  else
+  {
+    y_max = 0;
+    for ( i = 0; i < history->priv->plotted->len; i++ )
+      y_max = MAX (y_max, g_array_index (history->priv->plotted, HistoryPoint, i).y);
+    y_max = MAX (1, y_max * 1.1);
+  }
+
+#define PX(p) (plot_x + ((p).x - start) / history->priv->timespan * plot_w)
+#define PY(p) (plot_y + plot_h - CLAMP ((p).y / y_max, 0, 1) * plot_h)
+
+  for ( i = 0; i < history->priv->plotted->len; i++ )
+  {
+    HistoryPoint p = g_array_index (history->priv->plotted, HistoryPoint, i);
+
+    if ( i == 0 )
+      cairo_move_to (cr, PX (p), PY (p));
+    else
+      cairo_line_to (cr, PX (p), PY (p));
+  }
+
+  cairo_set_line_width (cr, 1.5);
+  cairo_set_line_join (cr, CAIRO_LINE_JOIN_ROUND);
+  cairo_set_source_rgba (cr, color.red, color.green, color.blue, 0.9);
+  cairo_stroke_preserve (cr);
+
+  /* Area under the curve */
+  cairo_line_to (cr, PX (g_array_index (history->priv->plotted, HistoryPoint, history->priv->plotted->len - 1)),
+                 plot_y + plot_h);
+  cairo_line_to (cr, PX (g_array_index (history->priv->plotted, HistoryPoint, 0)), plot_y + plot_h);
+  cairo_close_path (cr);
+  cairo_set_source_rgba (cr, color.red, color.green, color.blue, 0.2);
+  cairo_fill (cr);
+
+#undef PX
+#undef PY
+
+  return FALSE;
+}
+
+static void
+xfpm_device_history_dispose (GObject *object)
+{
+  XfpmDeviceHistory *history = XFPM_DEVICE_HISTORY (object);
+
+  if ( history->priv->cancellable != NULL )
+  {
+    g_cancellable_cancel (history->priv->cancellable);
+    g_clear_object (&history->priv->cancellable);
+  }
+
+  if ( history->priv->device != NULL )
+  {
+    g_signal_handler_disconnect (history->priv->device, history->priv->notify_id);
+    g_clear_object (&history->priv->device);
+  }
+
+  g_clear_object (&history->priv->bus);
+
+  G_OBJECT_CLASS (xfpm_device_history_parent_class)->dispose (object);
+}
+
+static void
+xfpm_device_history_finalize (GObject *object)
+{
+  XfpmDeviceHistory *history = XFPM_DEVICE_HISTORY (object);
+
+  g_free (history->priv->object_path);
+  g_free (history->priv->history_type);
+  g_array_unref (history->priv->points);
+  if ( history->priv->plotted != NULL )
+    g_array_unref (history->priv->plotted);
+
+  G_OBJECT_CLASS (xfpm_device_history_parent_class)->finalize (object);
+}
+
+static void
+xfpm_device_history_class_init (XfpmDeviceHistoryClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+  object_class->dispose = xfpm_device_history_dispose;
+  object_class->finalize = xfpm_device_history_finalize;
+
+  widget_class->map = xfpm_device_history_map;
+  widget_class->draw = xfpm_device_history_draw;
+}
+
+static void
+xfpm_device_history_init (XfpmDeviceHistory *history)
+{
+  history->priv = xfpm_device_history_get_instance_private (history);
+
+  history->priv->points = g_array_new (FALSE, FALSE, sizeof (HistoryPoint));
+  history->priv->cancellable = g_cancellable_new ();
+
+  gtk_widget_set_size_request (GTK_WIDGET (history), -1, CHART_HEIGHT);
+}
+
+/**
+ * xfpm_device_history_new:
+ * @device: the device to chart
+ * @history_type: %XFPM_DEVICE_HISTORY_CHARGE or %XFPM_DEVICE_HISTORY_RATE
+ * @timespan: how far back to show, in seconds
+ *
+ * The history is only fetched once the widget is mapped, the last
+ * hour first and then the whole @timespan.
+ **/
+GtkWidget *
+xfpm_device_history_new (UpDevice *device, const gchar *history_type, guint timespan)
+{
+  XfpmDeviceHistory *history;
+  gchar *signal;
+
+  g_return_val_if_fail (UP_IS_DEVICE (device), NULL);
+
+  history = g_object_new (XFPM_TYPE_DEVICE_HISTORY, NULL);
+
+  history->priv->device = g_object_ref (device);
+  history->priv->object_path = g_strdup (up_device_get_object_path (device));
+  history->priv->history_type = g_strdup (history_type);
+  history->priv->timespan = MAX (timespan, 1);
+
+  /* Connecting doesn't hold up the dialog, the fetch starts from
+   * whichever of the connection and the map comes last */
+  g_bus_get (G_BUS_TYPE_SYSTEM, history->priv->cancellable,
+             xfpm_device_history_bus_ready_cb, history);
+
+  signal = g_strdup_printf ("notify::%s",
+                            g_strcmp0 (history_type, XFPM_DEVICE_HISTORY_CHARGE) == 0
+                            ? "percentage" : "energy-rate");
+  history->priv->notify_id = g_signal_connect (device, signal,
+                                               G_CALLBACK (xfpm_device_history_notify_cb), history);
+  g_free (signal);
+
+  return GTK_WIDGET (history);
+}
@@ -0,0 +1,61 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __XFPM_DEVICE_HISTORY_H
+#define __XFPM_DEVICE_HISTORY_H
+
+#include <gtk/gtk.h>
+#include <upower.h>
+
+G_BEGIN_DECLS
+
+/* History types known to UPower's GetHistory */
+#define XFPM_DEVICE_HISTORY_CHARGE  "charge"
+#define XFPM_DEVICE_HISTORY_RATE    "rate"
+
+#define XFPM_TYPE_DEVICE_HISTORY            (xfpm_device_history_get_type())
+#define XFPM_DEVICE_HISTORY(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), XFPM_TYPE_DEVICE_HISTORY, XfpmDeviceHistory))
+#define XFPM_IS_DEVICE_HISTORY(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj), XFPM_TYPE_DEVICE_HISTORY))
+
+typedef struct _XfpmDeviceHistory         XfpmDeviceHistory;
+typedef struct _XfpmDeviceHistoryClass    XfpmDeviceHistoryClass;
+typedef struct _XfpmDeviceHistoryPrivate  XfpmDeviceHistoryPrivate;
+
+struct _XfpmDeviceHistory
+{
+  GtkDrawingArea               parent;
+  XfpmDeviceHistoryPrivate    *priv;
+};
+
+struct _XfpmDeviceHistoryClass
+{
+  GtkDrawingAreaClass    parent_class;
+};
+
+
+GType                xfpm_device_history_get_type     (void) G_GNUC_CONST;
+GtkWidget           *xfpm_device_history_new          (UpDevice    *device,
+                                                       const gchar *history_type,
+                                                       guint        timespan);
+
+
+G_END_DECLS
+
+#endif /* __XFPM_DEVICE_HISTORY_H */
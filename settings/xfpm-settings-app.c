@@ -43,9 +43,11 @@ struct _XfpmSettingsAppPrivate
   gboolean          debug;
   Window            socket_id;
   gchar            *device_id;
+  XfpmPowerManager *manager;      /* set while querying the configuration */
 };
 
 static void xfpm_settings_app_launch     (GApplication *app);
+static gboolean get_config_retry_cb      (gpointer      user_data);
 
 static void activate_socket              (GSimpleAction  *action,
                                           GVariant       *parameter,
@@ -114,19 +116,16 @@ xfpm_settings_app_activate (GApplication *app)
 }
 
 static void
-xfpm_settings_app_launch (GApplication *app)
+xfpm_settings_app_show_dialog (XfpmSettingsApp *app, GVariant *config)
 {
-  XfpmSettingsAppPrivate *priv = xfpm_settings_app_get_instance_private (XFPM_SETTINGS_APP (app));
+  XfpmSettingsAppPrivate *priv = xfpm_settings_app_get_instance_private (app);
 
-  XfpmPowerManager *manager;
   XfconfChannel    *channel;
   GError           *error = NULL;
   GtkWidget        *dialog;
   GHashTable       *hash;
-  GVariant         *config;
   GVariantIter     *iter;
   gchar            *key, *value;
-  GList            *windows;
 
   gboolean has_battery;
   gboolean auth_suspend;
@@ -140,79 +139,6 @@ xfpm_settings_app_launch (GApplication *app)
   gboolean has_power_button;
   gboolean has_battery_button;
   gboolean has_lid;
-  gint     start_xfpm_if_not_running;
-
-  TRACE ("entering");
-
-  windows = gtk_application_get_windows (GTK_APPLICATION (app));
-
-  if (windows != NULL)
-  {
-    XFPM_DEBUG ("window already opened");
-
-    gdk_notify_startup_complete ();
-
-    if (priv->device_id != NULL)
-    {
-      xfpm_settings_show_device_id (priv->device_id);
-    }
-
-    return;
-  }
-
-  manager = xfpm_power_manager_proxy_new_for_bus_sync (G_BUS_TYPE_SESSION,
-                                                       G_BUS_NAME_OWNER_FLAGS_NONE,
-                                                       "org.xfce.PowerManager",
-                                                       "/org/xfce/PowerManager",
-                                                       NULL,
-                                                       &error);
-
-  if (error != NULL)
-  {
-    g_critical("xfpm_power_manager_proxy_new_sync failed: %s\n", error->message);
-    xfce_dialog_show_warning (NULL,
-                             _("Xfce Power Manager"),
-                             "%s",
-                             _("Failed to connect to power manager"));
-    g_clear_error (&error);
-    return;
-  }
-
-
-  while ( !xfpm_power_manager_call_get_config_sync (manager, &config, NULL, NULL) )
-  {
-    GtkWidget *startw;
-
-    startw = gtk_message_dialog_new (NULL,
-                                     GTK_DIALOG_MODAL,
-                                     GTK_MESSAGE_QUESTION,
-                                     GTK_BUTTONS_YES_NO,
-                                     _("Xfce4 Power Manager is not running, do you want to launch it now?"));
-    start_xfpm_if_not_running = gtk_dialog_run (GTK_DIALOG (startw));
-    gtk_widget_destroy (startw);
-
-    if (start_xfpm_if_not_running == GTK_RESPONSE_YES)
-    {
-      GAppInfo *app_info;
-
-      app_info = g_app_info_create_from_commandline ("xfce4-power-manager", "Xfce4 Power Manager",
-                                                     G_APP_INFO_CREATE_SUPPORTS_STARTUP_NOTIFICATION, NULL);
-      if (!g_app_info_launch (app_info, NULL, NULL, &error)) {
-          if (error != NULL) {
-            g_warning ("xfce4-power-manager could not be launched. %s", error->message);
-            g_error_free (error);
-            error = NULL;
-          }
-      }
-      /* wait 2 seconds for xfpm to startup */
-      g_usleep ( 2 * 1000000 );
-    }
-    else
-    {
-      /* exit without starting xfpm */
-      return;
-    }
-  }
 
   if ( !xfconf_init(&error) )
   {
@@ -236,7 +162,6 @@ xfpm_settings_app_launch (GApplication *app)
     g_hash_table_insert (hash, key, value);
   }
   g_variant_iter_free (iter);
-  g_variant_unref (config);
 
 
   has_battery = xfpm_string_to_bool (g_hash_table_lookup (hash, "has-battery"));
@@ -263,9 +188,129 @@ xfpm_settings_app_launch (GApplication *app)
   g_hash_table_destroy (hash);
 
   gtk_application_add_window (GTK_APPLICATION (app), GTK_WINDOW (dialog));
-  g_application_release (app);
+  g_application_release (G_APPLICATION (app));
+}
+
+static void
+get_config_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  XfpmSettingsApp *app = XFPM_SETTINGS_APP (user_data);
+  XfpmSettingsAppPrivate *priv = xfpm_settings_app_get_instance_private (app);
+  GVariant  *config = NULL;
+  GtkWidget *startw;
+  GError    *error = NULL;
+  gint       start_xfpm_if_not_running;
+
+  if ( xfpm_power_manager_call_get_config_finish (XFPM_POWER_MANAGER (source), &config, res, NULL) )
+  {
+    xfpm_settings_app_show_dialog (app, config);
+    g_variant_unref (config);
+    g_clear_object (&priv->manager);
+    return;
+  }
+
+  startw = gtk_message_dialog_new (NULL,
+                                   GTK_DIALOG_MODAL,
+                                   GTK_MESSAGE_QUESTION,
+                                   GTK_BUTTONS_YES_NO,
+                                   _("Xfce4 Power Manager is not running, do you want to launch it now?"));
+  start_xfpm_if_not_running = gtk_dialog_run (GTK_DIALOG (startw));
+  gtk_widget_destroy (startw);
+
+  if (start_xfpm_if_not_running == GTK_RESPONSE_YES)
+  {
+    GAppInfo *app_info;
+
+    app_info = g_app_info_create_from_commandline ("xfce4-power-manager", "Xfce4 Power Manager",
+                                                   G_APP_INFO_CREATE_SUPPORTS_STARTUP_NOTIFICATION, NULL);
+    if (!g_app_info_launch (app_info, NULL, NULL, &error)) {
+        if (error != NULL) {
+          g_warning ("xfce4-power-manager could not be launched. %s", error->message);
+          g_error_free (error);
+          error = NULL;
+        }
+    }
+    /* give xfpm 2 seconds to startup */
+    g_timeout_add_seconds (2, get_config_retry_cb, app);
+  }
+  else
+  {
+    /* exit without starting xfpm */
+    g_clear_object (&priv->manager);
+  }
+}
+
+static gboolean
+get_config_retry_cb (gpointer user_data)
+{
+  XfpmSettingsApp *app = XFPM_SETTINGS_APP (user_data);
+  XfpmSettingsAppPrivate *priv = xfpm_settings_app_get_instance_private (app);
+
+  xfpm_power_manager_call_get_config (priv->manager, NULL, get_config_cb, app);
+
+  return FALSE;
+}
+
+static void
+manager_proxy_ready_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  XfpmSettingsApp *app = XFPM_SETTINGS_APP (user_data);
+  XfpmSettingsAppPrivate *priv = xfpm_settings_app_get_instance_private (app);
+  GError *error = NULL;
+
+  priv->manager = xfpm_power_manager_proxy_new_for_bus_finish (res, &error);
+
+  if (error != NULL)
+  {
+    g_critical("xfpm_power_manager_proxy_new failed: %s\n", error->message);
+    xfce_dialog_show_warning (NULL,
+                             _("Xfce Power Manager"),
+                             "%s",
+                             _("Failed to connect to power manager"));
+    g_clear_error (&error);
+    return;
+  }
+
+  xfpm_power_manager_call_get_config (priv->manager, NULL, get_config_cb, app);
+}
+
+static void
+xfpm_settings_app_launch (GApplication *app)
+{
+  XfpmSettingsAppPrivate *priv = xfpm_settings_app_get_instance_private (XFPM_SETTINGS_APP (app));
+  GList *windows;
+
+  TRACE ("entering");
+
+  windows = gtk_application_get_windows (GTK_APPLICATION (app));
+
+  if (windows != NULL)
+  {
+    XFPM_DEBUG ("window already opened");
+
+    gdk_notify_startup_complete ();
+
+    if (priv->device_id != NULL)
+    {
+      xfpm_settings_show_device_id (priv->device_id);
+    }
+
+    return;
+  }
+
+  /* Still asking the power manager for its configuration */
+  if (priv->manager != NULL)
+    return;
 
-  g_object_unref (manager);
+  /* Don't block the main loop on the power manager, the dialog is
+   * created once it told us what the system supports */
+  xfpm_power_manager_proxy_new_for_bus (G_BUS_TYPE_SESSION,
+                                        G_DBUS_PROXY_FLAGS_NONE,
+                                        "org.xfce.PowerManager",
+                                        "/org/xfce/PowerManager",
+                                        NULL,
+                                        manager_proxy_ready_cb,
+                                        app);
 }
 
 static void
@@ -29,6 +29,7 @@
 
 #include <gtk/gtk.h>
 #include <glib.h>
+#include <gmodule.h>
 #include <upower.h>
 
 #include <xfconf/xfconf.h>
@@ -46,11 +47,15 @@
 #include "interfaces/xfpm-settings_ui.h"
 
 #include "xfpm-settings.h"
+#include "xfpm-device-history.h"
+#include "xfpm-consumers-view.h"
 #include "xfpm-config.h"
 #include "xfpm-enum-glib.h"
 #include "xfpm-enum.h"
 
 #define BRIGHTNESS_DISABLED   9
+/* How far back the device history charts go */
+#define DEVICE_HISTORY_TIMESPAN   (7 * 24 * 60 * 60)
 
 static  GtkApplication *app     = NULL;
 static  GtkBuilder *xml       = NULL;
@@ -95,6 +100,54 @@ static  UpClient *upower = NULL;
 
 static gint devices_page_num;
 
+/*
+ * Parts of the dialog that are filled in separately: the general and
+ * power ones the first time one of their tabs is shown, light-locker
+ * and the devices once the first frame is on screen, as they decide
+ * whether their tab is shown at all.
+ */
+typedef enum
+{
+  SETTINGS_SECTION_GENERAL,
+  SETTINGS_SECTION_POWER,         /* System and Display tabs */
+  SETTINGS_SECTION_LIGHT_LOCKER,
+  SETTINGS_SECTION_DEVICES,
+  N_SETTINGS_SECTIONS
+} SettingsSection;
+
+/* A GtkBuilder signal held back until its section is filled in */
+typedef struct
+{
+  GObject       *object;
+  gchar         *signal_name;
+  GCallback      handler;
+  GObject       *connect_object;
+  GConnectFlags  flags;
+} SettingsSignal;
+
+static gboolean  section_built[N_SETTINGS_SECTIONS];
+static GSList   *section_signals[N_SETTINGS_SECTIONS];
+
+/* What the dialog was created with, for the sections filled in later */
+static struct
+{
+  XfconfChannel *channel;
+  gboolean       auth_suspend;
+  gboolean       auth_hibernate;
+  gboolean       can_suspend;
+  gboolean       can_hibernate;
+  gboolean       can_shutdown;
+  gboolean       has_battery;
+  gboolean       has_lcd_brightness;
+  gboolean       has_lid;
+  gboolean       has_sleep_button;
+  gboolean       has_hibernate_button;
+  gboolean       has_power_button;
+  gboolean       has_battery_button;
+} caps;
+
+static gint64 dialog_created_time;
+
 
 enum
 {
@@ -1313,7 +1366,6 @@ xfpm_settings_general (XfconfChannel *channel, gboolean auth_suspend,
   GtkWidget *sleep_label;
   GtkWidget *battery_w;
   GtkWidget *battery_label;
-  GtkWidget *dpms;
 
   guint  value;
   guint list_value;
@@ -1323,14 +1375,6 @@ xfpm_settings_general (XfconfChannel *channel, gboolean auth_suspend,
   GtkListStore *list_store;
   GtkTreeIter iter;
 
-  dpms = GTK_WIDGET (gtk_builder_get_object (xml, "handle-dpms"));
-
-  /*
-   * Global dpms settings (enable/disable)
-   */
-  val = xfconf_channel_get_bool (channel, XFPM_PROPERTIES_PREFIX DPMS_ENABLED_CFG, TRUE);
-  gtk_switch_set_state (GTK_SWITCH (dpms), val);
-
   /*
    * Power button
    */
@@ -1755,6 +1799,7 @@ static void xfpm_settings_light_locker (XfconfChannel *channel,
 
   if (schema != NULL && get_light_locker_path() != NULL)
   {
+    gtk_widget_show (light_locker_tab);
     security_frame = GTK_WIDGET (gtk_builder_get_object (xml, "security-frame"));
     gtk_widget_hide (security_frame);
     /* Load the settings (Light Locker compiled with GSettings backend required) */
@@ -1819,70 +1864,69 @@ static void xfpm_settings_light_locker (XfconfChannel *channel,
 }
 /* END Light Locker Integration */
 
-/* Call gtk_tree_iter_free when done with the tree iter */
-static GtkTreeIter*
-find_device_in_tree (const gchar *object_path)
+/* A device's sidebar row and the rows of its details list, looked up
+ * by name so that an update only touches the rows that changed */
+typedef struct
 {
-  GtkTreeModel *model;
-  GtkTreeIter iter;
+  GtkTreeIter   sidebar_iter;     /* list store iters stay valid */
+  GtkListStore *store;
+  GHashTable   *rows;             /* name -> GtkTreeIter */
+  GHashTable   *values;           /* name -> value shown */
+  gchar        *icon_name;        /* shown in the sidebar */
+  gchar        *description;
+} DeviceInfo;
 
-  if ( !sideview )
-    return NULL;
+/* object path -> DeviceInfo */
+static GHashTable *device_infos = NULL;
 
-  model = gtk_tree_view_get_model(GTK_TREE_VIEW(sideview));
+static void
+device_info_free (DeviceInfo *info)
+{
+  g_object_unref (info->store);
+  g_hash_table_destroy (info->rows);
+  g_hash_table_destroy (info->values);
+  g_free (info->icon_name);
+  g_free (info->description);
+  g_free (info);
+}
 
-  if (!model)
-    return NULL;
+static DeviceInfo *
+device_info_new (GtkTreeIter *sidebar_iter, GtkListStore *store)
+{
+  DeviceInfo *info = g_new0 (DeviceInfo, 1);
 
-  if(gtk_tree_model_get_iter_first(model, &iter))
-  {
-    do {
-      gchar *path = NULL;
-      gtk_tree_model_get(model, &iter, COL_SIDEBAR_OBJECT_PATH, &path, -1);
+  info->sidebar_iter = *sidebar_iter;
+  info->store = g_object_ref (store);
+  info->rows = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) gtk_tree_iter_free);
+  info->values = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
-      if(g_strcmp0(path, object_path) == 0)
-      {
-        g_free(path);
-        return gtk_tree_iter_copy(&iter);
-      }
+  return info;
+}
 
-      g_free (path);
-    } while (gtk_tree_model_iter_next(model, &iter));
-  }
+static DeviceInfo *
+find_device_info (const gchar *object_path)
+{
+  if (device_infos == NULL || object_path == NULL)
+    return NULL;
 
-  return NULL;
+  return g_hash_table_lookup (device_infos, object_path);
 }
 
 /* Call gtk_tree_iter_free when done with the tree iter */
 static GtkTreeIter*
-find_device_info_name_in_tree (GtkTreeView *view, const gchar *device_info_name)
+find_device_in_tree (const gchar *object_path)
 {
-  GtkTreeModel *model;
-  GtkTreeIter iter;
+  DeviceInfo *info;
 
-  if ( !view )
+  if ( !sideview )
     return NULL;
 
-  model = gtk_tree_view_get_model (view);
+  info = find_device_info (object_path);
 
-  if (!model)
+  if (info == NULL)
     return NULL;
 
-  if (gtk_tree_model_get_iter_first (model, &iter)) {
-    do {
-      gchar *name = NULL;
-      gtk_tree_model_get (model, &iter, XFPM_DEVICE_INFO_NAME, &name, -1);
-
-      if(g_strcmp0 (name, device_info_name) == 0) {
-          g_free (name);
-          return gtk_tree_iter_copy (&iter);
-      }
-
-      g_free (name);
-    } while(gtk_tree_model_iter_next(model, &iter));
-  }
-
-  return NULL;
+  return gtk_tree_iter_copy (&info->sidebar_iter);
 }
 
 static gchar *
@@ -1896,102 +1940,111 @@ xfpm_info_get_energy_property (gdouble energy, const gchar *unit)
 }
 
 static void
-update_device_info_value_for_name (GtkTreeView *view,
-                                   GtkListStore *list_store,
+update_device_info_value_for_name (DeviceInfo *info,
                                    const gchar *name,
                                    const gchar *value)
 {
   GtkTreeIter *iter;
 
-  g_return_if_fail (GTK_IS_TREE_VIEW(view));
-  g_return_if_fail (GTK_IS_LIST_STORE(list_store));
+  g_return_if_fail (info != NULL);
   g_return_if_fail (name != NULL);
   /* Value can be NULL */
 
+  iter = g_hash_table_lookup (info->rows, name);
+
+  if (value == NULL)
+  {
+    /* The value no longer applies, remove the row */
+    if (iter != NULL)
+    {
+      gtk_list_store_remove (info->store, iter);
+      g_hash_table_remove (info->rows, name);
+      g_hash_table_remove (info->values, name);
+    }
+    return;
+  }
+
+  /* Unchanged, leave the row and the view alone */
+  if (g_strcmp0 (g_hash_table_lookup (info->values, name), value) == 0)
+    return;
+
   DBG ("updating  name %s with value %s", name, value);
 
-  iter = find_device_info_name_in_tree (view, name);
   if (iter == NULL)
   {
     /* The row doesn't exist yet, add it */
     GtkTreeIter new_iter;
-    gtk_list_store_append (list_store, &new_iter);
+    gtk_list_store_append (info->store, &new_iter);
     iter = gtk_tree_iter_copy (&new_iter);
+    g_hash_table_insert (info->rows, g_strdup (name), iter);
   }
 
-  if (value != NULL)
-  {
-    gtk_list_store_set (list_store, iter,
-                        XFPM_DEVICE_INFO_NAME, name,
-                        XFPM_DEVICE_INFO_VALUE, value,
-                        -1);
-  }
-  else
-  {
-    /* The value no longer applies, remove the row */
-    gtk_list_store_remove (list_store, iter);
-  }
+  gtk_list_store_set (info->store, iter,
+                      XFPM_DEVICE_INFO_NAME, name,
+                      XFPM_DEVICE_INFO_VALUE, value,
+                      -1);
 
-  gtk_tree_iter_free (iter);
+  g_hash_table_insert (info->values, g_strdup (name), g_strdup (value));
 }
 
 static void
-update_sideview_icon (UpDevice *device)
+update_sideview_icon (UpDevice *device, DeviceInfo *info)
 {
   GtkListStore *list_store;
-  GtkTreeIter *iter;
-  GdkPixbuf *pix;
-  guint type = 0;
-  gchar *name = NULL, *icon_name = NULL, *model = NULL, *vendor = NULL;
-  const gchar *object_path = up_device_get_object_path(device);
+  gchar *name = NULL, *icon_name = NULL;
 
   list_store = GTK_LIST_STORE (gtk_tree_view_get_model (GTK_TREE_VIEW (sideview)));
 
-  TRACE("entering for %s", object_path);
-
-  iter = find_device_in_tree (object_path);
-
-  /* quit if device doesn't exist in the sidebar */
-  if (!iter)
-    return;
-
-  /* hack, this depends on XFPM_DEVICE_TYPE_* being in sync with UP_DEVICE_KIND_* */
-  g_object_get (device,
-                "kind", &type,
-                "vendor", &vendor,
-                "model", &model,
-                NULL);
-
+  TRACE("entering for %s", up_device_get_object_path (device));
 
   name = get_device_description (upower, device);
   icon_name = get_device_icon_name (upower, device);
 
-  pix = gtk_icon_theme_load_icon (gtk_icon_theme_get_default (),
-                                  icon_name,
-                                  48,
-                                  GTK_ICON_LOOKUP_USE_BUILTIN,
-                                  NULL);
+  /* Loading the icon is the expensive part, only when it changed */
+  if (g_strcmp0 (icon_name, info->icon_name) != 0)
+  {
+    GdkPixbuf *pix;
 
-  gtk_list_store_set (list_store, iter,
-                      COL_SIDEBAR_ICON, pix,
-                      COL_SIDEBAR_NAME, name,
-                      -1);
+    pix = gtk_icon_theme_load_icon (gtk_icon_theme_get_default (),
+                                    icon_name,
+                                    48,
+                                    GTK_ICON_LOOKUP_USE_BUILTIN,
+                                    NULL);
 
-  if ( pix )
-    g_object_unref (pix);
+    gtk_list_store_set (list_store, &info->sidebar_iter,
+                        COL_SIDEBAR_ICON, pix,
+                        -1);
+
+    if ( pix )
+      g_object_unref (pix);
+
+    g_free (info->icon_name);
+    info->icon_name = icon_name;
+  }
+  else
+  {
+    g_free (icon_name);
+  }
 
-  g_free (name);
-  g_free (icon_name);
+  if (g_strcmp0 (name, info->description) != 0)
+  {
+    gtk_list_store_set (list_store, &info->sidebar_iter,
+                        COL_SIDEBAR_NAME, name,
+                        -1);
 
-  gtk_tree_iter_free (iter);
+    g_free (info->description);
+    info->description = name;
+  }
+  else
+  {
+    g_free (name);
+  }
 }
 
 static void
 update_device_details (UpDevice *device)
 {
-  GtkTreeView *view;
-  GtkListStore *list_store;
-  GtkTreeIter *sideview_iter;
+  DeviceInfo *info;
   gchar *str;
   guint type = 0, tech = 0;
   gdouble energy_full_design = -1.0, energy_full = -1.0, energy_empty = -1.0, voltage = -1.0, percent = -1.0;
@@ -2002,26 +2055,19 @@ update_device_details (UpDevice *device)
 
   TRACE("entering for %s", object_path);
 
-  sideview_iter = find_device_in_tree (object_path);
+  info = find_device_info (object_path);
 
   /* quit if device doesn't exist in the sidebar */
-  if (sideview_iter == NULL)
+  if (info == NULL)
     return;
 
-  gtk_tree_model_get (gtk_tree_view_get_model (GTK_TREE_VIEW(sideview)), sideview_iter,
-                      COL_SIDEBAR_VIEW, &view,
-                      -1);
-
-  list_store = GTK_LIST_STORE (gtk_tree_view_get_model (view));
-
   /**
    * Add/Update Device information:
    **/
   /*Device*/
-  update_device_info_value_for_name (view,
-                                    list_store,
-                                    _("Device"),
-                                    g_str_has_prefix (object_path, UPOWER_PATH_DEVICE) ? object_path + strlen (UPOWER_PATH_DEVICE) : object_path);
+  update_device_info_value_for_name (info,
+                                     _("Device"),
+                                     g_str_has_prefix (object_path, UPOWER_PATH_DEVICE) ? object_path + strlen (UPOWER_PATH_DEVICE) : object_path);
 
   /*Type*/
   /* hack, this depends on XFPM_DEVICE_TYPE_* being in sync with UP_DEVICE_KIND_* */
@@ -2042,11 +2088,10 @@ update_device_details (UpDevice *device)
   if (type != UP_DEVICE_KIND_UNKNOWN)
   {
     battery_type = xfpm_power_translate_device_type (type);
-    update_device_info_value_for_name (view, list_store, _("Type"), battery_type);
+    update_device_info_value_for_name (info, _("Type"), battery_type);
   }
 
-  update_device_info_value_for_name (view,
-                                     list_store,
+  update_device_info_value_for_name (info,
                                      _("PowerSupply"),
                                      p_supply == TRUE ? _("True") : _("False"));
 
@@ -2055,17 +2100,17 @@ update_device_details (UpDevice *device)
     /*Model*/
     if (model && strlen (model) > 0)
     {
-      update_device_info_value_for_name (view, list_store, _("Model"), model);
+      update_device_info_value_for_name (info, _("Model"), model);
     }
 
-    update_device_info_value_for_name (view, list_store, _("Technology"), xfpm_power_translate_technology (tech));
+    update_device_info_value_for_name (info, _("Technology"), xfpm_power_translate_technology (tech));
 
     /*Percentage*/
     if (percent >= 0)
     {
       str = g_strdup_printf("%d%%", (guint) percent);
 
-      update_device_info_value_for_name (view, list_store, _("Current charge"), str);
+      update_device_info_value_for_name (info, _("Current charge"), str);
 
       g_free(str);
     }
@@ -2075,7 +2120,7 @@ update_device_details (UpDevice *device)
       /* TRANSLATORS: Unit here is Watt hour*/
       str = xfpm_info_get_energy_property (energy_full_design, _("Wh"));
 
-      update_device_info_value_for_name (view, list_store, _("Fully charged (design)"), str);
+      update_device_info_value_for_name (info, _("Fully charged (design)"), str);
 
       g_free (str);
     }
@@ -2088,7 +2133,7 @@ update_device_details (UpDevice *device)
       str = xfpm_info_get_energy_property (energy_full, _("Wh"));
       str2 = g_strdup_printf ("%s (%d%%)", str, (guint) (energy_full / energy_full_design *100));
 
-      update_device_info_value_for_name (view, list_store, _("Fully charged"), str2);
+      update_device_info_value_for_name (info, _("Fully charged"), str2);
 
       g_free (str);
       g_free (str2);
@@ -2099,7 +2144,7 @@ update_device_details (UpDevice *device)
       /* TRANSLATORS: Unit here is Watt hour*/
       str = xfpm_info_get_energy_property (energy_empty, _("Wh"));
 
-      update_device_info_value_for_name (view, list_store, _("Energy empty"), str);
+      update_device_info_value_for_name (info, _("Energy empty"), str);
 
       g_free (str);
     }
@@ -2109,24 +2154,27 @@ update_device_details (UpDevice *device)
       /* TRANSLATORS: Unit here is Volt*/
       str = xfpm_info_get_energy_property (voltage, _("V"));
 
-      update_device_info_value_for_name (view, list_store, _("Voltage"), str);
+      update_device_info_value_for_name (info, _("Voltage"), str);
 
       g_free (str);
     }
 
     if (vendor && strlen (vendor) > 0)
     {
-      update_device_info_value_for_name (view, list_store, _("Vendor"), vendor);
+      update_device_info_value_for_name (info, _("Vendor"), vendor);
     }
 
     if (serial && strlen (serial) > 0)
     {
-      update_device_info_value_for_name (view, list_store, _("Serial"), serial);
+      update_device_info_value_for_name (info, _("Serial"), serial);
     }
   }
 
-  update_sideview_icon (device);
-  gtk_widget_show_all (GTK_WIDGET(view));
+  update_sideview_icon (device, info);
+
+  g_free (model);
+  g_free (vendor);
+  g_free (serial);
 }
 
 static void
@@ -2142,10 +2190,11 @@ add_device (UpDevice *device)
   GtkListStore *sideview_store, *devices_store;
   GtkTreeViewColumn *col;
   GtkCellRenderer *renderer;
-  GtkWidget *frame, *view;
+  GtkWidget *frame, *box, *view;
   const gchar *object_path = up_device_get_object_path(device);
   gulong signal_id;
   guint index;
+  gboolean has_history = FALSE;
   static gboolean first_run = TRUE;
 
   TRACE("entering for %s", object_path);
@@ -2169,8 +2218,23 @@ add_device (UpDevice *device)
 
   /* Create the page that the update_device_details will update/replace */
   frame = gtk_frame_new (NULL);
+  box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
   view = gtk_tree_view_new ();
-  gtk_container_add (GTK_CONTAINER (frame), view);
+  gtk_box_pack_start (GTK_BOX (box), view, FALSE, FALSE, 0);
+
+  /* Charge and rate over the last days, fetched when the page is shown */
+  g_object_get (device, "has-history", &has_history, NULL);
+  if (has_history)
+  {
+    gtk_box_pack_start (GTK_BOX (box),
+                        xfpm_device_history_new (device, XFPM_DEVICE_HISTORY_CHARGE, DEVICE_HISTORY_TIMESPAN),
+                        FALSE, FALSE, 0);
+    gtk_box_pack_start (GTK_BOX (box),
+                        xfpm_device_history_new (device, XFPM_DEVICE_HISTORY_RATE, DEVICE_HISTORY_TIMESPAN),
+                        FALSE, FALSE, 0);
+  }
+
+  gtk_container_add (GTK_CONTAINER (frame), box);
   gtk_widget_show_all (frame);
   gtk_notebook_append_page (GTK_NOTEBOOK (device_details_notebook), frame, NULL);
   gtk_tree_view_set_headers_visible (GTK_TREE_VIEW (view), FALSE);
@@ -2205,6 +2269,10 @@ add_device (UpDevice *device)
                       COL_SIDEBAR_VIEW, view,
                       -1);
 
+  if (device_infos == NULL)
+    device_infos = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) device_info_free);
+  g_hash_table_insert (device_infos, g_strdup (object_path), device_info_new (&iter, devices_store));
+
   /* Add the icon and description for the device */
   update_device_details (device);
 
@@ -2249,6 +2317,7 @@ remove_device (const gchar *object_path)
                       -1);
 
   gtk_list_store_remove (list_store, iter);
+  g_hash_table_remove (device_infos, object_path);
 
   if (device)
     g_signal_handler_disconnect (device, signal_id);
@@ -2271,39 +2340,139 @@ device_removed_cb (UpClient *upclient, const gchar *object_path, gpointer user_d
 }
 
 static void
-add_all_devices (void)
+devices_list_add (UpClient *client, GPtrArray *devices)
 {
-  GPtrArray *array = NULL;
   guint i;
 
-#if UP_CHECK_VERSION(0, 99, 8)
-  array = up_client_get_devices2 (upower);
-#else
-  array = up_client_get_devices (upower);
-#endif
+  upower = client;
+
+  g_signal_connect (upower, "device-added", G_CALLBACK (device_added_cb), NULL);
+  g_signal_connect (upower, "device-removed", G_CALLBACK (device_removed_cb), NULL);
 
-  if ( array )
+  if ( devices )
   {
-    for ( i = 0; i < array->len; i++)
+    for ( i = 0; i < devices->len; i++)
     {
-      UpDevice *device = g_ptr_array_index (array, i);
+      UpDevice *device = g_ptr_array_index (devices, i);
 
       add_device (device);
     }
-    g_ptr_array_free (array, TRUE);
   }
+
+  XFPM_DEBUG ("devices listed %.1f ms after the dialog was created",
+              (g_get_monotonic_time () - dialog_created_time) / 1000.0);
+}
+
+#if UP_CHECK_VERSION(1, 90, 0)
+static void
+devices_list_ready_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  UpClient *client = UP_CLIENT (source);
+  GPtrArray *devices;
+  GError *error = NULL;
+
+  devices = up_client_get_devices_finish (client, res, &error);
+
+  if (devices == NULL)
+  {
+    g_warning ("Unable to list the UPower devices: %s", error->message);
+    g_error_free (error);
+  }
+
+  /* Keep the client, devices may still show up later */
+  devices_list_add (client, devices);
+
+  if (devices != NULL)
+    g_ptr_array_unref (devices);
+}
+
+static void
+devices_list_client_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  UpClient *client;
+  GError *error = NULL;
+
+  client = up_client_new_finish (res, &error);
+
+  if (client == NULL)
+  {
+    g_warning ("Unable to connect to UPower: %s", error->message);
+    g_error_free (error);
+    return;
+  }
+
+  up_client_get_devices_async (client, NULL, devices_list_ready_cb, NULL);
 }
 
 static void
 settings_create_devices_list (void)
 {
-  upower = up_client_new ();
+  up_client_new_async (NULL, devices_list_client_cb, NULL);
+}
+#else
+typedef struct
+{
+  UpClient  *client;
+  GPtrArray *devices;
+} DevicesList;
 
-  g_signal_connect (upower, "device-added", G_CALLBACK (device_added_cb), NULL);
-  g_signal_connect (upower, "device-removed", G_CALLBACK (device_removed_cb), NULL);
+static void
+devices_list_free (DevicesList *list)
+{
+  if (list->client != NULL)
+    g_object_unref (list->client);
+  if (list->devices != NULL)
+    g_ptr_array_free (list->devices, TRUE);
+  g_free (list);
+}
+
+/* Without the async UPower API, connecting and enumerating the devices
+ * are blocking calls, make them away from the main loop. The proxies are
+ * bound to the global default context, so their signals still arrive
+ * there. */
+static void
+devices_list_thread (GTask *task, gpointer source_object,
+                     gpointer task_data, GCancellable *cancellable)
+{
+  DevicesList *list = g_new0 (DevicesList, 1);
+
+  list->client = up_client_new ();
+
+#if UP_CHECK_VERSION(0, 99, 8)
+  list->devices = up_client_get_devices2 (list->client);
+#else
+  list->devices = up_client_get_devices (list->client);
+#endif
+
+  g_task_return_pointer (task, list, (GDestroyNotify) devices_list_free);
+}
+
+static void
+devices_list_ready_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  DevicesList *list;
+
+  list = g_task_propagate_pointer (G_TASK (res), NULL);
+
+  if (list == NULL)
+    return;
+
+  devices_list_add (list->client, list->devices);
+  list->client = NULL;
+
+  devices_list_free (list);
+}
 
-  add_all_devices ();
+static void
+settings_create_devices_list (void)
+{
+  GTask *task;
+
+  task = g_task_new (NULL, NULL, devices_list_ready_cb, NULL);
+  g_task_run_in_thread (task, devices_list_thread);
+  g_object_unref (task);
 }
+#endif
 
 static void
 view_cursor_changed_cb (GtkTreeView *view, gpointer *user_data)
@@ -2356,6 +2525,216 @@ delete_event_cb (GtkWidget *plug, GdkEvent *ev, XfconfChannel *channel)
   settings_quit (plug, channel);
 }
 
+static gint
+settings_section_for_page (GtkWidget *widget)
+{
+  static const struct
+  {
+    const gchar     *page;
+    SettingsSection  section;
+  } pages[] =
+  {
+    { "general-tab",        SETTINGS_SECTION_GENERAL },
+    { "system-tab",         SETTINGS_SECTION_POWER },
+    { "display-tab",        SETTINGS_SECTION_POWER },
+    { "light-locker-vbox1", SETTINGS_SECTION_LIGHT_LOCKER },
+  };
+  GtkWidget *page;
+  guint i;
+
+  for ( i = 0; i < G_N_ELEMENTS (pages); i++ )
+  {
+    page = GTK_WIDGET (gtk_builder_get_object (xml, pages[i].page));
+    if ( widget == page || gtk_widget_is_ancestor (widget, page) )
+      return pages[i].section;
+  }
+
+  if ( widget == gtk_notebook_get_nth_page (GTK_NOTEBOOK (nt), devices_page_num) )
+    return SETTINGS_SECTION_DEVICES;
+
+  return -1;
+}
+
+static void
+settings_connect_signal (SettingsSignal *signal)
+{
+  if ( signal->connect_object != NULL )
+    g_signal_connect_object (signal->object, signal->signal_name, signal->handler,
+                             signal->connect_object, signal->flags);
+  else
+    g_signal_connect_data (signal->object, signal->signal_name, signal->handler,
+                           caps.channel, NULL, signal->flags);
+}
+
+static void
+settings_signal_free (SettingsSignal *signal)
+{
+  g_free (signal->signal_name);
+  g_free (signal);
+}
+
+static void
+settings_build_section (SettingsSection section)
+{
+  GtkWidget *stack;
+  GSList *l;
+  gint64 start;
+
+  if ( section_built[section] )
+    return;
+
+  section_built[section] = TRUE;
+  start = g_get_monotonic_time ();
+
+  switch ( section )
+  {
+    case SETTINGS_SECTION_GENERAL:
+      xfpm_settings_general (caps.channel, caps.auth_suspend, caps.auth_hibernate,
+                             caps.can_suspend, caps.can_hibernate, caps.can_shutdown,
+                             caps.has_sleep_button, caps.has_hibernate_button,
+                             caps.has_power_button, caps.has_battery_button);
+      break;
+
+    case SETTINGS_SECTION_POWER:
+      /* Global dpms settings (enable/disable) */
+      gtk_switch_set_state (GTK_SWITCH (gtk_builder_get_object (xml, "handle-dpms")),
+                            xfconf_channel_get_bool (caps.channel, XFPM_PROPERTIES_PREFIX DPMS_ENABLED_CFG, TRUE));
+
+      xfpm_settings_on_ac (caps.channel,
+                           caps.auth_suspend,
+                           caps.auth_hibernate,
+                           caps.can_suspend,
+                           caps.can_hibernate,
+                           caps.has_lcd_brightness,
+                           caps.has_lid);
+
+      if ( caps.has_battery )
+        xfpm_settings_on_battery (caps.channel,
+                                  caps.auth_suspend,
+                                  caps.auth_hibernate,
+                                  caps.can_suspend,
+                                  caps.can_hibernate,
+                                  caps.can_shutdown,
+                                  caps.has_lcd_brightness,
+                                  caps.has_lid);
+      else
+      {
+        gtk_widget_hide (GTK_WIDGET (gtk_builder_get_object (xml ,"critical-power-frame")));
+        stack = GTK_WIDGET (gtk_builder_get_object (xml ,"system-stack"));
+        gtk_widget_hide (gtk_stack_get_child_by_name (GTK_STACK (stack), "page0"));
+        stack = GTK_WIDGET (gtk_builder_get_object (xml ,"display-stack"));
+        gtk_widget_hide (gtk_stack_get_child_by_name (GTK_STACK (stack), "page0"));
+        gtk_widget_hide (GTK_WIDGET (gtk_builder_get_object (xml ,"system-stack-switcher")));
+        gtk_widget_hide (GTK_WIDGET (gtk_builder_get_object (xml ,"display-stack-switcher")));
+      }
+
+      xfpm_settings_advanced (caps.channel, caps.auth_suspend, caps.auth_hibernate,
+                              caps.can_suspend, caps.can_hibernate, caps.has_battery);
+      break;
+
+    case SETTINGS_SECTION_LIGHT_LOCKER:
+      xfpm_settings_light_locker (caps.channel, caps.auth_suspend, caps.auth_hibernate,
+                                  caps.can_suspend, caps.can_hibernate);
+      break;
+
+    case SETTINGS_SECTION_DEVICES:
+      settings_create_devices_list ();
+      break;
+
+    default:
+      g_assert_not_reached ();
+  }
+
+  /* As before, the handlers from the UI file only see the user's
+   * changes, not the initial values set above */
+  section_signals[section] = g_slist_reverse (section_signals[section]);
+  for ( l = section_signals[section]; l != NULL; l = l->next )
+    settings_connect_signal (l->data);
+  g_slist_free_full (section_signals[section], (GDestroyNotify) settings_signal_free);
+  section_signals[section] = NULL;
+
+  XFPM_DEBUG ("section %d filled in %.1f ms", section,
+              (g_get_monotonic_time () - start) / 1000.0);
+}
+
+static void
+settings_connect_signal_cb (GtkBuilder *builder, GObject *object,
+                            const gchar *signal_name, const gchar *handler_name,
+                            GObject *connect_object, GConnectFlags flags,
+                            gpointer user_data)
+{
+  static GModule *module = NULL;
+  SettingsSignal *signal;
+  gpointer handler;
+  gint section = -1;
+
+  if ( module == NULL )
+    module = g_module_open (NULL, 0);
+
+  if ( module == NULL || !g_module_symbol (module, handler_name, &handler) )
+  {
+    g_warning ("Could not find signal handler '%s'", handler_name);
+    return;
+  }
+
+  signal = g_new0 (SettingsSignal, 1);
+  signal->object = object;
+  signal->signal_name = g_strdup (signal_name);
+  signal->handler = G_CALLBACK (handler);
+  signal->connect_object = connect_object;
+  signal->flags = flags;
+
+  if ( GTK_IS_WIDGET (object) )
+    section = settings_section_for_page (GTK_WIDGET (object));
+
+  if ( section >= 0 && !section_built[section] )
+  {
+    section_signals[section] = g_slist_prepend (section_signals[section], signal);
+    return;
+  }
+
+  settings_connect_signal (signal);
+  settings_signal_free (signal);
+}
+
+static void
+settings_build_page (GtkWidget *page)
+{
+  gint section = settings_section_for_page (page);
+
+  if ( section >= 0 )
+    settings_build_section (section);
+}
+
+static void
+notebook_switch_page_cb (GtkNotebook *notebook, GtkWidget *page,
+                         guint page_num, gpointer user_data)
+{
+  settings_build_page (page);
+}
+
+static gboolean
+settings_build_background_cb (gpointer user_data)
+{
+  settings_build_section (SETTINGS_SECTION_LIGHT_LOCKER);
+  settings_build_section (SETTINGS_SECTION_DEVICES);
+
+  return FALSE;
+}
+
+static gboolean
+first_frame_cb (GtkWidget *widget, cairo_t *cr, gpointer user_data)
+{
+  g_signal_handlers_disconnect_by_func (widget, first_frame_cb, user_data);
+
+  XFPM_DEBUG ("first frame drawn %.1f ms after the dialog was created",
+              (g_get_monotonic_time () - dialog_created_time) / 1000.0);
+
+  g_idle_add (settings_build_background_cb, NULL);
+
+  return FALSE;
+}
+
 GtkWidget *
 xfpm_settings_dialog_new (XfconfChannel *channel, gboolean auth_suspend,
                           gboolean auth_hibernate, gboolean can_suspend,
@@ -2373,8 +2752,8 @@ xfpm_settings_dialog_new (XfconfChannel *channel, gboolean auth_suspend,
   GtkWidget *viewport;
   GtkWidget *hbox;
   GtkWidget *frame;
+  GtkWidget *consumers;
   GtkWidget *switch_widget;
-  GtkWidget *stack;
   GtkStyleContext *context;
   GtkListStore *list_store;
   GtkTreeViewColumn *col;
@@ -2383,6 +2762,8 @@ xfpm_settings_dialog_new (XfconfChannel *channel, gboolean auth_suspend,
   guint val;
   GtkCssProvider *css_provider;
 
+  dialog_created_time = g_get_monotonic_time ();
+
   XFPM_DEBUG ("auth_hibernate=%s auth_suspend=%s can_shutdown=%s can_suspend=%s can_hibernate=%s " \
               "has_battery=%s has_lcd_brightness=%s has_lid=%s has_sleep_button=%s " \
               "has_hibernate_button=%s has_power_button=%s has_battery_button=%s",
@@ -2497,44 +2878,27 @@ xfpm_settings_dialog_new (XfconfChannel *channel, gboolean auth_suspend,
   gtk_widget_show_all (hbox);
   gtk_widget_hide (gtk_notebook_get_nth_page (GTK_NOTEBOOK (nt), devices_page_num));
 
-  settings_create_devices_list ();
-
-  xfpm_settings_on_ac (channel,
-                       auth_suspend,
-                       auth_hibernate,
-                       can_suspend,
-                       can_hibernate,
-                       has_lcd_brightness,
-                       has_lid);
-
-  if ( has_battery )
-  xfpm_settings_on_battery (channel,
-                            auth_suspend,
-                            auth_hibernate,
-                            can_suspend,
-                            can_hibernate,
-                            can_shutdown,
-                            has_lcd_brightness,
-                            has_lid);
-  else
-  {
-    gtk_widget_hide (GTK_WIDGET (gtk_builder_get_object (xml ,"critical-power-frame")));
-    stack = GTK_WIDGET (gtk_builder_get_object (xml ,"system-stack"));
-    gtk_widget_hide (gtk_stack_get_child_by_name (GTK_STACK (stack), "page0"));
-    stack = GTK_WIDGET (gtk_builder_get_object (xml ,"display-stack"));
-    gtk_widget_hide (gtk_stack_get_child_by_name (GTK_STACK (stack), "page0"));
-    gtk_widget_hide (GTK_WIDGET (gtk_builder_get_object (xml ,"system-stack-switcher")));
-    gtk_widget_hide (GTK_WIDGET (gtk_builder_get_object (xml ,"display-stack-switcher")));
-  }
-
-  xfpm_settings_general (channel, auth_suspend, auth_hibernate, can_suspend, can_hibernate, can_shutdown,
-                         has_sleep_button, has_hibernate_button, has_power_button, has_battery_button);
-
-  xfpm_settings_advanced (channel, auth_suspend, auth_hibernate, can_suspend, can_hibernate, has_battery);
-
-  /* Light Locker Integration */
-  xfpm_settings_light_locker (channel, auth_suspend, auth_hibernate, can_suspend, can_hibernate);
-  /* END Light Locker Integration */
+  /* Processes using the most power, only sampled while the tab is shown */
+  consumers = xfpm_consumers_view_new ();
+  gtk_widget_show_all (consumers);
+  gtk_notebook_append_page (GTK_NOTEBOOK (nt), consumers, gtk_label_new (_("Power Usage")));
+
+  caps.channel = channel;
+  caps.auth_suspend = auth_suspend;
+  caps.auth_hibernate = auth_hibernate;
+  caps.can_suspend = can_suspend;
+  caps.can_hibernate = can_hibernate;
+  caps.can_shutdown = can_shutdown;
+  caps.has_battery = has_battery;
+  caps.has_lcd_brightness = has_lcd_brightness;
+  caps.has_lid = has_lid;
+  caps.has_sleep_button = has_sleep_button;
+  caps.has_hibernate_button = has_hibernate_button;
+  caps.has_power_button = has_power_button;
+  caps.has_battery_button = has_battery_button;
+
+  /* Shown once we know light-locker is installed */
+  gtk_widget_hide (GTK_WIDGET (gtk_builder_get_object (xml, "light-locker-vbox1")));
 
   if ( !has_lcd_brightness )
   {
@@ -2567,15 +2931,24 @@ xfpm_settings_dialog_new (XfconfChannel *channel, gboolean auth_suspend,
 
     g_signal_connect (plug, "delete-event",
           G_CALLBACK (delete_event_cb), channel);
+    g_signal_connect_after (plug, "draw", G_CALLBACK (first_frame_cb), NULL);
     gdk_notify_startup_complete ();
   }
   else
   {
     g_signal_connect (dialog, "response", G_CALLBACK (dialog_response_cb), channel);
-    gtk_widget_show (dialog);
+    g_signal_connect_after (dialog, "draw", G_CALLBACK (first_frame_cb), NULL);
   }
 
-  gtk_builder_connect_signals (xml, channel);
+  /* Only the tab on screen is filled in now, the others when first shown */
+  settings_build_page (gtk_notebook_get_nth_page (GTK_NOTEBOOK (nt),
+                                                 gtk_notebook_get_current_page (GTK_NOTEBOOK (nt))));
+  g_signal_connect (nt, "switch-page", G_CALLBACK (notebook_switch_page_cb), NULL);
+
+  gtk_builder_connect_signals_full (xml, settings_connect_signal_cb, channel);
+
+  if ( id == 0 )
+    gtk_widget_show (dialog);
 
   /* If we passed in a device to display, show the devices tab now, otherwise hide it */
   if (device_id != NULL)
@@ -2617,4 +2990,9 @@ xfpm_settings_show_device_id (gchar *device_id)
     view_cursor_changed_cb (GTK_TREE_VIEW (sideview), NULL);
     gtk_tree_iter_free (device_iter);
   }
+  else
+  {
+    /* Still being listed, select it once it is added */
+    starting_device_id = device_id;
+  }
 }
@@ -71,13 +71,13 @@ struct XfpmBacklightPrivate
   XfpmButton     *button;
   XfpmNotify     *notify;
 
-  NotifyNotification *n;
-
   gboolean      has_hw;
   gboolean      on_battery;
 
   gint32          last_level;
   gint32      max_level;
+  /* Last level that was set or read, what brightness-changed reported */
+  gint32          level;
 
   guint           brightness_step_count;
   gboolean        brightness_exponential;
@@ -90,6 +90,14 @@ struct XfpmBacklightPrivate
   gboolean      block;
 };
 
+enum
+{
+  BRIGHTNESS_CHANGED,
+  LAST_SIGNAL
+};
+
+static guint signals [LAST_SIGNAL] = { 0 };
+
 enum
 {
   PROP_0,
@@ -100,6 +108,15 @@ enum
 
 G_DEFINE_TYPE_WITH_PRIVATE (XfpmBacklight, xfpm_backlight, G_TYPE_OBJECT)
 
+static void
+xfpm_backlight_level_changed (XfpmBacklight *backlight, gint32 level)
+{
+  if ( backlight->priv->level == level )
+    return;
+
+  backlight->priv->level = level;
+  g_signal_emit (G_OBJECT (backlight), signals [BRIGHTNESS_CHANGED], 0, level);
+}
 
 static void
 xfpm_backlight_dim_brightness (XfpmBacklight *backlight)
@@ -122,6 +139,8 @@ xfpm_backlight_dim_brightness (XfpmBacklight *backlight)
       return;
     }
 
+    xfpm_backlight_level_changed (backlight, backlight->priv->last_level);
+
     dim_level = dim_level * backlight->priv->max_level / 100;
 
     /**
@@ -132,49 +151,28 @@ xfpm_backlight_dim_brightness (XfpmBacklight *backlight)
     {
       XFPM_DEBUG ("Current brightness level before dimming : %d, new %d", backlight->priv->last_level, dim_level);
       backlight->priv->dimmed = xfpm_brightness_set_level (backlight->priv->brightness, dim_level);
+      if ( backlight->priv->dimmed )
+        xfpm_backlight_level_changed (backlight, dim_level);
     }
   }
 }
 
-static gboolean
-xfpm_backlight_destroy_popup (gpointer data)
-{
-  XfpmBacklight *backlight;
-
-  backlight = XFPM_BACKLIGHT (data);
-
-  if ( backlight->priv->n )
-  {
-    g_object_unref (backlight->priv->n);
-    backlight->priv->n = NULL;
-  }
-
-  return FALSE;
-}
-
 static void
 xfpm_backlight_show_notification (XfpmBacklight *backlight, gfloat value)
 {
   gchar *summary;
 
-  /* create the notification on demand */
-  if ( backlight->priv->n == NULL )
-  {
-    /* generate a human-readable summary for the notification */
-    summary = g_strdup_printf (_("Brightness: %.0f percent"), value);
-    backlight->priv->n = xfpm_notify_new_notification (backlight->priv->notify,
-                                                       _("Power Manager"),
-                                                       summary,
-                                                       XFPM_DISPLAY_BRIGHTNESS_ICON,
-                                                       XFPM_NOTIFY_NORMAL);
-    g_free (summary);
-  }
-
-  /* add the brightness value to the notification */
-  notify_notification_set_hint (backlight->priv->n, "value", g_variant_new_int32 (value));
-
-  /* show the notification */
-  notify_notification_show (backlight->priv->n, NULL);
+  /* generate a human-readable summary for the notification */
+  summary = g_strdup_printf (_("Brightness: %.0f percent"), value);
+
+  /* updates the one already on screen, steps in a burst are coalesced */
+  xfpm_notify_show_value (backlight->priv->notify,
+                          XFPM_NOTIFY_CATEGORY_BRIGHTNESS,
+                          _("Power Manager"),
+                          summary,
+                          XFPM_DISPLAY_BRIGHTNESS_ICON,
+                          value);
+  g_free (summary);
 }
 
 static void
@@ -208,26 +206,46 @@ xfpm_backlight_reset_cb (EggIdletime *idle, XfpmBacklight *backlight)
     if ( !backlight->priv->block)
     {
       XFPM_DEBUG ("Alarm reset, setting level to %d", backlight->priv->last_level);
-      xfpm_brightness_set_level (backlight->priv->brightness, backlight->priv->last_level);
+      if ( xfpm_brightness_set_level (backlight->priv->brightness, backlight->priv->last_level) )
+        xfpm_backlight_level_changed (backlight, backlight->priv->last_level);
     }
     backlight->priv->dimmed = FALSE;
   }
 }
 
+static gboolean
+xfpm_backlight_step_level (XfpmBacklight *backlight, gboolean up, gint32 *level)
+{
+  guint    brightness_step_count;
+  gboolean brightness_exponential;
+  gboolean ret;
+
+  g_object_get (G_OBJECT (backlight->priv->conf),
+                BRIGHTNESS_STEP_COUNT, &brightness_step_count,
+                BRIGHTNESS_EXPONENTIAL, &brightness_exponential,
+                NULL);
+
+  xfpm_brightness_set_step_count(backlight->priv->brightness,
+                                 brightness_step_count,
+                                 brightness_exponential);
+  if ( up )
+    ret = xfpm_brightness_up (backlight->priv->brightness, level);
+  else
+    ret = xfpm_brightness_down (backlight->priv->brightness, level);
+
+  return ret;
+}
+
 static void
 xfpm_backlight_button_pressed_cb (XfpmButton *button, XfpmButtonKey type, XfpmBacklight *backlight)
 {
   gint32   level;
   gboolean ret = TRUE;
   gboolean handle_brightness_keys, show_popup;
-  guint    brightness_step_count;
-  gboolean brightness_exponential;
 
   g_object_get (G_OBJECT (backlight->priv->conf),
                 HANDLE_BRIGHTNESS_KEYS, &handle_brightness_keys,
                 SHOW_BRIGHTNESS_POPUP, &show_popup,
-                BRIGHTNESS_STEP_COUNT, &brightness_step_count,
-                BRIGHTNESS_EXPONENTIAL, &brightness_exponential,
                 NULL);
 
   if ( type != BUTTON_MON_BRIGHTNESS_UP && type != BUTTON_MON_BRIGHTNESS_DOWN )
@@ -237,15 +255,11 @@ xfpm_backlight_button_pressed_cb (XfpmButton *button, XfpmButtonKey type, XfpmBa
   if ( !handle_brightness_keys )
     ret = xfpm_brightness_get_level (backlight->priv->brightness, &level);
   else
-  {
-    xfpm_brightness_set_step_count(backlight->priv->brightness,
-                                   brightness_step_count,
-                                   brightness_exponential);
-    if ( type == BUTTON_MON_BRIGHTNESS_UP )
-      ret = xfpm_brightness_up (backlight->priv->brightness, &level);
-    else
-      ret = xfpm_brightness_down (backlight->priv->brightness, &level);
-  }
+    ret = xfpm_backlight_step_level (backlight, type == BUTTON_MON_BRIGHTNESS_UP, &level);
+
+  if ( ret )
+    xfpm_backlight_level_changed (backlight, level);
+
   if ( ret && show_popup)
     xfpm_backlight_show (backlight, level);
 }
@@ -315,6 +329,15 @@ xfpm_backlight_class_init (XfpmBacklightClass *klass)
   object_class->set_property = xfpm_backlight_set_property;
   object_class->finalize = xfpm_backlight_finalize;
 
+  signals [BRIGHTNESS_CHANGED] =
+    g_signal_new ("brightness-changed",
+                  XFPM_TYPE_BACKLIGHT,
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (XfpmBacklightClass, brightness_changed),
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__INT,
+                  G_TYPE_NONE, 1, G_TYPE_INT);
+
   g_object_class_install_property (object_class,
                                    PROP_BRIGHTNESS_SWITCH,
                                    g_param_spec_int (BRIGHTNESS_SWITCH,
@@ -438,6 +461,7 @@ xfpm_backlight_init (XfpmBacklight *backlight)
                   "on-battery", &backlight->priv->on_battery,
                   NULL);
     xfpm_brightness_get_level (backlight->priv->brightness, &backlight->priv->last_level);
+    backlight->priv->level = backlight->priv->last_level;
     xfpm_backlight_set_timeouts (backlight);
 
     /* setup step count */
@@ -515,8 +539,6 @@ xfpm_backlight_finalize (GObject *object)
 
   backlight = XFPM_BACKLIGHT (object);
 
-  xfpm_backlight_destroy_popup (backlight);
-
   if ( backlight->priv->idle )
     g_object_unref (backlight->priv->idle);
 
@@ -572,3 +594,97 @@ gboolean xfpm_backlight_has_hw (XfpmBacklight *backlight)
 {
   return backlight->priv->has_hw;
 }
+
+gint32
+xfpm_backlight_get_level (XfpmBacklight *backlight)
+{
+  g_return_val_if_fail (XFPM_IS_BACKLIGHT (backlight), 0);
+
+  return backlight->priv->has_hw ? backlight->priv->level : 0;
+}
+
+gint32
+xfpm_backlight_get_max_level (XfpmBacklight *backlight)
+{
+  g_return_val_if_fail (XFPM_IS_BACKLIGHT (backlight), 0);
+
+  return backlight->priv->has_hw ? backlight->priv->max_level : 0;
+}
+
+static void
+xfpm_backlight_set_level_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  GTask *task = G_TASK (user_data);
+  XfpmBacklight *backlight = g_task_get_source_object (task);
+  GError *error = NULL;
+
+  if ( xfpm_brightness_set_level_finish (XFPM_BRIGHTNESS (source_object), res, &error) )
+  {
+    backlight->priv->dimmed = FALSE;
+    xfpm_backlight_level_changed (backlight, GPOINTER_TO_INT (g_task_get_task_data (task)));
+    g_task_return_boolean (task, TRUE);
+  }
+  else
+  {
+    g_task_return_error (task, error);
+  }
+
+  g_object_unref (task);
+}
+
+/*
+ * Brightness changes requested by clients, like the panel plugin
+ * slider. They end the idle dimming, the user picked this level.
+ * The helper may have to be spawned, so this doesn't block.
+ */
+void
+xfpm_backlight_set_level (XfpmBacklight *backlight, gint32 level,
+                          GAsyncReadyCallback callback, gpointer user_data)
+{
+  GTask *task;
+
+  g_return_if_fail (XFPM_IS_BACKLIGHT (backlight));
+
+  task = g_task_new (backlight, NULL, callback, user_data);
+
+  if ( !backlight->priv->has_hw )
+  {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                             "No brightness control available");
+    g_object_unref (task);
+    return;
+  }
+
+  level = CLAMP (level, 0, backlight->priv->max_level);
+  g_task_set_task_data (task, GINT_TO_POINTER (level), NULL);
+
+  xfpm_brightness_set_level_async (backlight->priv->brightness, level, NULL,
+                                   xfpm_backlight_set_level_cb, task);
+}
+
+gboolean
+xfpm_backlight_set_level_finish (XfpmBacklight *backlight, GAsyncResult *result, GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, backlight), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+gboolean
+xfpm_backlight_step (XfpmBacklight *backlight, gboolean up)
+{
+  gint32 level;
+
+  g_return_val_if_fail (XFPM_IS_BACKLIGHT (backlight), FALSE);
+
+  if ( !backlight->priv->has_hw )
+    return FALSE;
+
+  if ( !xfpm_backlight_step_level (backlight, up, &level) )
+    return FALSE;
+
+  backlight->priv->dimmed = FALSE;
+  xfpm_backlight_level_changed (backlight, level);
+
+  return TRUE;
+}
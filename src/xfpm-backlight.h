@@ -22,6 +22,7 @@
 #define __XFPM_BACKLIGHT_H
 
 #include <glib-object.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
@@ -40,11 +41,25 @@ typedef struct
 typedef struct
 {
   GObjectClass     parent_class;
+
+  void            (*brightness_changed)     (XfpmBacklight *backlight,
+                                             gint           level);
 } XfpmBacklightClass;
 
 GType              xfpm_backlight_get_type         (void) G_GNUC_CONST;
 XfpmBacklight     *xfpm_backlight_new              (void);
 gboolean           xfpm_backlight_has_hw           (XfpmBacklight *backlight);
+gint32             xfpm_backlight_get_level        (XfpmBacklight *backlight);
+gint32             xfpm_backlight_get_max_level    (XfpmBacklight *backlight);
+void               xfpm_backlight_set_level        (XfpmBacklight *backlight,
+                                                    gint32         level,
+                                                    GAsyncReadyCallback callback,
+                                                    gpointer       user_data);
+gboolean           xfpm_backlight_set_level_finish (XfpmBacklight *backlight,
+                                                    GAsyncResult  *result,
+                                                    GError       **error);
+gboolean           xfpm_backlight_step             (XfpmBacklight *backlight,
+                                                    gboolean       up);
 
 G_END_DECLS
 
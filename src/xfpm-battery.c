@@ -186,11 +186,15 @@ xfpm_battery_notify (XfpmBattery *battery)
   if ( !message )
     return;
 
-  xfpm_notify_show_notification (battery->priv->notify,
-                                 _("Power Manager"),
-                                 message,
-                                 xfpm_battery_get_icon_name (battery),
-                                 XFPM_NOTIFY_NORMAL);
+  /* Held back for a moment, so that state changes of several batteries
+   * at once (e.g. on plugging in AC) end up in one notification */
+  xfpm_notify_post (battery->priv->notify,
+                    XFPM_NOTIFY_CATEGORY_BATTERY,
+                    up_device_get_object_path (battery->priv->device),
+                    _("Power Manager"),
+                    message,
+                    xfpm_battery_get_icon_name (battery),
+                    XFPM_NOTIFY_NORMAL);
 
   g_free (message);
 }
@@ -209,7 +213,6 @@ xfpm_battery_notify_idle (gpointer data)
 static void
 xfpm_battery_notify_state (XfpmBattery *battery)
 {
-  gboolean notify;
   static gboolean starting_up = TRUE;
 
   if ( battery->priv->type == UP_DEVICE_KIND_BATTERY ||
@@ -221,11 +224,7 @@ xfpm_battery_notify_state (XfpmBattery *battery)
       return;
     }
 
-    g_object_get (G_OBJECT (battery->priv->conf),
-                  GENERAL_NOTIFICATION_CFG, &notify,
-                  NULL);
-
-    if ( notify )
+    if ( xfpm_xfconf_get_config (battery->priv->conf)->general_notification )
     {
       if (battery->priv->notify_idle == 0)
         battery->priv->notify_idle = g_idle_add (xfpm_battery_notify_idle, battery);
@@ -239,10 +238,7 @@ xfpm_battery_check_charge (XfpmBattery *battery)
   XfpmBatteryCharge charge;
   guint critical_level, low_level;
 
-  g_object_get (G_OBJECT (battery->priv->conf),
-                CRITICAL_POWER_LEVEL, &critical_level,
-                NULL);
-
+  critical_level = xfpm_xfconf_get_config (battery->priv->conf)->critical_level;
   low_level = critical_level + 10;
 
   if ( battery->priv->percentage > low_level )
@@ -516,3 +512,12 @@ xfpm_battery_get_icon_name (XfpmBattery *battery)
 
   return get_device_icon_name (battery->priv->client, battery->priv->device);
 }
+
+/* Not referenced, NULL until a device is monitored */
+UpDevice *
+xfpm_battery_get_device (XfpmBattery *battery)
+{
+  g_return_val_if_fail (XFPM_IS_BATTERY (battery), NULL);
+
+  return battery->priv->device;
+}
@@ -57,6 +57,7 @@ XfpmBatteryCharge   xfpm_battery_get_charge       (XfpmBattery *battery);
 const gchar        *xfpm_battery_get_battery_name (XfpmBattery *battery);
 gchar              *xfpm_battery_get_time_left    (XfpmBattery *battery);
 const gchar        *xfpm_battery_get_icon_name    (XfpmBattery *battery);
+UpDevice           *xfpm_battery_get_device       (XfpmBattery *battery);
 
 G_END_DECLS
 
@@ -0,0 +1,493 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <glib.h>
+
+#include <libxfce4util/libxfce4util.h>
+
+#include "xfpm-cpufreq.h"
+#include "xfpm-power.h"
+#include "xfpm-pkexec.h"
+#include "xfpm-xfconf.h"
+#include "xfpm-common.h"
+#include "xfpm-config.h"
+#include "xfpm-debug.h"
+
+static void xfpm_cpufreq_finalize   (GObject *object);
+
+#define CPUFREQ_SYSFS_LOCATION  "devices/system/cpu/cpufreq"
+
+typedef struct
+{
+  gchar           *name;
+  gchar           *dir;
+  guint64          min_freq;
+  guint64          max_freq;
+
+  /* What the policy had when we started, put back on exit */
+  gchar           *governor;
+  gchar           *epp;
+  gchar           *scaling_max_freq;
+} XfpmCpufreqPolicy;
+
+struct XfpmCpufreqPrivate
+{
+  XfpmPower       *power;
+  XfpmXfconf      *conf;
+  XfpmPkexec      *helper;
+
+  gchar           *root;
+
+  GPtrArray       *policies;
+
+  gboolean         on_battery;
+  /* Set when anything differs from the original values */
+  gboolean         changed;
+
+  gboolean         apply_pending;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (XfpmCpufreq, xfpm_cpufreq, G_TYPE_OBJECT)
+
+static void
+xfpm_cpufreq_policy_free (XfpmCpufreqPolicy *policy)
+{
+  g_free (policy->name);
+  g_free (policy->dir);
+  g_free (policy->governor);
+  g_free (policy->epp);
+  g_free (policy->scaling_max_freq);
+  g_free (policy);
+}
+
+static guint64
+xfpm_cpufreq_read_uint64 (const gchar *dir, const gchar *name)
+{
+  gchar *contents;
+  guint64 value = 0;
+
+  contents = xfpm_sysfs_read (dir, name);
+  if ( contents != NULL )
+    value = g_ascii_strtoull (contents, NULL, 10);
+  g_free (contents);
+
+  return value;
+}
+
+static gboolean
+xfpm_cpufreq_is_available (const gchar *dir, const gchar *list_name, const gchar *value)
+{
+  gchar *list;
+  gchar **words;
+  gboolean found = FALSE;
+  guint i;
+
+  list = xfpm_sysfs_read (dir, list_name);
+  if ( list == NULL )
+    return FALSE;
+
+  words = g_strsplit_set (list, " \t\n", -1);
+  for ( i = 0; !found && words[i] != NULL; i++ )
+    found = *words[i] != '\0' && g_strcmp0 (words[i], value) == 0;
+
+  g_strfreev (words);
+  g_free (list);
+
+  return found;
+}
+
+static void
+xfpm_cpufreq_find_policies (XfpmCpufreq *cpufreq)
+{
+  GDir *dir;
+  gchar *path;
+  const gchar *name;
+
+  path = g_build_filename (cpufreq->priv->root, CPUFREQ_SYSFS_LOCATION, NULL);
+  dir = g_dir_open (path, 0, NULL);
+
+  if ( dir == NULL )
+  {
+    g_free (path);
+    return;
+  }
+
+  while ( (name = g_dir_read_name (dir)) != NULL )
+  {
+    XfpmCpufreqPolicy *policy;
+
+    if ( !g_str_has_prefix (name, "policy") )
+      continue;
+
+    policy = g_new0 (XfpmCpufreqPolicy, 1);
+    policy->name = g_strdup (name);
+    policy->dir = g_build_filename (path, name, NULL);
+    policy->min_freq = xfpm_cpufreq_read_uint64 (policy->dir, "cpuinfo_min_freq");
+    policy->max_freq = xfpm_cpufreq_read_uint64 (policy->dir, "cpuinfo_max_freq");
+    policy->governor = xfpm_sysfs_read (policy->dir, "scaling_governor");
+    policy->epp = xfpm_sysfs_read (policy->dir, "energy_performance_preference");
+    policy->scaling_max_freq = xfpm_sysfs_read (policy->dir, "scaling_max_freq");
+
+    /* Offline CPUs keep their policy directory but nothing in it reads */
+    if ( policy->governor == NULL )
+    {
+      xfpm_cpufreq_policy_free (policy);
+      continue;
+    }
+
+    XFPM_DEBUG ("%s: governor %s, preference %s, max %s kHz", name, policy->governor,
+                policy->epp != NULL ? policy->epp : "none",
+                policy->scaling_max_freq != NULL ? policy->scaling_max_freq : "?");
+
+    g_ptr_array_add (cpufreq->priv->policies, policy);
+  }
+
+  g_dir_close (dir);
+  g_free (path);
+}
+
+static void xfpm_cpufreq_apply (XfpmCpufreq *cpufreq);
+
+static void
+xfpm_cpufreq_helper_finished_cb (XfpmPkexec *helper, gboolean success, XfpmCpufreq *cpufreq)
+{
+  if ( !success )
+    g_warning ("Unable to set the CPU frequency policy");
+
+  /* The power source changed again while the helper was running */
+  if ( cpufreq->priv->apply_pending )
+  {
+    cpufreq->priv->apply_pending = FALSE;
+    xfpm_cpufreq_apply (cpufreq);
+  }
+}
+
+/*
+ * Only the fields that differ from what sysfs has now go into the
+ * argument, an empty field tells the helper to leave it alone.
+ */
+static gchar *
+xfpm_cpufreq_policy_arg (XfpmCpufreqPolicy *policy,
+                         const gchar *governor,
+                         const gchar *epp,
+                         const gchar *max_freq)
+{
+  gchar *cur_governor;
+  gchar *cur_epp;
+  gchar *cur_max_freq;
+  gchar *arg = NULL;
+
+  /* intel_pstate pins the preference to performance under that governor
+   * and refuses anything else with EBUSY */
+  if ( g_strcmp0 (governor, "performance") == 0 )
+    epp = NULL;
+
+  cur_governor = xfpm_sysfs_read (policy->dir, "scaling_governor");
+  cur_epp = xfpm_sysfs_read (policy->dir, "energy_performance_preference");
+  cur_max_freq = xfpm_sysfs_read (policy->dir, "scaling_max_freq");
+
+  if ( governor != NULL && g_strcmp0 (governor, cur_governor) == 0 )
+    governor = NULL;
+  if ( epp != NULL && g_strcmp0 (epp, cur_epp) == 0 )
+    epp = NULL;
+  if ( max_freq != NULL && g_strcmp0 (max_freq, cur_max_freq) == 0 )
+    max_freq = NULL;
+
+  if ( governor != NULL || epp != NULL || max_freq != NULL )
+    arg = g_strdup_printf ("%s:%s:%s:%s", policy->name,
+                           governor != NULL ? governor : "",
+                           epp != NULL ? epp : "",
+                           max_freq != NULL ? max_freq : "");
+
+  g_free (cur_governor);
+  g_free (cur_epp);
+  g_free (cur_max_freq);
+
+  return arg;
+}
+
+/*
+ * Settings left empty, or 0 for the frequency limit, fall back to the
+ * values the policy had when the power manager started. Values the
+ * kernel doesn't offer for a policy are skipped instead of making the
+ * helper refuse the whole invocation.
+ */
+static void
+xfpm_cpufreq_apply (XfpmCpufreq *cpufreq)
+{
+  const XfpmConfig *config;
+  GPtrArray *args;
+  const gchar *governor;
+  const gchar *epp;
+  guint max_freq_percent;
+  gboolean changed = FALSE;
+  guint i;
+
+  if ( xfpm_pkexec_is_running (cpufreq->priv->helper) )
+  {
+    cpufreq->priv->apply_pending = TRUE;
+    return;
+  }
+
+  config = xfpm_xfconf_get_config (cpufreq->priv->conf);
+  governor = cpufreq->priv->on_battery ? config->cpu_governor_on_battery : config->cpu_governor_on_ac;
+  epp = cpufreq->priv->on_battery ? config->cpu_epp_on_battery : config->cpu_epp_on_ac;
+  max_freq_percent = cpufreq->priv->on_battery ? config->cpu_max_freq_on_battery : config->cpu_max_freq_on_ac;
+
+  args = g_ptr_array_new_with_free_func (g_free);
+
+  for ( i = 0; i < cpufreq->priv->policies->len; i++ )
+  {
+    XfpmCpufreqPolicy *policy = g_ptr_array_index (cpufreq->priv->policies, i);
+    const gchar *target_governor = policy->governor;
+    const gchar *target_epp = policy->epp;
+    gchar *target_max_freq = NULL;
+    gchar *arg;
+
+    if ( governor != NULL && *governor != '\0' )
+    {
+      if ( xfpm_cpufreq_is_available (policy->dir, "scaling_available_governors", governor) )
+        target_governor = governor;
+      else
+        XFPM_DEBUG ("Governor %s is not available for %s", governor, policy->name);
+    }
+
+    if ( epp != NULL && *epp != '\0' && policy->epp != NULL )
+    {
+      if ( xfpm_cpufreq_is_available (policy->dir, "energy_performance_available_preferences", epp) )
+        target_epp = epp;
+      else
+        XFPM_DEBUG ("Energy performance preference %s is not available for %s", epp, policy->name);
+    }
+
+    if ( max_freq_percent > 0 && policy->max_freq > 0 )
+    {
+      guint64 freq = policy->max_freq * max_freq_percent / 100;
+
+      target_max_freq = g_strdup_printf ("%" G_GUINT64_FORMAT, MAX (freq, policy->min_freq));
+    }
+
+    if ( target_governor != policy->governor || target_epp != policy->epp || target_max_freq != NULL )
+      changed = TRUE;
+
+    arg = xfpm_cpufreq_policy_arg (policy, target_governor, target_epp,
+                                   target_max_freq != NULL ? target_max_freq : policy->scaling_max_freq);
+    if ( arg != NULL )
+      g_ptr_array_add (args, arg);
+
+    g_free (target_max_freq);
+  }
+
+  cpufreq->priv->changed = changed;
+
+  if ( args->len > 0 )
+  {
+    gchar **helper_args = xfpm_pkexec_batch_args ("cpufreq", "--policy", args);
+
+    XFPM_DEBUG ("Updating %u cpufreq policies for %s", args->len,
+                cpufreq->priv->on_battery ? "battery" : "AC");
+    xfpm_pkexec_run (cpufreq->priv->helper, (const gchar * const *) helper_args);
+    g_strfreev (helper_args);
+  }
+
+  g_ptr_array_unref (args);
+}
+
+static void
+xfpm_cpufreq_on_battery_changed_cb (XfpmPower *power,
+                                    gboolean on_battery,
+                                    XfpmCpufreq *cpufreq)
+{
+  if ( cpufreq->priv->on_battery == on_battery )
+    return;
+
+  cpufreq->priv->on_battery = on_battery;
+
+  xfpm_cpufreq_apply (cpufreq);
+}
+
+static void
+xfpm_cpufreq_settings_changed_cb (XfpmXfconf *conf,
+                                  const gchar **keys,
+                                  XfpmCpufreq *cpufreq)
+{
+  guint i;
+
+  for ( i = 0; keys[i] != NULL; i++ )
+  {
+    if ( g_str_has_prefix (keys[i], "cpu-") )
+    {
+      xfpm_cpufreq_apply (cpufreq);
+      return;
+    }
+  }
+}
+
+static void
+xfpm_cpufreq_class_init (XfpmCpufreqClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = xfpm_cpufreq_finalize;
+}
+
+static void
+xfpm_cpufreq_init (XfpmCpufreq *cpufreq)
+{
+  const gchar *root;
+
+  cpufreq->priv = xfpm_cpufreq_get_instance_private (cpufreq);
+
+  /* Allows running against a fake cpufreq tree */
+  root = g_getenv ("XFPM_SYSFS_ROOT");
+  cpufreq->priv->root = g_strdup (root != NULL && *root != '\0' ? root : "/sys");
+
+  cpufreq->priv->policies = g_ptr_array_new_with_free_func ((GDestroyNotify) xfpm_cpufreq_policy_free);
+  cpufreq->priv->helper = xfpm_pkexec_new (XFPM_SYSFS_HELPER);
+
+  if ( !xfpm_pkexec_is_installed (cpufreq->priv->helper) )
+  {
+    XFPM_DEBUG ("%s is not installed", XFPM_SYSFS_HELPER);
+    return;
+  }
+
+  xfpm_cpufreq_find_policies (cpufreq);
+
+  if ( cpufreq->priv->policies->len == 0 )
+  {
+    XFPM_DEBUG ("No cpufreq policies in %s", cpufreq->priv->root);
+    return;
+  }
+
+  cpufreq->priv->power = xfpm_power_get ();
+  cpufreq->priv->conf = xfpm_xfconf_new ();
+
+  g_object_get (G_OBJECT (cpufreq->priv->power),
+                "on-battery", &cpufreq->priv->on_battery,
+                NULL);
+
+  g_signal_connect (cpufreq->priv->power, "on-battery-changed",
+                    G_CALLBACK (xfpm_cpufreq_on_battery_changed_cb), cpufreq);
+  g_signal_connect (cpufreq->priv->conf, "config-changed",
+                    G_CALLBACK (xfpm_cpufreq_settings_changed_cb), cpufreq);
+  g_signal_connect (cpufreq->priv->helper, "finished",
+                    G_CALLBACK (xfpm_cpufreq_helper_finished_cb), cpufreq);
+
+  xfpm_cpufreq_apply (cpufreq);
+}
+
+static void
+xfpm_cpufreq_finalize (GObject *object)
+{
+  XfpmCpufreq *cpufreq;
+
+  cpufreq = XFPM_CPUFREQ (object);
+
+  if ( cpufreq->priv->power != NULL )
+  {
+    g_signal_handlers_disconnect_by_data (cpufreq->priv->power, cpufreq);
+    g_object_unref (cpufreq->priv->power);
+  }
+
+  if ( cpufreq->priv->conf != NULL )
+  {
+    g_signal_handlers_disconnect_by_data (cpufreq->priv->conf, cpufreq);
+    g_object_unref (cpufreq->priv->conf);
+  }
+
+  g_signal_handlers_disconnect_by_data (cpufreq->priv->helper, cpufreq);
+  g_object_unref (cpufreq->priv->helper);
+
+  g_ptr_array_unref (cpufreq->priv->policies);
+  g_free (cpufreq->priv->root);
+
+  G_OBJECT_CLASS (xfpm_cpufreq_parent_class)->finalize (object);
+}
+
+XfpmCpufreq *
+xfpm_cpufreq_new (void)
+{
+  return g_object_new (XFPM_TYPE_CPUFREQ, NULL);
+}
+
+/**
+ * xfpm_cpufreq_restore:
+ *
+ * Puts back the governor, energy performance preference and frequency
+ * limit every policy had when the power manager started. Waits for the
+ * helper, it is meant to be called when the power manager quits.
+ **/
+void
+xfpm_cpufreq_restore (XfpmCpufreq *cpufreq)
+{
+  GPtrArray *args;
+  guint i;
+
+  g_return_if_fail (XFPM_IS_CPUFREQ (cpufreq));
+
+  if ( !cpufreq->priv->changed )
+    return;
+
+  args = g_ptr_array_new_with_free_func (g_free);
+
+  for ( i = 0; i < cpufreq->priv->policies->len; i++ )
+  {
+    XfpmCpufreqPolicy *policy = g_ptr_array_index (cpufreq->priv->policies, i);
+    gchar *arg;
+
+    arg = xfpm_cpufreq_policy_arg (policy, policy->governor, policy->epp,
+                                   policy->scaling_max_freq);
+    if ( arg != NULL )
+      g_ptr_array_add (args, arg);
+  }
+
+  if ( args->len > 0 )
+  {
+    gchar **helper_args = xfpm_pkexec_batch_args ("cpufreq", "--policy", args);
+    GError *error = NULL;
+
+    XFPM_DEBUG ("Restoring %u cpufreq policies", args->len);
+
+    /* There is no main loop left to wait in */
+    if ( !xfpm_pkexec_run_sync (cpufreq->priv->helper, (const gchar * const *) helper_args, &error) )
+    {
+      g_warning ("Unable to restore the CPU frequency policy: %s", error->message);
+      g_error_free (error);
+    }
+
+    g_strfreev (helper_args);
+  }
+
+  cpufreq->priv->changed = FALSE;
+  g_ptr_array_unref (args);
+}
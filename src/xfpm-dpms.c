@@ -58,6 +58,14 @@ struct XfpmDpmsPrivate
   gulong           switch_on_timeout_id;
 };
 
+enum
+{
+  LEVEL_CHANGED,
+  LAST_SIGNAL
+};
+
+static guint signals [LAST_SIGNAL] = { 0 };
+
 G_DEFINE_TYPE_WITH_PRIVATE (XfpmDpms, xfpm_dpms, G_TYPE_OBJECT)
 
 static void
@@ -190,12 +198,19 @@ xfpm_dpms_refresh (XfpmDpms *dpms)
 }
 
 static void
-xfpm_dpms_settings_changed_cb (GObject *obj, GParamSpec *spec, XfpmDpms *dpms)
+xfpm_dpms_settings_changed_cb (XfpmXfconf *conf, const gchar **keys, XfpmDpms *dpms)
 {
-  if ( g_str_has_prefix (spec->name, "dpms"))
+  guint i;
+
+  /* Reprogram the server once, however many dpms keys changed */
+  for ( i = 0; keys[i] != NULL; i++ )
   {
-    XFPM_DEBUG ("Configuration changed");
-    xfpm_dpms_refresh (dpms);
+    if ( g_str_has_prefix (keys[i], "dpms") )
+    {
+      XFPM_DEBUG ("Configuration changed");
+      xfpm_dpms_refresh (dpms);
+      return;
+    }
   }
 }
 
@@ -205,6 +220,22 @@ xfpm_dpms_class_init(XfpmDpmsClass *klass)
   GObjectClass *object_class = G_OBJECT_CLASS(klass);
 
   object_class->finalize = xfpm_dpms_finalize;
+
+  /**
+   * XfpmDpms::level-changed:
+   * @level: the DPMS mode we forced
+   *
+   * Only for the changes we force, the X server switching the display
+   * off on its own timeouts doesn't tell us.
+   **/
+  signals [LEVEL_CHANGED] =
+    g_signal_new ("level-changed",
+                  XFPM_TYPE_DPMS,
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (XfpmDpmsClass, level_changed),
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__UINT,
+                  G_TYPE_NONE, 1, G_TYPE_UINT);
 }
 
 /*
@@ -223,7 +254,7 @@ xfpm_dpms_init(XfpmDpms *dpms)
   {
     dpms->priv->conf    = xfpm_xfconf_new  ();
 
-    g_signal_connect (dpms->priv->conf, "notify",
+    g_signal_connect (dpms->priv->conf, "config-changed",
                       G_CALLBACK (xfpm_dpms_settings_changed_cb), dpms);
 
     xfpm_dpms_refresh (dpms);
@@ -309,6 +340,8 @@ xfpm_dpms_force_level (XfpmDpms *dpms, CARD16 level)
       XResetScreenSaver (gdk_x11_get_default_xdisplay ());
 
     XSync (gdk_x11_get_default_xdisplay (), FALSE);
+
+    g_signal_emit (G_OBJECT (dpms), signals [LEVEL_CHANGED], 0, (guint) level);
   }
   else
   {
@@ -346,3 +379,23 @@ xfpm_dpms_set_on_battery (XfpmDpms *dpms, gboolean on_battery)
   xfpm_dpms_refresh (dpms);
   XFPM_DEBUG ("dpms on battery %s", on_battery ? "TRUE" : "FALSE");
 }
+
+/*
+ * The current DPMS mode of the display, FALSE if it has no DPMS or it
+ * is disabled.
+ */
+gboolean
+xfpm_dpms_get_level (XfpmDpms *dpms, CARD16 *level)
+{
+  BOOL state;
+
+  g_return_val_if_fail (XFPM_IS_DPMS (dpms), FALSE);
+
+  if ( !dpms->priv->dpms_capable )
+    return FALSE;
+
+  if ( !DPMSInfo (gdk_x11_get_default_xdisplay (), level, &state) )
+    return FALSE;
+
+  return state;
+}
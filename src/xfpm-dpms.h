@@ -50,6 +50,9 @@ typedef struct
 typedef struct
 {
   GObjectClass       parent_class;
+
+  void              (*level_changed)      (XfpmDpms *dpms,
+                                           guint     level);
 } XfpmDpmsClass;
 
 GType           xfpm_dpms_get_type        (void) G_GNUC_CONST;
@@ -60,6 +63,7 @@ void            xfpm_dpms_refresh         (XfpmDpms *dpms);
 void            xfpm_dpms_inhibit         (XfpmDpms *dpms, gboolean inhibit);
 gboolean        xfpm_dpms_is_inhibited    (XfpmDpms *dpms);
 void            xfpm_dpms_set_on_battery  (XfpmDpms *dpms, gboolean on_battery);
+gboolean        xfpm_dpms_get_level       (XfpmDpms *dpms, CARD16 *level);
 
 G_END_DECLS
 
@@ -0,0 +1,579 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <fcntl.h>
+#include <dirent.h>
+
+#include <glib.h>
+#include <upower.h>
+
+#include "xfpm-energy.h"
+#include "xfpm-power.h"
+#include "xfpm-battery.h"
+#include "xfpm-rapl.h"
+#include "xfpm-debug.h"
+
+static void xfpm_energy_finalize   (GObject *object);
+
+/*
+ * Which processes the power goes to. Every sample walks /proc and
+ * gives each process a score from its CPU time, wakeups and disk I/O
+ * since the previous sample, the system draw is then split up in
+ * proportion to the scores. The draw is the battery discharge rate,
+ * or the CPU package power on AC.
+ *
+ * Sampling only runs while someone asks, each request keeps it going
+ * for ENERGY_LEASE seconds. Processes that didn't run since the last
+ * sample cost a single read of their stat file.
+ */
+
+/* Seconds between two samples */
+#define ENERGY_SAMPLE_INTERVAL  5
+
+/* Seconds sampling goes on after the last request */
+#define ENERGY_LEASE            60
+
+/* What a wakeup and a MiB of disk I/O are worth in seconds of CPU
+ * time, rough figures for leaving a deep C-state and for keeping a
+ * disk busy */
+#define ENERGY_WAKEUP_COST      0.0001
+#define ENERGY_IO_COST          0.02
+
+typedef struct
+{
+  guint32      pid;
+  gchar        comm[17];
+  guint64      start_time;
+  guint64      cpu_ticks;
+  guint64      wakeups;
+  guint64      io_bytes;
+  gboolean     has_io;
+  guint        generation;
+
+  /* Since the previous sample */
+  gdouble      cpu_seconds;
+  gdouble      score;
+} EnergyProc;
+
+struct XfpmEnergyPrivate
+{
+  XfpmPower       *power;
+
+  /* Directory used in place of /proc, and a descriptor on it */
+  gchar           *root;
+  gint             root_fd;
+
+  /* Reused by every read */
+  gchar            path[64];
+  gchar            buf[1024];
+
+  /* pid -> EnergyProc */
+  GHashTable      *procs;
+  guint            generation;
+  gdouble          ticks_per_second;
+
+  guint            timeout_id;
+  gint64           lease_end;
+  gint64           last_time;
+
+  /* From the last sample */
+  gdouble          interval;
+  gdouble          total_score;
+  gdouble          watts;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (XfpmEnergy, xfpm_energy, G_TYPE_OBJECT)
+
+/* Reads <pid>/<name> into the shared buffer */
+static gssize
+xfpm_energy_read (XfpmEnergy *energy, guint32 pid, const gchar *name)
+{
+  gssize len;
+  gint fd;
+
+  g_snprintf (energy->priv->path, sizeof (energy->priv->path), "%u/%s", pid, name);
+
+  fd = openat (energy->priv->root_fd, energy->priv->path, O_RDONLY | O_CLOEXEC);
+  if ( fd < 0 )
+    return -1;
+
+  len = read (fd, energy->priv->buf, sizeof (energy->priv->buf) - 1);
+  close (fd);
+
+  if ( len < 0 )
+    return -1;
+
+  energy->priv->buf[len] = '\0';
+
+  return len;
+}
+
+/* Skips @n space separated fields */
+static const gchar *
+xfpm_energy_skip_fields (const gchar *p, guint n)
+{
+  while ( n-- > 0 && p != NULL )
+  {
+    p = strchr (p, ' ');
+    if ( p != NULL )
+      p++;
+  }
+
+  return p;
+}
+
+/*
+ * <pid>/stat, the name is in parentheses and can contain anything, so
+ * the fields are counted from the last closing one. utime and stime
+ * are fields 14 and 15, the start time field 22.
+ */
+static gboolean
+xfpm_energy_read_stat (XfpmEnergy *energy, guint32 pid, gchar *comm, gsize comm_len,
+                       guint64 *cpu_ticks, guint64 *start_time)
+{
+  const gchar *open_paren, *close_paren, *p;
+  gchar *end;
+  guint64 utime, stime;
+
+  if ( xfpm_energy_read (energy, pid, "stat") <= 0 )
+    return FALSE;
+
+  open_paren = strchr (energy->priv->buf, '(');
+  close_paren = strrchr (energy->priv->buf, ')');
+  if ( open_paren == NULL || close_paren == NULL || close_paren < open_paren )
+    return FALSE;
+
+  if ( comm != NULL )
+    g_strlcpy (comm, open_paren + 1, MIN (comm_len, (gsize) (close_paren - open_paren)));
+
+  /* ") S ppid ...", the state is field 3 */
+  p = xfpm_energy_skip_fields (close_paren + 2, 11);
+  if ( p == NULL )
+    return FALSE;
+
+  utime = g_ascii_strtoull (p, &end, 10);
+  stime = g_ascii_strtoull (end, &end, 10);
+  *cpu_ticks = utime + stime;
+
+  p = xfpm_energy_skip_fields (end + 1, 6);
+  if ( p == NULL )
+    return FALSE;
+
+  *start_time = g_ascii_strtoull (p, NULL, 10);
+
+  return TRUE;
+}
+
+/* The third field of <pid>/schedstat is how often the process was put
+ * on a CPU, which is as close to its wakeups as /proc gets */
+static gboolean
+xfpm_energy_read_wakeups (XfpmEnergy *energy, guint32 pid, guint64 *wakeups)
+{
+  const gchar *p;
+
+  if ( xfpm_energy_read (energy, pid, "schedstat") <= 0 )
+    return FALSE;
+
+  p = xfpm_energy_skip_fields (energy->priv->buf, 2);
+  if ( p == NULL )
+    return FALSE;
+
+  *wakeups = g_ascii_strtoull (p, NULL, 10);
+
+  return TRUE;
+}
+
+/* read_bytes plus write_bytes of <pid>/io, only readable for our own
+ * processes */
+static gboolean
+xfpm_energy_read_io (XfpmEnergy *energy, guint32 pid, guint64 *bytes)
+{
+  const gchar *p;
+
+  if ( xfpm_energy_read (energy, pid, "io") <= 0 )
+    return FALSE;
+
+  *bytes = 0;
+
+  p = strstr (energy->priv->buf, "\nread_bytes: ");
+  if ( p != NULL )
+    *bytes += g_ascii_strtoull (p + strlen ("\nread_bytes: "), NULL, 10);
+
+  p = strstr (energy->priv->buf, "\nwrite_bytes: ");
+  if ( p != NULL )
+    *bytes += g_ascii_strtoull (p + strlen ("\nwrite_bytes: "), NULL, 10);
+
+  return TRUE;
+}
+
+static void
+xfpm_energy_sample_proc (XfpmEnergy *energy, guint32 pid)
+{
+  EnergyProc *proc;
+  guint64 cpu_ticks, start_time, wakeups, io_bytes;
+  gdouble score;
+
+  proc = g_hash_table_lookup (energy->priv->procs, GUINT_TO_POINTER (pid));
+
+  if ( proc == NULL )
+  {
+    proc = g_new0 (EnergyProc, 1);
+    proc->pid = pid;
+
+    if ( !xfpm_energy_read_stat (energy, pid, proc->comm, sizeof (proc->comm),
+                                 &proc->cpu_ticks, &proc->start_time) )
+    {
+      g_free (proc);
+      return;
+    }
+
+    /* Only the baseline this time */
+    xfpm_energy_read_wakeups (energy, pid, &proc->wakeups);
+    proc->has_io = xfpm_energy_read_io (energy, pid, &proc->io_bytes);
+    proc->generation = energy->priv->generation;
+
+    g_hash_table_insert (energy->priv->procs, GUINT_TO_POINTER (pid), proc);
+    return;
+  }
+
+  if ( !xfpm_energy_read_stat (energy, pid, NULL, 0, &cpu_ticks, &start_time) )
+    return;
+
+  /* The pid was reused, start over */
+  if ( start_time != proc->start_time )
+  {
+    g_hash_table_remove (energy->priv->procs, GUINT_TO_POINTER (pid));
+    xfpm_energy_sample_proc (energy, pid);
+    return;
+  }
+
+  proc->generation = energy->priv->generation;
+  proc->cpu_seconds = 0;
+  proc->score = 0;
+
+  /* A process that didn't run didn't wake up or do I/O either */
+  if ( cpu_ticks == proc->cpu_ticks )
+    return;
+
+  proc->cpu_seconds = (cpu_ticks - proc->cpu_ticks) / energy->priv->ticks_per_second;
+  proc->cpu_ticks = cpu_ticks;
+  score = proc->cpu_seconds;
+
+  if ( xfpm_energy_read_wakeups (energy, pid, &wakeups) )
+  {
+    if ( wakeups > proc->wakeups )
+      score += (wakeups - proc->wakeups) * ENERGY_WAKEUP_COST;
+    proc->wakeups = wakeups;
+  }
+
+  if ( proc->has_io && xfpm_energy_read_io (energy, pid, &io_bytes) )
+  {
+    if ( io_bytes > proc->io_bytes )
+      score += (io_bytes - proc->io_bytes) / (1024.0 * 1024.0) * ENERGY_IO_COST;
+    proc->io_bytes = io_bytes;
+  }
+
+  proc->score = score;
+  energy->priv->total_score += score;
+}
+
+static gboolean
+xfpm_energy_proc_is_gone (gpointer key, gpointer value, gpointer user_data)
+{
+  EnergyProc *proc = value;
+
+  return proc->generation != GPOINTER_TO_UINT (user_data);
+}
+
+/* Watts the machine draws, -1 if we can't tell */
+static gdouble
+xfpm_energy_get_system_power (XfpmEnergy *energy)
+{
+  UpClient *upower = xfpm_power_get_client (energy->priv->power);
+  XfpmRapl *rapl = xfpm_power_get_rapl (energy->priv->power);
+  gdouble rate = -1;
+
+  /* While charging, the rate is what goes into the battery. The
+   * devices are the ones XfpmPower already watches, asking UPower for
+   * its list would be a round trip on every sample */
+  if ( up_client_get_on_battery (upower) )
+  {
+    GList *batteries, *li;
+
+    batteries = xfpm_power_get_batteries (energy->priv->power);
+
+    for ( li = batteries; li != NULL; li = li->next )
+    {
+      UpDevice *device = xfpm_battery_get_device (XFPM_BATTERY (li->data));
+      gboolean power_supply;
+      gdouble energy_rate;
+
+      if ( device == NULL ||
+           xfpm_battery_get_device_type (XFPM_BATTERY (li->data)) != UP_DEVICE_KIND_BATTERY )
+        continue;
+
+      g_object_get (device,
+                    "power-supply", &power_supply,
+                    "energy-rate", &energy_rate,
+                    NULL);
+
+      if ( power_supply && energy_rate > 0 )
+        rate = MAX (rate, 0) + energy_rate;
+    }
+
+    g_list_free (batteries);
+  }
+
+  if ( rate < 0 && rapl != NULL )
+    g_object_get (rapl, XFPM_RAPL_ENERGY_RATE, &rate, NULL);
+
+  return rate;
+}
+
+static gboolean
+xfpm_energy_sample_cb (gpointer data)
+{
+  XfpmEnergy *energy = XFPM_ENERGY (data);
+  struct dirent *entry;
+  DIR *dir;
+  gint fd;
+  gint64 now;
+
+  now = g_get_monotonic_time ();
+
+  if ( now > energy->priv->lease_end )
+  {
+    XFPM_DEBUG ("Nobody asked for the top consumers lately, stopping");
+
+    energy->priv->timeout_id = 0;
+    g_hash_table_remove_all (energy->priv->procs);
+    return FALSE;
+  }
+
+  /* Reuses the descriptor from startup, dup'ed because closedir()
+   * closes the one it is given */
+  fd = dup (energy->priv->root_fd);
+  if ( fd < 0 )
+    return TRUE;
+
+  dir = fdopendir (fd);
+  if ( dir == NULL )
+  {
+    close (fd);
+    return TRUE;
+  }
+
+  /* A dup shares the offset of the previous sample */
+  rewinddir (dir);
+
+  energy->priv->generation++;
+  energy->priv->total_score = 0;
+
+  while ( (entry = readdir (dir)) != NULL )
+  {
+    gchar *end;
+    guint64 pid;
+
+    pid = g_ascii_strtoull (entry->d_name, &end, 10);
+    if ( *end != '\0' || end == entry->d_name || pid > G_MAXUINT32 )
+      continue;
+
+    xfpm_energy_sample_proc (energy, pid);
+  }
+
+  closedir (dir);
+
+  g_hash_table_foreach_remove (energy->priv->procs, xfpm_energy_proc_is_gone,
+                               GUINT_TO_POINTER (energy->priv->generation));
+
+  energy->priv->interval = (now - energy->priv->last_time) / (gdouble) G_USEC_PER_SEC;
+  energy->priv->last_time = now;
+  energy->priv->watts = xfpm_energy_get_system_power (energy);
+
+  XFPM_DEBUG ("%u processes sampled in %.2f ms, %.1f W",
+              g_hash_table_size (energy->priv->procs),
+              (g_get_monotonic_time () - now) / 1000.0,
+              energy->priv->watts);
+
+  return TRUE;
+}
+
+static void
+xfpm_energy_start (XfpmEnergy *energy)
+{
+  XFPM_DEBUG ("Starting process sampling in %s", energy->priv->root);
+
+  energy->priv->total_score = 0;
+  energy->priv->interval = 0;
+  energy->priv->last_time = g_get_monotonic_time ();
+
+  /* The first sample is only the baseline */
+  xfpm_energy_sample_cb (energy);
+  energy->priv->interval = 0;
+
+  energy->priv->timeout_id = g_timeout_add_seconds (ENERGY_SAMPLE_INTERVAL,
+                                                    xfpm_energy_sample_cb,
+                                                    energy);
+}
+
+static gint
+xfpm_energy_compare_score (gconstpointer a, gconstpointer b)
+{
+  const EnergyProc *proc_a = *(EnergyProc **) a;
+  const EnergyProc *proc_b = *(EnergyProc **) b;
+
+  if ( proc_a->score == proc_b->score )
+    return 0;
+
+  return proc_a->score > proc_b->score ? -1 : 1;
+}
+
+static void
+xfpm_energy_class_init (XfpmEnergyClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = xfpm_energy_finalize;
+}
+
+static void
+xfpm_energy_init (XfpmEnergy *energy)
+{
+  const gchar *root;
+  glong ticks;
+
+  energy->priv = xfpm_energy_get_instance_private (energy);
+
+  /* Allows running the sampler against fixture files */
+  root = g_getenv ("XFPM_PROC_ROOT");
+  energy->priv->root = g_strdup (root != NULL && *root != '\0' ? root : "/proc");
+  energy->priv->root_fd = open (energy->priv->root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+  ticks = sysconf (_SC_CLK_TCK);
+  energy->priv->ticks_per_second = ticks > 0 ? ticks : 100;
+
+  energy->priv->procs = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+  energy->priv->watts = -1;
+  energy->priv->power = xfpm_power_get ();
+}
+
+static void
+xfpm_energy_finalize (GObject *object)
+{
+  XfpmEnergy *energy;
+
+  energy = XFPM_ENERGY (object);
+
+  if ( energy->priv->timeout_id != 0 )
+    g_source_remove (energy->priv->timeout_id);
+
+  if ( energy->priv->root_fd >= 0 )
+    close (energy->priv->root_fd);
+
+  g_hash_table_destroy (energy->priv->procs);
+  g_object_unref (energy->priv->power);
+  g_free (energy->priv->root);
+
+  G_OBJECT_CLASS (xfpm_energy_parent_class)->finalize (object);
+}
+
+XfpmEnergy *
+xfpm_energy_new (void)
+{
+  return g_object_new (XFPM_TYPE_ENERGY, NULL);
+}
+
+/**
+ * xfpm_energy_get_top_consumers:
+ * @count: how many processes to return at most
+ *
+ * Starts sampling if it isn't running, the list is empty until there
+ * are two samples to compare.
+ *
+ * Returns: a floating (da(usdd)) with the system draw in watts and
+ * the pid, name, CPU usage in percent of one CPU and estimated watts
+ * of the processes using the most, watts are -1 if the draw is unknown.
+ **/
+GVariant *
+xfpm_energy_get_top_consumers (XfpmEnergy *energy, guint count)
+{
+  GVariantBuilder builder;
+  GPtrArray *array;
+  GHashTableIter iter;
+  gpointer value;
+  guint i;
+
+  g_return_val_if_fail (XFPM_IS_ENERGY (energy), NULL);
+
+  energy->priv->lease_end = g_get_monotonic_time () + ENERGY_LEASE * G_USEC_PER_SEC;
+
+  if ( energy->priv->timeout_id == 0 && energy->priv->root_fd >= 0 )
+    xfpm_energy_start (energy);
+
+  array = g_ptr_array_new ();
+
+  if ( energy->priv->interval > 0 )
+  {
+    g_hash_table_iter_init (&iter, energy->priv->procs);
+    while ( g_hash_table_iter_next (&iter, NULL, &value) )
+    {
+      if ( ((EnergyProc *) value)->score > 0 )
+        g_ptr_array_add (array, value);
+    }
+  }
+
+  g_ptr_array_sort (array, xfpm_energy_compare_score);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(usdd)"));
+
+  for ( i = 0; i < array->len && i < MIN (count, XFPM_ENERGY_MAX_CONSUMERS); i++ )
+  {
+    EnergyProc *proc = g_ptr_array_index (array, i);
+    gdouble watts = -1;
+
+    if ( energy->priv->watts >= 0 )
+      watts = energy->priv->watts * proc->score / energy->priv->total_score;
+
+    g_variant_builder_add (&builder, "(usdd)",
+                           proc->pid,
+                           proc->comm,
+                           proc->cpu_seconds * 100 / energy->priv->interval,
+                           watts);
+  }
+
+  g_ptr_array_free (array, TRUE);
+
+  return g_variant_new ("(d@a(usdd))", energy->priv->watts, g_variant_builder_end (&builder));
+}
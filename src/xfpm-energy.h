@@ -0,0 +1,56 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __XFPM_ENERGY_H
+#define __XFPM_ENERGY_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+/* At most this many processes per GetTopConsumers reply */
+#define XFPM_ENERGY_MAX_CONSUMERS  50
+
+#define XFPM_TYPE_ENERGY        (xfpm_energy_get_type () )
+#define XFPM_ENERGY(o)          (G_TYPE_CHECK_INSTANCE_CAST((o), XFPM_TYPE_ENERGY, XfpmEnergy))
+#define XFPM_IS_ENERGY(o)       (G_TYPE_CHECK_INSTANCE_TYPE((o), XFPM_TYPE_ENERGY))
+
+typedef struct XfpmEnergyPrivate XfpmEnergyPrivate;
+
+typedef struct
+{
+  GObject               parent;
+  XfpmEnergyPrivate    *priv;
+} XfpmEnergy;
+
+typedef struct
+{
+  GObjectClass          parent_class;
+} XfpmEnergyClass;
+
+GType              xfpm_energy_get_type          (void) G_GNUC_CONST;
+XfpmEnergy        *xfpm_energy_new               (void);
+GVariant          *xfpm_energy_get_top_consumers (XfpmEnergy *energy,
+                                                  guint       count);
+
+G_END_DECLS
+
+#endif /* __XFPM_ENERGY_H */
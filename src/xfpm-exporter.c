@@ -0,0 +1,642 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Writes the battery, power source, sleep and display state in the
+ * Prometheus text format for the node_exporter textfile collector.
+ * The file is replaced atomically and only when something changed.
+ * Changes are picked up from the signals of what we export. Only the
+ * DPMS mode has none, the X server blanks the display on its own, it is
+ * polled every metrics-interval seconds.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <gtk/gtk.h>
+#include <upower.h>
+
+#include <libxfce4util/libxfce4util.h>
+
+#include "xfpm-exporter.h"
+#include "xfpm-power.h"
+#include "xfpm-battery.h"
+#include "xfpm-hibernate.h"
+#include "xfpm-inhibit.h"
+#include "xfpm-dpms.h"
+#include "xfpm-xfconf.h"
+#include "xfpm-debug.h"
+
+/* UPower sends a notify per property, write them out together */
+#define METRICS_COALESCE_SECONDS 2
+
+static void xfpm_exporter_finalize   (GObject *object);
+
+struct XfpmExporterPrivate
+{
+  XfpmXfconf          *conf;
+  XfpmPower           *power;
+  XfpmInhibit         *inhibit;
+  XfpmDpms            *dpms;
+  XfpmBacklight       *backlight;
+  XfpmHibernate       *hibernate;
+  UpClient            *upower;
+
+  /* UpDevice -> notify handler id of the batteries we export */
+  GHashTable          *devices;
+  gboolean             devices_changed;
+
+  /* Polls the DPMS mode, the only metric without a change signal */
+  guint                dpms_id;
+  gint                 dpms_level;
+  guint                queue_id;
+
+  /* What we wrote last, to skip writing the same again */
+  gchar               *path;
+  gchar               *contents;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (XfpmExporter, xfpm_exporter, G_TYPE_OBJECT)
+
+static void
+xfpm_exporter_family (GString *str, const gchar *name, const gchar *type, const gchar *help)
+{
+  g_string_append_printf (str, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/* Label values may hold anything the hardware reports */
+static void
+xfpm_exporter_append_label (GString *str, const gchar *name, const gchar *value)
+{
+  const gchar *p;
+
+  g_string_append_printf (str, "%s=\"", name);
+
+  for ( p = value != NULL ? value : ""; *p != '\0'; p++ )
+  {
+    if ( *p == '\\' || *p == '"' )
+      g_string_append_c (str, '\\');
+
+    if ( *p == '\n' )
+      g_string_append (str, "\\n");
+    else
+      g_string_append_c (str, *p);
+  }
+
+  g_string_append_c (str, '"');
+}
+
+static void
+xfpm_exporter_sample (GString *str, const gchar *name, const gchar *labels, gdouble value)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  /* Locale independent, Prometheus wants a dot */
+  g_ascii_formatd (buf, sizeof (buf), "%.6g", value);
+
+  if ( labels != NULL && *labels != '\0' )
+    g_string_append_printf (str, "%s{%s} %s\n", name, labels, buf);
+  else
+    g_string_append_printf (str, "%s %s\n", name, buf);
+}
+
+typedef enum
+{
+  BATTERY_PERCENTAGE,
+  BATTERY_ENERGY,
+  BATTERY_ENERGY_RATE,
+  BATTERY_ENERGY_FULL,
+  BATTERY_ENERGY_FULL_DESIGN,
+  BATTERY_CAPACITY,
+  BATTERY_STATE,
+  N_BATTERY_METRICS
+} XfpmBatteryMetric;
+
+static const struct
+{
+  const gchar *name;
+  const gchar *property;
+  const gchar *help;
+} battery_metrics[N_BATTERY_METRICS] =
+{
+  { "xfpm_battery_percentage", "percentage", "Charge of the device in percent." },
+  { "xfpm_battery_energy_wh", "energy", "Energy left in the device in Wh." },
+  { "xfpm_battery_energy_rate_watts", "energy-rate", "Rate the device charges or discharges at in W." },
+  { "xfpm_battery_energy_full_wh", "energy-full", "Energy of the device when full in Wh." },
+  { "xfpm_battery_energy_full_design_wh", "energy-full-design", "Design energy of the device when full in Wh." },
+  { "xfpm_battery_capacity_ratio", NULL, "Energy when full over the design energy." },
+  { "xfpm_battery_state", NULL, "UPower state of the device, 1 for the current one." },
+};
+
+static void
+xfpm_exporter_append_batteries (XfpmExporter *exporter, GString *str)
+{
+  GList *batteries;
+  GList *li;
+  guint metric;
+
+  batteries = xfpm_power_get_batteries (exporter->priv->power);
+
+  for ( metric = 0; metric < N_BATTERY_METRICS; metric++ )
+  {
+    gboolean first = TRUE;
+
+    for ( li = batteries; li != NULL; li = li->next )
+    {
+      UpDevice *device;
+      UpDeviceKind kind;
+      UpDeviceState state;
+      gchar *native_path = NULL;
+      gdouble value = 0;
+      gdouble full = 0;
+      gdouble design = 0;
+      GString *labels;
+
+      device = xfpm_battery_get_device (XFPM_BATTERY (li->data));
+      if ( device == NULL )
+        continue;
+
+      g_object_get (device,
+                    "kind", &kind,
+                    "state", &state,
+                    "native-path", &native_path,
+                    "energy-full", &full,
+                    "energy-full-design", &design,
+                    NULL);
+
+      /* The AC adapter is xfpm_ac_online */
+      if ( kind == UP_DEVICE_KIND_LINE_POWER )
+      {
+        g_free (native_path);
+        continue;
+      }
+
+      if ( battery_metrics[metric].property != NULL )
+        g_object_get (device, battery_metrics[metric].property, &value, NULL);
+      else if ( metric == BATTERY_CAPACITY )
+        value = design > 0 ? full / design : 0;
+
+      if ( first )
+      {
+        xfpm_exporter_family (str, battery_metrics[metric].name, "gauge",
+                              battery_metrics[metric].help);
+        first = FALSE;
+      }
+
+      labels = g_string_new (NULL);
+      xfpm_exporter_append_label (labels, "device", native_path);
+      g_string_append_c (labels, ',');
+      xfpm_exporter_append_label (labels, "kind", up_device_kind_to_string (kind));
+
+      if ( metric == BATTERY_STATE )
+      {
+        g_string_append_c (labels, ',');
+        xfpm_exporter_append_label (labels, "state", up_device_state_to_string (state));
+        value = 1;
+      }
+
+      xfpm_exporter_sample (str, battery_metrics[metric].name, labels->str, value);
+
+      g_string_free (labels, TRUE);
+      g_free (native_path);
+    }
+  }
+
+  g_list_free (batteries);
+}
+
+static void
+xfpm_exporter_append_sleep (XfpmExporter *exporter, GString *str)
+{
+  XfpmHibernate *hibernate;
+  XfpmSleepStats stats[2];
+  const gchar *labels[2] = { "kind=\"suspend\"", "kind=\"hibernate\"" };
+  guint i;
+
+  hibernate = xfpm_power_get_hibernate (exporter->priv->power);
+  xfpm_hibernate_get_stats (hibernate, FALSE, &stats[0]);
+  xfpm_hibernate_get_stats (hibernate, TRUE, &stats[1]);
+
+  xfpm_exporter_family (str, "xfpm_sleep_total", "counter",
+                        "Sleeps requested since the power manager started.");
+  for ( i = 0; i < 2; i++ )
+    xfpm_exporter_sample (str, "xfpm_sleep_total", labels[i], stats[i].count);
+
+  xfpm_exporter_family (str, "xfpm_sleep_failed_total", "counter",
+                        "Sleeps that failed or never started.");
+  for ( i = 0; i < 2; i++ )
+    xfpm_exporter_sample (str, "xfpm_sleep_failed_total", labels[i], stats[i].failed);
+
+  xfpm_exporter_family (str, "xfpm_sleep_seconds_total", "counter",
+                        "Time spent asleep in seconds.");
+  for ( i = 0; i < 2; i++ )
+    xfpm_exporter_sample (str, "xfpm_sleep_seconds_total", labels[i],
+                          (gdouble) stats[i].asleep_usec / G_USEC_PER_SEC);
+
+  xfpm_exporter_family (str, "xfpm_sleep_last_seconds", "gauge",
+                        "Length of the last sleep in seconds.");
+  for ( i = 0; i < 2; i++ )
+    xfpm_exporter_sample (str, "xfpm_sleep_last_seconds", labels[i],
+                          (gdouble) stats[i].last_usec / G_USEC_PER_SEC);
+}
+
+static void
+xfpm_exporter_append_display (XfpmExporter *exporter, GString *str)
+{
+  const gchar *modes[] = { "on", "standby", "suspend", "off" };
+  CARD16 level;
+  guint i;
+
+  if ( exporter->priv->backlight != NULL && xfpm_backlight_has_hw (exporter->priv->backlight) )
+  {
+    xfpm_exporter_family (str, "xfpm_brightness_level", "gauge",
+                          "Backlight level of the display.");
+    xfpm_exporter_sample (str, "xfpm_brightness_level", NULL,
+                          xfpm_backlight_get_level (exporter->priv->backlight));
+
+    xfpm_exporter_family (str, "xfpm_brightness_max_level", "gauge",
+                          "Highest backlight level of the display.");
+    xfpm_exporter_sample (str, "xfpm_brightness_max_level", NULL,
+                          xfpm_backlight_get_max_level (exporter->priv->backlight));
+  }
+
+  if ( exporter->priv->dpms != NULL && xfpm_dpms_get_level (exporter->priv->dpms, &level) )
+  {
+    exporter->priv->dpms_level = level;
+
+    xfpm_exporter_family (str, "xfpm_dpms_mode", "gauge",
+                          "DPMS mode of the display, 1 for the current one.");
+
+    for ( i = 0; i < G_N_ELEMENTS (modes); i++ )
+    {
+      gchar *labels = g_strdup_printf ("mode=\"%s\"", modes[i]);
+
+      xfpm_exporter_sample (str, "xfpm_dpms_mode", labels, level == i);
+      g_free (labels);
+    }
+  }
+}
+
+static gchar *
+xfpm_exporter_build (XfpmExporter *exporter)
+{
+  GString *str;
+  const gchar **inhibitors;
+  gboolean on_battery;
+
+  str = g_string_new (NULL);
+
+  xfpm_exporter_append_batteries (exporter, str);
+
+  g_object_get (G_OBJECT (exporter->priv->power),
+                "on-battery", &on_battery,
+                NULL);
+
+  xfpm_exporter_family (str, "xfpm_ac_online", "gauge",
+                        "Whether the system runs on AC power.");
+  xfpm_exporter_sample (str, "xfpm_ac_online", NULL, !on_battery);
+
+  inhibitors = xfpm_inhibit_get_inhibit_list (exporter->priv->inhibit);
+  xfpm_exporter_family (str, "xfpm_inhibitors", "gauge",
+                        "Applications keeping the system from sleeping.");
+  xfpm_exporter_sample (str, "xfpm_inhibitors", NULL, g_strv_length ((gchar **) inhibitors));
+  g_free (inhibitors);
+
+  xfpm_exporter_append_sleep (exporter, str);
+  xfpm_exporter_append_display (exporter, str);
+
+  return g_string_free (str, FALSE);
+}
+
+static void xfpm_exporter_queue_write (XfpmExporter *exporter);
+
+/* Follow the batteries UPower currently has */
+static void
+xfpm_exporter_watch_batteries (XfpmExporter *exporter)
+{
+  GHashTable *old = exporter->priv->devices;
+  GHashTableIter iter;
+  GList *batteries;
+  GList *li;
+  gpointer device;
+  gpointer id;
+
+  exporter->priv->devices = g_hash_table_new_full (NULL, NULL, g_object_unref, NULL);
+
+  batteries = xfpm_power_get_batteries (exporter->priv->power);
+
+  for ( li = batteries; li != NULL; li = li->next )
+  {
+    device = xfpm_battery_get_device (XFPM_BATTERY (li->data));
+    if ( device == NULL )
+      continue;
+
+    if ( old != NULL && g_hash_table_lookup_extended (old, device, NULL, &id) )
+    {
+      /* Moves the reference along */
+      g_hash_table_steal (old, device);
+    }
+    else
+    {
+      id = GSIZE_TO_POINTER (g_signal_connect_swapped (device, "notify",
+                                                       G_CALLBACK (xfpm_exporter_queue_write),
+                                                       exporter));
+      g_object_ref (device);
+    }
+
+    g_hash_table_insert (exporter->priv->devices, device, id);
+  }
+
+  g_list_free (batteries);
+
+  if ( old == NULL )
+    return;
+
+  g_hash_table_iter_init (&iter, old);
+  while ( g_hash_table_iter_next (&iter, &device, &id) )
+    g_signal_handler_disconnect (device, GPOINTER_TO_SIZE (id));
+
+  g_hash_table_destroy (old);
+}
+
+static void
+xfpm_exporter_write (XfpmExporter *exporter)
+{
+  gchar *contents;
+  GError *error = NULL;
+
+  /* Only after UPower added or removed something, XfpmPower has
+   * caught up with it by the time the queued write runs */
+  if ( exporter->priv->devices_changed )
+  {
+    exporter->priv->devices_changed = FALSE;
+    xfpm_exporter_watch_batteries (exporter);
+  }
+
+  contents = xfpm_exporter_build (exporter);
+
+  if ( g_strcmp0 (contents, exporter->priv->contents) == 0 )
+  {
+    g_free (contents);
+    return;
+  }
+
+  /* Writes a temporary file next to it and renames it over, the
+   * collector never sees half a file */
+  if ( !g_file_set_contents (exporter->priv->path, contents, -1, &error) )
+  {
+    g_warning ("Unable to write %s: %s", exporter->priv->path, error->message);
+    g_error_free (error);
+    g_free (contents);
+    return;
+  }
+
+  XFPM_DEBUG ("Metrics written to %s", exporter->priv->path);
+
+  g_free (exporter->priv->contents);
+  exporter->priv->contents = contents;
+}
+
+/* The X server blanks the display on its own, without telling us */
+static gboolean
+xfpm_exporter_dpms_cb (gpointer data)
+{
+  XfpmExporter *exporter = XFPM_EXPORTER (data);
+  CARD16 level;
+
+  if ( xfpm_dpms_get_level (exporter->priv->dpms, &level) && level != exporter->priv->dpms_level )
+    xfpm_exporter_queue_write (exporter);
+
+  return TRUE;
+}
+
+static gboolean
+xfpm_exporter_queue_cb (gpointer data)
+{
+  XfpmExporter *exporter = XFPM_EXPORTER (data);
+
+  exporter->priv->queue_id = 0;
+  xfpm_exporter_write (exporter);
+
+  return FALSE;
+}
+
+static void
+xfpm_exporter_queue_write (XfpmExporter *exporter)
+{
+  if ( exporter->priv->path == NULL || exporter->priv->queue_id != 0 )
+    return;
+
+  exporter->priv->queue_id = g_timeout_add_seconds (METRICS_COALESCE_SECONDS,
+                                                    xfpm_exporter_queue_cb, exporter);
+}
+
+static void
+xfpm_exporter_devices_changed_cb (XfpmExporter *exporter)
+{
+  exporter->priv->devices_changed = TRUE;
+  xfpm_exporter_queue_write (exporter);
+}
+
+static void
+xfpm_exporter_start (XfpmExporter *exporter)
+{
+  const XfpmConfig *config;
+  CARD16 level;
+
+  if ( exporter->priv->dpms_id != 0 )
+  {
+    g_source_remove (exporter->priv->dpms_id);
+    exporter->priv->dpms_id = 0;
+  }
+
+  if ( exporter->priv->queue_id != 0 )
+  {
+    g_source_remove (exporter->priv->queue_id);
+    exporter->priv->queue_id = 0;
+  }
+
+  g_clear_pointer (&exporter->priv->path, g_free);
+  g_clear_pointer (&exporter->priv->contents, g_free);
+
+  config = xfpm_xfconf_get_config (exporter->priv->conf);
+
+  if ( config->metrics_textfile == NULL || *config->metrics_textfile == '\0' )
+    return;
+
+  exporter->priv->path = g_strdup (config->metrics_textfile);
+  exporter->priv->dpms_level = -1;
+  exporter->priv->devices_changed = TRUE;
+
+  if ( xfpm_dpms_get_level (exporter->priv->dpms, &level) )
+  {
+    XFPM_DEBUG ("Writing metrics to %s on changes, checking the display every %u seconds",
+                exporter->priv->path, config->metrics_interval);
+    exporter->priv->dpms_id = g_timeout_add_seconds (config->metrics_interval,
+                                                     xfpm_exporter_dpms_cb, exporter);
+  }
+  else
+  {
+    XFPM_DEBUG ("Writing metrics to %s on changes", exporter->priv->path);
+  }
+
+  xfpm_exporter_write (exporter);
+}
+
+static void
+xfpm_exporter_settings_changed_cb (XfpmXfconf *conf,
+                                   const gchar **keys,
+                                   XfpmExporter *exporter)
+{
+  guint i;
+
+  for ( i = 0; keys[i] != NULL; i++ )
+  {
+    if ( g_str_has_prefix (keys[i], "metrics-") )
+    {
+      xfpm_exporter_start (exporter);
+      return;
+    }
+  }
+}
+
+static void
+xfpm_exporter_class_init (XfpmExporterClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = xfpm_exporter_finalize;
+}
+
+static void
+xfpm_exporter_init (XfpmExporter *exporter)
+{
+  exporter->priv = xfpm_exporter_get_instance_private (exporter);
+
+  exporter->priv->conf = xfpm_xfconf_new ();
+  exporter->priv->power = xfpm_power_get ();
+  exporter->priv->inhibit = xfpm_inhibit_new ();
+  exporter->priv->dpms = xfpm_dpms_new ();
+  exporter->priv->hibernate = g_object_ref (xfpm_power_get_hibernate (exporter->priv->power));
+  exporter->priv->upower = g_object_ref (xfpm_power_get_client (exporter->priv->power));
+
+  g_signal_connect (exporter->priv->conf, "config-changed",
+                    G_CALLBACK (xfpm_exporter_settings_changed_cb), exporter);
+
+  g_signal_connect_swapped (exporter->priv->upower, "device-added",
+                            G_CALLBACK (xfpm_exporter_devices_changed_cb), exporter);
+  g_signal_connect_swapped (exporter->priv->upower, "device-removed",
+                            G_CALLBACK (xfpm_exporter_devices_changed_cb), exporter);
+  g_signal_connect_swapped (exporter->priv->power, "on-battery-changed",
+                            G_CALLBACK (xfpm_exporter_queue_write), exporter);
+  g_signal_connect_swapped (exporter->priv->power, "sleeping",
+                            G_CALLBACK (xfpm_exporter_queue_write), exporter);
+  g_signal_connect_swapped (exporter->priv->hibernate, "sleep-finished",
+                            G_CALLBACK (xfpm_exporter_queue_write), exporter);
+  g_signal_connect_swapped (exporter->priv->inhibit, "inhibitors-list-changed",
+                            G_CALLBACK (xfpm_exporter_queue_write), exporter);
+  g_signal_connect_swapped (exporter->priv->dpms, "level-changed",
+                            G_CALLBACK (xfpm_exporter_queue_write), exporter);
+}
+
+static void
+xfpm_exporter_finalize (GObject *object)
+{
+  XfpmExporter *exporter;
+
+  exporter = XFPM_EXPORTER (object);
+
+  if ( exporter->priv->dpms_id != 0 )
+    g_source_remove (exporter->priv->dpms_id);
+
+  if ( exporter->priv->queue_id != 0 )
+    g_source_remove (exporter->priv->queue_id);
+
+  if ( exporter->priv->devices != NULL )
+  {
+    GHashTableIter iter;
+    gpointer device;
+    gpointer id;
+
+    g_hash_table_iter_init (&iter, exporter->priv->devices);
+    while ( g_hash_table_iter_next (&iter, &device, &id) )
+      g_signal_handler_disconnect (device, GPOINTER_TO_SIZE (id));
+
+    g_hash_table_destroy (exporter->priv->devices);
+  }
+
+  g_signal_handlers_disconnect_by_data (exporter->priv->conf, exporter);
+  g_signal_handlers_disconnect_by_data (exporter->priv->upower, exporter);
+  g_signal_handlers_disconnect_by_data (exporter->priv->power, exporter);
+  g_signal_handlers_disconnect_by_data (exporter->priv->hibernate, exporter);
+  g_signal_handlers_disconnect_by_data (exporter->priv->inhibit, exporter);
+  g_signal_handlers_disconnect_by_data (exporter->priv->dpms, exporter);
+
+  if ( exporter->priv->backlight != NULL )
+  {
+    g_signal_handlers_disconnect_by_data (exporter->priv->backlight, exporter);
+    g_object_unref (exporter->priv->backlight);
+  }
+
+  g_object_unref (exporter->priv->hibernate);
+  g_object_unref (exporter->priv->upower);
+
+  g_object_unref (exporter->priv->conf);
+  g_object_unref (exporter->priv->power);
+  g_object_unref (exporter->priv->inhibit);
+  g_object_unref (exporter->priv->dpms);
+
+  g_free (exporter->priv->path);
+  g_free (exporter->priv->contents);
+
+  G_OBJECT_CLASS (xfpm_exporter_parent_class)->finalize (object);
+}
+
+/**
+ * xfpm_exporter_new:
+ * @backlight: the display backlight, or %NULL
+ **/
+XfpmExporter *
+xfpm_exporter_new (XfpmBacklight *backlight)
+{
+  XfpmExporter *exporter;
+
+  exporter = g_object_new (XFPM_TYPE_EXPORTER, NULL);
+
+  if ( backlight != NULL )
+  {
+    exporter->priv->backlight = g_object_ref (backlight);
+    g_signal_connect_swapped (backlight, "brightness-changed",
+                              G_CALLBACK (xfpm_exporter_queue_write), exporter);
+  }
+
+  xfpm_exporter_start (exporter);
+
+  return exporter;
+}
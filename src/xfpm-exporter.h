@@ -0,0 +1,52 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __XFPM_EXPORTER_H
+#define __XFPM_EXPORTER_H
+
+#include <glib-object.h>
+
+#include "xfpm-backlight.h"
+
+G_BEGIN_DECLS
+
+#define XFPM_TYPE_EXPORTER        (xfpm_exporter_get_type () )
+#define XFPM_EXPORTER(o)          (G_TYPE_CHECK_INSTANCE_CAST((o), XFPM_TYPE_EXPORTER, XfpmExporter))
+#define XFPM_IS_EXPORTER(o)       (G_TYPE_CHECK_INSTANCE_TYPE((o), XFPM_TYPE_EXPORTER))
+
+typedef struct XfpmExporterPrivate XfpmExporterPrivate;
+
+typedef struct
+{
+  GObject               parent;
+  XfpmExporterPrivate  *priv;
+} XfpmExporter;
+
+typedef struct
+{
+  GObjectClass          parent_class;
+} XfpmExporterClass;
+
+GType              xfpm_exporter_get_type       (void) G_GNUC_CONST;
+XfpmExporter      *xfpm_exporter_new            (XfpmBacklight *backlight);
+
+G_END_DECLS
+
+#endif /* __XFPM_EXPORTER_H */
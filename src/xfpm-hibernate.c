@@ -0,0 +1,989 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <gio/gio.h>
+
+#include <libxfce4util/libxfce4util.h>
+
+#include "xfpm-hibernate.h"
+#include "xfpm-wakeup.h"
+#include "xfpm-notify.h"
+#include "xfpm-xfconf.h"
+#include "xfpm-config.h"
+#include "xfpm-debug.h"
+#include "xfpm-journal.h"
+#include "xfpm-pkexec.h"
+
+static void xfpm_hibernate_finalize   (GObject *object);
+
+#define PM_HELPER               SBINDIR "/xfce4-pm-helper"
+
+/* How long logind gets to start hibernating after accepting the request */
+#define HIBERNATE_START_TIMEOUT 120
+
+/* Wall clock running ahead of the monotonic one by more than this
+ * means we were asleep */
+#define HIBERNATE_SLEPT_USEC    (G_USEC_PER_SEC)
+
+/* A wake this close to the alarm was the alarm */
+#define WAKE_ALARM_SLACK_USEC   (60 * G_USEC_PER_SEC)
+
+/* Lets UPower and the lid state catch up before sleeping again */
+#define RESLEEP_DELAY           5
+
+/* Durations we couldn't measure stay -1 */
+#define USEC_TO_MSEC(usec)      ((usec) < 0 ? -1 : (usec) / 1000)
+
+typedef enum
+{
+  HIBERNATE_IDLE,
+  HIBERNATE_REQUESTED,
+  HIBERNATE_SLEEPING
+} XfpmHibernateStage;
+
+typedef enum
+{
+  SLEEP_HIBERNATE,
+  SLEEP_SUSPEND
+} XfpmSleepKind;
+
+enum
+{
+  SLEEP_REQUEST,
+  SLEEP_FINISHED,
+  LAST_SIGNAL
+};
+
+static guint signals [LAST_SIGNAL] = { 0 };
+
+struct XfpmHibernatePrivate
+{
+  XfpmXfconf          *conf;
+  XfpmNotify          *notify;
+  XfpmWakeup          *wakeup;
+  GDBusConnection     *bus;
+  guint                prepare_id;
+
+  XfpmPkexec          *pm_helper;
+
+  gchar               *proc_root;
+  gchar               *sys_root;
+
+  XfpmHibernateStage   stage;
+  XfpmSleepKind        kind;
+  guint                timeout_id;
+
+  /* Suspend-then-hibernate: the suspend wakes up on the RTC alarm,
+   * or logind handles it and we only measure */
+  gboolean             cycle;
+  const gchar         *method;
+  gint64               alarm_real;
+  guint                resleep_id;
+  const gchar         *resleep_action;
+
+  /* Battery energy in Wh when the suspend started, -1 without one */
+  gdouble              energy_before;
+
+  /* Indexed by XfpmSleepKind */
+  XfpmSleepStats       stats[2];
+
+  /* Memory when the attempt started, in KiB */
+  guint64              anon;
+  guint64              cache;
+
+  /* image_size we set and the one to put back, -1 if untouched */
+  gint64               image_size;
+  gint64               saved_image_size;
+
+  /* Request, the last moment before the freeze and the resume, as
+   * monotonic and wall clock times */
+  gint64               request_mono;
+  gint64               request_real;
+  gint64               sleep_mono;
+  gint64               sleep_real;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (XfpmHibernate, xfpm_hibernate, G_TYPE_OBJECT)
+
+static gint64
+xfpm_hibernate_read_image_size (XfpmHibernate *hibernate)
+{
+  gchar *filename;
+  gchar *contents = NULL;
+  gint64 size = -1;
+
+  filename = g_build_filename (hibernate->priv->sys_root, "power", "image_size", NULL);
+  if ( g_file_get_contents (filename, &contents, NULL, NULL) )
+    size = g_ascii_strtoll (contents, NULL, 10);
+
+  g_free (contents);
+  g_free (filename);
+
+  return size;
+}
+
+/*
+ * Anonymous memory has to go into the image or out to swap, both cost
+ * about the same, so it is always kept. Reclaimable page cache is what
+ * the kernel drops to reach image_size, we keep the configured share
+ * of it.
+ */
+static gint64
+xfpm_hibernate_get_target (XfpmHibernate *hibernate, guint keep_cache)
+{
+  gchar *filename;
+  gchar *contents = NULL;
+  gchar **lines;
+  guint64 anon = 0, shmem = 0, cached = 0, sreclaimable = 0;
+  guint64 sunreclaim = 0, kernel_stack = 0, page_tables = 0;
+  guint64 required;
+  guint i;
+
+  filename = g_build_filename (hibernate->priv->proc_root, "meminfo", NULL);
+  if ( !g_file_get_contents (filename, &contents, NULL, NULL) )
+  {
+    g_free (filename);
+    return -1;
+  }
+  g_free (filename);
+
+  lines = g_strsplit (contents, "\n", -1);
+  for ( i = 0; lines[i] != NULL; i++ )
+  {
+    gchar *value = strchr (lines[i], ':');
+    guint64 kib;
+
+    if ( value == NULL )
+      continue;
+
+    *value++ = '\0';
+    kib = g_ascii_strtoull (value, NULL, 10);
+
+    if ( g_strcmp0 (lines[i], "AnonPages") == 0 )
+      anon = kib;
+    else if ( g_strcmp0 (lines[i], "Shmem") == 0 )
+      shmem = kib;
+    else if ( g_strcmp0 (lines[i], "Cached") == 0 )
+      cached = kib;
+    else if ( g_strcmp0 (lines[i], "SReclaimable") == 0 )
+      sreclaimable = kib;
+    else if ( g_strcmp0 (lines[i], "SUnreclaim") == 0 )
+      sunreclaim = kib;
+    else if ( g_strcmp0 (lines[i], "KernelStack") == 0 )
+      kernel_stack = kib;
+    else if ( g_strcmp0 (lines[i], "PageTables") == 0 )
+      page_tables = kib;
+  }
+
+  g_strfreev (lines);
+  g_free (contents);
+
+  /* Cached counts shmem too, which can't be dropped */
+  hibernate->priv->anon = anon + shmem;
+  hibernate->priv->cache = (cached > shmem ? cached - shmem : 0) + sreclaimable;
+
+  required = hibernate->priv->anon + sunreclaim + kernel_stack + page_tables;
+
+  return (gint64) (required + hibernate->priv->cache * keep_cache / 100) * 1024;
+}
+
+/*
+ * Runs xfce4-pm-helper with @args, waiting for it when the change has
+ * to be in place before going on.
+ */
+static gboolean
+xfpm_hibernate_run_pm_helper (XfpmHibernate *hibernate, const gchar * const *args, gboolean wait)
+{
+  GError *error = NULL;
+
+  if ( !wait )
+  {
+    xfpm_pkexec_run (hibernate->priv->pm_helper, args);
+    return TRUE;
+  }
+
+  if ( !xfpm_pkexec_run_sync (hibernate->priv->pm_helper, args, &error) )
+  {
+    g_warning ("Unable to run %s: %s", PM_HELPER, error->message);
+    g_error_free (error);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gdouble
+xfpm_hibernate_read_double (const gchar *dir, const gchar *name)
+{
+  gchar *filename;
+  gchar *contents = NULL;
+  gdouble value = -1;
+
+  filename = g_build_filename (dir, name, NULL);
+  if ( g_file_get_contents (filename, &contents, NULL, NULL) )
+    value = g_ascii_strtod (contents, NULL);
+
+  g_free (contents);
+  g_free (filename);
+
+  return value;
+}
+
+/*
+ * Sums the system batteries straight from sysfs, UPower may not have
+ * refreshed yet this early after a resume. Returns the energy in Wh
+ * or -1 without a battery, @full gets the energy when fully charged
+ * in Wh, which is what the charge percentage is relative to.
+ */
+static gdouble
+xfpm_hibernate_read_battery (XfpmHibernate *hibernate, gdouble *full, gboolean *on_ac)
+{
+  GDir *dir;
+  gchar *path;
+  const gchar *name;
+  gdouble energy = -1;
+
+  *full = 0;
+  *on_ac = FALSE;
+
+  path = g_build_filename (hibernate->priv->sys_root, "class", "power_supply", NULL);
+  dir = g_dir_open (path, 0, NULL);
+
+  while ( dir != NULL && (name = g_dir_read_name (dir)) != NULL )
+  {
+    gchar *supply;
+    gchar *type = NULL;
+    gchar *scope = NULL;
+    gchar *filename;
+
+    supply = g_build_filename (path, name, NULL);
+
+    filename = g_build_filename (supply, "type", NULL);
+    g_file_get_contents (filename, &type, NULL, NULL);
+    g_free (filename);
+
+    filename = g_build_filename (supply, "scope", NULL);
+    g_file_get_contents (filename, &scope, NULL, NULL);
+    g_free (filename);
+
+    if ( type != NULL && g_str_has_prefix (type, "Mains") )
+    {
+      if ( xfpm_hibernate_read_double (supply, "online") > 0 )
+        *on_ac = TRUE;
+    }
+    else if ( type != NULL && g_str_has_prefix (type, "Battery") &&
+              (scope == NULL || !g_str_has_prefix (scope, "Device")) )
+    {
+      gdouble now = xfpm_hibernate_read_double (supply, "energy_now");
+      gdouble capacity = xfpm_hibernate_read_double (supply, "energy_full");
+
+      /* Charge based batteries, µAh times the design voltage */
+      if ( now < 0 || capacity <= 0 )
+      {
+        gdouble voltage = xfpm_hibernate_read_double (supply, "voltage_min_design") / 1e6;
+
+        now = xfpm_hibernate_read_double (supply, "charge_now") * voltage;
+        capacity = xfpm_hibernate_read_double (supply, "charge_full") * voltage;
+      }
+
+      if ( now >= 0 && capacity > 0 )
+      {
+        energy = MAX (energy, 0) + now / 1e6;
+        *full += capacity / 1e6;
+      }
+    }
+
+    g_free (type);
+    g_free (scope);
+    g_free (supply);
+  }
+
+  if ( dir != NULL )
+    g_dir_close (dir);
+  g_free (path);
+
+  return energy;
+}
+
+static void
+xfpm_hibernate_append (const gchar *line)
+{
+  GDateTime *now;
+  gchar *stamp;
+  gchar *dir;
+  gchar *filename;
+  FILE *file;
+
+  dir = g_build_filename (g_get_user_cache_dir (), "xfce4-power-manager", NULL);
+  if ( g_mkdir_with_parents (dir, 0700) != 0 )
+  {
+    g_free (dir);
+    return;
+  }
+
+  filename = g_build_filename (dir, "sleep-history", NULL);
+  file = fopen (filename, "a");
+
+  if ( file != NULL )
+  {
+    now = g_date_time_new_now_utc ();
+    stamp = g_date_time_format (now, "%Y-%m-%dT%H:%M:%SZ");
+
+    fprintf (file, "%s %s\n", stamp, line);
+
+    fclose (file);
+    g_free (stamp);
+    g_date_time_unref (now);
+  }
+
+  g_free (filename);
+  g_free (dir);
+}
+
+/*
+ * One line per attempt in the user's cache directory, e.g.
+ * 2026-01-02T10:00:00Z hibernate result=ok image_size=... anon_kib=...
+ * suspends get their own line with the drain, see below.
+ */
+static void
+xfpm_hibernate_record (XfpmHibernate *hibernate, const gchar *result, const gchar *woke,
+                       gint64 prepare_usec, gint64 kernel_usec, gint64 offline_usec)
+{
+  gchar *line;
+
+  XFPM_DEBUG ("Hibernate %s: image size %" G_GINT64_FORMAT ", prepare %" G_GINT64_FORMAT
+              " ms, in kernel %" G_GINT64_FORMAT " ms, offline %" G_GINT64_FORMAT " ms",
+              result, hibernate->priv->image_size, USEC_TO_MSEC (prepare_usec),
+              USEC_TO_MSEC (kernel_usec), USEC_TO_MSEC (offline_usec));
+
+  line = g_strdup_printf ("hibernate result=%s image_size=%" G_GINT64_FORMAT
+                          " anon_kib=%" G_GUINT64_FORMAT " cache_kib=%" G_GUINT64_FORMAT
+                          " prepare_ms=%" G_GINT64_FORMAT " kernel_ms=%" G_GINT64_FORMAT
+                          " offline_ms=%" G_GINT64_FORMAT "%s%s",
+                          result, hibernate->priv->image_size,
+                          hibernate->priv->anon, hibernate->priv->cache,
+                          USEC_TO_MSEC (prepare_usec), USEC_TO_MSEC (kernel_usec),
+                          USEC_TO_MSEC (offline_usec),
+                          woke != NULL ? " " : "", woke != NULL ? woke : "");
+  xfpm_hibernate_append (line);
+  g_free (line);
+}
+
+static void
+xfpm_hibernate_reset (XfpmHibernate *hibernate)
+{
+  const gchar *args[3];
+  gchar *image_size = NULL;
+  guint i = 0;
+
+  if ( hibernate->priv->timeout_id != 0 )
+  {
+    g_source_remove (hibernate->priv->timeout_id);
+    hibernate->priv->timeout_id = 0;
+  }
+
+  /* Don't leave our value behind for hibernations started elsewhere */
+  if ( hibernate->priv->saved_image_size >= 0 )
+  {
+    image_size = g_strdup_printf ("--image-size=%" G_GINT64_FORMAT,
+                                  hibernate->priv->saved_image_size);
+    args[i++] = image_size;
+  }
+
+  /* We woke up before the alarm, it would wake us from the next sleep */
+  if ( hibernate->priv->alarm_real != 0 )
+    args[i++] = "--wake-alarm=0";
+
+  args[i] = NULL;
+
+  if ( i > 0 )
+    xfpm_hibernate_run_pm_helper (hibernate, args, FALSE);
+
+  g_free (image_size);
+
+  hibernate->priv->saved_image_size = -1;
+  hibernate->priv->alarm_real = 0;
+  hibernate->priv->cycle = FALSE;
+  hibernate->priv->stage = HIBERNATE_IDLE;
+}
+
+static gboolean
+xfpm_hibernate_resleep_cb (gpointer user_data)
+{
+  XfpmHibernate *hibernate = XFPM_HIBERNATE (user_data);
+
+  hibernate->priv->resleep_id = 0;
+
+  g_signal_emit (G_OBJECT (hibernate), signals [SLEEP_REQUEST], 0,
+                 hibernate->priv->resleep_action);
+
+  return FALSE;
+}
+
+/*
+ * Records the drain of a suspend and, on the timed wake of a
+ * suspend-then-hibernate cycle, goes back to sleep if the charge
+ * projected for the next wake stays above the critical level or
+ * hibernates otherwise.
+ */
+static void
+xfpm_hibernate_suspend_finished (XfpmHibernate *hibernate, const gchar *result,
+                                 const gchar *woke, gint64 slept_usec)
+{
+  gdouble energy;
+  gdouble full;
+  gboolean on_ac;
+  gdouble hours;
+  gdouble drain = -1;
+  gdouble drain_percent = -1;
+  gboolean alarm_wake;
+  gchar *line;
+
+  energy = xfpm_hibernate_read_battery (hibernate, &full, &on_ac);
+  hours = slept_usec / (3600.0 * G_USEC_PER_SEC);
+
+  /* Less than a few minutes is too noisy for a rate */
+  if ( energy >= 0 && hibernate->priv->energy_before >= 0 && hours > 0.05 )
+  {
+    drain = (hibernate->priv->energy_before - energy) / hours;
+    drain_percent = drain / full * 100;
+  }
+
+  XFPM_DEBUG ("Suspend %s (%s): slept %.2f h, %.2f Wh -> %.2f Wh, %.3f W",
+              result, hibernate->priv->method, hours,
+              hibernate->priv->energy_before, energy, drain);
+
+  line = g_strdup_printf ("suspend result=%s method=%s slept_s=%" G_GINT64_FORMAT
+                          " energy_before_wh=%.2f energy_after_wh=%.2f"
+                          " drain_w=%.3f drain_percent_per_hour=%.2f%s%s",
+                          result, hibernate->priv->method,
+                          slept_usec < 0 ? -1 : slept_usec / G_USEC_PER_SEC,
+                          hibernate->priv->energy_before, energy,
+                          drain, drain_percent,
+                          woke != NULL ? " " : "", woke != NULL ? woke : "");
+  xfpm_hibernate_append (line);
+  g_free (line);
+
+  alarm_wake = hibernate->priv->alarm_real != 0 &&
+               g_get_real_time () >= hibernate->priv->alarm_real - WAKE_ALARM_SLACK_USEC;
+
+  if ( hibernate->priv->cycle && alarm_wake && g_strcmp0 (result, "ok") == 0 )
+  {
+    const XfpmConfig *config;
+    gdouble projected = 100;
+
+    /* The alarm went off, nothing left to clear */
+    hibernate->priv->alarm_real = 0;
+
+    config = xfpm_xfconf_get_config (hibernate->priv->conf);
+
+    if ( energy >= 0 && full > 0 )
+      projected = energy / full * 100 -
+                  MAX (drain_percent, 0) * config->suspend_then_hibernate_interval / 60.0;
+
+    if ( !on_ac && projected <= config->critical_level )
+    {
+      XFPM_DEBUG ("%.1f%% projected for the next wake, hibernating", projected);
+      hibernate->priv->resleep_action = "Hibernate";
+    }
+    else
+    {
+      XFPM_DEBUG ("%.1f%% projected for the next wake, suspending again", projected);
+      hibernate->priv->resleep_action = "Suspend";
+    }
+
+    if ( hibernate->priv->resleep_id != 0 )
+      g_source_remove (hibernate->priv->resleep_id);
+    hibernate->priv->resleep_id = g_timeout_add_seconds (RESLEEP_DELAY,
+                                                         xfpm_hibernate_resleep_cb,
+                                                         hibernate);
+  }
+}
+
+/*
+ * A sleep that ended right away was most likely ended by a device,
+ * tell the user which one instead of leaving them guessing.
+ */
+static void
+xfpm_hibernate_notify_short_sleep (XfpmHibernate *hibernate, gint64 slept_usec,
+                                   const gchar *culprit)
+{
+  guint threshold;
+  gint seconds;
+  gchar *message;
+
+  threshold = xfpm_xfconf_get_config (hibernate->priv->conf)->short_sleep_threshold;
+
+  if ( threshold == 0 || slept_usec < 0 || slept_usec >= (gint64) threshold * G_USEC_PER_SEC )
+    return;
+
+  seconds = slept_usec / G_USEC_PER_SEC;
+
+  if ( culprit != NULL )
+    message = g_strdup_printf (ngettext ("The system woke up after %i second, woken by %s.",
+                                         "The system woke up after %i seconds, woken by %s.",
+                                         seconds),
+                               seconds, culprit);
+  else
+    message = g_strdup_printf (ngettext ("The system woke up after %i second.",
+                                         "The system woke up after %i seconds.",
+                                         seconds),
+                               seconds);
+
+  xfpm_notify_post (hibernate->priv->notify,
+                    XFPM_NOTIFY_CATEGORY_GENERAL,
+                    "short-sleep",
+                    _("Power Manager"),
+                    message,
+                    "dialog-information",
+                    XFPM_NOTIFY_NORMAL);
+
+  g_free (message);
+}
+
+static void
+xfpm_hibernate_finished (XfpmHibernate *hibernate, const gchar *result,
+                         gint64 prepare_usec, gint64 kernel_usec, gint64 offline_usec)
+{
+  XfpmSleepStats *stats;
+  gchar *woke;
+  gchar *culprit = NULL;
+
+  woke = xfpm_wakeup_diff (hibernate->priv->wakeup, &culprit);
+
+  /* What woke us when it went fine, else how it went */
+  xfpm_journal_log (XFPM_JOURNAL_RESUME,
+                    offline_usec >= 0 ? offline_usec / G_USEC_PER_SEC : -1,
+                    g_strcmp0 (result, "ok") == 0 ? culprit : result);
+
+  stats = &hibernate->priv->stats[hibernate->priv->kind];
+  stats->count++;
+  if ( g_strcmp0 (result, "ok") == 0 && offline_usec >= 0 )
+  {
+    stats->asleep_usec += offline_usec;
+    stats->last_usec = offline_usec;
+  }
+  else
+  {
+    stats->failed++;
+  }
+
+  if ( hibernate->priv->kind == SLEEP_HIBERNATE )
+    xfpm_hibernate_record (hibernate, result, woke, prepare_usec, kernel_usec, offline_usec);
+  else
+    xfpm_hibernate_suspend_finished (hibernate, result, woke, offline_usec);
+
+  if ( g_strcmp0 (result, "ok") == 0 )
+    xfpm_hibernate_notify_short_sleep (hibernate, offline_usec, culprit);
+
+  g_free (culprit);
+  g_free (woke);
+
+  xfpm_hibernate_reset (hibernate);
+
+  g_signal_emit (G_OBJECT (hibernate), signals [SLEEP_FINISHED], 0);
+}
+
+static gboolean
+xfpm_hibernate_timeout_cb (gpointer user_data)
+{
+  XfpmHibernate *hibernate = XFPM_HIBERNATE (user_data);
+
+  XFPM_DEBUG ("The system didn't go to sleep");
+
+  hibernate->priv->timeout_id = 0;
+  xfpm_hibernate_finished (hibernate, "not-started", -1, -1, -1);
+
+  return FALSE;
+}
+
+static void
+xfpm_hibernate_prepare_for_sleep_cb (GDBusConnection *connection,
+                                     const gchar *sender_name,
+                                     const gchar *object_path,
+                                     const gchar *interface_name,
+                                     const gchar *signal_name,
+                                     GVariant *parameters,
+                                     gpointer user_data)
+{
+  XfpmHibernate *hibernate = XFPM_HIBERNATE (user_data);
+  gboolean start;
+  gint64 mono;
+  gint64 real;
+
+  if ( !g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(b)")) )
+    return;
+
+  g_variant_get (parameters, "(b)", &start);
+
+  mono = g_get_monotonic_time ();
+  real = g_get_real_time ();
+
+  if ( start && hibernate->priv->stage == HIBERNATE_REQUESTED )
+  {
+    hibernate->priv->stage = HIBERNATE_SLEEPING;
+    hibernate->priv->sleep_mono = mono;
+    hibernate->priv->sleep_real = real;
+
+    if ( hibernate->priv->timeout_id != 0 )
+    {
+      g_source_remove (hibernate->priv->timeout_id);
+      hibernate->priv->timeout_id = 0;
+    }
+  }
+  else if ( !start && hibernate->priv->stage == HIBERNATE_SLEEPING )
+  {
+    gint64 kernel = mono - hibernate->priv->sleep_mono;
+
+    xfpm_hibernate_finished (hibernate, "ok",
+                             hibernate->priv->sleep_mono - hibernate->priv->request_mono,
+                             kernel,
+                             real - hibernate->priv->sleep_real - kernel);
+  }
+}
+
+static void
+xfpm_hibernate_bus_ready_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  XfpmHibernate *hibernate = XFPM_HIBERNATE (user_data);
+  GError *error = NULL;
+
+  hibernate->priv->bus = g_bus_get_finish (res, &error);
+
+  if ( hibernate->priv->bus == NULL )
+  {
+    XFPM_DEBUG ("No system bus, sleep timing only for the built-in fallback: %s",
+                error->message);
+    g_error_free (error);
+  }
+  else
+  {
+    /* logind and ConsoleKit2 both announce the sleep this way */
+    hibernate->priv->prepare_id =
+      g_dbus_connection_signal_subscribe (hibernate->priv->bus,
+                                          NULL,
+                                          NULL,
+                                          "PrepareForSleep",
+                                          NULL,
+                                          NULL,
+                                          G_DBUS_SIGNAL_FLAGS_NONE,
+                                          xfpm_hibernate_prepare_for_sleep_cb,
+                                          hibernate,
+                                          NULL);
+  }
+
+  g_object_unref (hibernate);
+}
+
+static void
+xfpm_hibernate_class_init (XfpmHibernateClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = xfpm_hibernate_finalize;
+
+  /**
+   * XfpmHibernate::sleep-request:
+   * @sleep_time: "Suspend" or "Hibernate"
+   *
+   * Emitted after the timed wake of a suspend-then-hibernate cycle.
+   **/
+  signals [SLEEP_REQUEST] =
+    g_signal_new ("sleep-request",
+                  XFPM_TYPE_HIBERNATE,
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (XfpmHibernateClass, sleep_request),
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__STRING,
+                  G_TYPE_NONE, 1, G_TYPE_STRING);
+
+  /**
+   * XfpmHibernate::sleep-finished:
+   *
+   * Emitted once an attempt is over and its statistics are updated.
+   **/
+  signals [SLEEP_FINISHED] =
+    g_signal_new ("sleep-finished",
+                  XFPM_TYPE_HIBERNATE,
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (XfpmHibernateClass, sleep_finished),
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
+}
+
+static void
+xfpm_hibernate_init (XfpmHibernate *hibernate)
+{
+  const gchar *root;
+
+  hibernate->priv = xfpm_hibernate_get_instance_private (hibernate);
+
+  /* Allows running against fixture trees */
+  root = g_getenv ("XFPM_PROC_ROOT");
+  hibernate->priv->proc_root = g_strdup (root != NULL && *root != '\0' ? root : "/proc");
+  root = g_getenv ("XFPM_SYSFS_ROOT");
+  hibernate->priv->sys_root = g_strdup (root != NULL && *root != '\0' ? root : "/sys");
+
+  hibernate->priv->image_size = -1;
+  hibernate->priv->saved_image_size = -1;
+  hibernate->priv->energy_before = -1;
+
+  hibernate->priv->conf = xfpm_xfconf_new ();
+  hibernate->priv->notify = xfpm_notify_new ();
+  hibernate->priv->wakeup = xfpm_wakeup_new ();
+  hibernate->priv->pm_helper = xfpm_pkexec_new (PM_HELPER);
+
+  g_bus_get (G_BUS_TYPE_SYSTEM, NULL, xfpm_hibernate_bus_ready_cb, g_object_ref (hibernate));
+}
+
+static void
+xfpm_hibernate_finalize (GObject *object)
+{
+  XfpmHibernate *hibernate;
+
+  hibernate = XFPM_HIBERNATE (object);
+
+  if ( hibernate->priv->timeout_id != 0 )
+    g_source_remove (hibernate->priv->timeout_id);
+  if ( hibernate->priv->resleep_id != 0 )
+    g_source_remove (hibernate->priv->resleep_id);
+
+  if ( hibernate->priv->bus != NULL )
+  {
+    if ( hibernate->priv->prepare_id != 0 )
+      g_dbus_connection_signal_unsubscribe (hibernate->priv->bus, hibernate->priv->prepare_id);
+    g_object_unref (hibernate->priv->bus);
+  }
+
+  g_object_unref (hibernate->priv->conf);
+  g_object_unref (hibernate->priv->notify);
+  g_object_unref (hibernate->priv->wakeup);
+  g_object_unref (hibernate->priv->pm_helper);
+  g_free (hibernate->priv->proc_root);
+  g_free (hibernate->priv->sys_root);
+
+  G_OBJECT_CLASS (xfpm_hibernate_parent_class)->finalize (object);
+}
+
+static void
+xfpm_hibernate_start_timing (XfpmHibernate *hibernate)
+{
+  xfpm_wakeup_mark (hibernate->priv->wakeup);
+
+  if ( hibernate->priv->kind == SLEEP_HIBERNATE )
+    xfpm_journal_log (XFPM_JOURNAL_HIBERNATE, 0, NULL);
+  else
+    xfpm_journal_log (XFPM_JOURNAL_SUSPEND, 0, hibernate->priv->method);
+
+  hibernate->priv->stage = HIBERNATE_REQUESTED;
+  hibernate->priv->request_mono = g_get_monotonic_time ();
+  hibernate->priv->request_real = g_get_real_time ();
+}
+
+XfpmHibernate *
+xfpm_hibernate_new (void)
+{
+  return g_object_new (XFPM_TYPE_HIBERNATE, NULL);
+}
+
+/**
+ * xfpm_hibernate_begin:
+ *
+ * Called right before asking for a hibernation. Shrinks the image to
+ * what is worth keeping when enabled and starts timing the attempt.
+ * The helper is waited for, the image size has to be in place before
+ * the kernel starts freezing.
+ **/
+void
+xfpm_hibernate_begin (XfpmHibernate *hibernate)
+{
+  const XfpmConfig *config;
+  gint64 current;
+  gint64 target;
+
+  g_return_if_fail (XFPM_IS_HIBERNATE (hibernate));
+
+  if ( hibernate->priv->stage != HIBERNATE_IDLE )
+    xfpm_hibernate_reset (hibernate);
+
+  hibernate->priv->kind = SLEEP_HIBERNATE;
+
+  config = xfpm_xfconf_get_config (hibernate->priv->conf);
+
+  current = xfpm_hibernate_read_image_size (hibernate);
+  target = xfpm_hibernate_get_target (hibernate, config->hibernate_keep_cache);
+  hibernate->priv->image_size = current;
+
+  /* Only ever below the kernel's own target, 2/5 of RAM by default */
+  if ( config->hibernate_image_tuning && current > 0 && target > 0 && target < current &&
+       xfpm_pkexec_is_installed (hibernate->priv->pm_helper) )
+  {
+    gchar *arg;
+    const gchar *args[2];
+    gboolean ret;
+
+    XFPM_DEBUG ("Hibernation image size %" G_GINT64_FORMAT " instead of %" G_GINT64_FORMAT,
+                target, current);
+
+    arg = g_strdup_printf ("--image-size=%" G_GINT64_FORMAT, target);
+    args[0] = arg;
+    args[1] = NULL;
+    ret = xfpm_hibernate_run_pm_helper (hibernate, args, TRUE);
+    g_free (arg);
+
+    if ( ret )
+    {
+      hibernate->priv->image_size = target;
+      hibernate->priv->saved_image_size = current;
+    }
+  }
+
+  xfpm_hibernate_start_timing (hibernate);
+}
+
+/**
+ * xfpm_hibernate_suspend_begin:
+ * @cycle: %TRUE for suspend-then-hibernate
+ * @by_logind: logind does the timed wake through SuspendThenHibernate
+ *
+ * Called right before asking for a suspend. Every suspend gets its
+ * drain recorded, for a suspend-then-hibernate cycle without logind the
+ * RTC is armed to wake us after suspend-then-hibernate-interval minutes.
+ * Without a battery there is nothing to watch and it is a plain suspend.
+ **/
+void
+xfpm_hibernate_suspend_begin (XfpmHibernate *hibernate, gboolean cycle, gboolean by_logind)
+{
+  gdouble full;
+  gboolean on_ac;
+
+  g_return_if_fail (XFPM_IS_HIBERNATE (hibernate));
+
+  if ( hibernate->priv->stage != HIBERNATE_IDLE )
+    xfpm_hibernate_reset (hibernate);
+
+  if ( hibernate->priv->resleep_id != 0 )
+  {
+    g_source_remove (hibernate->priv->resleep_id);
+    hibernate->priv->resleep_id = 0;
+  }
+
+  hibernate->priv->kind = SLEEP_SUSPEND;
+  hibernate->priv->method = "none";
+  hibernate->priv->energy_before = xfpm_hibernate_read_battery (hibernate, &full, &on_ac);
+
+  if ( cycle && by_logind )
+  {
+    hibernate->priv->method = "logind";
+  }
+  else if ( cycle && hibernate->priv->energy_before >= 0 && !on_ac &&
+            xfpm_pkexec_is_installed (hibernate->priv->pm_helper) )
+  {
+    guint interval;
+    gchar *arg;
+    const gchar *args[2];
+    gboolean ret;
+
+    interval = xfpm_xfconf_get_config (hibernate->priv->conf)->suspend_then_hibernate_interval;
+
+    arg = g_strdup_printf ("--wake-alarm=%u", interval * 60);
+    args[0] = arg;
+    args[1] = NULL;
+    ret = xfpm_hibernate_run_pm_helper (hibernate, args, TRUE);
+    g_free (arg);
+
+    if ( ret )
+    {
+      hibernate->priv->cycle = TRUE;
+      hibernate->priv->method = "rtc";
+      hibernate->priv->alarm_real = g_get_real_time () + (gint64) interval * 60 * G_USEC_PER_SEC;
+    }
+  }
+
+  xfpm_hibernate_start_timing (hibernate);
+}
+
+/**
+ * xfpm_hibernate_end:
+ * @error: the error the sleep request failed with, or %NULL
+ *
+ * Called once the hibernate or suspend request returned. The built-in fallback
+ * only returns after the resume, logind and ConsoleKit2 return right
+ * away and the attempt is finished by their PrepareForSleep signal.
+ **/
+void
+xfpm_hibernate_end (XfpmHibernate *hibernate, const GError *error)
+{
+  gint64 mono;
+  gint64 real;
+
+  g_return_if_fail (XFPM_IS_HIBERNATE (hibernate));
+
+  if ( hibernate->priv->stage != HIBERNATE_REQUESTED )
+    return;
+
+  if ( error != NULL )
+  {
+    xfpm_hibernate_finished (hibernate, "failed", -1, -1, -1);
+    return;
+  }
+
+  mono = g_get_monotonic_time () - hibernate->priv->request_mono;
+  real = g_get_real_time () - hibernate->priv->request_real;
+
+  if ( real - mono > HIBERNATE_SLEPT_USEC )
+  {
+    /* No PrepareForSleep here, the request and the freeze are one */
+    xfpm_hibernate_finished (hibernate, "ok", -1, mono, real - mono);
+    return;
+  }
+
+  hibernate->priv->timeout_id = g_timeout_add_seconds (HIBERNATE_START_TIMEOUT,
+                                                       xfpm_hibernate_timeout_cb,
+                                                       hibernate);
+}
+
+/**
+ * xfpm_hibernate_get_stats:
+ * @hibernation: %TRUE for hibernations, %FALSE for suspends
+ *
+ * Attempts that didn't start or failed count in @stats->failed too.
+ **/
+void
+xfpm_hibernate_get_stats (XfpmHibernate *hibernate, gboolean hibernation, XfpmSleepStats *stats)
+{
+  g_return_if_fail (XFPM_IS_HIBERNATE (hibernate));
+
+  *stats = hibernate->priv->stats[hibernation ? SLEEP_HIBERNATE : SLEEP_SUSPEND];
+}
@@ -0,0 +1,72 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __XFPM_HIBERNATE_H
+#define __XFPM_HIBERNATE_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define XFPM_TYPE_HIBERNATE        (xfpm_hibernate_get_type () )
+#define XFPM_HIBERNATE(o)          (G_TYPE_CHECK_INSTANCE_CAST((o), XFPM_TYPE_HIBERNATE, XfpmHibernate))
+#define XFPM_IS_HIBERNATE(o)       (G_TYPE_CHECK_INSTANCE_TYPE((o), XFPM_TYPE_HIBERNATE))
+
+typedef struct XfpmHibernatePrivate XfpmHibernatePrivate;
+
+/* Sleeps of one kind since the power manager started */
+typedef struct
+{
+  guint                 count;
+  guint                 failed;
+  gint64                asleep_usec;
+  gint64                last_usec;
+} XfpmSleepStats;
+
+typedef struct
+{
+  GObject               parent;
+  XfpmHibernatePrivate *priv;
+} XfpmHibernate;
+
+typedef struct
+{
+  GObjectClass          parent_class;
+
+  void                  (*sleep_request)        (XfpmHibernate *hibernate,
+                                                 const gchar   *sleep_time);
+  void                  (*sleep_finished)       (XfpmHibernate *hibernate);
+} XfpmHibernateClass;
+
+GType              xfpm_hibernate_get_type      (void) G_GNUC_CONST;
+XfpmHibernate     *xfpm_hibernate_new           (void);
+void               xfpm_hibernate_begin         (XfpmHibernate *hibernate);
+void               xfpm_hibernate_suspend_begin (XfpmHibernate *hibernate,
+                                                 gboolean       cycle,
+                                                 gboolean       by_logind);
+void               xfpm_hibernate_end           (XfpmHibernate *hibernate,
+                                                 const GError  *error);
+void               xfpm_hibernate_get_stats     (XfpmHibernate  *hibernate,
+                                                 gboolean        hibernation,
+                                                 XfpmSleepStats *stats);
+
+G_END_DECLS
+
+#endif /* __XFPM_HIBERNATE_H */
@@ -38,16 +38,20 @@
 #include "xfpm-dbus-monitor.h"
 #include "xfpm-errors.h"
 #include "xfpm-debug.h"
+#include "xfpm-journal.h"
 
 static void xfpm_inhibit_finalize         (GObject *object);
 static void xfpm_inhibit_dbus_class_init  (XfpmInhibitClass *klass);
 static void xfpm_inhibit_dbus_init        (XfpmInhibit *inhibit);
+static void xfpm_inhibit_dbus_emit        (XfpmInhibit *inhibit,
+                                           gboolean     has_inhibit_changed);
 
 struct XfpmInhibitPrivate
 {
   XfpmDBusMonitor *monitor;
   GPtrArray       *array;
   gboolean         inhibited;
+  gpointer         inhibit_dbus;
 };
 
 typedef struct
@@ -74,6 +78,7 @@ xfpm_inhibit_free_inhibitor (XfpmInhibit *inhibit, Inhibitor *inhibitor)
   g_return_if_fail (inhibitor != NULL );
 
   g_ptr_array_remove (inhibit->priv->array, inhibitor);
+  xfpm_journal_log (XFPM_JOURNAL_INHIBIT_REMOVED, inhibit->priv->array->len, inhibitor->app_name);
 
   g_free (inhibitor->app_name);
   g_free (inhibitor->unique_name);
@@ -83,6 +88,8 @@ xfpm_inhibit_free_inhibitor (XfpmInhibit *inhibit, Inhibitor *inhibitor)
 static gboolean
 xfpm_inhibit_has_inhibit_changed (XfpmInhibit *inhibit)
 {
+  gboolean was_inhibited = inhibit->priv->inhibited;
+
   if ( inhibit->priv->array->len == 0 && inhibit->priv->inhibited == TRUE )
   {
     XFPM_DEBUG("Inhibit removed");
@@ -100,6 +107,8 @@ xfpm_inhibit_has_inhibit_changed (XfpmInhibit *inhibit)
    * stays in sync */
   g_signal_emit (G_OBJECT(inhibit), signals[INHIBIT_LIST_CHANGED], 0, inhibit->priv->inhibited);
 
+  xfpm_inhibit_dbus_emit (inhibit, was_inhibited != inhibit->priv->inhibited);
+
   return inhibit->priv->inhibited;
 }
 
@@ -134,6 +143,7 @@ xfpm_inhibit_add_application (XfpmInhibit *inhibit, const gchar *app_name, const
   inhibitor->unique_name = g_strdup (unique_name);
 
   g_ptr_array_add (inhibit->priv->array, inhibitor);
+  xfpm_journal_log (XFPM_JOURNAL_INHIBIT_ADDED, inhibit->priv->array->len, app_name);
 
   return cookie;
 }
@@ -179,7 +189,8 @@ xfpm_inhibit_remove_application_by_cookie (XfpmInhibit *inhibit, guint cookie)
 
   inhibitor = xfpm_inhibit_find_application_by_cookie (inhibit, cookie);
 
-  if ( inhibitor )
+  /* Internal inhibitors can't be released over D-Bus */
+  if ( inhibitor && inhibitor->unique_name != NULL )
   {
     xfpm_dbus_monitor_remove_unique_name (inhibit->priv->monitor, G_BUS_TYPE_SESSION, inhibitor->unique_name);
     xfpm_inhibit_free_inhibitor (inhibit, inhibitor);
@@ -260,6 +271,12 @@ xfpm_inhibit_finalize (GObject *object)
 
   g_object_unref (inhibit->priv->monitor);
 
+  if ( inhibit->priv->inhibit_dbus != NULL )
+  {
+    g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (inhibit->priv->inhibit_dbus));
+    g_object_unref (inhibit->priv->inhibit_dbus);
+  }
+
   for ( i = 0; i<inhibit->priv->array->len; i++)
   {
     inhibitor = g_ptr_array_index (inhibit->priv->array, i);
@@ -317,6 +334,51 @@ xfpm_inhibit_get_inhibit_list (XfpmInhibit *inhibit)
   return OUT_inhibitors;
 }
 
+/***
+ * xfpm_inhibit_add_internal
+ * @inhibit: the XfpmInhibit object.
+ * @app_name: name shown in the list of inhibitors.
+ *
+ * Adds an inhibitor on behalf of the power manager itself, it is not
+ * tied to a D-Bus connection and only goes away with
+ * xfpm_inhibit_remove_internal.
+ *
+ * Returns: the cookie of the new inhibitor.
+ */
+guint
+xfpm_inhibit_add_internal (XfpmInhibit *inhibit, const gchar *app_name)
+{
+  guint cookie;
+
+  g_return_val_if_fail (XFPM_IS_INHIBIT (inhibit), 0);
+
+  cookie = xfpm_inhibit_add_application (inhibit, app_name, NULL);
+
+  XFPM_DEBUG ("Internal inhibit name=%s cookie=%u", app_name, cookie);
+
+  xfpm_inhibit_has_inhibit_changed (inhibit);
+
+  return cookie;
+}
+
+void
+xfpm_inhibit_remove_internal (XfpmInhibit *inhibit, guint cookie)
+{
+  Inhibitor *inhibitor;
+
+  g_return_if_fail (XFPM_IS_INHIBIT (inhibit));
+
+  inhibitor = xfpm_inhibit_find_application_by_cookie (inhibit, cookie);
+
+  if ( inhibitor == NULL || inhibitor->unique_name != NULL )
+    return;
+
+  XFPM_DEBUG ("Internal uninhibit name=%s cookie=%u", inhibitor->app_name, cookie);
+
+  xfpm_inhibit_free_inhibitor (inhibit, inhibitor);
+  xfpm_inhibit_has_inhibit_changed (inhibit);
+}
+
 /*
  *
  * DBus server implementation for org.freedesktop.PowerManagement.Inhibit
@@ -376,6 +438,30 @@ xfpm_inhibit_dbus_init (XfpmInhibit *inhibit)
                             "handle-get-inhibitors",
                             G_CALLBACK (xfpm_inhibit_get_inhibitors),
                             inhibit);
+
+  inhibit->priv->inhibit_dbus = inhibit_dbus;
+}
+
+/*
+ * Clients like the panel plugin keep their own copy of the list and
+ * patch it from InhibitorsChanged instead of calling GetInhibitors
+ * every time they need it.
+ */
+static void
+xfpm_inhibit_dbus_emit (XfpmInhibit *inhibit, gboolean has_inhibit_changed)
+{
+  XfpmPowerManagementInhibit *inhibit_dbus = inhibit->priv->inhibit_dbus;
+  const gchar **inhibitors;
+
+  if ( inhibit_dbus == NULL )
+    return;
+
+  if ( has_inhibit_changed )
+    xfpm_power_management_inhibit_emit_has_inhibit_changed (inhibit_dbus, inhibit->priv->inhibited);
+
+  inhibitors = xfpm_inhibit_get_inhibit_list (inhibit);
+  xfpm_power_management_inhibit_emit_inhibitors_changed (inhibit_dbus, inhibitors);
+  g_free (inhibitors);
 }
 
 static gboolean
@@ -53,6 +53,10 @@ GType              xfpm_inhibit_error_get_type   (void) G_GNUC_CONST;
 GQuark             xfpm_inhibit_get_error_quark  ();
 XfpmInhibit       *xfpm_inhibit_new              (void);
 const gchar      **xfpm_inhibit_get_inhibit_list (XfpmInhibit *inhibit);
+guint              xfpm_inhibit_add_internal     (XfpmInhibit *inhibit,
+                                                  const gchar *app_name);
+void               xfpm_inhibit_remove_internal  (XfpmInhibit *inhibit,
+                                                  guint        cookie);
 
 G_END_DECLS
 
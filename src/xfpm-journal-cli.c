@@ -0,0 +1,300 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Prints the event journal of the power manager, e.g.
+ *
+ *   xfpm-journal --around "2026-10-19 14:02" --event sleep-request,sleep-blocked
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "xfpm-journal.h"
+#include "xfpm-enum-glib.h"
+
+#define EXIT_CODE_SUCCESS           0
+#define EXIT_CODE_FAILED            1
+#define EXIT_CODE_ARGUMENTS_INVALID 3
+
+typedef struct
+{
+  gint64    since;
+  gint64    until;
+  gboolean  events[XFPM_JOURNAL_N_EVENTS];
+  gboolean  all_events;
+  guint     printed;
+} JournalFilter;
+
+/* "YYYY-MM-DD", "YYYY-MM-DD HH:MM[:SS]" or "HH:MM[:SS]" for today, local time */
+static gboolean
+parse_time (const gchar *text, gint64 *usec)
+{
+  GDateTime *now;
+  GDateTime *time;
+  gint year, month, day;
+  gint hour = 0, minute = 0, second = 0;
+  gint n;
+
+  n = sscanf (text, "%d-%d-%d %d:%d:%d", &year, &month, &day, &hour, &minute, &second);
+  if (n != 3 && n != 5 && n != 6)
+    {
+      hour = minute = second = 0;
+      n = sscanf (text, "%d:%d:%d", &hour, &minute, &second);
+      if (n != 2 && n != 3)
+        return FALSE;
+
+      now = g_date_time_new_now_local ();
+      g_date_time_get_ymd (now, &year, &month, &day);
+      g_date_time_unref (now);
+    }
+
+  time = g_date_time_new_local (year, month, day, hour, minute, second);
+  if (time == NULL)
+    return FALSE;
+
+  *usec = g_date_time_to_unix (time) * G_USEC_PER_SEC;
+  g_date_time_unref (time);
+
+  return TRUE;
+}
+
+static gboolean
+parse_events (const gchar *text, JournalFilter *filter)
+{
+  gchar **names;
+  XfpmJournalEvent event;
+  gboolean ret = TRUE;
+  guint i;
+
+  names = g_strsplit (text, ",", -1);
+
+  for (i = 0; names[i] != NULL; i++)
+    {
+      event = xfpm_journal_event_from_string (g_strstrip (names[i]));
+      if (event == XFPM_JOURNAL_NONE)
+        {
+          g_printerr ("Unknown event \"%s\"\n", names[i]);
+          ret = FALSE;
+          break;
+        }
+
+      filter->events[event] = TRUE;
+    }
+
+  g_strfreev (names);
+
+  return ret;
+}
+
+/* Spell out the value for events where it is a state */
+static gchar *
+format_value (const XfpmJournalRecord *record)
+{
+  static const gchar *requests[] = { "nothing", "suspend", "hibernate", "ask", "shutdown" };
+
+  switch (record->event)
+    {
+      case XFPM_JOURNAL_IDLE:
+        return g_strdup (record->value ? "on-battery" : "on-ac");
+      case XFPM_JOURNAL_SLEEP_REQUEST:
+      case XFPM_JOURNAL_SLEEP_BLOCKED:
+      case XFPM_JOURNAL_CRITICAL_ACTION:
+        if (record->value >= 0 && record->value < (gint) G_N_ELEMENTS (requests))
+          return g_strdup (requests[record->value]);
+        return g_strdup_printf ("%d", record->value);
+      case XFPM_JOURNAL_INHIBIT_ADDED:
+      case XFPM_JOURNAL_INHIBIT_REMOVED:
+        return g_strdup_printf ("%d active", record->value);
+      case XFPM_JOURNAL_LID:
+        return g_strdup (record->value ? "closed" : "open");
+      case XFPM_JOURNAL_AC:
+        return g_strdup (record->value ? "online" : "offline");
+      case XFPM_JOURNAL_BATTERY_LEVEL:
+        switch (record->value)
+          {
+            case XFPM_BATTERY_CHARGE_CRITICAL:
+              return g_strdup ("critical");
+            case XFPM_BATTERY_CHARGE_LOW:
+              return g_strdup ("low");
+            case XFPM_BATTERY_CHARGE_OK:
+              return g_strdup ("ok");
+            default:
+              return g_strdup ("unknown");
+          }
+      case XFPM_JOURNAL_RESUME:
+        if (record->value < 0)
+          return g_strdup ("-");
+        return g_strdup_printf ("%ds asleep", record->value);
+      case XFPM_JOURNAL_STARTED:
+      case XFPM_JOURNAL_SUSPEND:
+      case XFPM_JOURNAL_HIBERNATE:
+        return g_strdup ("-");
+      default:
+        return g_strdup_printf ("%d", record->value);
+    }
+}
+
+static gboolean
+print_record (const XfpmJournalRecord *record, gpointer user_data)
+{
+  JournalFilter *filter = user_data;
+  GDateTime *time;
+  gchar *stamp;
+  gchar *value;
+
+  if (record->time < filter->since || record->time > filter->until)
+    return TRUE;
+
+  if (!filter->all_events &&
+      (record->event >= XFPM_JOURNAL_N_EVENTS || !filter->events[record->event]))
+    return TRUE;
+
+  time = g_date_time_new_from_unix_local (record->time / G_USEC_PER_SEC);
+  stamp = g_date_time_format (time, "%Y-%m-%d %H:%M:%S");
+  value = format_value (record);
+
+  g_print ("%s  %-16s %-12s %.*s\n",
+           stamp,
+           xfpm_journal_event_to_string (record->event),
+           value,
+           (gint) sizeof (record->detail), record->detail);
+
+  filter->printed++;
+
+  g_free (value);
+  g_free (stamp);
+  g_date_time_unref (time);
+
+  return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  JournalFilter filter;
+  gchar *file = NULL;
+  gchar *since = NULL;
+  gchar *until = NULL;
+  gchar *around = NULL;
+  gchar *events = NULL;
+  gchar *rotated;
+  gint window = 10;
+  gint ret = EXIT_CODE_SUCCESS;
+
+  const GOptionEntry options[] = {
+    { "file",   'f', 0, G_OPTION_ARG_FILENAME, &file, "Read this journal instead of the one of the user", "PATH" },
+    { "since",  's', 0, G_OPTION_ARG_STRING, &since, "Only show events at or after TIME", "TIME" },
+    { "until",  'u', 0, G_OPTION_ARG_STRING, &until, "Only show events at or before TIME", "TIME" },
+    { "around", 'a', 0, G_OPTION_ARG_STRING, &around, "Only show events within the window around TIME", "TIME" },
+    { "window", 'w', 0, G_OPTION_ARG_INT, &window, "Minutes on either side of --around, 10 by default", "MINUTES" },
+    { "event",  'e', 0, G_OPTION_ARG_STRING, &events, "Only show these events, separated by commas", "EVENTS" },
+    { NULL, },
+  };
+
+  context = g_option_context_new (NULL);
+  g_option_context_set_summary (context, "Print the event journal of the XFCE Power Manager");
+  g_option_context_set_description (context,
+                                    "TIME is \"YYYY-MM-DD\", \"YYYY-MM-DD HH:MM[:SS]\" or \"HH:MM[:SS]\" for today.\n"
+                                    "EVENTS are any of started, lid, ac, battery-level, idle, inhibit-added,\n"
+                                    "inhibit-removed, sleep-request, sleep-blocked, suspend, hibernate, resume\n"
+                                    "and critical-action.");
+  g_option_context_add_main_entries (context, options, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return EXIT_CODE_ARGUMENTS_INVALID;
+    }
+
+  g_option_context_free (context);
+
+  memset (&filter, 0, sizeof (filter));
+  filter.since = 0;
+  filter.until = G_MAXINT64;
+  filter.all_events = (events == NULL);
+
+  if ((since != NULL && !parse_time (since, &filter.since)) ||
+      (until != NULL && !parse_time (until, &filter.until)))
+    {
+      g_printerr ("Invalid time, use \"YYYY-MM-DD HH:MM[:SS]\" or \"HH:MM[:SS]\"\n");
+      return EXIT_CODE_ARGUMENTS_INVALID;
+    }
+
+  if (around != NULL)
+    {
+      gint64 center;
+
+      if (!parse_time (around, &center) || window < 0)
+        {
+          g_printerr ("Invalid time or window for --around\n");
+          return EXIT_CODE_ARGUMENTS_INVALID;
+        }
+
+      filter.since = center - (gint64) window * 60 * G_USEC_PER_SEC;
+      filter.until = center + (gint64) window * 60 * G_USEC_PER_SEC;
+    }
+
+  if (events != NULL && !parse_events (events, &filter))
+    return EXIT_CODE_ARGUMENTS_INVALID;
+
+  if (file == NULL)
+    file = xfpm_journal_get_path ();
+
+  /* The rotated journal first, it holds the older events */
+  rotated = g_strconcat (file, ".1", NULL);
+  if (g_file_test (rotated, G_FILE_TEST_EXISTS) &&
+      !xfpm_journal_read (rotated, print_record, &filter, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_clear_error (&error);
+    }
+
+  if (!xfpm_journal_read (file, print_record, &filter, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      ret = EXIT_CODE_FAILED;
+    }
+  else if (filter.printed == 0)
+    {
+      g_printerr ("No events\n");
+    }
+
+  g_free (rotated);
+  g_free (file);
+  g_free (since);
+  g_free (until);
+  g_free (around);
+  g_free (events);
+
+  return ret;
+}
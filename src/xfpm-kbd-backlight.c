@@ -40,7 +40,6 @@ struct XfpmKbdBacklightPrivate
   XfpmPower          *power;
   XfpmButton         *button;
 
-  GDBusConnection    *bus;
   GDBusProxy         *proxy;
 
   gboolean            dimmed;
@@ -50,7 +49,6 @@ struct XfpmKbdBacklightPrivate
   gint                step;
 
   XfpmNotify         *notify;
-  NotifyNotification *n;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (XfpmKbdBacklight, xfpm_kbd_backlight, G_TYPE_OBJECT)
@@ -73,56 +71,22 @@ xfpm_kbd_backlight_on_battery_changed_cb (XfpmPower *power, gboolean on_battery,
 }
 
 
-static void
-xfpm_kbd_backlight_init_max_level (XfpmKbdBacklight *backlight)
-{
-  GError *error = NULL;
-  GVariant *var;
-
-  var = g_dbus_proxy_call_sync (backlight->priv->proxy, "GetMaxBrightness",
-                                NULL,
-                                G_DBUS_CALL_FLAGS_NONE,
-                                -1, NULL,
-                                &error);
-
-  if (var)
-  {
-    g_variant_get (var,
-                   "(i)",
-                   &backlight->priv->max_level);
-    g_variant_unref (var);
-  }
-
-  if ( error )
-  {
-    g_warning ("Failed to get keyboard max brightness level : %s", error->message);
-    g_error_free (error);
-  }
-}
-
-
 static void
 xfpm_kbd_backlight_show_notification (XfpmKbdBacklight *self, gfloat value)
 {
   gchar *summary;
 
-  if ( self->priv->n == NULL )
-  {
-    /* generate a human-readable summary for the notification */
-    summary = g_strdup_printf (_("Keyboard Brightness: %.0f percent"), value);
-    self->priv->n = xfpm_notify_new_notification (self->priv->notify,
-                                                  _("Power Manager"),
-                                                  summary,
-                                                  "keyboard-brightness",
-                                                  XFPM_NOTIFY_NORMAL);
-    g_free (summary);
-  }
-
-  /* add the brightness value to the notification */
-  notify_notification_set_hint (self->priv->n, "value", g_variant_new_int32 (value));
-
-  /* show the notification */
-  notify_notification_show (self->priv->n, NULL);
+  /* generate a human-readable summary for the notification */
+  summary = g_strdup_printf (_("Keyboard Brightness: %.0f percent"), value);
+
+  /* updates the one already on screen, steps in a burst are coalesced */
+  xfpm_notify_show_value (self->priv->notify,
+                          XFPM_NOTIFY_CATEGORY_KBD_BRIGHTNESS,
+                          _("Power Manager"),
+                          summary,
+                          "keyboard-brightness",
+                          value);
+  g_free (summary);
 }
 
 
@@ -251,49 +215,28 @@ xfpm_kbd_backlight_class_init (XfpmKbdBacklightClass *klass)
 
 
 static void
-xfpm_kbd_backlight_init (XfpmKbdBacklight *backlight)
+xfpm_kbd_backlight_max_level_cb (GObject *source, GAsyncResult *res, gpointer user_data)
 {
+  XfpmKbdBacklight *backlight = XFPM_KBD_BACKLIGHT (user_data);
   GError *error = NULL;
+  GVariant *var;
 
-  backlight->priv = xfpm_kbd_backlight_get_instance_private (backlight);
-
-  backlight->priv->bus = NULL;
-  backlight->priv->proxy = NULL;
-  backlight->priv->power = NULL;
-  backlight->priv->button = NULL;
-  backlight->priv->dimmed = FALSE;
-  backlight->priv->on_battery = FALSE;
-  backlight->priv->max_level = 0;
-  backlight->priv->min_level = 0;
-  backlight->priv->notify = NULL;
-  backlight->priv->n = NULL;
-
-  backlight->priv->bus = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
+  var = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
 
-  if ( error )
+  if (var)
   {
-    g_critical ("Unable to get system bus connection : %s", error->message);
-    g_error_free (error);
-    goto out;
+    g_variant_get (var,
+                   "(i)",
+                   &backlight->priv->max_level);
+    g_variant_unref (var);
   }
 
-  backlight->priv->proxy = g_dbus_proxy_new_sync (backlight->priv->bus,
-                                                  G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
-                                                  G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
-                                                  NULL,
-                                                  "org.freedesktop.UPower",
-                                                  "/org/freedesktop/UPower/KbdBacklight",
-                                                  "org.freedesktop.UPower.KbdBacklight",
-                                                  NULL,
-                                                  NULL);
-  if ( backlight->priv->proxy == NULL )
+  if ( error )
   {
-    g_warning ("Unable to get the interface, org.freedesktop.UPower.KbdBacklight");
-    goto out;
+    g_warning ("Failed to get keyboard max brightness level : %s", error->message);
+    g_error_free (error);
   }
 
-  xfpm_kbd_backlight_init_max_level (backlight);
-
   if ( backlight->priv->max_level == 0 )
     goto out;
 
@@ -313,7 +256,61 @@ xfpm_kbd_backlight_init (XfpmKbdBacklight *backlight)
                 NULL);
 
 out:
-  ;
+  g_object_unref (backlight);
+}
+
+
+static void
+xfpm_kbd_backlight_proxy_ready_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  XfpmKbdBacklight *backlight = XFPM_KBD_BACKLIGHT (user_data);
+  GError *error = NULL;
+
+  backlight->priv->proxy = g_dbus_proxy_new_for_bus_finish (res, &error);
+
+  if ( backlight->priv->proxy == NULL )
+  {
+    g_warning ("Unable to get the interface, org.freedesktop.UPower.KbdBacklight : %s", error->message);
+    g_error_free (error);
+    g_object_unref (backlight);
+    return;
+  }
+
+  /* keeps the reference on backlight */
+  g_dbus_proxy_call (backlight->priv->proxy, "GetMaxBrightness",
+                     NULL,
+                     G_DBUS_CALL_FLAGS_NONE,
+                     -1, NULL,
+                     xfpm_kbd_backlight_max_level_cb,
+                     backlight);
+}
+
+
+static void
+xfpm_kbd_backlight_init (XfpmKbdBacklight *backlight)
+{
+  backlight->priv = xfpm_kbd_backlight_get_instance_private (backlight);
+
+  backlight->priv->proxy = NULL;
+  backlight->priv->power = NULL;
+  backlight->priv->button = NULL;
+  backlight->priv->dimmed = FALSE;
+  backlight->priv->on_battery = FALSE;
+  backlight->priv->max_level = 0;
+  backlight->priv->min_level = 0;
+  backlight->priv->notify = NULL;
+
+  /* Key handling is hooked up once UPower told us the max level */
+  g_dbus_proxy_new_for_bus (G_BUS_TYPE_SYSTEM,
+                            G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+                            G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+                            NULL,
+                            "org.freedesktop.UPower",
+                            "/org/freedesktop/UPower/KbdBacklight",
+                            "org.freedesktop.UPower.KbdBacklight",
+                            NULL,
+                            xfpm_kbd_backlight_proxy_ready_cb,
+                            g_object_ref (backlight));
 }
 
 
@@ -333,15 +330,9 @@ xfpm_kbd_backlight_finalize (GObject *object)
   if ( backlight->priv->notify )
     g_object_unref (backlight->priv->notify);
 
-  if ( backlight->priv->n )
-    g_object_unref (backlight->priv->n);
-
   if ( backlight->priv->proxy )
     g_object_unref (backlight->priv->proxy);
 
-  if ( backlight->priv->bus )
-    g_object_unref (backlight->priv->bus);
-
   G_OBJECT_CLASS (xfpm_kbd_backlight_parent_class)->finalize (object);
 }
 
@@ -47,6 +47,7 @@
 
 #include "xfce-power-manager-dbus.h"
 #include "xfpm-manager.h"
+#include "xfpm-startup.h"
 
 static void G_GNUC_NORETURN
 show_version (void)
@@ -201,6 +202,16 @@ xfpm_dump_remote (GDBusConnection *bus)
   g_hash_table_destroy (hash);
 }
 
+static void
+xfpm_dump_started_cb (XfpmManager *manager, gpointer user_data)
+{
+  GHashTable *hash;
+
+  hash = xfpm_manager_get_config (manager);
+  xfpm_dump (hash);
+  g_hash_table_destroy (hash);
+}
+
 static void G_GNUC_NORETURN
 xfpm_start (GDBusConnection *bus, const gchar *client_id, gboolean dump)
 {
@@ -231,16 +242,11 @@ xfpm_start (GDBusConnection *bus, const gchar *client_id, gboolean dump)
     g_error_free (error);
   }
 
-  xfpm_manager_start (manager);
-
+  /* The components come up asynchronously, dump once they are all there */
   if ( dump )
-  {
-    GHashTable *hash;
-    hash = xfpm_manager_get_config (manager);
-    xfpm_dump (hash);
-    g_hash_table_destroy (hash);
-  }
+    g_signal_connect (manager, "started", G_CALLBACK (xfpm_dump_started_cb), NULL);
 
+  xfpm_manager_start (manager);
 
   gtk_main ();
 
@@ -264,7 +270,9 @@ int main (int argc, char **argv)
   gboolean no_daemon  = FALSE;
   gboolean debug      = FALSE;
   gboolean dump       = FALSE;
+  gboolean profile    = FALSE;
   gchar   *client_id  = NULL;
+  gint64   begin;
 
   GOptionEntry option_entries[] =
   {
@@ -272,6 +280,7 @@ int main (int argc, char **argv)
     { "no-daemon",'\0' , G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_NONE, &no_daemon, N_("Do not daemonize"), NULL },
     { "debug",'\0' , G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_NONE, &debug, N_("Enable debugging"), NULL },
     { "dump",'\0' , G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_NONE, &dump, N_("Dump all information"), NULL },
+    { "profile-startup",'\0' , G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_NONE, &profile, N_("Print how long each component takes to start"), NULL },
     { "restart", '\0', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_NONE, &reload, N_("Restart the running instance of Xfce power manager"), NULL},
     { "customize", 'c', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_NONE, &config, N_("Show the configuration dialog"), NULL },
     { "quit", 'q', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_NONE, &quit, N_("Quit any running xfce power manager"), NULL },
@@ -280,6 +289,9 @@ int main (int argc, char **argv)
     { NULL, },
   };
 
+  /* Start the clock as early as possible */
+  xfpm_startup_profile_init (FALSE);
+
   /* Parse the options */
   octx = g_option_context_new("");
   g_option_context_set_ignore_unknown_options(octx, TRUE);
@@ -304,8 +316,11 @@ int main (int argc, char **argv)
   if ( version )
     show_version ();
 
+  if ( profile )
+    xfpm_startup_profile_init (TRUE);
+
   /* Fork if needed */
-  if ( dump == FALSE && debug == FALSE && no_daemon == FALSE && daemon(0,0) )
+  if ( dump == FALSE && debug == FALSE && profile == FALSE && no_daemon == FALSE && daemon(0,0) )
   {
     g_critical ("Could not daemonize");
   }
@@ -315,6 +330,8 @@ int main (int argc, char **argv)
 
   g_set_application_name (PACKAGE_NAME);
 
+  begin = g_get_monotonic_time ();
+
   if (!gtk_init_check (&argc, &argv))
   {
     if (G_LIKELY (error))
@@ -332,9 +349,13 @@ int main (int argc, char **argv)
     return EXIT_FAILURE;
   }
 
+  xfpm_startup_profile_add ("gtk-init", 0, begin, g_get_monotonic_time ());
+
   xfpm_debug_init (debug);
 
+  begin = g_get_monotonic_time ();
   bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  xfpm_startup_profile_add ("session-bus", 0, begin, g_get_monotonic_time ());
 
   if ( error )
   {
@@ -54,6 +54,7 @@
 #include "egg-idletime.h"
 #include "xfpm-config.h"
 #include "xfpm-debug.h"
+#include "xfpm-journal.h"
 #include "xfpm-xfconf.h"
 #include "xfpm-errors.h"
 #include "xfpm-common.h"
@@ -63,6 +64,14 @@
 #include "xfpm-dbus-monitor.h"
 #include "xfpm-systemd.h"
 #include "xfce-screensaver.h"
+#include "xfpm-startup.h"
+#include "xfpm-workload.h"
+#include "xfpm-cpufreq.h"
+#include "xfpm-runtime-pm.h"
+#include "xfpm-thermal.h"
+#include "xfpm-exporter.h"
+#include "xfpm-power-profiles.h"
+#include "xfpm-state.h"
 #include "../panel-plugins/power-manager-plugin/power-manager-button.h"
 
 static void xfpm_manager_finalize   (GObject *object);
@@ -83,6 +92,8 @@ static gboolean xfpm_manager_quit (XfpmManager *manager);
 static void xfpm_manager_show_tray_icon (XfpmManager *manager);
 static void xfpm_manager_hide_tray_icon (XfpmManager *manager);
 
+static void xfpm_manager_power_ready_cb (XfpmPower *power, XfpmManager *manager);
+
 #define SLEEP_KEY_TIMEOUT 6.0f
 
 struct XfpmManagerPrivate
@@ -108,6 +119,14 @@ struct XfpmManagerPrivate
   gint                show_tray_icon;
 
   XfpmDpms           *dpms;
+  XfpmWorkload       *workload;
+  XfpmPowerProfiles  *power_profiles;
+  XfpmCpufreq        *cpufreq;
+  XfpmRuntimePm      *runtime_pm;
+  XfpmThermal        *thermal;
+  XfpmExporter       *exporter;
+  XfpmState          *state;
+  XfpmStartup        *startup;
 
   GTimer         *timer;
 
@@ -123,6 +142,14 @@ enum
   PROP_SHOW_TRAY_ICON
 };
 
+enum
+{
+  STARTED,
+  LAST_SIGNAL
+};
+
+static guint signals [LAST_SIGNAL] = { 0 };
+
 G_DEFINE_TYPE_WITH_PRIVATE (XfpmManager, xfpm_manager, G_TYPE_OBJECT)
 
 static void
@@ -134,6 +161,15 @@ xfpm_manager_class_init (XfpmManagerClass *klass)
   object_class->set_property = xfpm_manager_set_property;
   object_class->get_property = xfpm_manager_get_property;
 
+  signals [STARTED] =
+    g_signal_new ("started",
+                  XFPM_TYPE_MANAGER,
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (XfpmManagerClass, started),
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0, G_TYPE_NONE);
+
 #define XFPM_PARAM_FLAGS  (G_PARAM_READWRITE \
                      | G_PARAM_CONSTRUCT \
                      | G_PARAM_STATIC_NAME \
@@ -155,6 +191,7 @@ xfpm_manager_init (XfpmManager *manager)
   manager->priv = xfpm_manager_get_instance_private (manager);
 
   manager->priv->timer = g_timer_new ();
+  manager->priv->inhibit_fd = -1;
 
   notify_init ("xfce4-power-manager");
 }
@@ -172,25 +209,37 @@ xfpm_manager_finalize (GObject *object)
   if ( manager->priv->system_bus )
     g_object_unref (manager->priv->system_bus);
 
-  g_object_unref (manager->priv->power);
-  g_object_unref (manager->priv->button);
-  g_object_unref (manager->priv->conf);
+  /* Components are created by the startup tasks, any of them may be
+   * missing if we are going down before startup finished */
+  g_clear_object (&manager->priv->power_profiles);
+  g_clear_object (&manager->priv->cpufreq);
+  g_clear_object (&manager->priv->runtime_pm);
+  g_clear_object (&manager->priv->thermal);
+  g_clear_object (&manager->priv->exporter);
+  g_clear_object (&manager->priv->state);
+  if ( manager->priv->power != NULL )
+    g_signal_handlers_disconnect_by_func (manager->priv->power, xfpm_manager_power_ready_cb, manager);
+  g_clear_object (&manager->priv->power);
+  g_clear_object (&manager->priv->button);
+  g_clear_object (&manager->priv->conf);
   g_object_unref (manager->priv->client);
-  if ( manager->priv->systemd != NULL )
-    g_object_unref (manager->priv->systemd);
-  if ( manager->priv->console != NULL )
-    g_object_unref (manager->priv->console);
-  g_object_unref (manager->priv->monitor);
-  g_object_unref (manager->priv->inhibit);
-  g_object_unref (manager->priv->idle);
+  g_clear_object (&manager->priv->systemd);
+  g_clear_object (&manager->priv->console);
+  g_clear_object (&manager->priv->monitor);
+  g_clear_object (&manager->priv->workload);
+  g_clear_object (&manager->priv->inhibit);
+  g_clear_object (&manager->priv->screensaver);
+  g_clear_object (&manager->priv->idle);
 
   g_timer_destroy (manager->priv->timer);
 
-  g_object_unref (manager->priv->dpms);
+  g_clear_object (&manager->priv->dpms);
+
+  g_clear_object (&manager->priv->backlight);
 
-  g_object_unref (manager->priv->backlight);
+  g_clear_object (&manager->priv->kbd_backlight);
 
-  g_object_unref (manager->priv->kbd_backlight);
+  g_clear_object (&manager->priv->startup);
 
   G_OBJECT_CLASS (xfpm_manager_parent_class)->finalize (object);
 }
@@ -266,6 +315,15 @@ xfpm_manager_quit (XfpmManager *manager)
   if (manager->priv->inhibit_fd >= 0)
     close (manager->priv->inhibit_fd);
 
+  if ( manager->priv->power_profiles )
+    xfpm_power_profiles_restore (manager->priv->power_profiles);
+
+  if ( manager->priv->cpufreq )
+    xfpm_cpufreq_restore (manager->priv->cpufreq);
+
+  if ( manager->priv->runtime_pm )
+    xfpm_runtime_pm_restore (manager->priv->runtime_pm);
+
   gtk_main_quit ();
   return TRUE;
 }
@@ -327,8 +385,12 @@ xfpm_manager_ask_shutdown (XfpmManager *manager)
 }
 
 static void
-xfpm_manager_sleep_request (XfpmManager *manager, XfpmShutdownRequest req, gboolean force)
+xfpm_manager_sleep_request (XfpmManager *manager, XfpmShutdownRequest req,
+                            gboolean force, const gchar *source)
 {
+  if ( req != XFPM_DO_NOTHING )
+    xfpm_journal_log (XFPM_JOURNAL_SLEEP_REQUEST, req, source);
+
   switch (req)
   {
     case XFPM_DO_NOTHING:
@@ -360,6 +422,7 @@ xfpm_manager_reset_sleep_timer (XfpmManager *manager)
 static void
 xfpm_manager_button_pressed_cb (XfpmButton *bt, XfpmButtonKey type, XfpmManager *manager)
 {
+  const XfpmConfig *config = xfpm_xfconf_get_config (manager->priv->conf);
   XfpmShutdownRequest req = XFPM_DO_NOTHING;
 
   XFPM_DEBUG_ENUM (type, XFPM_TYPE_BUTTON_KEY, "Received button press event");
@@ -371,29 +434,13 @@ xfpm_manager_button_pressed_cb (XfpmButton *bt, XfpmButtonKey type, XfpmManager
     return;
 
   if ( type == BUTTON_POWER_OFF )
-  {
-    g_object_get (G_OBJECT (manager->priv->conf),
-                  POWER_SWITCH_CFG, &req,
-                  NULL);
-  }
+    req = config->power_button;
   else if ( type == BUTTON_SLEEP )
-  {
-    g_object_get (G_OBJECT (manager->priv->conf),
-                  SLEEP_SWITCH_CFG, &req,
-                  NULL);
-  }
+    req = config->sleep_button;
   else if ( type == BUTTON_HIBERNATE )
-    {
-    g_object_get (G_OBJECT (manager->priv->conf),
-                  HIBERNATE_SWITCH_CFG, &req,
-                  NULL);
-  }
+    req = config->hibernate_button;
   else if ( type == BUTTON_BATTERY )
-  {
-    g_object_get (G_OBJECT (manager->priv->conf),
-                  BATTERY_SWITCH_CFG, &req,
-                  NULL);
-  }
+    req = config->battery_button;
   else
   {
     g_return_if_reached ();
@@ -408,7 +455,7 @@ xfpm_manager_button_pressed_cb (XfpmButton *bt, XfpmButtonKey type, XfpmManager
     if ( g_timer_elapsed (manager->priv->timer, NULL) > SLEEP_KEY_TIMEOUT )
     {
       g_timer_reset (manager->priv->timer);
-      xfpm_manager_sleep_request (manager, req, FALSE);
+      xfpm_manager_sleep_request (manager, req, FALSE, "button");
     }
   }
 }
@@ -416,26 +463,18 @@ xfpm_manager_button_pressed_cb (XfpmButton *bt, XfpmButtonKey type, XfpmManager
 static void
 xfpm_manager_lid_changed_cb (XfpmPower *power, gboolean lid_is_closed, XfpmManager *manager)
 {
+  const XfpmConfig *config = xfpm_xfconf_get_config (manager->priv->conf);
   XfpmLidTriggerAction action;
-  gboolean on_battery, logind_handle_lid_switch;
+  gboolean on_battery;
 
-  if ( LOGIND_RUNNING() )
-  {
-    g_object_get (G_OBJECT (manager->priv->conf),
-                  LOGIND_HANDLE_LID_SWITCH, &logind_handle_lid_switch,
-                  NULL);
-
-    if (logind_handle_lid_switch)
-      return;
-  }
+  if ( LOGIND_RUNNING() && config->logind_handle_lid_switch )
+    return;
 
   g_object_get (G_OBJECT (power),
                 "on-battery", &on_battery,
                 NULL);
 
-  g_object_get (G_OBJECT (manager->priv->conf),
-                on_battery ? LID_SWITCH_ON_BATTERY_CFG : LID_SWITCH_ON_AC_CFG, &action,
-                NULL);
+  action = on_battery ? config->lid_action_on_battery : config->lid_action_on_ac;
 
   if ( lid_is_closed )
   {
@@ -466,7 +505,7 @@ xfpm_manager_lid_changed_cb (XfpmPower *power, gboolean lid_is_closed, XfpmManag
        * user for confirmation in case of an application is inhibiting
        * the power manager.
        */
-      xfpm_manager_sleep_request (manager, action, TRUE);
+      xfpm_manager_sleep_request (manager, action, TRUE, "lid");
     }
   }
   else
@@ -486,39 +525,50 @@ xfpm_manager_inhibit_changed_cb (XfpmInhibit *inhibit, gboolean inhibited, XfpmM
 static void
 xfpm_manager_alarm_timeout_cb (EggIdletime *idle, guint id, XfpmManager *manager)
 {
+  gboolean inactivity = id == TIMEOUT_INACTIVITY_ON_AC || id == TIMEOUT_INACTIVITY_ON_BATTERY;
+
+  if ( inactivity )
+    xfpm_journal_log (XFPM_JOURNAL_IDLE, id == TIMEOUT_INACTIVITY_ON_BATTERY ? 1 : 0, NULL);
+
   if (xfpm_power_is_in_presentation_mode (manager->priv->power) == TRUE)
+  {
+    if ( inactivity )
+      xfpm_journal_log (XFPM_JOURNAL_SLEEP_BLOCKED, XFPM_DO_NOTHING, "presentation");
     return;
+  }
 
   XFPM_DEBUG ("Alarm inactivity timeout id %d", id);
 
-  if ( id == TIMEOUT_INACTIVITY_ON_AC || id == TIMEOUT_INACTIVITY_ON_BATTERY )
+  if ( inactivity )
   {
     XfpmShutdownRequest sleep_mode = XFPM_DO_NOTHING;
     gboolean on_battery;
 
+    if ( id == TIMEOUT_INACTIVITY_ON_AC)
+      sleep_mode = xfpm_xfconf_get_config (manager->priv->conf)->inactivity_sleep_mode_on_ac;
+    else
+      sleep_mode = xfpm_xfconf_get_config (manager->priv->conf)->inactivity_sleep_mode_on_battery;
+
     if ( manager->priv->inhibited )
     {
       XFPM_DEBUG ("Idle sleep alarm timeout, but power manager is currently inhibited, action ignored");
+      if ( sleep_mode != XFPM_DO_NOTHING )
+        xfpm_journal_log (XFPM_JOURNAL_SLEEP_BLOCKED, sleep_mode, "inhibited");
       return;
     }
 
-    if ( id == TIMEOUT_INACTIVITY_ON_AC)
-      g_object_get (G_OBJECT (manager->priv->conf),
-                    INACTIVITY_SLEEP_MODE_ON_AC, &sleep_mode,
-                    NULL);
-    else
-      g_object_get (G_OBJECT (manager->priv->conf),
-                    INACTIVITY_SLEEP_MODE_ON_BATTERY, &sleep_mode,
-                    NULL);
-
     g_object_get (G_OBJECT (manager->priv->power),
                   "on-battery", &on_battery,
                   NULL);
 
     if ( id == TIMEOUT_INACTIVITY_ON_AC && on_battery == FALSE )
-      xfpm_manager_sleep_request (manager, sleep_mode, FALSE);
+      xfpm_manager_sleep_request (manager, sleep_mode, FALSE, "idle");
     else if ( id ==  TIMEOUT_INACTIVITY_ON_BATTERY && on_battery )
-      xfpm_manager_sleep_request (manager, sleep_mode, FALSE);
+      xfpm_manager_sleep_request (manager, sleep_mode, FALSE, "idle");
+    else if ( sleep_mode != XFPM_DO_NOTHING )
+      /* The alarm of the other power source fired before it was reset */
+      xfpm_journal_log (XFPM_JOURNAL_SLEEP_BLOCKED, sleep_mode,
+                        on_battery ? "on-battery" : "on-ac");
   }
 }
 
@@ -527,9 +577,7 @@ xfpm_manager_set_idle_alarm_on_ac (XfpmManager *manager)
 {
   guint on_ac;
 
-  g_object_get (G_OBJECT (manager->priv->conf),
-                ON_AC_INACTIVITY_TIMEOUT, &on_ac,
-                NULL);
+  on_ac = xfpm_xfconf_get_config (manager->priv->conf)->inactivity_on_ac;
 
 #ifdef DEBUG
   if ( on_ac == 14 )
@@ -553,9 +601,7 @@ xfpm_manager_set_idle_alarm_on_battery (XfpmManager *manager)
 {
   guint on_battery;
 
-  g_object_get (G_OBJECT (manager->priv->conf),
-                ON_BATTERY_INACTIVITY_TIMEOUT, &on_battery,
-                NULL);
+  on_battery = xfpm_xfconf_get_config (manager->priv->conf)->inactivity_on_battery;
 
 #ifdef DEBUG
   if ( on_battery == 14 )
@@ -592,22 +638,15 @@ xfpm_manager_get_systemd_events(XfpmManager *manager)
 {
   GSList *events = NULL;
   gchar *what = "";
-  gboolean logind_handle_power_key, logind_handle_suspend_key, logind_handle_hibernate_key, logind_handle_lid_switch;
-
-  g_object_get (G_OBJECT (manager->priv->conf),
-                LOGIND_HANDLE_POWER_KEY, &logind_handle_power_key,
-                LOGIND_HANDLE_SUSPEND_KEY, &logind_handle_suspend_key,
-                LOGIND_HANDLE_HIBERNATE_KEY, &logind_handle_hibernate_key,
-                LOGIND_HANDLE_LID_SWITCH, &logind_handle_lid_switch,
-                NULL);
+  const XfpmConfig *config = xfpm_xfconf_get_config (manager->priv->conf);
 
-  if (!logind_handle_power_key)
+  if (!config->logind_handle_power_key)
     events = g_slist_append(events, "handle-power-key");
-  if (!logind_handle_suspend_key)
+  if (!config->logind_handle_suspend_key)
     events = g_slist_append(events, "handle-suspend-key");
-  if (!logind_handle_hibernate_key)
+  if (!config->logind_handle_hibernate_key)
     events = g_slist_append(events, "handle-hibernate-key");
-  if (!logind_handle_lid_switch)
+  if (!config->logind_handle_lid_switch)
     events = g_slist_append(events, "handle-lid-switch");
 
   while (events != NULL)
@@ -623,51 +662,25 @@ xfpm_manager_get_systemd_events(XfpmManager *manager)
   return what;
 }
 
-static gint
-xfpm_manager_inhibit_sleep_systemd (XfpmManager *manager)
+static void
+xfpm_manager_inhibit_sleep_systemd_cb (GObject *source, GAsyncResult *res, gpointer user_data)
 {
-  GDBusConnection *bus_connection;
+  XfpmManager *manager = XFPM_MANAGER (user_data);
   GVariant *reply;
   GError *error = NULL;
   GUnixFDList *fd_list = NULL;
-  gint fd = -1;
-  char *what = xfpm_manager_get_systemd_events(manager);
-  const char *who = "xfce4-power-manager";
-  const char *why = "xfce4-power-manager handles these events";
-  const char *mode = "block";
+  gint fd;
 
-  if (g_strcmp0(what, "") == 0)
-    return -1;
-
-  if (!(LOGIND_RUNNING()))
-    return -1;
-
-  XFPM_DEBUG ("Inhibiting systemd sleep: %s", what);
-
-  bus_connection = manager->priv->system_bus;
-  if (!xfpm_dbus_name_has_owner (bus_connection, "org.freedesktop.login1"))
-    return -1;
-
-  reply = g_dbus_connection_call_with_unix_fd_list_sync (bus_connection,
-                                                         "org.freedesktop.login1",
-                                                         "/org/freedesktop/login1",
-                                                         "org.freedesktop.login1.Manager",
-                                                         "Inhibit",
-                                                         g_variant_new ("(ssss)",
-                                                                        what, who, why, mode),
-                                                         G_VARIANT_TYPE ("(h)"),
-                                                         G_DBUS_CALL_FLAGS_NONE,
-                                                         -1,
-                                                         NULL,
-                                                         &fd_list,
-                                                         NULL,
-                                                         &error);
+  reply = g_dbus_connection_call_with_unix_fd_list_finish (G_DBUS_CONNECTION (source),
+                                                           &fd_list,
+                                                           res,
+                                                           &error);
 
   if (!reply)
   {
     g_warning ("Unable to inhibit systemd sleep: %s", error->message);
     g_error_free (error);
-    return -1;
+    goto out;
   }
 
   g_variant_unref (reply);
@@ -676,15 +689,63 @@ xfpm_manager_inhibit_sleep_systemd (XfpmManager *manager)
   if (fd == -1)
   {
     g_warning ("Inhibit() reply parsing failed: %s", error->message);
+    g_error_free (error);
   }
 
   g_object_unref (fd_list);
 
-  g_error_free (error);
+  /* The events changed again while we were waiting for the reply */
+  if (manager->priv->inhibit_fd >= 0)
+    close (manager->priv->inhibit_fd);
+
+  manager->priv->inhibit_fd = fd;
+
+out:
+  if (manager->priv->startup && !xfpm_startup_is_done (manager->priv->startup, "logind-inhibit"))
+    xfpm_startup_task_done (manager->priv->startup, "logind-inhibit");
+
+  g_object_unref (manager);
+}
+
+/* Returns FALSE if there is nothing to inhibit, otherwise the
+ * inhibit fd is set once logind replies */
+static gboolean
+xfpm_manager_inhibit_sleep_systemd (XfpmManager *manager)
+{
+  gchar *what;
+  const char *who = "xfce4-power-manager";
+  const char *why = "xfce4-power-manager handles these events";
+  const char *mode = "block";
+
+  if (!(LOGIND_RUNNING()))
+    return FALSE;
+
+  what = xfpm_manager_get_systemd_events(manager);
+
+  if (g_strcmp0(what, "") == 0)
+    return FALSE;
+
+  XFPM_DEBUG ("Inhibiting systemd sleep: %s", what);
+
+  /* Don't activate logind, if it isn't there the call fails right away */
+  g_dbus_connection_call_with_unix_fd_list (manager->priv->system_bus,
+                                            "org.freedesktop.login1",
+                                            "/org/freedesktop/login1",
+                                            "org.freedesktop.login1.Manager",
+                                            "Inhibit",
+                                            g_variant_new ("(ssss)",
+                                                           what, who, why, mode),
+                                            G_VARIANT_TYPE ("(h)"),
+                                            G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                                            -1,
+                                            NULL,
+                                            NULL,
+                                            xfpm_manager_inhibit_sleep_systemd_cb,
+                                            g_object_ref (manager));
 
   g_free (what);
 
-  return fd;
+  return TRUE;
 }
 
 static void
@@ -693,8 +754,10 @@ xfpm_manager_systemd_events_changed (XfpmManager *manager)
   if (manager->priv->inhibit_fd >= 0)
     close (manager->priv->inhibit_fd);
 
+  manager->priv->inhibit_fd = -1;
+
   if (manager->priv->system_bus)
-    manager->priv->inhibit_fd = xfpm_manager_inhibit_sleep_systemd (manager);
+    xfpm_manager_inhibit_sleep_systemd (manager);
 }
 
 static void
@@ -836,19 +899,34 @@ xfpm_manager_new (GDBusConnection *bus, const gchar *client_id)
   return manager;
 }
 
-void xfpm_manager_start (XfpmManager *manager)
+/*
+ * Startup tasks, see xfpm_manager_start for the order they run in.
+ */
+static void
+xfpm_manager_startup_xfconf (XfpmStartup *startup, XfpmManager *manager)
 {
-  GError *error = NULL;
+  manager->priv->conf = xfpm_xfconf_new ();
 
-  if ( !xfpm_manager_reserve_names (manager) )
-  goto out;
+  xfpm_startup_task_done (startup, "xfconf");
+}
 
-  manager->priv->power = xfpm_power_get ();
-  manager->priv->button = xfpm_button_new ();
-  manager->priv->conf = xfpm_xfconf_new ();
+static void
+xfpm_manager_startup_tray_icon (XfpmStartup *startup, XfpmManager *manager)
+{
+  /* Shows the tray icon right away if it is enabled */
+  xfconf_g_property_bind (xfpm_xfconf_get_channel (manager->priv->conf),
+                                                   XFPM_PROPERTIES_PREFIX SHOW_TRAY_ICON_CFG,
+                                                   G_TYPE_INT,
+                                                   G_OBJECT(manager),
+                                                   SHOW_TRAY_ICON_CFG);
+
+  xfpm_startup_task_done (startup, "tray-icon");
+}
+
+static void
+xfpm_manager_startup_session (XfpmStartup *startup, XfpmManager *manager)
+{
   manager->priv->screensaver = xfce_screensaver_new ();
-  manager->priv->console = NULL;
-  manager->priv->systemd = NULL;
 
   if ( LOGIND_RUNNING () )
     manager->priv->systemd = xfpm_systemd_new ();
@@ -857,25 +935,43 @@ void xfpm_manager_start (XfpmManager *manager)
 
   manager->priv->monitor = xfpm_dbus_monitor_new ();
   manager->priv->inhibit = xfpm_inhibit_new ();
-  manager->priv->idle = egg_idletime_new ();
 
-    /* Don't allow systemd to handle power/suspend/hibernate buttons
-     * and lid-switch */
-  manager->priv->system_bus = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
-  if (manager->priv->system_bus)
-    manager->priv->inhibit_fd = xfpm_manager_inhibit_sleep_systemd (manager);
-  else
+  g_signal_connect (manager->priv->inhibit, "has-inhibit-changed",
+                    G_CALLBACK (xfpm_manager_inhibit_changed_cb), manager);
+  g_signal_connect (manager->priv->monitor, "system-bus-connection-changed",
+                    G_CALLBACK (xfpm_manager_system_bus_connection_changed_cb), manager);
+
+  xfpm_startup_task_done (startup, "session");
+}
+
+static void
+xfpm_manager_system_bus_ready_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  XfpmManager *manager = XFPM_MANAGER (user_data);
+  GError *error = NULL;
+
+  manager->priv->system_bus = g_bus_get_finish (res, &error);
+
+  if ( manager->priv->system_bus == NULL )
   {
     g_warning ("Unable connect to system bus: %s", error->message);
     g_clear_error (&error);
   }
 
-  g_signal_connect (manager->priv->idle, "alarm-expired",
-                    G_CALLBACK (xfpm_manager_alarm_timeout_cb), manager);
-  g_signal_connect_swapped (manager->priv->conf, "notify::" ON_AC_INACTIVITY_TIMEOUT,
-                            G_CALLBACK (xfpm_manager_set_idle_alarm_on_ac), manager);
-  g_signal_connect_swapped (manager->priv->conf, "notify::" ON_BATTERY_INACTIVITY_TIMEOUT,
-                            G_CALLBACK (xfpm_manager_set_idle_alarm_on_battery), manager);
+  xfpm_startup_task_done (manager->priv->startup, "system-bus");
+
+  g_object_unref (manager);
+}
+
+static void
+xfpm_manager_startup_system_bus (XfpmStartup *startup, XfpmManager *manager)
+{
+  g_bus_get (G_BUS_TYPE_SYSTEM, NULL, xfpm_manager_system_bus_ready_cb, g_object_ref (manager));
+}
+
+static void
+xfpm_manager_startup_logind_inhibit (XfpmStartup *startup, XfpmManager *manager)
+{
   g_signal_connect_swapped (manager->priv->conf, "notify::" LOGIND_HANDLE_POWER_KEY,
                             G_CALLBACK (xfpm_manager_systemd_events_changed), manager);
   g_signal_connect_swapped (manager->priv->conf, "notify::" LOGIND_HANDLE_SUSPEND_KEY,
@@ -885,47 +981,228 @@ void xfpm_manager_start (XfpmManager *manager)
   g_signal_connect_swapped (manager->priv->conf, "notify::" LOGIND_HANDLE_LID_SWITCH,
                             G_CALLBACK (xfpm_manager_systemd_events_changed), manager);
 
-  xfpm_manager_set_idle_alarm (manager);
+  /* Don't allow systemd to handle power/suspend/hibernate buttons
+   * and lid-switch, the task is done when logind replies */
+  if ( manager->priv->system_bus == NULL || !xfpm_manager_inhibit_sleep_systemd (manager) )
+    xfpm_startup_task_done (startup, "logind-inhibit");
+}
 
-  g_signal_connect (manager->priv->inhibit, "has-inhibit-changed",
-                    G_CALLBACK (xfpm_manager_inhibit_changed_cb), manager);
-  g_signal_connect (manager->priv->monitor, "system-bus-connection-changed",
-                    G_CALLBACK (xfpm_manager_system_bus_connection_changed_cb), manager);
+static void
+xfpm_manager_power_ready_cb (XfpmPower *power, XfpmManager *manager)
+{
+  g_signal_handlers_disconnect_by_func (power, xfpm_manager_power_ready_cb, manager);
 
-  manager->priv->backlight = xfpm_backlight_new ();
+  xfpm_startup_task_done (manager->priv->startup, "power");
+}
 
-  manager->priv->kbd_backlight = xfpm_kbd_backlight_new ();
+static void
+xfpm_manager_startup_power (XfpmStartup *startup, XfpmManager *manager)
+{
+  manager->priv->power = xfpm_power_get ();
+
+  g_signal_connect_swapped (manager->priv->power, "waking-up",
+                            G_CALLBACK (xfpm_manager_reset_sleep_timer), manager);
+
+  g_signal_connect_swapped (manager->priv->power, "sleeping",
+                            G_CALLBACK (xfpm_manager_reset_sleep_timer), manager);
 
+  g_signal_connect_swapped (manager->priv->power, "ask-shutdown",
+                            G_CALLBACK (xfpm_manager_ask_shutdown), manager);
+
+  g_signal_connect_swapped (manager->priv->power, "shutdown",
+                            G_CALLBACK (xfpm_manager_shutdown), manager);
+
+  /* Batteries and sleep capabilities come in once the system bus
+   * answered, the tasks after this one and --dump need them */
+  if ( xfpm_power_is_ready (manager->priv->power) )
+    xfpm_startup_task_done (startup, "power");
+  else
+    g_signal_connect (manager->priv->power, "ready",
+                      G_CALLBACK (xfpm_manager_power_ready_cb), manager);
+}
+
+static void
+xfpm_manager_startup_idle (XfpmStartup *startup, XfpmManager *manager)
+{
+  manager->priv->idle = egg_idletime_new ();
+
+  g_signal_connect (manager->priv->idle, "alarm-expired",
+                    G_CALLBACK (xfpm_manager_alarm_timeout_cb), manager);
+  g_signal_connect_swapped (manager->priv->conf, "notify::" ON_AC_INACTIVITY_TIMEOUT,
+                            G_CALLBACK (xfpm_manager_set_idle_alarm_on_ac), manager);
+  g_signal_connect_swapped (manager->priv->conf, "notify::" ON_BATTERY_INACTIVITY_TIMEOUT,
+                            G_CALLBACK (xfpm_manager_set_idle_alarm_on_battery), manager);
+
+  xfpm_manager_set_idle_alarm (manager);
+
+  g_signal_connect (manager->priv->power, "on-battery-changed",
+                    G_CALLBACK (xfpm_manager_on_battery_changed_cb), manager);
+
+  xfpm_startup_task_done (startup, "idle");
+}
+
+static void
+xfpm_manager_startup_dpms (XfpmStartup *startup, XfpmManager *manager)
+{
   manager->priv->dpms = xfpm_dpms_new ();
 
+  xfpm_startup_task_done (startup, "dpms");
+}
+
+static void
+xfpm_manager_startup_buttons (XfpmStartup *startup, XfpmManager *manager)
+{
+  manager->priv->button = xfpm_button_new ();
+
   g_signal_connect (manager->priv->button, "button_pressed",
                     G_CALLBACK (xfpm_manager_button_pressed_cb), manager);
 
   g_signal_connect (manager->priv->power, "lid-changed",
                     G_CALLBACK (xfpm_manager_lid_changed_cb), manager);
 
-  g_signal_connect (manager->priv->power, "on-battery-changed",
-                    G_CALLBACK (xfpm_manager_on_battery_changed_cb), manager);
+  xfpm_startup_task_done (startup, "buttons");
+}
 
-  g_signal_connect_swapped (manager->priv->power, "waking-up",
-                            G_CALLBACK (xfpm_manager_reset_sleep_timer), manager);
+static void
+xfpm_manager_startup_backlight (XfpmStartup *startup, XfpmManager *manager)
+{
+  manager->priv->backlight = xfpm_backlight_new ();
 
-  g_signal_connect_swapped (manager->priv->power, "sleeping",
-                            G_CALLBACK (xfpm_manager_reset_sleep_timer), manager);
+  xfpm_startup_task_done (startup, "backlight");
+}
 
-  g_signal_connect_swapped (manager->priv->power, "ask-shutdown",
-                            G_CALLBACK (xfpm_manager_ask_shutdown), manager);
+static void
+xfpm_manager_startup_kbd_backlight (XfpmStartup *startup, XfpmManager *manager)
+{
+  /* The UPower proxy is set up asynchronously by the object itself */
+  manager->priv->kbd_backlight = xfpm_kbd_backlight_new ();
 
-  g_signal_connect_swapped (manager->priv->power, "shutdown",
-                            G_CALLBACK (xfpm_manager_shutdown), manager);
+  xfpm_startup_task_done (startup, "kbd-backlight");
+}
 
-  xfconf_g_property_bind (xfpm_xfconf_get_channel (manager->priv->conf),
-                                                   XFPM_PROPERTIES_PREFIX SHOW_TRAY_ICON_CFG,
-                                                   G_TYPE_INT,
-                                                   G_OBJECT(manager),
-                                                   SHOW_TRAY_ICON_CFG);
-out:
-  ;
+static void
+xfpm_manager_startup_power_profiles (XfpmStartup *startup, XfpmManager *manager)
+{
+  /* Connects to power-profiles-daemon asynchronously */
+  manager->priv->power_profiles = xfpm_power_profiles_new ();
+
+  xfpm_startup_task_done (startup, "power-profiles");
+}
+
+static void
+xfpm_manager_startup_cpufreq (XfpmStartup *startup, XfpmManager *manager)
+{
+  /* Reads the cpufreq policies, the helper runs in the background */
+  manager->priv->cpufreq = xfpm_cpufreq_new ();
+
+  xfpm_startup_task_done (startup, "cpufreq");
+}
+
+static void
+xfpm_manager_startup_runtime_pm (XfpmStartup *startup, XfpmManager *manager)
+{
+  /* Walks the PCI and USB devices, the helper runs in the background */
+  manager->priv->runtime_pm = xfpm_runtime_pm_new ();
+
+  xfpm_startup_task_done (startup, "runtime-pm");
+}
+
+static void
+xfpm_manager_startup_thermal (XfpmStartup *startup, XfpmManager *manager)
+{
+  /* Reads the thermal zones every few seconds, acts through the
+   * backlight and the power profiles */
+  manager->priv->thermal = xfpm_thermal_new (manager->priv->backlight,
+                                             manager->priv->power_profiles);
+
+  xfpm_startup_task_done (startup, "thermal");
+}
+
+static void
+xfpm_manager_startup_exporter (XfpmStartup *startup, XfpmManager *manager)
+{
+  /* Only writes anything once metrics-textfile is set */
+  manager->priv->exporter = xfpm_exporter_new (manager->priv->backlight);
+
+  xfpm_startup_task_done (startup, "exporter");
+}
+
+static void
+xfpm_manager_startup_workload (XfpmStartup *startup, XfpmManager *manager)
+{
+  /* Samples the system load when enabled and inhibits through
+   * XfpmInhibit, so it only needs the session objects */
+  manager->priv->workload = xfpm_workload_new ();
+
+  xfpm_startup_task_done (startup, "workload");
+}
+
+static void
+xfpm_manager_startup_state (XfpmStartup *startup, XfpmManager *manager)
+{
+  /* Clients waiting on the empty state get everything as the first delta */
+  xfpm_state_start (manager->priv->state, manager->priv->backlight);
+
+  xfpm_startup_task_done (startup, "state");
+}
+
+static void
+xfpm_manager_startup_finished_cb (XfpmStartup *startup, XfpmManager *manager)
+{
+  XFPM_DEBUG ("Power manager started");
+
+  xfpm_journal_log (XFPM_JOURNAL_STARTED, 0, VERSION);
+
+  g_signal_emit (G_OBJECT (manager), signals [STARTED], 0);
+}
+
+void xfpm_manager_start (XfpmManager *manager)
+{
+  XfpmStartup *startup;
+  gint64 begin;
+
+  begin = g_get_monotonic_time ();
+
+  if ( !xfpm_manager_reserve_names (manager) )
+    return;
+
+  xfpm_startup_profile_add ("dbus-names", 0, begin, g_get_monotonic_time ());
+
+  /*
+   * Everything else comes up as a dependency graph, tasks without a
+   * dependency on each other run interleaved on the main loop and the
+   * ones waiting on the system bus don't block the rest.
+   */
+  startup = manager->priv->startup = xfpm_startup_new ();
+
+  g_signal_connect (startup, "finished",
+                    G_CALLBACK (xfpm_manager_startup_finished_cb), manager);
+
+#define ADD_TASK(name, after, func) \
+  xfpm_startup_add (startup, name, after, (XfpmStartupFunc) func, manager)
+
+  ADD_TASK ("xfconf",         NULL,                       xfpm_manager_startup_xfconf);
+  ADD_TASK ("system-bus",     NULL,                       xfpm_manager_startup_system_bus);
+  ADD_TASK ("tray-icon",      "xfconf",                   xfpm_manager_startup_tray_icon);
+  ADD_TASK ("session",        "xfconf",                   xfpm_manager_startup_session);
+  ADD_TASK ("dpms",           "xfconf",                   xfpm_manager_startup_dpms);
+  ADD_TASK ("logind-inhibit", "xfconf,system-bus",        xfpm_manager_startup_logind_inhibit);
+  ADD_TASK ("power",          "session",                  xfpm_manager_startup_power);
+  ADD_TASK ("idle",           "power",                    xfpm_manager_startup_idle);
+  ADD_TASK ("buttons",        "power,dpms",               xfpm_manager_startup_buttons);
+  ADD_TASK ("backlight",      "power",                    xfpm_manager_startup_backlight);
+  ADD_TASK ("kbd-backlight",  "power",                    xfpm_manager_startup_kbd_backlight);
+  ADD_TASK ("power-profiles", "power",                    xfpm_manager_startup_power_profiles);
+  ADD_TASK ("cpufreq",        "power",                    xfpm_manager_startup_cpufreq);
+  ADD_TASK ("runtime-pm",     "power",                    xfpm_manager_startup_runtime_pm);
+  ADD_TASK ("thermal",        "backlight,power-profiles", xfpm_manager_startup_thermal);
+  ADD_TASK ("exporter",       "backlight,dpms",           xfpm_manager_startup_exporter);
+  ADD_TASK ("workload",       "session",                  xfpm_manager_startup_workload);
+  ADD_TASK ("state",          "power,backlight",          xfpm_manager_startup_state);
+
+#undef ADD_TASK
+
+  xfpm_startup_run (startup);
 }
 
 void xfpm_manager_stop (XfpmManager *manager)
@@ -955,31 +1232,37 @@ GHashTable *xfpm_manager_get_config (XfpmManager *manager)
 
   hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
-  if ( LOGIND_RUNNING () )
+  /* We can be asked over D-Bus before all the components are up */
+  if ( manager->priv->systemd != NULL )
   {
     g_object_get (G_OBJECT (manager->priv->systemd),
                   "can-shutdown", &can_shutdown,
                   NULL);
   }
-  else
+  else if ( manager->priv->console != NULL )
   {
     g_object_get (G_OBJECT (manager->priv->console),
                   "can-shutdown", &can_shutdown,
                   NULL);
   }
 
-  g_object_get (G_OBJECT (manager->priv->power),
-                "auth-suspend", &auth_suspend,
-                "auth-hibernate", &auth_hibernate,
-                "can-suspend", &can_suspend,
-                "can-hibernate", &can_hibernate,
-                "has-lid", &has_lid,
-                NULL);
+  if ( manager->priv->power != NULL )
+  {
+    g_object_get (G_OBJECT (manager->priv->power),
+                  "auth-suspend", &auth_suspend,
+                  "auth-hibernate", &auth_hibernate,
+                  "can-suspend", &can_suspend,
+                  "can-hibernate", &can_hibernate,
+                  "has-lid", &has_lid,
+                  NULL);
+
+    has_battery = xfpm_power_has_battery (manager->priv->power);
+  }
 
-  has_battery = xfpm_power_has_battery (manager->priv->power);
-  has_lcd_brightness = xfpm_backlight_has_hw (manager->priv->backlight);
+  if ( manager->priv->backlight != NULL )
+    has_lcd_brightness = xfpm_backlight_has_hw (manager->priv->backlight);
 
-  mapped_buttons = xfpm_button_get_mapped (manager->priv->button);
+  mapped_buttons = manager->priv->button != NULL ? xfpm_button_get_mapped (manager->priv->button) : 0;
 
   if ( mapped_buttons & SLEEP_KEY )
     has_sleep_button = TRUE;
@@ -1029,6 +1312,25 @@ static gboolean xfpm_manager_dbus_get_info   (XfpmManager *manager,
                                               GDBusMethodInvocation *invocation,
                                               gpointer user_data);
 
+static gboolean xfpm_manager_dbus_get_state  (XfpmManager *manager,
+                                              GDBusMethodInvocation *invocation,
+                                              gpointer user_data);
+
+static gboolean xfpm_manager_dbus_set_brightness  (XfpmManager *manager,
+                                                   GDBusMethodInvocation *invocation,
+                                                   gint32 level,
+                                                   gpointer user_data);
+
+static gboolean xfpm_manager_dbus_step_brightness (XfpmManager *manager,
+                                                   GDBusMethodInvocation *invocation,
+                                                   gboolean up,
+                                                   gpointer user_data);
+
+static gboolean xfpm_manager_dbus_get_top_consumers (XfpmManager *manager,
+                                                     GDBusMethodInvocation *invocation,
+                                                     guint count,
+                                                     gpointer user_data);
+
 #include "xfce-power-manager-dbus.h"
 
 static void
@@ -1062,6 +1364,28 @@ xfpm_manager_dbus_init (XfpmManager *manager)
                             "handle-get-info",
                             G_CALLBACK (xfpm_manager_dbus_get_info),
                             manager);
+  g_signal_connect_swapped (manager_dbus,
+                            "handle-get-state",
+                            G_CALLBACK (xfpm_manager_dbus_get_state),
+                            manager);
+  g_signal_connect_swapped (manager_dbus,
+                            "handle-set-brightness",
+                            G_CALLBACK (xfpm_manager_dbus_set_brightness),
+                            manager);
+  g_signal_connect_swapped (manager_dbus,
+                            "handle-step-brightness",
+                            G_CALLBACK (xfpm_manager_dbus_step_brightness),
+                            manager);
+  g_signal_connect_swapped (manager_dbus,
+                            "handle-get-top-consumers",
+                            G_CALLBACK (xfpm_manager_dbus_get_top_consumers),
+                            manager);
+
+  /* Empty until the state startup task runs */
+  manager->priv->state = xfpm_state_new ();
+  g_signal_connect_swapped (manager->priv->state, "state-changed",
+                            G_CALLBACK (xfpm_power_manager_emit_state_changed),
+                            manager_dbus);
 }
 
 static gboolean
@@ -1139,3 +1463,92 @@ xfpm_manager_dbus_get_info (XfpmManager *manager,
 
   return TRUE;
 }
+
+static gboolean
+xfpm_manager_dbus_get_state (XfpmManager *manager,
+                             GDBusMethodInvocation *invocation,
+                             gpointer user_data)
+{
+  GVariant *state;
+  guint64 serial;
+
+  state = xfpm_state_get_snapshot (manager->priv->state, &serial);
+
+  xfpm_power_manager_complete_get_state (user_data,
+                                         invocation,
+                                         XFPM_STATE_VERSION,
+                                         serial,
+                                         state);
+
+  g_variant_unref (state);
+
+  return TRUE;
+}
+
+static void
+xfpm_manager_dbus_set_brightness_cb (GObject *source_object,
+                                     GAsyncResult *res,
+                                     gpointer user_data)
+{
+  GDBusMethodInvocation *invocation = G_DBUS_METHOD_INVOCATION (user_data);
+  GError *error = NULL;
+
+  if ( !xfpm_state_set_brightness_finish (XFPM_STATE (source_object), res, &error) )
+  {
+    XFPM_DEBUG ("SetBrightness failed: %s", error->message);
+    g_error_free (error);
+    g_dbus_method_invocation_return_error (invocation,
+                                           XFPM_ERROR,
+                                           XFPM_ERROR_NO_HARDWARE_SUPPORT,
+                                           _("Unable to set the brightness level"));
+    return;
+  }
+
+  g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
+static gboolean
+xfpm_manager_dbus_set_brightness (XfpmManager *manager,
+                                  GDBusMethodInvocation *invocation,
+                                  gint32 level,
+                                  gpointer user_data)
+{
+  XFPM_DEBUG ("SetBrightness %d", level);
+
+  /* Answered once written, without blocking the other clients meanwhile */
+  xfpm_state_set_brightness (manager->priv->state, level,
+                             xfpm_manager_dbus_set_brightness_cb, invocation);
+
+  return TRUE;
+}
+
+static gboolean
+xfpm_manager_dbus_step_brightness (XfpmManager *manager,
+                                   GDBusMethodInvocation *invocation,
+                                   gboolean up,
+                                   gpointer user_data)
+{
+  XFPM_DEBUG ("StepBrightness %s", up ? "up" : "down");
+
+  /* Already at the end of the range is not an error */
+  xfpm_state_step_brightness (manager->priv->state, up);
+
+  xfpm_power_manager_complete_step_brightness (user_data, invocation);
+
+  return TRUE;
+}
+
+static gboolean
+xfpm_manager_dbus_get_top_consumers (XfpmManager *manager,
+                                     GDBusMethodInvocation *invocation,
+                                     guint count,
+                                     gpointer user_data)
+{
+  GVariant *reply;
+
+  reply = xfpm_state_get_top_consumers (manager->priv->state, count);
+
+  g_dbus_method_invocation_return_value (invocation, reply);
+
+  return TRUE;
+}
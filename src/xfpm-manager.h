@@ -41,6 +41,9 @@ typedef struct
 typedef struct
 {
   GObjectClass     parent_class;
+
+  /* signals */
+  void            (*started)      (XfpmManager *manager);
 } XfpmManagerClass;
 
 GType              xfpm_manager_get_type        (void) G_GNUC_CONST;
@@ -45,6 +45,10 @@
 #include "xfpm-common.h"
 #include "xfpm-notify.h"
 #include "xfpm-dbus-monitor.h"
+#include "xfpm-debug.h"
+
+#define NOTIFICATIONS_SERVICE   "org.freedesktop.Notifications"
+#define NOTIFICATIONS_PATH      "/org/freedesktop/Notifications"
 
 static void xfpm_notify_finalize   (GObject *object);
 
@@ -53,10 +57,56 @@ static NotifyNotification * xfpm_notify_new_notification_internal (const gchar *
                                                                    const gchar *icon_name,
                                                                    XfpmNotifyUrgency urgency) G_GNUC_MALLOC;
 
+/* How each category is sent, delays in milliseconds */
+static const struct
+{
+  const gchar *name;      /* for the synchronous hint */
+  guint        gather;    /* wait for more messages before the first send */
+  guint        interval;  /* at least this long between two sends */
+  gboolean     osd;       /* carries a value, shown as a bar */
+} categories[XFPM_NOTIFY_N_CATEGORIES] =
+{
+  { "xfpm-general",        0,   0,    FALSE },
+  { "xfpm-brightness",     0,   100,  TRUE  },
+  { "xfpm-kbd-brightness", 0,   100,  TRUE  },
+  { "xfpm-battery",        500, 2000, FALSE },
+  { "xfpm-low-battery",    500, 5000, FALSE },
+};
+
+typedef struct
+{
+  gchar *key;
+  gchar *text;
+} XfpmNotifyMessage;
+
+typedef struct
+{
+  XfpmNotify         *notify;
+  XfpmNotifyCategory  category;
+
+  guint32             id;         /* on the server, 0 when there is none */
+  gint64              last_sent;
+  guint               flush_id;
+  gboolean            in_flight;
+  gboolean            dirty;      /* posted to while a send was in flight */
+  gboolean            close_pending; /* closed while a send was in flight */
+
+  /* What the next send shows */
+  gchar              *title;
+  gchar              *icon_name;
+  XfpmNotifyUrgency   urgency;
+  gint                value;
+  GPtrArray          *messages;
+} XfpmNotifySlot;
+
 struct XfpmNotifyPrivate
 {
   XfpmDBusMonitor    *monitor;
 
+  GDBusConnection    *bus;
+  guint               closed_id;
+  XfpmNotifySlot      slots[XFPM_NOTIFY_N_CATEGORIES];
+
   NotifyNotification *notification;
   NotifyNotification *critical;
 
@@ -105,8 +155,295 @@ xfpm_notify_check_server (XfpmDBusMonitor *monitor,
                           gboolean on_session,
                           XfpmNotify *notify)
 {
-  if ( !g_strcmp0 (service_name, "org.freedesktop.Notifications") && on_session && connected )
-    xfpm_notify_get_server_caps (notify);
+  guint i;
+
+  if ( !g_strcmp0 (service_name, NOTIFICATIONS_SERVICE) && on_session )
+  {
+    /* A new server doesn't know the ids of the old one */
+    for ( i = 0; i < XFPM_NOTIFY_N_CATEGORIES; i++ )
+      notify->priv->slots[i].id = 0;
+
+    if ( connected )
+      xfpm_notify_get_server_caps (notify);
+  }
+}
+
+static void
+xfpm_notify_closed_signal_cb (GDBusConnection *connection,
+                              const gchar     *sender_name,
+                              const gchar     *object_path,
+                              const gchar     *interface_name,
+                              const gchar     *signal_name,
+                              GVariant        *parameters,
+                              gpointer         user_data)
+{
+  XfpmNotify *notify = XFPM_NOTIFY (user_data);
+  guint32 id, reason;
+  guint i;
+
+  if ( !g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(uu)")) )
+    return;
+
+  g_variant_get (parameters, "(uu)", &id, &reason);
+
+  for ( i = 0; i < XFPM_NOTIFY_N_CATEGORIES; i++ )
+  {
+    if ( notify->priv->slots[i].id == id )
+      notify->priv->slots[i].id = 0;
+  }
+}
+
+static void
+xfpm_notify_message_free (XfpmNotifyMessage *message)
+{
+  g_free (message->key);
+  g_free (message->text);
+  g_free (message);
+}
+
+static void xfpm_notify_schedule (XfpmNotifySlot *slot);
+
+static void
+xfpm_notify_close_id (XfpmNotifySlot *slot)
+{
+  if ( slot->id != 0 && slot->notify->priv->bus != NULL )
+  {
+    g_dbus_connection_call (slot->notify->priv->bus,
+                            NOTIFICATIONS_SERVICE,
+                            NOTIFICATIONS_PATH,
+                            NOTIFICATIONS_SERVICE,
+                            "CloseNotification",
+                            g_variant_new ("(u)", slot->id),
+                            NULL,
+                            G_DBUS_CALL_FLAGS_NONE,
+                            -1,
+                            NULL,
+                            NULL,
+                            NULL);
+    slot->id = 0;
+  }
+}
+
+static void
+xfpm_notify_sent_cb (GObject      *source,
+                     GAsyncResult *res,
+                     gpointer      user_data)
+{
+  XfpmNotifySlot *slot = user_data;
+  XfpmNotify *notify = slot->notify;
+  GVariant *ret;
+  GError *error = NULL;
+
+  ret = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), res, &error);
+
+  slot->in_flight = FALSE;
+
+  if ( ret != NULL )
+  {
+    g_variant_get (ret, "(u)", &slot->id);
+    g_variant_unref (ret);
+  }
+  else
+  {
+    XFPM_DEBUG ("Failed to send %s notification: %s", categories[slot->category].name, error->message);
+    g_error_free (error);
+    slot->id = 0;
+  }
+
+  if ( slot->close_pending )
+  {
+    slot->close_pending = FALSE;
+    xfpm_notify_close_id (slot);
+  }
+
+  /* Posted to after the close, that one shows */
+  if ( slot->dirty )
+  {
+    slot->dirty = FALSE;
+    xfpm_notify_schedule (slot);
+  }
+
+  g_object_unref (notify);
+}
+
+static void
+xfpm_notify_send (XfpmNotifySlot *slot)
+{
+  static const gchar *const no_actions[] = { NULL };
+  GVariantBuilder hints;
+  GString *body;
+  guint i;
+
+  if ( slot->messages->len == 0 || slot->notify->priv->bus == NULL )
+    return;
+
+  body = g_string_new (NULL);
+  for ( i = 0; i < slot->messages->len; i++ )
+  {
+    XfpmNotifyMessage *message = g_ptr_array_index (slot->messages, i);
+
+    if ( i > 0 )
+      g_string_append_c (body, '\n');
+    g_string_append (body, message->text);
+  }
+
+  if ( slot->messages->len > 1 )
+    XFPM_DEBUG ("Merged %u %s messages", slot->messages->len, categories[slot->category].name);
+
+  g_variant_builder_init (&hints, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&hints, "{sv}", "urgency", g_variant_new_byte (slot->urgency));
+  /* Same as for libnotify ones, see xfpm_notify_new_notification_internal */
+  if ( slot->urgency != XFPM_NOTIFY_CRITICAL )
+    g_variant_builder_add (&hints, "{sv}", "transient", g_variant_new_boolean (FALSE));
+  if ( slot->icon_name != NULL )
+    g_variant_builder_add (&hints, "{sv}", "image-path", g_variant_new_string (slot->icon_name));
+  if ( categories[slot->category].osd )
+  {
+    g_variant_builder_add (&hints, "{sv}", "value", g_variant_new_int32 (slot->value));
+    g_variant_builder_add (&hints, "{sv}", "x-canonical-private-synchronous",
+                           g_variant_new_string (categories[slot->category].name));
+  }
+
+  g_dbus_connection_call (slot->notify->priv->bus,
+                          NOTIFICATIONS_SERVICE,
+                          NOTIFICATIONS_PATH,
+                          NOTIFICATIONS_SERVICE,
+                          "Notify",
+                          g_variant_new ("(susss^asa{sv}i)",
+                                         notify_get_app_name (),
+                                         slot->id,
+                                         slot->icon_name ? slot->icon_name : "",
+                                         slot->title ? slot->title : "",
+                                         body->str,
+                                         no_actions,
+                                         &hints,
+                                         -1),
+                          G_VARIANT_TYPE ("(u)"),
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1,
+                          NULL,
+                          xfpm_notify_sent_cb,
+                          slot);
+
+  g_object_ref (slot->notify);
+  slot->in_flight = TRUE;
+  slot->last_sent = g_get_monotonic_time ();
+  g_ptr_array_set_size (slot->messages, 0);
+  g_string_free (body, TRUE);
+}
+
+static gboolean
+xfpm_notify_flush_cb (gpointer data)
+{
+  XfpmNotifySlot *slot = data;
+
+  slot->flush_id = 0;
+  xfpm_notify_send (slot);
+
+  return FALSE;
+}
+
+static void
+xfpm_notify_schedule (XfpmNotifySlot *slot)
+{
+  gint64 now, next;
+  guint delay;
+
+  /* Sent again once the server told us the id to replace */
+  if ( slot->in_flight )
+  {
+    slot->dirty = TRUE;
+    return;
+  }
+
+  if ( slot->flush_id != 0 || slot->messages->len == 0 )
+    return;
+
+  delay = categories[slot->category].gather;
+
+  now = g_get_monotonic_time ();
+  next = slot->last_sent + (gint64) categories[slot->category].interval * 1000;
+  if ( slot->last_sent != 0 && now < next )
+    delay = MAX (delay, (next - now) / 1000);
+
+  slot->flush_id = g_timeout_add (delay, xfpm_notify_flush_cb, slot);
+}
+
+static void
+xfpm_notify_queue (XfpmNotify        *notify,
+                   XfpmNotifyCategory category,
+                   const gchar       *key,
+                   const gchar       *title,
+                   const gchar       *text,
+                   const gchar       *icon_name,
+                   XfpmNotifyUrgency  urgency,
+                   gint               value)
+{
+  XfpmNotifySlot *slot;
+  XfpmNotifyMessage *message = NULL;
+  guint i;
+
+  g_return_if_fail (XFPM_IS_NOTIFY (notify));
+  g_return_if_fail (category < XFPM_NOTIFY_N_CATEGORIES);
+
+  slot = &notify->priv->slots[category];
+
+  /* Without a key a message replaces whatever is pending, with one it
+   * only replaces the pending message of the same key */
+  if ( key == NULL )
+    g_ptr_array_set_size (slot->messages, 0);
+
+  for ( i = 0; key != NULL && i < slot->messages->len; i++ )
+  {
+    XfpmNotifyMessage *pending = g_ptr_array_index (slot->messages, i);
+
+    if ( g_strcmp0 (pending->key, key) == 0 )
+    {
+      message = pending;
+      break;
+    }
+  }
+
+  if ( message == NULL )
+  {
+    message = g_new0 (XfpmNotifyMessage, 1);
+    message->key = g_strdup (key);
+    g_ptr_array_add (slot->messages, message);
+  }
+
+  g_free (message->text);
+  message->text = g_strdup (text);
+
+  g_free (slot->title);
+  slot->title = g_strdup (title);
+  g_free (slot->icon_name);
+  slot->icon_name = g_strdup (icon_name);
+  slot->value = value;
+
+  /* The most urgent of the merged messages */
+  if ( slot->messages->len == 1 || urgency > slot->urgency )
+    slot->urgency = urgency;
+
+  xfpm_notify_schedule (slot);
+}
+
+static void
+xfpm_notify_close_slot (XfpmNotifySlot *slot)
+{
+  if ( slot->flush_id != 0 )
+  {
+    g_source_remove (slot->flush_id);
+    slot->flush_id = 0;
+  }
+
+  g_ptr_array_set_size (slot->messages, 0);
+  slot->dirty = FALSE;
+
+  /* The id comes with the reply, close it then */
+  if ( slot->in_flight )
+    slot->close_pending = TRUE;
+  else
+    xfpm_notify_close_id (slot);
 }
 
 static void xfpm_notify_get_property (GObject *object,
@@ -158,6 +495,8 @@ xfpm_notify_class_init (XfpmNotifyClass *klass)
 static void
 xfpm_notify_init (XfpmNotify *notify)
 {
+  guint i;
+
   notify->priv = xfpm_notify_get_instance_private (notify);
 
   notify->priv->notification = NULL;
@@ -171,6 +510,27 @@ xfpm_notify_init (XfpmNotify *notify)
   g_signal_connect (notify->priv->monitor, "service-connection-changed",
                     G_CALLBACK (xfpm_notify_check_server), notify);
 
+  notify->priv->bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
+  if ( notify->priv->bus != NULL )
+    notify->priv->closed_id =
+      g_dbus_connection_signal_subscribe (notify->priv->bus,
+                                          NOTIFICATIONS_SERVICE,
+                                          NOTIFICATIONS_SERVICE,
+                                          "NotificationClosed",
+                                          NOTIFICATIONS_PATH,
+                                          NULL,
+                                          G_DBUS_SIGNAL_FLAGS_NONE,
+                                          xfpm_notify_closed_signal_cb,
+                                          notify,
+                                          NULL);
+
+  for ( i = 0; i < XFPM_NOTIFY_N_CATEGORIES; i++ )
+  {
+    notify->priv->slots[i].notify = notify;
+    notify->priv->slots[i].category = i;
+    notify->priv->slots[i].messages = g_ptr_array_new_with_free_func ((GDestroyNotify) xfpm_notify_message_free);
+  }
+
   xfpm_notify_get_server_caps (notify);
 }
 
@@ -178,12 +538,34 @@ static void
 xfpm_notify_finalize (GObject *object)
 {
   XfpmNotify *notify;
+  guint i;
 
   notify = XFPM_NOTIFY (object);
 
   xfpm_notify_close_normal (notify);
   xfpm_notify_close_critical (notify);
 
+  for ( i = 0; i < XFPM_NOTIFY_N_CATEGORIES; i++ )
+  {
+    XfpmNotifySlot *slot = &notify->priv->slots[i];
+
+    if ( slot->flush_id != 0 )
+      g_source_remove (slot->flush_id);
+
+    g_ptr_array_free (slot->messages, TRUE);
+    g_free (slot->title);
+    g_free (slot->icon_name);
+  }
+
+  if ( notify->priv->bus != NULL )
+  {
+    g_dbus_connection_signal_unsubscribe (notify->priv->bus, notify->priv->closed_id);
+    g_object_unref (notify->priv->bus);
+  }
+
+  g_signal_handlers_disconnect_by_data (notify->priv->monitor, notify);
+  g_object_unref (notify->priv->monitor);
+
   G_OBJECT_CLASS (xfpm_notify_parent_class)->finalize(object);
 }
 
@@ -276,11 +658,45 @@ xfpm_notify_show_notification (XfpmNotify        *notify,
                                const gchar       *icon_name,
                                XfpmNotifyUrgency  urgency)
 {
-  NotifyNotification *n;
+  xfpm_notify_post (notify, XFPM_NOTIFY_CATEGORY_GENERAL, NULL,
+                    title, text, icon_name, urgency);
+}
 
-  xfpm_notify_close_notification (notify);
-  n = xfpm_notify_new_notification_internal (title, text, icon_name, urgency);
-  xfpm_notify_present_notification (notify, n);
+/**
+ * xfpm_notify_post:
+ * @key: what the message is about, e.g. a device, or %NULL
+ *
+ * Queues a message in @category. Messages with the same @key replace
+ * each other, different keys pending at the same time are shown in a
+ * single notification.
+ **/
+void
+xfpm_notify_post (XfpmNotify        *notify,
+                  XfpmNotifyCategory category,
+                  const gchar       *key,
+                  const gchar       *title,
+                  const gchar       *text,
+                  const gchar       *icon_name,
+                  XfpmNotifyUrgency  urgency)
+{
+  xfpm_notify_queue (notify, category, key, title, text, icon_name, urgency, 0);
+}
+
+/**
+ * xfpm_notify_show_value:
+ *
+ * Shows @value, a percentage, in the on screen display of @category,
+ * updating the one already shown.
+ **/
+void
+xfpm_notify_show_value (XfpmNotify        *notify,
+                        XfpmNotifyCategory category,
+                        const gchar       *title,
+                        const gchar       *text,
+                        const gchar       *icon_name,
+                        gint               value)
+{
+  xfpm_notify_queue (notify, category, NULL, title, text, icon_name, XFPM_NOTIFY_NORMAL, value);
 }
 
 NotifyNotification *
@@ -381,4 +797,5 @@ xfpm_notify_close_normal (XfpmNotify *notify)
   g_return_if_fail (XFPM_IS_NOTIFY (notify));
 
   xfpm_notify_close_notification (notify);
+  xfpm_notify_close_slot (&notify->priv->slots[XFPM_NOTIFY_CATEGORY_GENERAL]);
 }
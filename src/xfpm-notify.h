@@ -39,6 +39,21 @@ typedef enum
   XFPM_NOTIFY_CRITICAL
 } XfpmNotifyUrgency;
 
+/*
+ * Each category owns one notification on the server that is updated in
+ * place. Messages posted in a burst are held back for a moment and the
+ * ones of a merging category are shown together.
+ */
+typedef enum
+{
+  XFPM_NOTIFY_CATEGORY_GENERAL = 0,
+  XFPM_NOTIFY_CATEGORY_BRIGHTNESS,
+  XFPM_NOTIFY_CATEGORY_KBD_BRIGHTNESS,
+  XFPM_NOTIFY_CATEGORY_BATTERY,
+  XFPM_NOTIFY_CATEGORY_LOW_BATTERY,
+  XFPM_NOTIFY_N_CATEGORIES
+} XfpmNotifyCategory;
+
 typedef struct XfpmNotifyPrivate XfpmNotifyPrivate;
 
 typedef struct
@@ -59,6 +74,19 @@ void                xfpm_notify_show_notification             (XfpmNotify
                                                                const gchar          *text,
                                                                const gchar          *icon_name,
                                                                XfpmNotifyUrgency     urgency);
+void                xfpm_notify_post                          (XfpmNotify           *notify,
+                                                               XfpmNotifyCategory    category,
+                                                               const gchar          *key,
+                                                               const gchar          *title,
+                                                               const gchar          *text,
+                                                               const gchar          *icon_name,
+                                                               XfpmNotifyUrgency     urgency);
+void                xfpm_notify_show_value                    (XfpmNotify           *notify,
+                                                               XfpmNotifyCategory    category,
+                                                               const gchar          *title,
+                                                               const gchar          *text,
+                                                               const gchar          *icon_name,
+                                                               gint                  value);
 NotifyNotification *xfpm_notify_new_notification              (XfpmNotify           *notify,
                                                                const gchar          *title,
                                                                const gchar          *text,
@@ -0,0 +1,310 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "xfpm-pkexec.h"
+#include "xfpm-debug.h"
+
+static void xfpm_pkexec_finalize   (GObject *object);
+
+/*
+ * Runs one of our privileged helpers through pkexec, one at a time.
+ * With XFPM_SYSFS_ROOT set the helper runs directly instead, pkexec
+ * would clear the variable and the helpers only accept it from a user
+ * writing to a fixture tree.
+ */
+
+struct XfpmPkexecPrivate
+{
+  gchar           *helper;
+  gboolean         direct;
+
+  GPid             pid;
+  /* Arguments of a run asked for while the helper was busy */
+  gchar          **queued;
+};
+
+enum
+{
+  FINISHED,
+  LAST_SIGNAL
+};
+
+static guint signals [LAST_SIGNAL] = { 0 };
+
+G_DEFINE_TYPE_WITH_PRIVATE (XfpmPkexec, xfpm_pkexec, G_TYPE_OBJECT)
+
+static gchar **
+xfpm_pkexec_build_argv (XfpmPkexec *pkexec, const gchar * const *args)
+{
+  GPtrArray *argv;
+  guint i;
+
+  argv = g_ptr_array_new ();
+
+  if ( !pkexec->priv->direct )
+    g_ptr_array_add (argv, g_strdup ("pkexec"));
+  g_ptr_array_add (argv, g_strdup (pkexec->priv->helper));
+
+  for ( i = 0; args[i] != NULL; i++ )
+    g_ptr_array_add (argv, g_strdup (args[i]));
+
+  g_ptr_array_add (argv, NULL);
+
+  return (gchar **) g_ptr_array_free (argv, FALSE);
+}
+
+static void xfpm_pkexec_spawn (XfpmPkexec *pkexec, const gchar * const *args);
+
+static void
+xfpm_pkexec_exited_cb (GPid pid, gint status, gpointer user_data)
+{
+  XfpmPkexec *pkexec = XFPM_PKEXEC (user_data);
+  GError *error = NULL;
+  gboolean success;
+
+  g_spawn_close_pid (pid);
+  pkexec->priv->pid = 0;
+
+  success = g_spawn_check_exit_status (status, &error);
+  if ( !success )
+  {
+    XFPM_DEBUG ("%s failed: %s", pkexec->priv->helper, error->message);
+    g_error_free (error);
+  }
+
+  if ( pkexec->priv->queued != NULL )
+  {
+    gchar **args = pkexec->priv->queued;
+
+    pkexec->priv->queued = NULL;
+    xfpm_pkexec_spawn (pkexec, (const gchar * const *) args);
+    g_strfreev (args);
+  }
+
+  g_signal_emit (G_OBJECT (pkexec), signals [FINISHED], 0, success);
+}
+
+static void
+xfpm_pkexec_spawn (XfpmPkexec *pkexec, const gchar * const *args)
+{
+  gchar **argv;
+  GError *error = NULL;
+
+  argv = xfpm_pkexec_build_argv (pkexec, args);
+
+  if ( g_spawn_async (NULL, argv, NULL,
+                      G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
+                      G_SPAWN_STDOUT_TO_DEV_NULL | G_SPAWN_STDERR_TO_DEV_NULL,
+                      NULL, NULL, &pkexec->priv->pid, &error) )
+  {
+    /* Keeps us around until the helper is gone */
+    g_child_watch_add_full (G_PRIORITY_DEFAULT,
+                            pkexec->priv->pid,
+                            xfpm_pkexec_exited_cb,
+                            g_object_ref (pkexec),
+                            g_object_unref);
+  }
+  else
+  {
+    g_warning ("Unable to run %s: %s", pkexec->priv->helper, error->message);
+    g_error_free (error);
+  }
+
+  g_strfreev (argv);
+}
+
+static void
+xfpm_pkexec_class_init (XfpmPkexecClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = xfpm_pkexec_finalize;
+
+  /**
+   * XfpmPkexec::finished:
+   * @success: whether the helper exited with 0
+   *
+   * Emitted when a run started with xfpm_pkexec_run() is over.
+   **/
+  signals [FINISHED] =
+    g_signal_new ("finished",
+                  XFPM_TYPE_PKEXEC,
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (XfpmPkexecClass, finished),
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__BOOLEAN,
+                  G_TYPE_NONE, 1, G_TYPE_BOOLEAN);
+}
+
+static void
+xfpm_pkexec_init (XfpmPkexec *pkexec)
+{
+  const gchar *root;
+
+  pkexec->priv = xfpm_pkexec_get_instance_private (pkexec);
+
+  root = g_getenv ("XFPM_SYSFS_ROOT");
+  pkexec->priv->direct = root != NULL && *root != '\0';
+}
+
+static void
+xfpm_pkexec_finalize (GObject *object)
+{
+  XfpmPkexec *pkexec;
+
+  pkexec = XFPM_PKEXEC (object);
+
+  g_strfreev (pkexec->priv->queued);
+  g_free (pkexec->priv->helper);
+
+  G_OBJECT_CLASS (xfpm_pkexec_parent_class)->finalize (object);
+}
+
+XfpmPkexec *
+xfpm_pkexec_new (const gchar *helper)
+{
+  XfpmPkexec *pkexec;
+
+  pkexec = g_object_new (XFPM_TYPE_PKEXEC, NULL);
+  pkexec->priv->helper = g_strdup (helper);
+
+  return pkexec;
+}
+
+gboolean
+xfpm_pkexec_is_installed (XfpmPkexec *pkexec)
+{
+  g_return_val_if_fail (XFPM_IS_PKEXEC (pkexec), FALSE);
+
+  return g_file_test (pkexec->priv->helper, G_FILE_TEST_IS_EXECUTABLE);
+}
+
+gboolean
+xfpm_pkexec_is_running (XfpmPkexec *pkexec)
+{
+  g_return_val_if_fail (XFPM_IS_PKEXEC (pkexec), FALSE);
+
+  return pkexec->priv->pid != 0;
+}
+
+/**
+ * xfpm_pkexec_run:
+ * @args: the helper's arguments, %NULL terminated
+ *
+ * Starts the helper without waiting for it, XfpmPkexec::finished
+ * tells when it is done. While it is running a new run is queued,
+ * only the newest one is kept.
+ **/
+void
+xfpm_pkexec_run (XfpmPkexec *pkexec, const gchar * const *args)
+{
+  g_return_if_fail (XFPM_IS_PKEXEC (pkexec));
+
+  if ( pkexec->priv->pid != 0 )
+  {
+    g_strfreev (pkexec->priv->queued);
+    pkexec->priv->queued = g_strdupv ((gchar **) args);
+    return;
+  }
+
+  xfpm_pkexec_spawn (pkexec, args);
+}
+
+/**
+ * xfpm_pkexec_run_sync:
+ * @args: the helper's arguments, %NULL terminated
+ *
+ * Runs the helper and waits for it, for when the result has to be in
+ * place before going on or there is no main loop left.
+ *
+ * Returns: %FALSE with @error set to what the helper printed, if
+ *          anything, when it failed
+ **/
+gboolean
+xfpm_pkexec_run_sync (XfpmPkexec *pkexec, const gchar * const *args, GError **error)
+{
+  gchar **argv;
+  gchar *output = NULL;
+  GError *local_error = NULL;
+  gint status;
+  gboolean ret;
+
+  g_return_val_if_fail (XFPM_IS_PKEXEC (pkexec), FALSE);
+
+  argv = xfpm_pkexec_build_argv (pkexec, args);
+
+  ret = g_spawn_sync (NULL, argv, NULL,
+                      G_SPAWN_SEARCH_PATH | G_SPAWN_STDERR_TO_DEV_NULL,
+                      NULL, NULL, &output, NULL, &status, error);
+
+  if ( ret && !g_spawn_check_exit_status (status, &local_error) )
+  {
+    /* The helpers say on stdout what they didn't like */
+    if ( output != NULL && *g_strstrip (output) != '\0' )
+    {
+      g_set_error_literal (error, local_error->domain, local_error->code, output);
+      g_error_free (local_error);
+    }
+    else
+    {
+      g_propagate_error (error, local_error);
+    }
+
+    ret = FALSE;
+  }
+
+  g_free (output);
+  g_strfreev (argv);
+
+  return ret;
+}
+
+/**
+ * xfpm_pkexec_batch_args:
+ * @command: the helper command, e.g. "cpufreq"
+ * @option: the option repeated for each value, e.g. "--policy"
+ * @values: strings
+ *
+ * Returns: the arguments for one helper run covering all @values
+ **/
+gchar **
+xfpm_pkexec_batch_args (const gchar *command, const gchar *option, GPtrArray *values)
+{
+  gchar **args;
+  guint i;
+
+  args = g_new0 (gchar *, 2 * values->len + 2);
+  args[0] = g_strdup (command);
+
+  for ( i = 0; i < values->len; i++ )
+  {
+    args[2 * i + 1] = g_strdup (option);
+    args[2 * i + 2] = g_strdup (g_ptr_array_index (values, i));
+  }
+
+  return args;
+}
@@ -0,0 +1,66 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __XFPM_PKEXEC_H
+#define __XFPM_PKEXEC_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+/* Writes the cpufreq and runtime PM attributes, see xfpm-sysfs-helper.c */
+#define XFPM_SYSFS_HELPER       SBINDIR "/xfpm-power-sysfs-helper"
+
+#define XFPM_TYPE_PKEXEC        (xfpm_pkexec_get_type () )
+#define XFPM_PKEXEC(o)          (G_TYPE_CHECK_INSTANCE_CAST((o), XFPM_TYPE_PKEXEC, XfpmPkexec))
+#define XFPM_IS_PKEXEC(o)       (G_TYPE_CHECK_INSTANCE_TYPE((o), XFPM_TYPE_PKEXEC))
+
+typedef struct XfpmPkexecPrivate XfpmPkexecPrivate;
+
+typedef struct
+{
+  GObject               parent;
+  XfpmPkexecPrivate    *priv;
+} XfpmPkexec;
+
+typedef struct
+{
+  GObjectClass          parent_class;
+
+  void                  (*finished)             (XfpmPkexec *pkexec,
+                                                 gboolean    success);
+} XfpmPkexecClass;
+
+GType              xfpm_pkexec_get_type         (void) G_GNUC_CONST;
+XfpmPkexec        *xfpm_pkexec_new              (const gchar         *helper);
+gboolean           xfpm_pkexec_is_installed     (XfpmPkexec          *pkexec);
+gboolean           xfpm_pkexec_is_running       (XfpmPkexec          *pkexec);
+void               xfpm_pkexec_run              (XfpmPkexec          *pkexec,
+                                                 const gchar * const *args);
+gboolean           xfpm_pkexec_run_sync         (XfpmPkexec          *pkexec,
+                                                 const gchar * const *args,
+                                                 GError             **error);
+gchar            **xfpm_pkexec_batch_args       (const gchar         *command,
+                                                 const gchar         *option,
+                                                 GPtrArray           *values) G_GNUC_MALLOC;
+
+G_END_DECLS
+
+#endif /* __XFPM_PKEXEC_H */
@@ -127,6 +127,91 @@ run (const gchar *command)
   return (WIFEXITED (status) && WEXITSTATUS (status) == 0);
 }
 
+/*
+ * The kernel shrinks the hibernation image to about this many bytes by
+ * dropping page cache, so a smaller value trades caches for write time.
+ */
+static gboolean
+set_image_size (const gchar *root, gint64 image_size)
+{
+  gchar *filename;
+  gchar *value;
+  FILE *file;
+  gboolean ret = TRUE;
+
+  filename = g_build_filename (root, "power", "image_size", NULL);
+  value = g_strdup_printf ("%" G_GINT64_FORMAT, image_size);
+
+  file = fopen (filename, "w");
+  if (file == NULL)
+    ret = FALSE;
+  else
+  {
+    if (fputs (value, file) < 0)
+      ret = FALSE;
+    if (fclose (file) != 0)
+      ret = FALSE;
+  }
+
+  if (!ret)
+    g_print ("Could not write %s to %s\n", value, filename);
+
+  g_free (filename);
+  g_free (value);
+  return ret;
+}
+
+/*
+ * Arms the RTC to wake the system after that many seconds, 0 only
+ * clears it. The kernel refuses a new alarm while one is pending.
+ */
+static gboolean
+set_wake_alarm (const gchar *root, gint64 seconds)
+{
+  gchar *filename;
+  gchar *value;
+  FILE *file;
+  gboolean ret = TRUE;
+
+  filename = g_build_filename (root, "class", "rtc", "rtc0", "wakealarm", NULL);
+
+  file = fopen (filename, "w");
+  if (file == NULL)
+  {
+    g_print ("Could not open %s\n", filename);
+    g_free (filename);
+    return FALSE;
+  }
+  if (fputs ("0", file) < 0)
+    ret = FALSE;
+  if (fclose (file) != 0)
+    ret = FALSE;
+
+  if (ret && seconds > 0)
+  {
+    value = g_strdup_printf ("+%" G_GINT64_FORMAT, seconds);
+
+    file = fopen (filename, "w");
+    if (file == NULL)
+      ret = FALSE;
+    else
+    {
+      if (fputs (value, file) < 0)
+        ret = FALSE;
+      if (fclose (file) != 0)
+        ret = FALSE;
+    }
+
+    g_free (value);
+  }
+
+  if (!ret)
+    g_print ("Could not set the wake alarm in %s\n", filename);
+
+  g_free (filename);
+  return ret;
+}
+
 
 int
 main (int argc, char **argv)
@@ -137,10 +222,15 @@ main (int argc, char **argv)
   const gchar *pkexec_uid_str;
   gboolean suspend = FALSE;
   gboolean hibernate = FALSE;
+  gint64 image_size = -1;
+  gint64 wake_alarm = -1;
+  const gchar *root;
 
   const GOptionEntry options[] = {
     { "suspend",   '\0', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_NONE, &suspend, "Suspend the system", NULL },
     { "hibernate", '\0', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_NONE, &hibernate, "Hibernate the system", NULL },
+    { "image-size", '\0', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_INT64, &image_size, "Set the preferred hibernation image size in bytes", NULL },
+    { "wake-alarm", '\0', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_INT64, &wake_alarm, "Wake the system after that many seconds, 0 clears the alarm", NULL },
     { NULL }
   };
 
@@ -151,29 +241,46 @@ main (int argc, char **argv)
   g_option_context_free (context);
 
   /* no input */
-  if (!suspend && !hibernate)
+  if (!suspend && !hibernate && image_size < 0 && wake_alarm < 0)
   {
     puts ("No valid option was specified");
     return EXIT_CODE_ARGUMENTS_INVALID;
   }
 
-  /* get calling process */
-  uid = getuid ();
-  euid = geteuid ();
-  if (uid != 0 || euid != 0)
+  /* pkexec clears the environment, a sysfs root means a fake tree and
+   * then nothing but the sysfs values are touched */
+  root = g_getenv ("XFPM_SYSFS_ROOT");
+  if (root == NULL || *root == '\0' || suspend || hibernate)
   {
-    puts ("This program can only be used by the root user");
-    return EXIT_CODE_ARGUMENTS_INVALID;
-  }
+    root = "/sys";
 
-  /* check we're not being spoofed */
-  pkexec_uid_str = g_getenv ("PKEXEC_UID");
-  if (pkexec_uid_str == NULL)
-  {
-    puts ("This program must only be run through pkexec");
-    return EXIT_CODE_INVALID_USER;
+    /* get calling process */
+    uid = getuid ();
+    euid = geteuid ();
+    if (uid != 0 || euid != 0)
+    {
+      puts ("This program can only be used by the root user");
+      return EXIT_CODE_ARGUMENTS_INVALID;
+    }
+
+    /* check we're not being spoofed */
+    pkexec_uid_str = g_getenv ("PKEXEC_UID");
+    if (pkexec_uid_str == NULL)
+    {
+      puts ("This program must only be run through pkexec");
+      return EXIT_CODE_INVALID_USER;
+    }
   }
 
+  if (image_size >= 0 && !set_image_size (root, image_size))
+    return EXIT_CODE_FAILED;
+
+  if (wake_alarm >= 0 && !set_wake_alarm (root, wake_alarm))
+    return EXIT_CODE_FAILED;
+
+  if (!suspend && !hibernate)
+    return EXIT_CODE_SUCCESS;
+
   /* run the command */
   if(suspend)
   {
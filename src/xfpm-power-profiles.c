@@ -0,0 +1,499 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <gio/gio.h>
+
+#include <libxfce4util/libxfce4util.h>
+
+#include "xfpm-power-profiles.h"
+#include "xfpm-power.h"
+#include "xfpm-xfconf.h"
+#include "xfpm-config.h"
+#include "xfpm-debug.h"
+
+static void xfpm_power_profiles_finalize   (GObject *object);
+
+#define PPD_NAME       "net.hadess.PowerProfiles"
+#define PPD_PATH       "/net/hadess/PowerProfiles"
+#define PPD_INTERFACE  "net.hadess.PowerProfiles"
+
+struct XfpmPowerProfilesPrivate
+{
+  XfpmPower       *power;
+  XfpmXfconf      *conf;
+  GDBusProxy      *proxy;
+
+  gboolean         on_battery;
+  gboolean         on_low_battery;
+  gboolean         hot;
+
+  /* Last profile we asked for and how many of our sets haven't
+   * returned. A change to another profile only comes from the user or
+   * another client when none are left, before that it can be the echo
+   * of an earlier set */
+  gchar           *requested;
+  guint            pending;
+  /* Profile picked by the user since the last power source change */
+  gchar           *manual;
+  /* Profile to go back to on exit */
+  gchar           *original;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (XfpmPowerProfiles, xfpm_power_profiles, G_TYPE_OBJECT)
+
+static gchar *
+xfpm_power_profiles_get_active (XfpmPowerProfiles *profiles)
+{
+  GVariant *active;
+  gchar *ret = NULL;
+
+  active = g_dbus_proxy_get_cached_property (profiles->priv->proxy, "ActiveProfile");
+
+  if ( active != NULL )
+  {
+    if ( g_variant_is_of_type (active, G_VARIANT_TYPE_STRING) )
+      ret = g_variant_dup_string (active, NULL);
+    g_variant_unref (active);
+  }
+
+  return ret;
+}
+
+static gboolean
+xfpm_power_profiles_is_available (XfpmPowerProfiles *profiles, const gchar *profile)
+{
+  GVariant *list;
+  GVariantIter iter;
+  GVariant *dict;
+  gboolean found = FALSE;
+
+  list = g_dbus_proxy_get_cached_property (profiles->priv->proxy, "Profiles");
+
+  /* Let the daemon decide if it doesn't tell us */
+  if ( list == NULL )
+    return TRUE;
+
+  if ( g_variant_is_of_type (list, G_VARIANT_TYPE ("aa{sv}")) )
+  {
+    g_variant_iter_init (&iter, list);
+    while ( !found && (dict = g_variant_iter_next_value (&iter)) != NULL )
+    {
+      const gchar *name;
+
+      if ( g_variant_lookup (dict, "Profile", "&s", &name) )
+        found = g_strcmp0 (name, profile) == 0;
+
+      g_variant_unref (dict);
+    }
+  }
+  else
+  {
+    found = TRUE;
+  }
+
+  g_variant_unref (list);
+
+  return found;
+}
+
+static void
+xfpm_power_profiles_set_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  XfpmPowerProfiles *profiles = XFPM_POWER_PROFILES (user_data);
+  GVariant *ret;
+  GError *error = NULL;
+
+  ret = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+
+  profiles->priv->pending--;
+
+  if ( ret == NULL )
+  {
+    g_warning ("Unable to switch the power profile: %s", error->message);
+    g_error_free (error);
+  }
+  else
+  {
+    g_variant_unref (ret);
+  }
+
+  g_object_unref (profiles);
+}
+
+static void
+xfpm_power_profiles_set (XfpmPowerProfiles *profiles, const gchar *profile, gboolean wait)
+{
+  XFPM_DEBUG ("Switching power profile to %s", profile);
+
+  g_free (profiles->priv->requested);
+  profiles->priv->requested = g_strdup (profile);
+
+  if ( wait )
+  {
+    /* Only used on exit, where there is no main loop left to wait in */
+    GVariant *ret;
+
+    ret = g_dbus_proxy_call_sync (profiles->priv->proxy,
+                                  "org.freedesktop.DBus.Properties.Set",
+                                  g_variant_new ("(ssv)", PPD_INTERFACE, "ActiveProfile",
+                                                 g_variant_new_string (profile)),
+                                  G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                                  1000, NULL, NULL);
+    if ( ret != NULL )
+      g_variant_unref (ret);
+    return;
+  }
+
+  profiles->priv->pending++;
+
+  g_dbus_proxy_call (profiles->priv->proxy,
+                     "org.freedesktop.DBus.Properties.Set",
+                     g_variant_new ("(ssv)", PPD_INTERFACE, "ActiveProfile",
+                                    g_variant_new_string (profile)),
+                     G_DBUS_CALL_FLAGS_NONE,
+                     -1, NULL,
+                     xfpm_power_profiles_set_cb,
+                     g_object_ref (profiles));
+}
+
+/*
+ * Critical charge wins over everything, then running too hot, then a
+ * profile the user picked since the last power source change, then
+ * the AC/battery setting.
+ * An empty setting goes back to the profile the user had.
+ */
+static void
+xfpm_power_profiles_apply (XfpmPowerProfiles *profiles)
+{
+  const XfpmConfig *config;
+  const gchar *target = NULL;
+  const gchar *current;
+  gchar *active;
+
+  if ( profiles->priv->proxy == NULL )
+    return;
+
+  active = xfpm_power_profiles_get_active (profiles);
+
+  /* Daemon not running */
+  if ( active == NULL )
+    return;
+
+  if ( profiles->priv->original == NULL )
+    profiles->priv->original = g_strdup (active);
+
+  config = xfpm_xfconf_get_config (profiles->priv->conf);
+
+  if ( profiles->priv->on_low_battery )
+    target = config->profile_on_critical;
+
+  if ( (target == NULL || *target == '\0') && profiles->priv->hot )
+    target = config->profile_on_hot;
+
+  if ( target == NULL || *target == '\0' )
+  {
+    if ( profiles->priv->manual != NULL )
+      target = profiles->priv->manual;
+    else
+      target = profiles->priv->on_battery ? config->profile_on_battery : config->profile_on_ac;
+  }
+
+  if ( target == NULL || *target == '\0' )
+    target = profiles->priv->original;
+
+  /* The cached profile is stale while a set is on its way */
+  current = profiles->priv->pending > 0 ? profiles->priv->requested : active;
+
+  if ( g_strcmp0 (target, current) == 0 )
+  {
+    g_free (profiles->priv->requested);
+    profiles->priv->requested = g_strdup (target);
+  }
+  else if ( !xfpm_power_profiles_is_available (profiles, target) )
+  {
+    XFPM_DEBUG ("Power profile %s is not available", target);
+  }
+  else
+  {
+    xfpm_power_profiles_set (profiles, target, FALSE);
+  }
+
+  g_free (active);
+}
+
+static void
+xfpm_power_profiles_properties_changed_cb (GDBusProxy *proxy,
+                                           GVariant *changed,
+                                           GStrv invalidated,
+                                           XfpmPowerProfiles *profiles)
+{
+  const gchar *active;
+
+  if ( !g_variant_lookup (changed, "ActiveProfile", "&s", &active) )
+    return;
+
+  if ( g_strcmp0 (active, profiles->priv->requested) == 0 )
+    return;
+
+  if ( profiles->priv->pending > 0 )
+  {
+    XFPM_DEBUG ("Power profile changed to %s while %u of our switches are pending",
+                active, profiles->priv->pending);
+    return;
+  }
+
+  /* Keep the user's choice until the power source changes, and go
+   * back to it on exit */
+  XFPM_DEBUG ("Power profile changed to %s outside of the power manager", active);
+
+  g_free (profiles->priv->manual);
+  profiles->priv->manual = g_strdup (active);
+
+  g_free (profiles->priv->original);
+  profiles->priv->original = g_strdup (active);
+
+  g_free (profiles->priv->requested);
+  profiles->priv->requested = g_strdup (active);
+}
+
+static void
+xfpm_power_profiles_name_owner_changed_cb (GDBusProxy *proxy,
+                                           GParamSpec *pspec,
+                                           XfpmPowerProfiles *profiles)
+{
+  gchar *owner;
+
+  owner = g_dbus_proxy_get_name_owner (proxy);
+
+  XFPM_DEBUG ("power-profiles-daemon %s", owner != NULL ? "appeared" : "vanished");
+
+  /* The daemon starts with its own saved profile */
+  g_clear_pointer (&profiles->priv->requested, g_free);
+
+  if ( owner != NULL )
+    xfpm_power_profiles_apply (profiles);
+
+  g_free (owner);
+}
+
+static void
+xfpm_power_profiles_proxy_ready_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+  XfpmPowerProfiles *profiles = XFPM_POWER_PROFILES (user_data);
+  GError *error = NULL;
+
+  profiles->priv->proxy = g_dbus_proxy_new_for_bus_finish (res, &error);
+
+  if ( profiles->priv->proxy == NULL )
+  {
+    g_warning ("Unable to get the interface, %s : %s", PPD_INTERFACE, error->message);
+    g_error_free (error);
+    g_object_unref (profiles);
+    return;
+  }
+
+  g_signal_connect (profiles->priv->proxy, "g-properties-changed",
+                    G_CALLBACK (xfpm_power_profiles_properties_changed_cb), profiles);
+  g_signal_connect (profiles->priv->proxy, "notify::g-name-owner",
+                    G_CALLBACK (xfpm_power_profiles_name_owner_changed_cb), profiles);
+
+  xfpm_power_profiles_apply (profiles);
+
+  g_object_unref (profiles);
+}
+
+static void
+xfpm_power_profiles_on_battery_changed_cb (XfpmPower *power,
+                                           gboolean on_battery,
+                                           XfpmPowerProfiles *profiles)
+{
+  if ( profiles->priv->on_battery == on_battery )
+    return;
+
+  profiles->priv->on_battery = on_battery;
+
+  /* A new power source, the settings take over again */
+  g_clear_pointer (&profiles->priv->manual, g_free);
+
+  xfpm_power_profiles_apply (profiles);
+}
+
+static void
+xfpm_power_profiles_low_battery_changed_cb (XfpmPower *power,
+                                            gboolean low_battery,
+                                            XfpmPowerProfiles *profiles)
+{
+  if ( profiles->priv->on_low_battery == low_battery )
+    return;
+
+  profiles->priv->on_low_battery = low_battery;
+
+  xfpm_power_profiles_apply (profiles);
+}
+
+static void
+xfpm_power_profiles_settings_changed_cb (XfpmXfconf *conf,
+                                         const gchar **keys,
+                                         XfpmPowerProfiles *profiles)
+{
+  guint i;
+
+  for ( i = 0; keys[i] != NULL; i++ )
+  {
+    if ( g_str_has_prefix (keys[i], "profile-on-") )
+    {
+      /* A new setting replaces whatever the user picked by hand */
+      g_clear_pointer (&profiles->priv->manual, g_free);
+      xfpm_power_profiles_apply (profiles);
+      return;
+    }
+  }
+}
+
+static void
+xfpm_power_profiles_class_init (XfpmPowerProfilesClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = xfpm_power_profiles_finalize;
+}
+
+static void
+xfpm_power_profiles_init (XfpmPowerProfiles *profiles)
+{
+  profiles->priv = xfpm_power_profiles_get_instance_private (profiles);
+
+  profiles->priv->power = xfpm_power_get ();
+  profiles->priv->conf = xfpm_xfconf_new ();
+
+  g_object_get (G_OBJECT (profiles->priv->power),
+                "on-battery", &profiles->priv->on_battery,
+                "on-low-battery", &profiles->priv->on_low_battery,
+                NULL);
+
+  g_signal_connect (profiles->priv->power, "on-battery-changed",
+                    G_CALLBACK (xfpm_power_profiles_on_battery_changed_cb), profiles);
+  g_signal_connect (profiles->priv->power, "low-battery-changed",
+                    G_CALLBACK (xfpm_power_profiles_low_battery_changed_cb), profiles);
+  g_signal_connect (profiles->priv->conf, "config-changed",
+                    G_CALLBACK (xfpm_power_profiles_settings_changed_cb), profiles);
+
+  /* Don't activate the daemon if it isn't running, we follow it once
+   * it appears. DBUS_SYSTEM_BUS_ADDRESS can point this at a mock. */
+  g_dbus_proxy_new_for_bus (G_BUS_TYPE_SYSTEM,
+                            G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                            NULL,
+                            PPD_NAME,
+                            PPD_PATH,
+                            PPD_INTERFACE,
+                            NULL,
+                            xfpm_power_profiles_proxy_ready_cb,
+                            g_object_ref (profiles));
+}
+
+static void
+xfpm_power_profiles_finalize (GObject *object)
+{
+  XfpmPowerProfiles *profiles;
+
+  profiles = XFPM_POWER_PROFILES (object);
+
+  g_signal_handlers_disconnect_by_data (profiles->priv->power, profiles);
+  g_signal_handlers_disconnect_by_data (profiles->priv->conf, profiles);
+
+  if ( profiles->priv->proxy != NULL )
+  {
+    g_signal_handlers_disconnect_by_data (profiles->priv->proxy, profiles);
+    g_object_unref (profiles->priv->proxy);
+  }
+
+  g_object_unref (profiles->priv->power);
+  g_object_unref (profiles->priv->conf);
+
+  g_free (profiles->priv->requested);
+  g_free (profiles->priv->manual);
+  g_free (profiles->priv->original);
+
+  G_OBJECT_CLASS (xfpm_power_profiles_parent_class)->finalize (object);
+}
+
+XfpmPowerProfiles *
+xfpm_power_profiles_new (void)
+{
+  return g_object_new (XFPM_TYPE_POWER_PROFILES, NULL);
+}
+
+/**
+ * xfpm_power_profiles_set_hot:
+ * @hot: whether the system is running too hot
+ *
+ * Switches to profile-on-hot while @hot, the profile picked by the user
+ * or the settings comes back once it cools down.
+ **/
+void
+xfpm_power_profiles_set_hot (XfpmPowerProfiles *profiles, gboolean hot)
+{
+  g_return_if_fail (XFPM_IS_POWER_PROFILES (profiles));
+
+  if ( profiles->priv->hot == hot )
+    return;
+
+  profiles->priv->hot = hot;
+
+  xfpm_power_profiles_apply (profiles);
+}
+
+/**
+ * xfpm_power_profiles_restore:
+ *
+ * Puts back the profile the user had before the power manager changed
+ * it, or the last one they picked. Blocks for at most a second, it is
+ * meant to be called when the power manager quits.
+ **/
+void
+xfpm_power_profiles_restore (XfpmPowerProfiles *profiles)
+{
+  gchar *active;
+
+  g_return_if_fail (XFPM_IS_POWER_PROFILES (profiles));
+
+  if ( profiles->priv->proxy == NULL || profiles->priv->original == NULL )
+    return;
+
+  active = xfpm_power_profiles_get_active (profiles);
+
+  if ( active != NULL && g_strcmp0 (active, profiles->priv->original) != 0 )
+    xfpm_power_profiles_set (profiles, profiles->priv->original, TRUE);
+
+  g_free (active);
+}
@@ -0,0 +1,54 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __XFPM_POWER_PROFILES_H
+#define __XFPM_POWER_PROFILES_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define XFPM_TYPE_POWER_PROFILES        (xfpm_power_profiles_get_type () )
+#define XFPM_POWER_PROFILES(o)          (G_TYPE_CHECK_INSTANCE_CAST((o), XFPM_TYPE_POWER_PROFILES, XfpmPowerProfiles))
+#define XFPM_IS_POWER_PROFILES(o)       (G_TYPE_CHECK_INSTANCE_TYPE((o), XFPM_TYPE_POWER_PROFILES))
+
+typedef struct XfpmPowerProfilesPrivate XfpmPowerProfilesPrivate;
+
+typedef struct
+{
+  GObject                    parent;
+  XfpmPowerProfilesPrivate  *priv;
+} XfpmPowerProfiles;
+
+typedef struct
+{
+  GObjectClass               parent_class;
+} XfpmPowerProfilesClass;
+
+GType              xfpm_power_profiles_get_type     (void) G_GNUC_CONST;
+XfpmPowerProfiles *xfpm_power_profiles_new          (void);
+void               xfpm_power_profiles_restore      (XfpmPowerProfiles *profiles);
+void               xfpm_power_profiles_set_hot      (XfpmPowerProfiles *profiles,
+                                                     gboolean           hot);
+
+G_END_DECLS
+
+#endif /* __XFPM_POWER_PROFILES_H */
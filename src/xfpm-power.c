@@ -56,10 +56,12 @@
 #include "xfpm-power-common.h"
 #include "xfpm-config.h"
 #include "xfpm-debug.h"
+#include "xfpm-journal.h"
 #include "xfpm-enum-types.h"
 #include "egg-idletime.h"
 #include "xfpm-systemd.h"
 #include "xfpm-suspend.h"
+#include "xfpm-hibernate.h"
 #include "xfpm-brightness.h"
 #include "xfce-screensaver.h"
 
@@ -86,6 +88,8 @@ static void xfpm_power_dbus_init (XfpmPower *power);
 struct XfpmPowerPrivate
 {
   GDBusConnection  *bus;
+  /* Devices, properties and sleep capabilities are known */
+  gboolean          ready;
 
   UpClient         *upower;
 
@@ -111,6 +115,9 @@ struct XfpmPowerPrivate
   XfceScreenSaver  *screensaver;
 
   XfpmNotify       *notify;
+  /* CPU energy counters, NULL when there are none we can read */
+  XfpmRapl         *rapl;
+  XfpmHibernate    *hibernate;
 #ifdef ENABLE_POLKIT
   XfpmPolkit       *polkit;
 #endif
@@ -158,6 +165,7 @@ enum
   SLEEPING,
   ASK_SHUTDOWN,
   SHUTDOWN,
+  READY,
   LAST_SIGNAL
 };
 
@@ -245,6 +253,7 @@ xfpm_power_check_power (XfpmPower *power, gboolean on_battery)
   {
     GList *list;
     guint len, i;
+    xfpm_journal_log (XFPM_JOURNAL_AC, !on_battery, NULL);
     g_signal_emit (G_OBJECT (power), signals [ON_BATTERY_CHANGED], 0, on_battery);
 
     xfpm_dpms_set_on_battery (power->priv->dpms, on_battery);
@@ -275,6 +284,7 @@ xfpm_power_check_lid (XfpmPower *power, gboolean present, gboolean closed)
     if (closed != power->priv->lid_is_closed )
     {
       power->priv->lid_is_closed = closed;
+      xfpm_journal_log (XFPM_JOURNAL_LID, closed, NULL);
       g_signal_emit (G_OBJECT (power), signals [LID_CHANGED], 0, power->priv->lid_is_closed);
     }
   }
@@ -371,6 +381,9 @@ xfpm_power_sleep (XfpmPower *power, const gchar *sleep_time, gboolean force)
 #endif
   XfpmBrightness *brightness;
   gint32 brightness_level;
+  gboolean hibernate;
+
+  hibernate = g_strcmp0 (sleep_time, "Hibernate") == 0;
 
   if ( power->priv->inhibited && force == FALSE)
   {
@@ -384,11 +397,15 @@ xfpm_power_sleep (XfpmPower *power, const gchar *sleep_time, gboolean force)
                                      _("An application is currently disabling the automatic sleep. "
                                        "Doing this action now may damage the working state of this application.\n"
                                        "Are you sure you want to hibernate the system?"));
-  ret = gtk_dialog_run (GTK_DIALOG (dialog));
-  gtk_widget_destroy (dialog);
+    ret = gtk_dialog_run (GTK_DIALOG (dialog));
+    gtk_widget_destroy (dialog);
 
-  if ( !ret || ret == GTK_RESPONSE_NO)
-    return;
+    if ( !ret || ret == GTK_RESPONSE_NO)
+    {
+      xfpm_journal_log (XFPM_JOURNAL_SLEEP_BLOCKED,
+                        hibernate ? XFPM_DO_HIBERNATE : XFPM_DO_SUSPEND, "declined");
+      return;
+    }
   }
 
   g_signal_emit (G_OBJECT (power), signals [SLEEPING], 0);
@@ -439,9 +456,37 @@ xfpm_power_sleep (XfpmPower *power, const gchar *sleep_time, gboolean force)
       gtk_widget_destroy (dialog);
 
       if ( !ret || ret == GTK_RESPONSE_NO)
+      {
+        xfpm_journal_log (XFPM_JOURNAL_SLEEP_BLOCKED,
+                          hibernate ? XFPM_DO_HIBERNATE : XFPM_DO_SUSPEND, "lock-failed");
         return;
       }
     }
+  }
+
+  /* Sizes the image or arms the wake alarm, and times the attempt */
+  if ( hibernate )
+  {
+    xfpm_hibernate_begin (power->priv->hibernate);
+  }
+  else
+  {
+    gboolean then_hibernate;
+    gboolean by_logind = FALSE;
+
+    then_hibernate = xfpm_xfconf_get_config (power->priv->conf)->suspend_then_hibernate &&
+                     power->priv->can_hibernate && power->priv->auth_hibernate;
+
+    /* logind checks the battery on its own timed wake */
+    if ( then_hibernate && power->priv->systemd != NULL &&
+         xfpm_systemd_can_suspend_then_hibernate (power->priv->systemd) )
+    {
+      sleep_time = "SuspendThenHibernate";
+      by_logind = TRUE;
+    }
+
+    xfpm_hibernate_suspend_begin (power->priv->hibernate, then_hibernate, by_logind);
+  }
 
     /* This is fun, here's the order of operations:
      * - if the Logind is running then use it
@@ -479,6 +524,10 @@ xfpm_power_sleep (XfpmPower *power, const gchar *sleep_time, gboolean force)
     }
   }
 
+  xfpm_hibernate_end (power->priv->hibernate,
+                      error != NULL && !g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_NO_REPLY)
+                      ? error : NULL);
+
   if ( error )
   {
     if ( g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_NO_REPLY) )
@@ -506,11 +555,42 @@ xfpm_power_sleep (XfpmPower *power, const gchar *sleep_time, gboolean force)
 #endif
 }
 
+/*
+ * Timed wake of a suspend-then-hibernate cycle, nobody is in front of
+ * the machine so no dialogs and nothing against an open lid or an
+ * application keeping the system awake.
+ */
+static void
+xfpm_power_sleep_request_cb (XfpmHibernate *hibernate, const gchar *sleep_time, XfpmPower *power)
+{
+  XfpmShutdownRequest req;
+
+  req = g_strcmp0 (sleep_time, "Hibernate") == 0 ? XFPM_DO_HIBERNATE : XFPM_DO_SUSPEND;
+  xfpm_journal_log (XFPM_JOURNAL_SLEEP_REQUEST, req, "timed-wake");
+
+  if ( power->priv->inhibited )
+  {
+    XFPM_DEBUG ("Sleep inhibited, staying awake");
+    xfpm_journal_log (XFPM_JOURNAL_SLEEP_BLOCKED, req, "inhibited");
+    return;
+  }
+
+  if ( power->priv->lid_is_present && !power->priv->lid_is_closed )
+  {
+    XFPM_DEBUG ("Lid opened during the timed wake, staying awake");
+    xfpm_journal_log (XFPM_JOURNAL_SLEEP_BLOCKED, req, "lid-open");
+    return;
+  }
+
+  xfpm_power_sleep (power, sleep_time, TRUE);
+}
+
 static void
 xfpm_power_hibernate_clicked (XfpmPower *power)
 {
   gtk_widget_destroy (power->priv->dialog );
   power->priv->dialog = NULL;
+  xfpm_journal_log (XFPM_JOURNAL_SLEEP_REQUEST, XFPM_DO_HIBERNATE, "critical-dialog");
   xfpm_power_sleep (power, "Hibernate", TRUE);
 }
 
@@ -519,6 +599,7 @@ xfpm_power_suspend_clicked (XfpmPower *power)
 {
   gtk_widget_destroy (power->priv->dialog );
   power->priv->dialog = NULL;
+  xfpm_journal_log (XFPM_JOURNAL_SLEEP_REQUEST, XFPM_DO_SUSPEND, "critical-dialog");
   xfpm_power_sleep (power, "Suspend", TRUE);
 }
 
@@ -568,7 +649,12 @@ xfpm_power_notify_action_callback (NotifyNotification *n, gchar *action, XfpmPow
   if ( !g_strcmp0 (action, "Shutdown") )
     g_signal_emit (G_OBJECT (power), signals [SHUTDOWN], 0);
   else
+  {
+    xfpm_journal_log (XFPM_JOURNAL_SLEEP_REQUEST,
+                      g_strcmp0 (action, "Hibernate") == 0 ? XFPM_DO_HIBERNATE : XFPM_DO_SUSPEND,
+                      "notification");
     xfpm_power_sleep (power, action, TRUE);
+  }
 }
 
 static void
@@ -751,6 +837,8 @@ xfpm_power_show_critical_action (XfpmPower *power, XfpmBattery *battery)
 static void
 xfpm_power_process_critical_action (XfpmPower *power, XfpmShutdownRequest req)
 {
+  xfpm_journal_log (XFPM_JOURNAL_CRITICAL_ACTION, req, NULL);
+
   if ( req == XFPM_ASK )
     g_signal_emit (G_OBJECT (power), signals [ASK_SHUTDOWN], 0);
   else if ( req == XFPM_DO_SUSPEND )
@@ -766,9 +854,7 @@ xfpm_power_system_on_critical_power (XfpmPower *power, XfpmBattery *battery)
 {
   XfpmShutdownRequest critical_action;
 
-  g_object_get (G_OBJECT (power->priv->conf),
-                CRITICAL_BATT_ACTION_CFG, &critical_action,
-                NULL);
+  critical_action = xfpm_xfconf_get_config (power->priv->conf)->critical_action;
 
   XFPM_DEBUG ("System is running on low power");
   XFPM_DEBUG_ENUM (critical_action, XFPM_TYPE_SHUTDOWN_REQUEST, "Critical battery action");
@@ -810,6 +896,7 @@ xfpm_power_battery_charge_changed_cb (XfpmBattery *battery, XfpmPower *power)
     power->priv->critical_action_done = FALSE;
 
   power->priv->overall_state = current_charge;
+  xfpm_journal_log (XFPM_JOURNAL_BATTERY_LEVEL, current_charge, NULL);
 
   if ( current_charge == XFPM_BATTERY_CHARGE_CRITICAL && power->priv->on_battery)
   {
@@ -826,20 +913,20 @@ xfpm_power_battery_charge_changed_cb (XfpmBattery *battery, XfpmPower *power)
     g_signal_emit (G_OBJECT (power), signals [LOW_BATTERY_CHANGED], 0, power->priv->on_low_battery);
   }
 
-  g_object_get (G_OBJECT (power->priv->conf),
-                GENERAL_NOTIFICATION_CFG, &notify,
-                NULL);
+  notify = xfpm_xfconf_get_config (power->priv->conf)->general_notification;
 
   if ( power->priv->on_battery )
   {
     if ( current_charge == XFPM_BATTERY_CHARGE_LOW )
     {
       if ( notify )
-        xfpm_notify_show_notification (power->priv->notify,
-                       _("Power Manager"),
-                       _("System is running on low power"),
-                       xfpm_battery_get_icon_name (battery),
-                       XFPM_NOTIFY_NORMAL);
+        xfpm_notify_post (power->priv->notify,
+                          XFPM_NOTIFY_CATEGORY_LOW_BATTERY,
+                          "system",
+                          _("Power Manager"),
+                          _("System is running on low power"),
+                          xfpm_battery_get_icon_name (battery),
+                          XFPM_NOTIFY_NORMAL);
 
      }
     else if ( battery_charge == XFPM_BATTERY_CHARGE_LOW )
@@ -856,11 +943,14 @@ xfpm_power_battery_charge_changed_cb (XfpmBattery *battery, XfpmPower *power)
         msg = g_strdup_printf (_("Your %s charge level is low\nEstimated time left %s"), battery_name, time_str);
 
 
-        xfpm_notify_show_notification (power->priv->notify,
-                       _("Power Manager"),
-                       msg,
-                       xfpm_battery_get_icon_name (battery),
-                       XFPM_NOTIFY_NORMAL);
+        /* Peripherals running low together get a single notification */
+        xfpm_notify_post (power->priv->notify,
+                          XFPM_NOTIFY_CATEGORY_LOW_BATTERY,
+                          battery_name,
+                          _("Power Manager"),
+                          msg,
+                          xfpm_battery_get_icon_name (battery),
+                          XFPM_NOTIFY_NORMAL);
         g_free (msg);
         g_free (time_str);
       }
@@ -1080,6 +1170,15 @@ xfpm_power_class_init (XfpmPowerClass *klass)
                       g_cclosure_marshal_VOID__VOID,
                       G_TYPE_NONE, 0, G_TYPE_NONE);
 
+  signals [READY] =
+        g_signal_new ("ready",
+                      XFPM_TYPE_POWER,
+                      G_SIGNAL_RUN_LAST,
+                      G_STRUCT_OFFSET(XfpmPowerClass, ready),
+                      NULL, NULL,
+                      g_cclosure_marshal_VOID__VOID,
+                      G_TYPE_NONE, 0, G_TYPE_NONE);
+
 #define XFPM_PARAM_FLAGS  (  G_PARAM_READWRITE \
                            | G_PARAM_CONSTRUCT \
                            | G_PARAM_STATIC_NAME \
@@ -1165,10 +1264,45 @@ xfpm_power_class_init (XfpmPowerClass *klass)
 }
 
 static void
-xfpm_power_init (XfpmPower *power)
+xfpm_power_system_bus_ready_cb (GObject *source, GAsyncResult *res, gpointer user_data)
 {
+  XfpmPower *power = XFPM_POWER (user_data);
   GError *error = NULL;
 
+  power->priv->bus = g_bus_get_finish (res, &error);
+
+  if ( error )
+  {
+    g_critical ("Unable to connect to the system bus : %s", error->message);
+    g_error_free (error);
+    goto out;
+  }
+
+  g_signal_connect (power->priv->upower, "device-added", G_CALLBACK (xfpm_power_device_added_cb), power);
+  g_signal_connect (power->priv->upower, "device-removed", G_CALLBACK (xfpm_power_device_removed_cb), power);
+  g_signal_connect (power->priv->upower, "notify", G_CALLBACK (xfpm_power_changed_cb), power);
+
+  xfpm_power_get_power_devices (power);
+  xfpm_power_get_properties (power);
+#ifdef ENABLE_POLKIT
+  xfpm_power_check_polkit_auth (power);
+#endif
+
+out:
+  /*
+   * Emit org.freedesktop.PowerManagement session signals on startup
+   */
+  g_signal_emit (G_OBJECT (power), signals [ON_BATTERY_CHANGED], 0, power->priv->on_battery);
+
+  power->priv->ready = TRUE;
+  g_signal_emit (G_OBJECT (power), signals [READY], 0);
+
+  g_object_unref (power);
+}
+
+static void
+xfpm_power_init (XfpmPower *power)
+{
   power->priv = xfpm_power_get_instance_private (power);
 
   power->priv->hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
@@ -1197,6 +1331,14 @@ xfpm_power_init (XfpmPower *power)
   power->priv->upower  = up_client_new ();
   power->priv->screensaver = xfce_screensaver_new ();
 
+  power->priv->rapl = xfpm_rapl_new ();
+  if ( !xfpm_rapl_is_available (power->priv->rapl) )
+    g_clear_object (&power->priv->rapl);
+
+  power->priv->hibernate = xfpm_hibernate_new ();
+  g_signal_connect (power->priv->hibernate, "sleep-request",
+                    G_CALLBACK (xfpm_power_sleep_request_cb), power);
+
   power->priv->systemd = NULL;
   power->priv->console = NULL;
   if ( LOGIND_RUNNING () )
@@ -1213,32 +1355,11 @@ xfpm_power_init (XfpmPower *power)
   g_signal_connect (power->priv->inhibit, "has-inhibit-changed",
                     G_CALLBACK (xfpm_power_inhibit_changed_cb), power);
 
-  power->priv->bus = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
-
-  if ( error )
-  {
-    g_critical ("Unable to connect to the system bus : %s", error->message);
-    g_error_free (error);
-    goto out;
-  }
-
-  g_signal_connect (power->priv->upower, "device-added", G_CALLBACK (xfpm_power_device_added_cb), power);
-  g_signal_connect (power->priv->upower, "device-removed", G_CALLBACK (xfpm_power_device_removed_cb), power);
-  g_signal_connect (power->priv->upower, "notify", G_CALLBACK (xfpm_power_changed_cb), power);
-
-  xfpm_power_get_power_devices (power);
-  xfpm_power_get_properties (power);
-#ifdef ENABLE_POLKIT
-  xfpm_power_check_polkit_auth (power);
-#endif
-
-out:
   xfpm_power_dbus_init (power);
 
-  /*
-   * Emit org.freedesktop.PowerManagement session signals on startup
-   */
-  g_signal_emit (G_OBJECT (power), signals [ON_BATTERY_CHANGED], 0, power->priv->on_battery);
+  /* Device enumeration waits for the system bus, don't hold up the
+   * rest of the startup on it */
+  g_bus_get (G_BUS_TYPE_SYSTEM, NULL, xfpm_power_system_bus_ready_cb, g_object_ref (power));
 }
 
 static void
@@ -1255,6 +1376,9 @@ xfpm_power_get_property (GObject *object,
     case PROP_ON_BATTERY:
       g_value_set_boolean (value, power->priv->on_battery);
       break;
+    case PROP_ON_LOW_BATTERY:
+      g_value_set_boolean (value, power->priv->on_low_battery);
+      break;
     case PROP_AUTH_HIBERNATE:
       g_value_set_boolean (value, power->priv->auth_hibernate);
       break;
@@ -1328,12 +1452,18 @@ xfpm_power_finalize (GObject *object)
   g_object_unref (power->priv->conf);
   g_object_unref (power->priv->screensaver);
 
+  if ( power->priv->rapl != NULL )
+    g_object_unref (power->priv->rapl);
+
+  g_object_unref (power->priv->hibernate);
+
   if ( power->priv->systemd != NULL )
     g_object_unref (power->priv->systemd);
   if ( power->priv->console != NULL )
     g_object_unref (power->priv->console);
 
-  g_object_unref (power->priv->bus);
+  if ( power->priv->bus != NULL )
+    g_object_unref (power->priv->bus);
 
   g_hash_table_destroy (power->priv->hash);
 
@@ -1384,6 +1514,18 @@ xfpm_power_get (void)
   return XFPM_POWER (xfpm_power_object);
 }
 
+/*
+ * TRUE once the system bus answered and the devices, properties and
+ * sleep capabilities were read, see the ready signal.
+ */
+gboolean
+xfpm_power_is_ready (XfpmPower *power)
+{
+  g_return_val_if_fail (XFPM_IS_POWER (power), FALSE);
+
+  return power->priv->ready;
+}
+
 void xfpm_power_suspend (XfpmPower *power, gboolean force)
 {
   xfpm_power_sleep (power, "Suspend", force);
@@ -1503,6 +1645,44 @@ xfpm_power_is_in_presentation_mode (XfpmPower *power)
   return power->priv->presentation_mode || power->priv->inhibited;
 }
 
+/* The UPower client shared by everything in the daemon, not referenced */
+UpClient *
+xfpm_power_get_client (XfpmPower *power)
+{
+  g_return_val_if_fail (XFPM_IS_POWER (power), NULL);
+
+  return power->priv->upower;
+}
+
+/* The CPU energy counters, a pseudo device next to the UPower ones,
+ * or NULL if the system has none. Not referenced. */
+XfpmRapl *
+xfpm_power_get_rapl (XfpmPower *power)
+{
+  g_return_val_if_fail (XFPM_IS_POWER (power), NULL);
+
+  return power->priv->rapl;
+}
+
+/* Times every suspend and hibernation, not referenced */
+XfpmHibernate *
+xfpm_power_get_hibernate (XfpmPower *power)
+{
+  g_return_val_if_fail (XFPM_IS_POWER (power), NULL);
+
+  return power->priv->hibernate;
+}
+
+/* The XfpmBattery of every UPower device, free the list with
+ * g_list_free(), the batteries are not referenced */
+GList *
+xfpm_power_get_batteries (XfpmPower *power)
+{
+  g_return_val_if_fail (XFPM_IS_POWER (power), NULL);
+
+  return g_hash_table_get_values (power->priv->hash);
+}
+
 
 /*
  *
@@ -1712,8 +1892,11 @@ xfpm_power_dbus_hibernate (XfpmPower * power,
                            GDBusMethodInvocation *invocation,
                            gpointer user_data)
 {
+  xfpm_journal_log (XFPM_JOURNAL_SLEEP_REQUEST, XFPM_DO_HIBERNATE, "dbus");
+
   if ( !power->priv->auth_hibernate )
   {
+    xfpm_journal_log (XFPM_JOURNAL_SLEEP_BLOCKED, XFPM_DO_HIBERNATE, "not-authorized");
     g_dbus_method_invocation_return_error (invocation,
                                            XFPM_ERROR,
                                            XFPM_ERROR_PERMISSION_DENIED,
@@ -1723,6 +1906,7 @@ xfpm_power_dbus_hibernate (XfpmPower * power,
 
   if (!power->priv->can_hibernate )
   {
+    xfpm_journal_log (XFPM_JOURNAL_SLEEP_BLOCKED, XFPM_DO_HIBERNATE, "not-supported");
     g_dbus_method_invocation_return_error (invocation,
                                            XFPM_ERROR,
                                            XFPM_ERROR_NO_HARDWARE_SUPPORT,
@@ -1742,8 +1926,11 @@ xfpm_power_dbus_suspend (XfpmPower * power,
                          GDBusMethodInvocation *invocation,
                          gpointer user_data)
 {
+  xfpm_journal_log (XFPM_JOURNAL_SLEEP_REQUEST, XFPM_DO_SUSPEND, "dbus");
+
   if ( !power->priv->auth_suspend )
   {
+    xfpm_journal_log (XFPM_JOURNAL_SLEEP_BLOCKED, XFPM_DO_SUSPEND, "not-authorized");
     g_dbus_method_invocation_return_error (invocation,
                                            XFPM_ERROR,
                                            XFPM_ERROR_PERMISSION_DENIED,
@@ -1753,6 +1940,7 @@ xfpm_power_dbus_suspend (XfpmPower * power,
 
   if (!power->priv->can_suspend )
   {
+    xfpm_journal_log (XFPM_JOURNAL_SLEEP_BLOCKED, XFPM_DO_SUSPEND, "not-supported");
     g_dbus_method_invocation_return_error (invocation,
                                            XFPM_ERROR,
                                            XFPM_ERROR_NO_HARDWARE_SUPPORT,
@@ -22,7 +22,10 @@
 #define __XFPM_POWER_H
 
 #include <glib-object.h>
+#include <upower.h>
 #include "xfpm-enum-glib.h"
+#include "xfpm-rapl.h"
+#include "xfpm-hibernate.h"
 
 G_BEGIN_DECLS
 
@@ -51,17 +54,23 @@ typedef struct
     void         (*sleeping)                     (XfpmPower *power);
     void         (*ask_shutdown)                 (XfpmPower *power);
     void         (*shutdown)                     (XfpmPower *power);
+    void         (*ready)                        (XfpmPower *power);
 
 } XfpmPowerClass;
 
 GType       xfpm_power_get_type                 (void) G_GNUC_CONST;
 XfpmPower  *xfpm_power_get                      (void);
+gboolean    xfpm_power_is_ready                 (XfpmPower *power);
 void        xfpm_power_suspend                  (XfpmPower *power,
                                                  gboolean force);
 void        xfpm_power_hibernate                (XfpmPower *power,
                                                  gboolean force);
 gboolean    xfpm_power_has_battery              (XfpmPower *power);
 gboolean    xfpm_power_is_in_presentation_mode  (XfpmPower *power);
+UpClient   *xfpm_power_get_client               (XfpmPower *power);
+XfpmRapl   *xfpm_power_get_rapl                 (XfpmPower *power);
+XfpmHibernate *xfpm_power_get_hibernate         (XfpmPower *power);
+GList      *xfpm_power_get_batteries            (XfpmPower *power);
 
 G_END_DECLS
 
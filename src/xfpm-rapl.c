@@ -0,0 +1,499 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <fcntl.h>
+#include <errno.h>
+
+#include <glib.h>
+
+#include "xfpm-rapl.h"
+#include "xfpm-debug.h"
+
+static void xfpm_rapl_finalize     (GObject *object);
+static void xfpm_rapl_get_property (GObject *object,
+                                    guint prop_id,
+                                    GValue *value,
+                                    GParamSpec *pspec);
+
+/*
+ * CPU power from the energy counters of the powercap framework, the
+ * intel-rapl zones, which the kernel also provides for AMD Zen. Older
+ * kernels only have the amd_energy hwmon driver on those, it is used
+ * when there are no powercap zones.
+ *
+ * The counters are kept open and read with pread(), a sample is one
+ * small read per zone.
+ */
+
+/* Seconds between two samples */
+#define RAPL_SAMPLE_INTERVAL  3
+
+typedef enum
+{
+  RAPL_PACKAGE,
+  RAPL_CORE,
+  RAPL_UNCORE,
+  RAPL_N_DOMAINS
+} RaplDomain;
+
+typedef struct
+{
+  RaplDomain  domain;
+  gchar      *path;
+  gint        fd;
+  /* Where the counter wraps around, 0 if it doesn't */
+  guint64     max_range;
+  guint64     last;
+} RaplZone;
+
+struct XfpmRaplPrivate
+{
+  /* Directory used in place of /sys */
+  gchar           *root;
+
+  GPtrArray       *zones;
+  guint            timeout_id;
+  gint64           last_time;
+
+  /* Watts, -1 until measured or if the domain isn't there */
+  gdouble          rate[RAPL_N_DOMAINS];
+};
+
+enum
+{
+  PROP_0,
+  PROP_ENERGY_RATE,
+  PROP_CORE_ENERGY_RATE,
+  PROP_UNCORE_ENERGY_RATE,
+  N_PROPERTIES
+};
+
+static GParamSpec *properties[N_PROPERTIES] = { NULL, };
+
+G_DEFINE_TYPE_WITH_PRIVATE (XfpmRapl, xfpm_rapl, G_TYPE_OBJECT)
+
+static void
+xfpm_rapl_zone_free (RaplZone *zone)
+{
+  if ( zone->fd >= 0 )
+    close (zone->fd);
+
+  g_free (zone->path);
+  g_free (zone);
+}
+
+static gboolean
+xfpm_rapl_read_counter (gint fd, guint64 *value)
+{
+  gchar buf[32];
+  gchar *end;
+  gssize len;
+
+  len = pread (fd, buf, sizeof (buf) - 1, 0);
+  if ( len <= 0 )
+    return FALSE;
+
+  buf[len] = '\0';
+  *value = g_ascii_strtoull (buf, &end, 10);
+
+  return end != buf;
+}
+
+/* Contents of a small sysfs attribute, stripped */
+static gchar *
+xfpm_rapl_read_attr (const gchar *dir, const gchar *name)
+{
+  gchar *path;
+  gchar *contents = NULL;
+
+  path = g_build_filename (dir, name, NULL);
+
+  if ( g_file_get_contents (path, &contents, NULL, NULL) )
+    g_strstrip (contents);
+  else
+    contents = NULL;
+
+  g_free (path);
+
+  return contents;
+}
+
+static void
+xfpm_rapl_add_zone (XfpmRapl *rapl, RaplDomain domain, const gchar *path, guint64 max_range)
+{
+  RaplZone *zone;
+  guint64 value;
+  gint fd;
+
+  fd = open (path, O_RDONLY | O_CLOEXEC);
+  if ( fd < 0 )
+  {
+    /* energy_uj is only readable by root since Linux 5.10 */
+    if ( errno == EACCES )
+      XFPM_DEBUG ("%s is not readable, a udev rule can make it so", path);
+    else
+      XFPM_DEBUG ("Unable to open %s: %s", path, g_strerror (errno));
+    return;
+  }
+
+  if ( !xfpm_rapl_read_counter (fd, &value) )
+  {
+    XFPM_DEBUG ("Unable to read %s", path);
+    close (fd);
+    return;
+  }
+
+  XFPM_DEBUG ("Energy counter %s, domain %d, range %" G_GUINT64_FORMAT,
+              path, domain, max_range);
+
+  zone = g_new0 (RaplZone, 1);
+  zone->domain = domain;
+  zone->path = g_strdup (path);
+  zone->fd = fd;
+  zone->max_range = max_range;
+  zone->last = value;
+
+  g_ptr_array_add (rapl->priv->zones, zone);
+}
+
+/*
+ * class/powercap/intel-rapl:N are the packages, intel-rapl:N:M their
+ * core, uncore (the integrated GPU) and dram subzones. The mmio copies
+ * of the package zones are skipped, they count the same energy.
+ */
+static void
+xfpm_rapl_find_powercap_zones (XfpmRapl *rapl)
+{
+  gchar *dirname;
+  const gchar *entry;
+  GDir *dir;
+
+  dirname = g_build_filename (rapl->priv->root, "class", "powercap", NULL);
+  dir = g_dir_open (dirname, 0, NULL);
+
+  if ( dir == NULL )
+  {
+    g_free (dirname);
+    return;
+  }
+
+  while ( (entry = g_dir_read_name (dir)) != NULL )
+  {
+    gchar *zone_dir, *name, *range, *path;
+    RaplDomain domain;
+
+    if ( !g_str_has_prefix (entry, "intel-rapl:") )
+      continue;
+
+    zone_dir = g_build_filename (dirname, entry, NULL);
+    name = xfpm_rapl_read_attr (zone_dir, "name");
+
+    if ( name != NULL && g_str_has_prefix (name, "package-") )
+      domain = RAPL_PACKAGE;
+    else if ( g_strcmp0 (name, "core") == 0 )
+      domain = RAPL_CORE;
+    else if ( g_strcmp0 (name, "uncore") == 0 )
+      domain = RAPL_UNCORE;
+    else
+      domain = RAPL_N_DOMAINS;
+
+    if ( domain != RAPL_N_DOMAINS )
+    {
+      range = xfpm_rapl_read_attr (zone_dir, "max_energy_range_uj");
+      path = g_build_filename (zone_dir, "energy_uj", NULL);
+
+      xfpm_rapl_add_zone (rapl, domain, path,
+                          range != NULL ? g_ascii_strtoull (range, NULL, 10) : 0);
+
+      g_free (range);
+      g_free (path);
+    }
+
+    g_free (name);
+    g_free (zone_dir);
+  }
+
+  g_dir_close (dir);
+  g_free (dirname);
+}
+
+/* amd_energy has energyN_input labelled Esocket<n> and Ecore<n>, in
+ * microjoules like powercap, on 64 bit counters that don't wrap */
+static void
+xfpm_rapl_find_amd_energy_zones (XfpmRapl *rapl)
+{
+  gchar *dirname;
+  const gchar *entry;
+  GDir *dir;
+
+  dirname = g_build_filename (rapl->priv->root, "class", "hwmon", NULL);
+  dir = g_dir_open (dirname, 0, NULL);
+
+  if ( dir == NULL )
+  {
+    g_free (dirname);
+    return;
+  }
+
+  while ( (entry = g_dir_read_name (dir)) != NULL )
+  {
+    gchar *hwmon_dir, *name;
+    guint i;
+
+    hwmon_dir = g_build_filename (dirname, entry, NULL);
+    name = xfpm_rapl_read_attr (hwmon_dir, "name");
+
+    if ( g_strcmp0 (name, "amd_energy") != 0 )
+    {
+      g_free (name);
+      g_free (hwmon_dir);
+      continue;
+    }
+
+    /* The inputs are numbered from 1, without holes */
+    for ( i = 1; ; i++ )
+    {
+      gchar *attr, *label, *path;
+
+      attr = g_strdup_printf ("energy%u_label", i);
+      label = xfpm_rapl_read_attr (hwmon_dir, attr);
+      g_free (attr);
+
+      if ( label == NULL )
+        break;
+
+      path = g_strdup_printf ("%s/energy%u_input", hwmon_dir, i);
+
+      if ( g_str_has_prefix (label, "Esocket") )
+        xfpm_rapl_add_zone (rapl, RAPL_PACKAGE, path, 0);
+      else if ( g_str_has_prefix (label, "Ecore") )
+        xfpm_rapl_add_zone (rapl, RAPL_CORE, path, 0);
+
+      g_free (path);
+      g_free (label);
+    }
+
+    g_free (name);
+    g_free (hwmon_dir);
+  }
+
+  g_dir_close (dir);
+  g_free (dirname);
+}
+
+static void
+xfpm_rapl_set_rate (XfpmRapl *rapl, RaplDomain domain, gdouble watts)
+{
+  static const guint prop_ids[RAPL_N_DOMAINS] =
+  {
+    PROP_ENERGY_RATE,
+    PROP_CORE_ENERGY_RATE,
+    PROP_UNCORE_ENERGY_RATE
+  };
+
+  /* Tenths of a watt are enough, and keep the notifies down */
+  if ( watts >= 0 )
+    watts = (gint64) (watts * 10 + 0.5) / 10.0;
+
+  if ( watts == rapl->priv->rate[domain] )
+    return;
+
+  rapl->priv->rate[domain] = watts;
+  g_object_notify_by_pspec (G_OBJECT (rapl), properties[prop_ids[domain]]);
+}
+
+static gboolean
+xfpm_rapl_sample_cb (gpointer data)
+{
+  XfpmRapl *rapl = XFPM_RAPL (data);
+  guint64 energy[RAPL_N_DOMAINS] = { 0, };
+  gboolean seen[RAPL_N_DOMAINS] = { FALSE, };
+  gboolean valid[RAPL_N_DOMAINS] = { TRUE, TRUE, TRUE };
+  gint64 now;
+  gdouble seconds;
+  guint i;
+
+  now = g_get_monotonic_time ();
+  seconds = (now - rapl->priv->last_time) / (gdouble) G_USEC_PER_SEC;
+  rapl->priv->last_time = now;
+
+  for ( i = 0; i < rapl->priv->zones->len; i++ )
+  {
+    RaplZone *zone = g_ptr_array_index (rapl->priv->zones, i);
+    guint64 value;
+
+    if ( !xfpm_rapl_read_counter (zone->fd, &value) )
+    {
+      valid[zone->domain] = FALSE;
+      continue;
+    }
+
+    seen[zone->domain] = TRUE;
+
+    if ( value >= zone->last )
+      energy[zone->domain] += value - zone->last;
+    else if ( zone->max_range > 0 && zone->last <= zone->max_range )
+      energy[zone->domain] += zone->max_range - zone->last + value;
+    else
+      /* Reset behind our back, e.g. by a resume, skip this round */
+      valid[zone->domain] = FALSE;
+
+    zone->last = value;
+  }
+
+  for ( i = 0; i < RAPL_N_DOMAINS; i++ )
+  {
+    if ( !seen[i] )
+      xfpm_rapl_set_rate (rapl, i, -1);
+    else if ( valid[i] && seconds > 0 )
+      xfpm_rapl_set_rate (rapl, i, energy[i] / seconds / 1e6);
+  }
+
+  return TRUE;
+}
+
+static void
+xfpm_rapl_class_init (XfpmRaplClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = xfpm_rapl_finalize;
+  object_class->get_property = xfpm_rapl_get_property;
+
+  properties[PROP_ENERGY_RATE] =
+    g_param_spec_double (XFPM_RAPL_ENERGY_RATE, NULL, NULL,
+                         -1, G_MAXDOUBLE, -1,
+                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  properties[PROP_CORE_ENERGY_RATE] =
+    g_param_spec_double (XFPM_RAPL_CORE_ENERGY_RATE, NULL, NULL,
+                         -1, G_MAXDOUBLE, -1,
+                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  properties[PROP_UNCORE_ENERGY_RATE] =
+    g_param_spec_double (XFPM_RAPL_UNCORE_ENERGY_RATE, NULL, NULL,
+                         -1, G_MAXDOUBLE, -1,
+                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (object_class, N_PROPERTIES, properties);
+}
+
+static void
+xfpm_rapl_init (XfpmRapl *rapl)
+{
+  const gchar *root;
+  guint i;
+
+  rapl->priv = xfpm_rapl_get_instance_private (rapl);
+
+  /* Allows running the sampler against fixture trees */
+  root = g_getenv ("XFPM_SYSFS_ROOT");
+  rapl->priv->root = g_strdup (root != NULL && *root != '\0' ? root : "/sys");
+
+  for ( i = 0; i < RAPL_N_DOMAINS; i++ )
+    rapl->priv->rate[i] = -1;
+
+  rapl->priv->zones = g_ptr_array_new_with_free_func ((GDestroyNotify) xfpm_rapl_zone_free);
+
+  xfpm_rapl_find_powercap_zones (rapl);
+  if ( rapl->priv->zones->len == 0 )
+    xfpm_rapl_find_amd_energy_zones (rapl);
+
+  if ( rapl->priv->zones->len == 0 )
+  {
+    XFPM_DEBUG ("No readable energy counters in %s", rapl->priv->root);
+    return;
+  }
+
+  /* The counters were read while adding the zones, that's the baseline */
+  rapl->priv->last_time = g_get_monotonic_time ();
+  rapl->priv->timeout_id = g_timeout_add_seconds (RAPL_SAMPLE_INTERVAL,
+                                                  xfpm_rapl_sample_cb,
+                                                  rapl);
+}
+
+static void
+xfpm_rapl_get_property (GObject *object,
+                        guint prop_id,
+                        GValue *value,
+                        GParamSpec *pspec)
+{
+  XfpmRapl *rapl = XFPM_RAPL (object);
+
+  switch ( prop_id )
+  {
+    case PROP_ENERGY_RATE:
+      g_value_set_double (value, rapl->priv->rate[RAPL_PACKAGE]);
+      break;
+    case PROP_CORE_ENERGY_RATE:
+      g_value_set_double (value, rapl->priv->rate[RAPL_CORE]);
+      break;
+    case PROP_UNCORE_ENERGY_RATE:
+      g_value_set_double (value, rapl->priv->rate[RAPL_UNCORE]);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+xfpm_rapl_finalize (GObject *object)
+{
+  XfpmRapl *rapl;
+
+  rapl = XFPM_RAPL (object);
+
+  if ( rapl->priv->timeout_id != 0 )
+    g_source_remove (rapl->priv->timeout_id);
+
+  g_ptr_array_free (rapl->priv->zones, TRUE);
+  g_free (rapl->priv->root);
+
+  G_OBJECT_CLASS (xfpm_rapl_parent_class)->finalize (object);
+}
+
+XfpmRapl *
+xfpm_rapl_new (void)
+{
+  return g_object_new (XFPM_TYPE_RAPL, NULL);
+}
+
+/* Whether there are energy counters we can read */
+gboolean
+xfpm_rapl_is_available (XfpmRapl *rapl)
+{
+  g_return_val_if_fail (XFPM_IS_RAPL (rapl), FALSE);
+
+  return rapl->priv->zones->len > 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __XFPM_RAPL_H
+#define __XFPM_RAPL_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+/* Watts drawn by the CPU packages, their cores and the rest of the
+ * package (the integrated GPU on client parts), -1 until measured */
+#define XFPM_RAPL_ENERGY_RATE          "energy-rate"
+#define XFPM_RAPL_CORE_ENERGY_RATE     "core-energy-rate"
+#define XFPM_RAPL_UNCORE_ENERGY_RATE   "uncore-energy-rate"
+
+#define XFPM_TYPE_RAPL        (xfpm_rapl_get_type () )
+#define XFPM_RAPL(o)          (G_TYPE_CHECK_INSTANCE_CAST((o), XFPM_TYPE_RAPL, XfpmRapl))
+#define XFPM_IS_RAPL(o)       (G_TYPE_CHECK_INSTANCE_TYPE((o), XFPM_TYPE_RAPL))
+
+typedef struct XfpmRaplPrivate XfpmRaplPrivate;
+
+typedef struct
+{
+  GObject               parent;
+  XfpmRaplPrivate      *priv;
+} XfpmRapl;
+
+typedef struct
+{
+  GObjectClass          parent_class;
+} XfpmRaplClass;
+
+GType              xfpm_rapl_get_type           (void) G_GNUC_CONST;
+XfpmRapl          *xfpm_rapl_new                (void);
+gboolean           xfpm_rapl_is_available       (XfpmRapl *rapl);
+
+G_END_DECLS
+
+#endif /* __XFPM_RAPL_H */
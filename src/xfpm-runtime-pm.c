@@ -0,0 +1,580 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <glib.h>
+
+#include <libxfce4util/libxfce4util.h>
+
+#include "xfpm-runtime-pm.h"
+#include "xfpm-power.h"
+#include "xfpm-pkexec.h"
+#include "xfpm-xfconf.h"
+#include "xfpm-common.h"
+#include "xfpm-config.h"
+#include "xfpm-debug.h"
+
+static void xfpm_runtime_pm_finalize   (GObject *object);
+
+/* USB interface classes */
+#define USB_CLASS_AUDIO         0x01
+#define USB_CLASS_HID           0x03
+
+/* PCI multimedia audio and HD audio controllers */
+#define PCI_CLASS_AUDIO         0x0401
+#define PCI_CLASS_HDA           0x0403
+
+static const gchar *buses[] = { "pci", "usb" };
+
+typedef struct
+{
+  /* bus/name, the way the helper takes it */
+  gchar           *id;
+  gchar           *dir;
+  gchar           *power_dir;
+  gboolean         is_usb;
+
+  /* What the device had when we first saw it, put back on exit */
+  gchar           *control;
+  gchar           *delay;
+
+  gboolean         seen;
+} XfpmRuntimePmDevice;
+
+struct XfpmRuntimePmPrivate
+{
+  XfpmPower       *power;
+  XfpmXfconf      *conf;
+  XfpmPkexec      *helper;
+
+  gchar           *root;
+
+  GHashTable      *devices;
+
+  gboolean         on_battery;
+  gboolean         changed;
+
+  gboolean         apply_pending;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (XfpmRuntimePm, xfpm_runtime_pm, G_TYPE_OBJECT)
+
+static void
+xfpm_runtime_pm_device_free (XfpmRuntimePmDevice *device)
+{
+  g_free (device->id);
+  g_free (device->dir);
+  g_free (device->power_dir);
+  g_free (device->control);
+  g_free (device->delay);
+  g_free (device);
+}
+
+static guint
+xfpm_runtime_pm_read_hex (const gchar *dir, const gchar *name)
+{
+  gchar *contents;
+  guint value = 0;
+
+  contents = xfpm_sysfs_read (dir, name);
+  if ( contents != NULL )
+    value = g_ascii_strtoull (contents, NULL, 16);
+  g_free (contents);
+
+  return value;
+}
+
+static gboolean
+xfpm_runtime_pm_usb_has_class (XfpmRuntimePmDevice *device, guint usb_class)
+{
+  GDir *dir;
+  const gchar *name;
+  gboolean found = FALSE;
+
+  dir = g_dir_open (device->dir, 0, NULL);
+  if ( dir == NULL )
+    return FALSE;
+
+  /* The interfaces are the 1-2:1.0 style children */
+  while ( !found && (name = g_dir_read_name (dir)) != NULL )
+  {
+    gchar *interface;
+
+    if ( strchr (name, ':') == NULL )
+      continue;
+
+    interface = g_build_filename (device->dir, name, NULL);
+    found = xfpm_runtime_pm_read_hex (interface, "bInterfaceClass") == usb_class;
+    g_free (interface);
+  }
+
+  g_dir_close (dir);
+
+  return found;
+}
+
+static gboolean
+xfpm_runtime_pm_matches_id (XfpmRuntimePmDevice *device, const gchar *entry)
+{
+  guint vendor;
+  guint product;
+  gchar *id;
+  gboolean ret;
+
+  if ( device->is_usb )
+  {
+    vendor = xfpm_runtime_pm_read_hex (device->dir, "idVendor");
+    product = xfpm_runtime_pm_read_hex (device->dir, "idProduct");
+  }
+  else
+  {
+    vendor = xfpm_runtime_pm_read_hex (device->dir, "vendor");
+    product = xfpm_runtime_pm_read_hex (device->dir, "device");
+  }
+
+  id = g_strdup_printf ("%04x:%04x", vendor, product);
+  ret = g_ascii_strcasecmp (id, entry) == 0;
+  g_free (id);
+
+  return ret;
+}
+
+/*
+ * Entries are hid, audio, a vendor:product id or a sysfs name with or
+ * without the bus, e.g. hid,audio,8087:0026,usb/1-4
+ */
+static gboolean
+xfpm_runtime_pm_is_denied (XfpmRuntimePmDevice *device, gchar **deny_list)
+{
+  const gchar *name;
+  guint i;
+
+  name = strchr (device->id, '/') + 1;
+
+  for ( i = 0; deny_list[i] != NULL; i++ )
+  {
+    const gchar *entry = g_strstrip (deny_list[i]);
+
+    if ( *entry == '\0' )
+      continue;
+
+    if ( g_strcmp0 (entry, device->id) == 0 || g_strcmp0 (entry, name) == 0 )
+      return TRUE;
+
+    if ( g_strcmp0 (entry, "hid") == 0 )
+    {
+      if ( device->is_usb && xfpm_runtime_pm_usb_has_class (device, USB_CLASS_HID) )
+        return TRUE;
+    }
+    else if ( g_strcmp0 (entry, "audio") == 0 )
+    {
+      if ( device->is_usb )
+      {
+        if ( xfpm_runtime_pm_usb_has_class (device, USB_CLASS_AUDIO) )
+          return TRUE;
+      }
+      else
+      {
+        guint pci_class = xfpm_runtime_pm_read_hex (device->dir, "class") >> 8;
+
+        if ( pci_class == PCI_CLASS_AUDIO || pci_class == PCI_CLASS_HDA )
+          return TRUE;
+      }
+    }
+    else if ( strlen (entry) == 9 && entry[4] == ':' &&
+              xfpm_runtime_pm_matches_id (device, entry) )
+    {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/*
+ * Devices come and go, new ones are added with their current values
+ * as the ones to restore and unplugged ones are dropped.
+ */
+static void
+xfpm_runtime_pm_scan (XfpmRuntimePm *runtime_pm)
+{
+  GHashTableIter iter;
+  XfpmRuntimePmDevice *device;
+  guint i;
+
+  g_hash_table_iter_init (&iter, runtime_pm->priv->devices);
+  while ( g_hash_table_iter_next (&iter, NULL, (gpointer *) &device) )
+    device->seen = FALSE;
+
+  for ( i = 0; i < G_N_ELEMENTS (buses); i++ )
+  {
+    GDir *dir;
+    gchar *path;
+    const gchar *name;
+    gboolean is_usb;
+
+    path = g_build_filename (runtime_pm->priv->root, "bus", buses[i], "devices", NULL);
+    dir = g_dir_open (path, 0, NULL);
+
+    is_usb = g_strcmp0 (buses[i], "usb") == 0;
+
+    while ( dir != NULL && (name = g_dir_read_name (dir)) != NULL )
+    {
+      gchar *id;
+      gchar *power_dir;
+      gchar *control;
+
+      /* USB interfaces don't have their own runtime PM control */
+      if ( is_usb && strchr (name, ':') != NULL )
+        continue;
+
+      id = g_strdup_printf ("%s/%s", buses[i], name);
+
+      device = g_hash_table_lookup (runtime_pm->priv->devices, id);
+      if ( device != NULL )
+      {
+        device->seen = TRUE;
+        g_free (id);
+        continue;
+      }
+
+      power_dir = g_build_filename (path, name, "power", NULL);
+      control = xfpm_sysfs_read (power_dir, "control");
+
+      if ( control == NULL )
+      {
+        g_free (power_dir);
+        g_free (id);
+        continue;
+      }
+
+      device = g_new0 (XfpmRuntimePmDevice, 1);
+      device->id = id;
+      device->dir = g_build_filename (path, name, NULL);
+      device->power_dir = power_dir;
+      device->is_usb = is_usb;
+      device->control = control;
+      device->delay = xfpm_sysfs_read (power_dir, "autosuspend_delay_ms");
+      device->seen = TRUE;
+
+      g_hash_table_insert (runtime_pm->priv->devices, device->id, device);
+    }
+
+    if ( dir != NULL )
+      g_dir_close (dir);
+    g_free (path);
+  }
+
+  g_hash_table_iter_init (&iter, runtime_pm->priv->devices);
+  while ( g_hash_table_iter_next (&iter, NULL, (gpointer *) &device) )
+  {
+    if ( !device->seen )
+      g_hash_table_iter_remove (&iter);
+  }
+}
+
+static void xfpm_runtime_pm_apply (XfpmRuntimePm *runtime_pm);
+
+static void
+xfpm_runtime_pm_helper_finished_cb (XfpmPkexec *helper, gboolean success, XfpmRuntimePm *runtime_pm)
+{
+  /* Usually a device that went away in the meantime */
+  if ( !success )
+    XFPM_DEBUG ("Runtime power management helper failed");
+
+  if ( runtime_pm->priv->apply_pending )
+  {
+    runtime_pm->priv->apply_pending = FALSE;
+    xfpm_runtime_pm_apply (runtime_pm);
+  }
+}
+
+static gchar *
+xfpm_runtime_pm_device_arg (XfpmRuntimePmDevice *device,
+                            const gchar *control,
+                            const gchar *delay)
+{
+  gchar *cur_control;
+  gchar *cur_delay;
+  gchar *arg = NULL;
+
+  cur_control = xfpm_sysfs_read (device->power_dir, "control");
+  cur_delay = xfpm_sysfs_read (device->power_dir, "autosuspend_delay_ms");
+
+  if ( control != NULL && g_strcmp0 (control, cur_control) == 0 )
+    control = NULL;
+  if ( delay != NULL && (cur_delay == NULL || g_strcmp0 (delay, cur_delay) == 0) )
+    delay = NULL;
+
+  if ( control != NULL || delay != NULL )
+    arg = g_strdup_printf ("%s,%s,%s", device->id,
+                           control != NULL ? control : "",
+                           delay != NULL ? delay : "");
+
+  g_free (cur_control);
+  g_free (cur_delay);
+
+  return arg;
+}
+
+/*
+ * With runtime PM enabled for the power source every device but the
+ * denied ones goes to auto, everything else gets its own values back.
+ * The whole batch goes to the helper in a single invocation.
+ */
+static void
+xfpm_runtime_pm_apply (XfpmRuntimePm *runtime_pm)
+{
+  const XfpmConfig *config;
+  GHashTableIter iter;
+  XfpmRuntimePmDevice *device;
+  GPtrArray *args;
+  gboolean enabled;
+  gchar **deny_list;
+  gchar *delay = NULL;
+  gboolean changed = FALSE;
+
+  if ( xfpm_pkexec_is_running (runtime_pm->priv->helper) )
+  {
+    runtime_pm->priv->apply_pending = TRUE;
+    return;
+  }
+
+  config = xfpm_xfconf_get_config (runtime_pm->priv->conf);
+  enabled = runtime_pm->priv->on_battery ? config->runtime_pm_on_battery : config->runtime_pm_on_ac;
+
+  deny_list = g_strsplit (config->runtime_pm_deny_list != NULL ? config->runtime_pm_deny_list : "", ",", -1);
+  if ( config->runtime_pm_autosuspend_delay > 0 )
+    delay = g_strdup_printf ("%u", config->runtime_pm_autosuspend_delay);
+
+  xfpm_runtime_pm_scan (runtime_pm);
+
+  args = g_ptr_array_new_with_free_func (g_free);
+
+  g_hash_table_iter_init (&iter, runtime_pm->priv->devices);
+  while ( g_hash_table_iter_next (&iter, NULL, (gpointer *) &device) )
+  {
+    const gchar *target_control = device->control;
+    const gchar *target_delay = device->delay;
+    gchar *arg;
+
+    if ( enabled && !xfpm_runtime_pm_is_denied (device, deny_list) )
+    {
+      target_control = "auto";
+      if ( delay != NULL )
+        target_delay = delay;
+      changed = TRUE;
+    }
+
+    arg = xfpm_runtime_pm_device_arg (device, target_control, target_delay);
+    if ( arg != NULL )
+      g_ptr_array_add (args, arg);
+  }
+
+  runtime_pm->priv->changed = changed;
+
+  if ( args->len > 0 )
+  {
+    gchar **helper_args = xfpm_pkexec_batch_args ("runtime-pm", "--device", args);
+
+    XFPM_DEBUG ("Updating runtime power management of %u devices for %s", args->len,
+                runtime_pm->priv->on_battery ? "battery" : "AC");
+    xfpm_pkexec_run (runtime_pm->priv->helper, (const gchar * const *) helper_args);
+    g_strfreev (helper_args);
+  }
+
+  g_ptr_array_unref (args);
+  g_strfreev (deny_list);
+  g_free (delay);
+}
+
+static void
+xfpm_runtime_pm_on_battery_changed_cb (XfpmPower *power,
+                                       gboolean on_battery,
+                                       XfpmRuntimePm *runtime_pm)
+{
+  if ( runtime_pm->priv->on_battery == on_battery )
+    return;
+
+  runtime_pm->priv->on_battery = on_battery;
+
+  xfpm_runtime_pm_apply (runtime_pm);
+}
+
+static void
+xfpm_runtime_pm_settings_changed_cb (XfpmXfconf *conf,
+                                     const gchar **keys,
+                                     XfpmRuntimePm *runtime_pm)
+{
+  guint i;
+
+  for ( i = 0; keys[i] != NULL; i++ )
+  {
+    if ( g_str_has_prefix (keys[i], "runtime-pm-") )
+    {
+      xfpm_runtime_pm_apply (runtime_pm);
+      return;
+    }
+  }
+}
+
+static void
+xfpm_runtime_pm_class_init (XfpmRuntimePmClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = xfpm_runtime_pm_finalize;
+}
+
+static void
+xfpm_runtime_pm_init (XfpmRuntimePm *runtime_pm)
+{
+  const gchar *root;
+
+  runtime_pm->priv = xfpm_runtime_pm_get_instance_private (runtime_pm);
+
+  /* Allows running against a fake sysfs tree */
+  root = g_getenv ("XFPM_SYSFS_ROOT");
+  runtime_pm->priv->root = g_strdup (root != NULL && *root != '\0' ? root : "/sys");
+
+  runtime_pm->priv->devices = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                                     (GDestroyNotify) xfpm_runtime_pm_device_free);
+  runtime_pm->priv->helper = xfpm_pkexec_new (XFPM_SYSFS_HELPER);
+
+  if ( !xfpm_pkexec_is_installed (runtime_pm->priv->helper) )
+  {
+    XFPM_DEBUG ("%s is not installed", XFPM_SYSFS_HELPER);
+    return;
+  }
+
+  runtime_pm->priv->power = xfpm_power_get ();
+  runtime_pm->priv->conf = xfpm_xfconf_new ();
+
+  g_object_get (G_OBJECT (runtime_pm->priv->power),
+                "on-battery", &runtime_pm->priv->on_battery,
+                NULL);
+
+  g_signal_connect (runtime_pm->priv->power, "on-battery-changed",
+                    G_CALLBACK (xfpm_runtime_pm_on_battery_changed_cb), runtime_pm);
+  g_signal_connect (runtime_pm->priv->conf, "config-changed",
+                    G_CALLBACK (xfpm_runtime_pm_settings_changed_cb), runtime_pm);
+  g_signal_connect (runtime_pm->priv->helper, "finished",
+                    G_CALLBACK (xfpm_runtime_pm_helper_finished_cb), runtime_pm);
+
+  xfpm_runtime_pm_apply (runtime_pm);
+}
+
+static void
+xfpm_runtime_pm_finalize (GObject *object)
+{
+  XfpmRuntimePm *runtime_pm;
+
+  runtime_pm = XFPM_RUNTIME_PM (object);
+
+  if ( runtime_pm->priv->power != NULL )
+  {
+    g_signal_handlers_disconnect_by_data (runtime_pm->priv->power, runtime_pm);
+    g_object_unref (runtime_pm->priv->power);
+  }
+
+  if ( runtime_pm->priv->conf != NULL )
+  {
+    g_signal_handlers_disconnect_by_data (runtime_pm->priv->conf, runtime_pm);
+    g_object_unref (runtime_pm->priv->conf);
+  }
+
+  g_signal_handlers_disconnect_by_data (runtime_pm->priv->helper, runtime_pm);
+  g_object_unref (runtime_pm->priv->helper);
+
+  g_hash_table_destroy (runtime_pm->priv->devices);
+  g_free (runtime_pm->priv->root);
+
+  G_OBJECT_CLASS (xfpm_runtime_pm_parent_class)->finalize (object);
+}
+
+XfpmRuntimePm *
+xfpm_runtime_pm_new (void)
+{
+  return g_object_new (XFPM_TYPE_RUNTIME_PM, NULL);
+}
+
+/**
+ * xfpm_runtime_pm_restore:
+ *
+ * Puts back the power control and autosuspend delay every device had
+ * when the power manager first saw it. Waits for the helper, it is
+ * meant to be called when the power manager quits.
+ **/
+void
+xfpm_runtime_pm_restore (XfpmRuntimePm *runtime_pm)
+{
+  GHashTableIter iter;
+  XfpmRuntimePmDevice *device;
+  GPtrArray *args;
+
+  g_return_if_fail (XFPM_IS_RUNTIME_PM (runtime_pm));
+
+  if ( !runtime_pm->priv->changed )
+    return;
+
+  args = g_ptr_array_new_with_free_func (g_free);
+
+  g_hash_table_iter_init (&iter, runtime_pm->priv->devices);
+  while ( g_hash_table_iter_next (&iter, NULL, (gpointer *) &device) )
+  {
+    gchar *arg;
+
+    arg = xfpm_runtime_pm_device_arg (device, device->control, device->delay);
+    if ( arg != NULL )
+      g_ptr_array_add (args, arg);
+  }
+
+  if ( args->len > 0 )
+  {
+    gchar **helper_args = xfpm_pkexec_batch_args ("runtime-pm", "--device", args);
+    GError *error = NULL;
+
+    XFPM_DEBUG ("Restoring runtime power management of %u devices", args->len);
+
+    /* There is no main loop left to wait in */
+    if ( !xfpm_pkexec_run_sync (runtime_pm->priv->helper, (const gchar * const *) helper_args, &error) )
+    {
+      g_warning ("Unable to restore the runtime power management settings: %s", error->message);
+      g_error_free (error);
+    }
+
+    g_strfreev (helper_args);
+  }
+
+  runtime_pm->priv->changed = FALSE;
+  g_ptr_array_unref (args);
+}
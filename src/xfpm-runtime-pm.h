@@ -0,0 +1,51 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __XFPM_RUNTIME_PM_H
+#define __XFPM_RUNTIME_PM_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define XFPM_TYPE_RUNTIME_PM     (xfpm_runtime_pm_get_type () )
+#define XFPM_RUNTIME_PM(o)       (G_TYPE_CHECK_INSTANCE_CAST((o), XFPM_TYPE_RUNTIME_PM, XfpmRuntimePm))
+#define XFPM_IS_RUNTIME_PM(o)    (G_TYPE_CHECK_INSTANCE_TYPE((o), XFPM_TYPE_RUNTIME_PM))
+
+typedef struct XfpmRuntimePmPrivate XfpmRuntimePmPrivate;
+
+typedef struct
+{
+  GObject               parent;
+  XfpmRuntimePmPrivate *priv;
+} XfpmRuntimePm;
+
+typedef struct
+{
+  GObjectClass          parent_class;
+} XfpmRuntimePmClass;
+
+GType              xfpm_runtime_pm_get_type     (void) G_GNUC_CONST;
+XfpmRuntimePm     *xfpm_runtime_pm_new          (void);
+void               xfpm_runtime_pm_restore      (XfpmRuntimePm *runtime_pm);
+
+G_END_DECLS
+
+#endif /* __XFPM_RUNTIME_PM_H */
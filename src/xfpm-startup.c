@@ -0,0 +1,392 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <glib.h>
+
+#include "xfpm-startup.h"
+#include "xfpm-debug.h"
+
+static void xfpm_startup_finalize   (GObject *object);
+
+typedef enum
+{
+  TASK_WAITING,
+  TASK_QUEUED,
+  TASK_RUNNING,
+  TASK_DONE
+} TaskState;
+
+typedef struct
+{
+  XfpmStartup     *startup;
+  gchar           *name;
+  gchar          **after;
+  XfpmStartupFunc  func;
+  gpointer         user_data;
+  TaskState        state;
+  gint64           queued;
+  gint64           begin;
+} StartupTask;
+
+typedef struct
+{
+  gchar  *component;
+  gint64  queued;
+  gint64  begin;
+  gint64  end;
+} ProfileEntry;
+
+struct XfpmStartupPrivate
+{
+  GPtrArray       *tasks;
+  GHashTable      *index;
+  guint            pending;
+  gboolean         running;
+};
+
+enum
+{
+  FINISHED,
+  LAST_SIGNAL
+};
+
+static guint signals [LAST_SIGNAL] = { 0 };
+
+/* Process wide, so that main () can record what happens before the
+ * manager is created */
+static gboolean  profile_enabled = FALSE;
+static gint64    profile_origin  = 0;
+static GArray   *profile_entries = NULL;
+
+G_DEFINE_TYPE_WITH_PRIVATE (XfpmStartup, xfpm_startup, G_TYPE_OBJECT)
+
+static void
+xfpm_startup_task_free (StartupTask *task)
+{
+  g_free (task->name);
+  g_strfreev (task->after);
+  g_free (task);
+}
+
+static gboolean
+xfpm_startup_task_ready (XfpmStartup *startup, StartupTask *task)
+{
+  guint i;
+
+  for ( i = 0; task->after[i] != NULL; i++ )
+  {
+    StartupTask *dep = g_hash_table_lookup (startup->priv->index, task->after[i]);
+
+    if ( dep == NULL )
+    {
+      g_warning ("Startup task '%s' depends on unknown task '%s'", task->name, task->after[i]);
+      continue;
+    }
+
+    if ( dep->state != TASK_DONE )
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+xfpm_startup_dispatch (gpointer data)
+{
+  StartupTask *task = data;
+  XfpmStartup *startup = task->startup;
+
+  task->state = TASK_RUNNING;
+  task->begin = g_get_monotonic_time ();
+
+  XFPM_DEBUG ("Starting %s", task->name);
+
+  task->func (startup, task->user_data);
+
+  g_object_unref (startup);
+
+  return FALSE;
+}
+
+/*
+ * Every runnable task gets its own idle source, so independent tasks
+ * interleave with the main loop (tray icon, D-Bus requests) and async
+ * tasks have their round trips in flight at the same time.
+ */
+static void
+xfpm_startup_queue_ready (XfpmStartup *startup)
+{
+  guint i;
+
+  for ( i = 0; i < startup->priv->tasks->len; i++ )
+  {
+    StartupTask *task = g_ptr_array_index (startup->priv->tasks, i);
+
+    if ( task->state != TASK_WAITING || !xfpm_startup_task_ready (startup, task) )
+      continue;
+
+    task->state = TASK_QUEUED;
+    task->queued = g_get_monotonic_time ();
+    g_idle_add (xfpm_startup_dispatch, task);
+    g_object_ref (startup);
+  }
+}
+
+static void
+xfpm_startup_class_init (XfpmStartupClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  signals [FINISHED] =
+    g_signal_new ("finished",
+                  XFPM_TYPE_STARTUP,
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (XfpmStartupClass, finished),
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0, G_TYPE_NONE);
+
+  object_class->finalize = xfpm_startup_finalize;
+}
+
+static void
+xfpm_startup_init (XfpmStartup *startup)
+{
+  startup->priv = xfpm_startup_get_instance_private (startup);
+
+  startup->priv->tasks = g_ptr_array_new_with_free_func ((GDestroyNotify) xfpm_startup_task_free);
+  startup->priv->index = g_hash_table_new (g_str_hash, g_str_equal);
+  startup->priv->pending = 0;
+  startup->priv->running = FALSE;
+}
+
+static void
+xfpm_startup_finalize (GObject *object)
+{
+  XfpmStartup *startup;
+
+  startup = XFPM_STARTUP (object);
+
+  g_hash_table_destroy (startup->priv->index);
+  g_ptr_array_free (startup->priv->tasks, TRUE);
+
+  G_OBJECT_CLASS (xfpm_startup_parent_class)->finalize (object);
+}
+
+XfpmStartup *
+xfpm_startup_new (void)
+{
+  return g_object_new (XFPM_TYPE_STARTUP, NULL);
+}
+
+/**
+ * xfpm_startup_add:
+ * @name: unique name of the task, also used in the startup profile
+ * @after: comma separated list of tasks that have to be done first, or %NULL
+ *
+ **/
+void
+xfpm_startup_add (XfpmStartup    *startup,
+                  const gchar    *name,
+                  const gchar    *after,
+                  XfpmStartupFunc func,
+                  gpointer        user_data)
+{
+  StartupTask *task;
+
+  g_return_if_fail (XFPM_IS_STARTUP (startup));
+  g_return_if_fail (name != NULL && func != NULL);
+  g_return_if_fail (g_hash_table_lookup (startup->priv->index, name) == NULL);
+
+  task = g_new0 (StartupTask, 1);
+  task->startup = startup;
+  task->name = g_strdup (name);
+  task->after = g_strsplit (after != NULL ? after : "", ",", -1);
+  task->func = func;
+  task->user_data = user_data;
+  task->state = TASK_WAITING;
+
+  g_ptr_array_add (startup->priv->tasks, task);
+  g_hash_table_insert (startup->priv->index, task->name, task);
+  startup->priv->pending++;
+
+  if ( startup->priv->running )
+    xfpm_startup_queue_ready (startup);
+}
+
+void
+xfpm_startup_run (XfpmStartup *startup)
+{
+  g_return_if_fail (XFPM_IS_STARTUP (startup));
+  g_return_if_fail (!startup->priv->running);
+
+  startup->priv->running = TRUE;
+
+  xfpm_startup_queue_ready (startup);
+}
+
+void
+xfpm_startup_task_done (XfpmStartup *startup, const gchar *name)
+{
+  StartupTask *task;
+  gint64 end;
+
+  g_return_if_fail (XFPM_IS_STARTUP (startup));
+
+  task = g_hash_table_lookup (startup->priv->index, name);
+
+  g_return_if_fail (task != NULL);
+  g_return_if_fail (task->state == TASK_RUNNING);
+
+  end = g_get_monotonic_time ();
+  task->state = TASK_DONE;
+  startup->priv->pending--;
+
+  XFPM_DEBUG ("Finished %s in %.1f ms", task->name, (end - task->begin) / 1000.0);
+
+  xfpm_startup_profile_add (task->name, task->queued, task->begin, end);
+
+  if ( startup->priv->pending == 0 )
+  {
+    XFPM_DEBUG ("All startup tasks finished");
+    g_signal_emit (G_OBJECT (startup), signals [FINISHED], 0);
+    xfpm_startup_profile_dump ();
+    return;
+  }
+
+  xfpm_startup_queue_ready (startup);
+}
+
+gboolean
+xfpm_startup_is_done (XfpmStartup *startup, const gchar *name)
+{
+  StartupTask *task;
+
+  g_return_val_if_fail (XFPM_IS_STARTUP (startup), FALSE);
+
+  task = g_hash_table_lookup (startup->priv->index, name);
+
+  return task != NULL && task->state == TASK_DONE;
+}
+
+/*
+ * Startup profiling, enabled with --profile-startup
+ */
+void
+xfpm_startup_profile_init (gboolean enable)
+{
+  profile_enabled = enable;
+
+  if ( profile_origin == 0 )
+    profile_origin = g_get_monotonic_time ();
+
+  if ( enable && profile_entries == NULL )
+    profile_entries = g_array_new (FALSE, TRUE, sizeof (ProfileEntry));
+}
+
+gboolean
+xfpm_startup_profile_enabled (void)
+{
+  return profile_enabled;
+}
+
+/**
+ * xfpm_startup_profile_add:
+ * @queued: when the component became runnable, 0 if it was started directly
+ * @begin: when the component started to initialize
+ * @end: when the component was ready
+ *
+ * All times are g_get_monotonic_time () values.
+ **/
+void
+xfpm_startup_profile_add (const gchar *component, gint64 queued, gint64 begin, gint64 end)
+{
+  ProfileEntry entry;
+
+  if ( !profile_enabled )
+    return;
+
+  entry.component = g_strdup (component);
+  entry.queued = queued != 0 ? queued : begin;
+  entry.begin = begin;
+  entry.end = end;
+
+  g_array_append_val (profile_entries, entry);
+}
+
+static gint
+xfpm_startup_profile_compare (gconstpointer a, gconstpointer b)
+{
+  const ProfileEntry *ea = a;
+  const ProfileEntry *eb = b;
+
+  if ( ea->begin != eb->begin )
+    return ea->begin < eb->begin ? -1 : 1;
+
+  return ea->end < eb->end ? -1 : ea->end > eb->end;
+}
+
+void
+xfpm_startup_profile_dump (void)
+{
+  gint64 last = 0;
+  guint i;
+
+  if ( !profile_enabled || profile_entries->len == 0 )
+    return;
+
+  g_array_sort (profile_entries, xfpm_startup_profile_compare);
+
+  g_print ("---------------------------------------------------\n");
+  g_print ("       Xfce power manager startup profile\n");
+  g_print ("---------------------------------------------------\n");
+  g_print ("%-20s %10s %10s %10s %10s\n", "component", "wait(ms)", "start(ms)", "end(ms)", "took(ms)");
+
+  for ( i = 0; i < profile_entries->len; i++ )
+  {
+    ProfileEntry *entry = &g_array_index (profile_entries, ProfileEntry, i);
+
+    g_print ("%-20s %10.1f %10.1f %10.1f %10.1f\n",
+             entry->component,
+             (entry->begin - entry->queued) / 1000.0,
+             (entry->begin - profile_origin) / 1000.0,
+             (entry->end - profile_origin) / 1000.0,
+             (entry->end - entry->begin) / 1000.0);
+
+    last = MAX (last, entry->end);
+    g_free (entry->component);
+  }
+
+  g_print ("%-20s %10s %10s %10.1f\n", "total", "", "", (last - profile_origin) / 1000.0);
+
+  g_array_set_size (profile_entries, 0);
+}
@@ -0,0 +1,79 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __XFPM_STARTUP_H
+#define __XFPM_STARTUP_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define XFPM_TYPE_STARTUP        (xfpm_startup_get_type () )
+#define XFPM_STARTUP(o)          (G_TYPE_CHECK_INSTANCE_CAST((o), XFPM_TYPE_STARTUP, XfpmStartup))
+#define XFPM_IS_STARTUP(o)       (G_TYPE_CHECK_INSTANCE_TYPE((o), XFPM_TYPE_STARTUP))
+
+typedef struct XfpmStartupPrivate XfpmStartupPrivate;
+
+typedef struct
+{
+  GObject               parent;
+  XfpmStartupPrivate   *priv;
+} XfpmStartup;
+
+typedef struct
+{
+  GObjectClass     parent_class;
+
+  /* signals */
+  void            (*finished)        (XfpmStartup *startup);
+} XfpmStartupClass;
+
+/*
+ * A startup task is started once all the tasks listed in its
+ * dependencies have completed. It must call xfpm_startup_task_done ()
+ * when it is finished, either directly or from an async callback.
+ */
+typedef void (*XfpmStartupFunc) (XfpmStartup *startup,
+                                 gpointer     user_data);
+
+GType              xfpm_startup_get_type         (void) G_GNUC_CONST;
+XfpmStartup       *xfpm_startup_new              (void);
+void               xfpm_startup_add              (XfpmStartup    *startup,
+                                                  const gchar    *name,
+                                                  const gchar    *after,
+                                                  XfpmStartupFunc func,
+                                                  gpointer        user_data);
+void               xfpm_startup_run              (XfpmStartup    *startup);
+void               xfpm_startup_task_done        (XfpmStartup    *startup,
+                                                  const gchar    *name);
+gboolean           xfpm_startup_is_done          (XfpmStartup    *startup,
+                                                  const gchar    *name);
+
+void               xfpm_startup_profile_init     (gboolean        enable);
+gboolean           xfpm_startup_profile_enabled  (void);
+void               xfpm_startup_profile_add      (const gchar    *component,
+                                                  gint64          queued,
+                                                  gint64          begin,
+                                                  gint64          end);
+void               xfpm_startup_profile_dump     (void);
+
+G_END_DECLS
+
+#endif /* __XFPM_STARTUP_H */
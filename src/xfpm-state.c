@@ -0,0 +1,811 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <upower.h>
+
+#include "xfpm-state.h"
+#include "xfpm-power.h"
+#include "xfpm-energy.h"
+#include "xfpm-inhibit.h"
+#include "xfpm-config.h"
+#include "xfpm-debug.h"
+
+static void xfpm_state_finalize   (GObject *object);
+
+/*
+ * The state the panel plugins and the systray icon show, kept by the
+ * daemon so that they don't each need their own UPower client and
+ * backlight access. Clients get a snapshot with GetState and then
+ * apply the StateChanged deltas in serial order, they call GetState
+ * again if they miss one.
+ */
+
+typedef struct
+{
+  XfpmState  *state;
+  /* An UpDevice, or the XfpmRapl pseudo device */
+  GObject    *device;
+  const gchar **prop_names;
+  gchar      *object_path;
+  /* property name -> GVariant, as last published */
+  GHashTable *props;
+  gulong      notify_id;
+} StateDevice;
+
+/* The UpDevice properties clients need for the icons, tooltips and
+ * descriptions, published under the same names */
+static const gchar *device_props[] =
+{
+  "kind",
+  "state",
+  "percentage",
+  "time-to-empty",
+  "time-to-full",
+  "icon-name",
+  "vendor",
+  "model",
+  "online",
+  "is-present",
+  NULL
+};
+
+/* Published for the CPU energy counters */
+static const gchar *rapl_props[] =
+{
+  XFPM_RAPL_ENERGY_RATE,
+  XFPM_RAPL_CORE_ENERGY_RATE,
+  XFPM_RAPL_UNCORE_ENERGY_RATE,
+  NULL
+};
+
+struct XfpmStatePrivate
+{
+  XfpmPower       *power;
+  UpClient        *upower;
+  XfpmBacklight   *backlight;
+  XfpmInhibit     *inhibit;
+  /* Created the first time someone asks for the top consumers */
+  XfpmEnergy      *energy;
+
+  gboolean         started;
+  guint64          serial;
+
+  /* object path -> StateDevice */
+  GHashTable      *devices;
+  UpDevice        *display_device;
+
+  /* Everything else, key -> GVariant */
+  GHashTable      *values;
+
+  /* Changes since the last StateChanged, sent together from an idle
+   * callback so that a burst of notifies goes out as one delta */
+  GHashTable      *changed_values;    /* set of keys */
+  GHashTable      *changed_devices;   /* object path -> set of property names */
+  GHashTable      *removed_devices;   /* set of object paths */
+  guint            flush_id;
+
+  /* SetBrightness writes one level at a time, a level asked for while
+   * one is written replaces the previous pending one. The tasks finish
+   * with the write that covered their level */
+  gboolean         brightness_in_flight;
+  GList           *brightness_writing;
+  gint32           brightness_pending;  /* -1 when there is nothing to write */
+  GList           *brightness_waiting;
+  guint            brightness_issued;
+  guint            brightness_dropped;
+};
+
+enum
+{
+  STATE_CHANGED,
+  LAST_SIGNAL
+};
+
+static guint signals [LAST_SIGNAL] = { 0 };
+
+G_DEFINE_TYPE_WITH_PRIVATE (XfpmState, xfpm_state, G_TYPE_OBJECT)
+
+static GVariant *
+xfpm_state_value_to_variant (const GValue *value)
+{
+  const gchar *str;
+
+  switch ( G_VALUE_TYPE (value) )
+  {
+    case G_TYPE_UINT:
+      return g_variant_new_uint32 (g_value_get_uint (value));
+    case G_TYPE_INT:
+      return g_variant_new_int32 (g_value_get_int (value));
+    case G_TYPE_UINT64:
+      return g_variant_new_uint64 (g_value_get_uint64 (value));
+    case G_TYPE_INT64:
+      return g_variant_new_int64 (g_value_get_int64 (value));
+    case G_TYPE_DOUBLE:
+      return g_variant_new_double (g_value_get_double (value));
+    case G_TYPE_BOOLEAN:
+      return g_variant_new_boolean (g_value_get_boolean (value));
+    case G_TYPE_STRING:
+      str = g_value_get_string (value);
+      return g_variant_new_string (str != NULL ? str : "");
+    default:
+      return NULL;
+  }
+}
+
+static gboolean
+xfpm_state_flush (gpointer user_data)
+{
+  XfpmState *state = XFPM_STATE (user_data);
+  GVariantBuilder builder;
+  GVariant *changes;
+  GHashTableIter iter;
+  gpointer key, value;
+
+  state->priv->flush_id = 0;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+
+  g_hash_table_iter_init (&iter, state->priv->changed_values);
+  while ( g_hash_table_iter_next (&iter, &key, NULL) )
+  {
+    GVariant *v = g_hash_table_lookup (state->priv->values, key);
+
+    if ( v != NULL )
+      g_variant_builder_add (&builder, "{sv}", key, v);
+  }
+
+  if ( g_hash_table_size (state->priv->removed_devices) > 0 )
+  {
+    GVariantBuilder removed;
+
+    g_variant_builder_init (&removed, G_VARIANT_TYPE_OBJECT_PATH_ARRAY);
+    g_hash_table_iter_init (&iter, state->priv->removed_devices);
+    while ( g_hash_table_iter_next (&iter, &key, NULL) )
+      g_variant_builder_add (&removed, "o", key);
+
+    g_variant_builder_add (&builder, "{sv}", XFPM_STATE_REMOVED_DEVICES,
+                           g_variant_builder_end (&removed));
+  }
+
+  if ( g_hash_table_size (state->priv->changed_devices) > 0 )
+  {
+    GVariantBuilder devices;
+
+    g_variant_builder_init (&devices, G_VARIANT_TYPE ("a{oa{sv}}"));
+    g_hash_table_iter_init (&iter, state->priv->changed_devices);
+    while ( g_hash_table_iter_next (&iter, &key, &value) )
+    {
+      StateDevice *sd = g_hash_table_lookup (state->priv->devices, key);
+      GVariantBuilder props;
+      GHashTableIter names;
+      gpointer name;
+
+      if ( sd == NULL )
+        continue;
+
+      g_variant_builder_init (&props, G_VARIANT_TYPE_VARDICT);
+      g_hash_table_iter_init (&names, value);
+      while ( g_hash_table_iter_next (&names, &name, NULL) )
+        g_variant_builder_add (&props, "{sv}", name, g_hash_table_lookup (sd->props, name));
+
+      g_variant_builder_add (&devices, "{oa{sv}}", key, &props);
+    }
+
+    g_variant_builder_add (&builder, "{sv}", XFPM_STATE_DEVICES,
+                           g_variant_builder_end (&devices));
+  }
+
+  g_hash_table_remove_all (state->priv->changed_values);
+  g_hash_table_remove_all (state->priv->changed_devices);
+  g_hash_table_remove_all (state->priv->removed_devices);
+
+  changes = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+  state->priv->serial++;
+  XFPM_DEBUG ("State serial %" G_GUINT64_FORMAT ": %u changes",
+              state->priv->serial, (guint) g_variant_n_children (changes));
+
+  g_signal_emit (G_OBJECT (state), signals [STATE_CHANGED], 0, state->priv->serial, changes);
+
+  g_variant_unref (changes);
+
+  return FALSE;
+}
+
+static void
+xfpm_state_queue_flush (XfpmState *state)
+{
+  if ( state->priv->flush_id == 0 )
+    state->priv->flush_id = g_idle_add (xfpm_state_flush, state);
+}
+
+/* Takes the floating reference of @value */
+static void
+xfpm_state_set_value (XfpmState *state, const gchar *key, GVariant *value)
+{
+  GVariant *old;
+
+  g_variant_ref_sink (value);
+
+  old = g_hash_table_lookup (state->priv->values, key);
+  if ( old != NULL && g_variant_equal (old, value) )
+  {
+    g_variant_unref (value);
+    return;
+  }
+
+  g_hash_table_replace (state->priv->values, (gpointer) key, value);
+  g_hash_table_add (state->priv->changed_values, (gpointer) key);
+  xfpm_state_queue_flush (state);
+}
+
+static void
+xfpm_state_device_update (StateDevice *sd, const gchar *name)
+{
+  XfpmState *state = sd->state;
+  GParamSpec *pspec;
+  GValue value = G_VALUE_INIT;
+  GVariant *v, *old;
+  GHashTable *names;
+
+  pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (sd->device), name);
+  if ( pspec == NULL )
+    return;
+
+  g_value_init (&value, pspec->value_type);
+  g_object_get_property (sd->device, name, &value);
+  v = xfpm_state_value_to_variant (&value);
+  g_value_unset (&value);
+
+  if ( v == NULL )
+    return;
+
+  g_variant_ref_sink (v);
+
+  old = g_hash_table_lookup (sd->props, name);
+  if ( old != NULL && g_variant_equal (old, v) )
+  {
+    g_variant_unref (v);
+    return;
+  }
+
+  g_hash_table_replace (sd->props, (gpointer) name, v);
+
+  names = g_hash_table_lookup (state->priv->changed_devices, sd->object_path);
+  if ( names == NULL )
+  {
+    names = g_hash_table_new (g_str_hash, g_str_equal);
+    g_hash_table_insert (state->priv->changed_devices, g_strdup (sd->object_path), names);
+  }
+  g_hash_table_add (names, (gpointer) name);
+
+  xfpm_state_queue_flush (state);
+}
+
+static void
+xfpm_state_device_notify_cb (GObject *device, GParamSpec *pspec, StateDevice *sd)
+{
+  guint i;
+
+  /* Only the published ones, using our own static strings as keys */
+  for ( i = 0; sd->prop_names[i] != NULL; i++ )
+  {
+    if ( g_strcmp0 (pspec->name, sd->prop_names[i]) == 0 )
+    {
+      xfpm_state_device_update (sd, sd->prop_names[i]);
+      return;
+    }
+  }
+}
+
+static void
+xfpm_state_device_free (StateDevice *sd)
+{
+  if ( sd->notify_id != 0 )
+    g_signal_handler_disconnect (sd->device, sd->notify_id);
+
+  g_object_unref (sd->device);
+  g_hash_table_destroy (sd->props);
+  g_free (sd->object_path);
+  g_free (sd);
+}
+
+static void
+xfpm_state_add_object (XfpmState *state, const gchar *object_path,
+                       GObject *device, const gchar **prop_names)
+{
+  StateDevice *sd;
+  guint i;
+
+  if ( object_path == NULL || g_hash_table_contains (state->priv->devices, object_path) )
+    return;
+
+  XFPM_DEBUG ("Publishing device %s", object_path);
+
+  sd = g_new0 (StateDevice, 1);
+  sd->state = state;
+  sd->device = g_object_ref (device);
+  sd->prop_names = prop_names;
+  sd->object_path = g_strdup (object_path);
+  sd->props = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) g_variant_unref);
+
+  g_hash_table_insert (state->priv->devices, sd->object_path, sd);
+
+  for ( i = 0; prop_names[i] != NULL; i++ )
+    xfpm_state_device_update (sd, prop_names[i]);
+
+  sd->notify_id = g_signal_connect (device, "notify",
+                                    G_CALLBACK (xfpm_state_device_notify_cb), sd);
+}
+
+static void
+xfpm_state_add_device (XfpmState *state, UpDevice *device)
+{
+  xfpm_state_add_object (state, up_device_get_object_path (device),
+                         G_OBJECT (device), device_props);
+}
+
+static void
+xfpm_state_remove_device (XfpmState *state, const gchar *object_path)
+{
+  if ( !g_hash_table_remove (state->priv->devices, object_path) )
+    return;
+
+  XFPM_DEBUG ("Device %s removed", object_path);
+
+  g_hash_table_remove (state->priv->changed_devices, object_path);
+  g_hash_table_add (state->priv->removed_devices, g_strdup (object_path));
+  xfpm_state_queue_flush (state);
+}
+
+static void
+xfpm_state_device_added_cb (UpClient *upower, UpDevice *device, XfpmState *state)
+{
+  xfpm_state_add_device (state, device);
+}
+
+static void
+xfpm_state_device_removed_cb (UpClient *upower, const gchar *object_path, XfpmState *state)
+{
+  xfpm_state_remove_device (state, object_path);
+}
+
+static void
+xfpm_state_upower_notify_cb (UpClient *upower, GParamSpec *pspec, XfpmState *state)
+{
+  xfpm_state_set_value (state, XFPM_STATE_ON_BATTERY,
+                        g_variant_new_boolean (up_client_get_on_battery (upower)));
+  xfpm_state_set_value (state, XFPM_STATE_LID_IS_PRESENT,
+                        g_variant_new_boolean (up_client_get_lid_is_present (upower)));
+}
+
+static void
+xfpm_state_brightness_changed_cb (XfpmBacklight *backlight, gint level, XfpmState *state)
+{
+  xfpm_state_set_value (state, XFPM_STATE_BRIGHTNESS, g_variant_new_int32 (level));
+}
+
+static void
+xfpm_state_inhibitors_changed_cb (XfpmInhibit *inhibit, gboolean is_inhibit, XfpmState *state)
+{
+  const gchar **inhibitors = xfpm_inhibit_get_inhibit_list (inhibit);
+
+  xfpm_state_set_value (state, XFPM_STATE_INHIBITORS, g_variant_new_strv (inhibitors, -1));
+  g_free (inhibitors);
+}
+
+static void
+xfpm_state_presentation_mode_cb (XfpmPower *power, GParamSpec *pspec, XfpmState *state)
+{
+  gboolean presentation_mode;
+
+  g_object_get (G_OBJECT (power), PRESENTATION_MODE, &presentation_mode, NULL);
+
+  xfpm_state_set_value (state, XFPM_STATE_PRESENTATION_MODE,
+                        g_variant_new_boolean (presentation_mode));
+}
+
+static void
+xfpm_state_class_init (XfpmStateClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  signals [STATE_CHANGED] =
+    g_signal_new ("state-changed",
+                  XFPM_TYPE_STATE,
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (XfpmStateClass, state_changed),
+                  NULL, NULL,
+                  g_cclosure_marshal_generic,
+                  G_TYPE_NONE, 2, G_TYPE_UINT64, G_TYPE_VARIANT);
+
+  object_class->finalize = xfpm_state_finalize;
+}
+
+static void
+xfpm_state_init (XfpmState *state)
+{
+  state->priv = xfpm_state_get_instance_private (state);
+
+  state->priv->devices = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                                (GDestroyNotify) xfpm_state_device_free);
+  state->priv->values = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                               (GDestroyNotify) g_variant_unref);
+  state->priv->changed_values = g_hash_table_new (g_str_hash, g_str_equal);
+  state->priv->changed_devices = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                                        (GDestroyNotify) g_hash_table_destroy);
+  state->priv->removed_devices = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  state->priv->brightness_pending = -1;
+}
+
+static void
+xfpm_state_finalize (GObject *object)
+{
+  XfpmState *state;
+
+  state = XFPM_STATE (object);
+
+  if ( state->priv->flush_id != 0 )
+    g_source_remove (state->priv->flush_id);
+
+  if ( state->priv->upower != NULL )
+  {
+    g_signal_handlers_disconnect_by_data (state->priv->upower, state);
+    g_object_unref (state->priv->upower);
+  }
+
+  if ( state->priv->backlight != NULL )
+  {
+    g_signal_handlers_disconnect_by_data (state->priv->backlight, state);
+    g_object_unref (state->priv->backlight);
+  }
+
+  if ( state->priv->inhibit != NULL )
+  {
+    g_signal_handlers_disconnect_by_data (state->priv->inhibit, state);
+    g_object_unref (state->priv->inhibit);
+  }
+
+  if ( state->priv->power != NULL )
+  {
+    g_signal_handlers_disconnect_by_data (state->priv->power, state);
+    g_object_unref (state->priv->power);
+  }
+
+  g_clear_object (&state->priv->display_device);
+  g_clear_object (&state->priv->energy);
+
+  g_hash_table_destroy (state->priv->changed_values);
+  g_hash_table_destroy (state->priv->changed_devices);
+  g_hash_table_destroy (state->priv->removed_devices);
+  g_hash_table_destroy (state->priv->devices);
+  g_hash_table_destroy (state->priv->values);
+
+  G_OBJECT_CLASS (xfpm_state_parent_class)->finalize (object);
+}
+
+XfpmState *
+xfpm_state_new (void)
+{
+  static gpointer xfpm_state_object = NULL;
+
+  if ( G_LIKELY (xfpm_state_object != NULL) )
+  {
+    g_object_ref (xfpm_state_object);
+  }
+  else
+  {
+    xfpm_state_object = g_object_new (XFPM_TYPE_STATE, NULL);
+    g_object_add_weak_pointer (xfpm_state_object, &xfpm_state_object);
+  }
+
+  return XFPM_STATE (xfpm_state_object);
+}
+
+/**
+ * xfpm_state_start:
+ * @backlight: the display backlight, or %NULL
+ *
+ * Starts publishing, until then the state is empty with serial 0.
+ * Everything known is sent as the first delta.
+ **/
+void
+xfpm_state_start (XfpmState *state, XfpmBacklight *backlight)
+{
+  GPtrArray *array;
+  XfpmRapl *rapl;
+  guint i;
+
+  g_return_if_fail (XFPM_IS_STATE (state));
+  g_return_if_fail (!state->priv->started);
+
+  state->priv->started = TRUE;
+
+  state->priv->power = xfpm_power_get ();
+  state->priv->upower = g_object_ref (xfpm_power_get_client (state->priv->power));
+  state->priv->inhibit = xfpm_inhibit_new ();
+
+  g_signal_connect (state->priv->upower, "device-added",
+                    G_CALLBACK (xfpm_state_device_added_cb), state);
+  g_signal_connect (state->priv->upower, "device-removed",
+                    G_CALLBACK (xfpm_state_device_removed_cb), state);
+  g_signal_connect (state->priv->upower, "notify",
+                    G_CALLBACK (xfpm_state_upower_notify_cb), state);
+  g_signal_connect (state->priv->inhibit, "inhibitors-list-changed",
+                    G_CALLBACK (xfpm_state_inhibitors_changed_cb), state);
+  g_signal_connect (state->priv->power, "notify::" PRESENTATION_MODE,
+                    G_CALLBACK (xfpm_state_presentation_mode_cb), state);
+
+  if ( backlight != NULL && xfpm_backlight_has_hw (backlight) )
+  {
+    state->priv->backlight = g_object_ref (backlight);
+    g_signal_connect (backlight, "brightness-changed",
+                      G_CALLBACK (xfpm_state_brightness_changed_cb), state);
+    xfpm_state_set_value (state, XFPM_STATE_BRIGHTNESS,
+                          g_variant_new_int32 (xfpm_backlight_get_level (backlight)));
+    xfpm_state_set_value (state, XFPM_STATE_BRIGHTNESS_MAX,
+                          g_variant_new_int32 (xfpm_backlight_get_max_level (backlight)));
+  }
+  else
+  {
+    xfpm_state_set_value (state, XFPM_STATE_BRIGHTNESS, g_variant_new_int32 (0));
+    xfpm_state_set_value (state, XFPM_STATE_BRIGHTNESS_MAX, g_variant_new_int32 (0));
+  }
+
+  xfpm_state_set_value (state, XFPM_STATE_BRIGHTNESS_WRITES, g_variant_new ("(uu)", 0, 0));
+
+  xfpm_state_upower_notify_cb (state->priv->upower, NULL, state);
+  xfpm_state_inhibitors_changed_cb (state->priv->inhibit, FALSE, state);
+  xfpm_state_presentation_mode_cb (state->priv->power, NULL, state);
+
+  state->priv->display_device = up_client_get_display_device (state->priv->upower);
+  if ( state->priv->display_device != NULL
+       && up_device_get_object_path (state->priv->display_device) != NULL )
+  {
+    xfpm_state_add_device (state, state->priv->display_device);
+    xfpm_state_set_value (state, XFPM_STATE_DISPLAY_DEVICE,
+                          g_variant_new_object_path (up_device_get_object_path (state->priv->display_device)));
+  }
+
+#if UP_CHECK_VERSION(0, 99, 8)
+  array = up_client_get_devices2 (state->priv->upower);
+#else
+  array = up_client_get_devices (state->priv->upower);
+#endif
+
+  if ( array != NULL )
+  {
+    for ( i = 0; i < array->len; i++ )
+      xfpm_state_add_device (state, g_ptr_array_index (array, i));
+    g_ptr_array_free (array, TRUE);
+  }
+
+  rapl = xfpm_power_get_rapl (state->priv->power);
+  if ( rapl != NULL )
+    xfpm_state_add_object (state, XFPM_STATE_RAPL_DEVICE, G_OBJECT (rapl), rapl_props);
+}
+
+/**
+ * xfpm_state_get_snapshot:
+ * @serial: (out): serial of the last delta included in the snapshot
+ *
+ * Returns: the whole state as a a{sv}, unref it when done.
+ **/
+GVariant *
+xfpm_state_get_snapshot (XfpmState *state, guint64 *serial)
+{
+  GVariantBuilder builder, devices;
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_return_val_if_fail (XFPM_IS_STATE (state), NULL);
+
+  /* Pending changes have to go out first, the serial must cover them */
+  if ( state->priv->flush_id != 0 )
+  {
+    g_source_remove (state->priv->flush_id);
+    xfpm_state_flush (state);
+  }
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+
+  g_hash_table_iter_init (&iter, state->priv->values);
+  while ( g_hash_table_iter_next (&iter, &key, &value) )
+    g_variant_builder_add (&builder, "{sv}", key, value);
+
+  g_variant_builder_init (&devices, G_VARIANT_TYPE ("a{oa{sv}}"));
+  g_hash_table_iter_init (&iter, state->priv->devices);
+  while ( g_hash_table_iter_next (&iter, &key, &value) )
+  {
+    StateDevice *sd = value;
+    GVariantBuilder props;
+    GHashTableIter names;
+    gpointer name, v;
+
+    g_variant_builder_init (&props, G_VARIANT_TYPE_VARDICT);
+    g_hash_table_iter_init (&names, sd->props);
+    while ( g_hash_table_iter_next (&names, &name, &v) )
+      g_variant_builder_add (&props, "{sv}", name, v);
+
+    g_variant_builder_add (&devices, "{oa{sv}}", key, &props);
+  }
+  g_variant_builder_add (&builder, "{sv}", XFPM_STATE_DEVICES, g_variant_builder_end (&devices));
+
+  if ( serial != NULL )
+    *serial = state->priv->serial;
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+static void xfpm_state_write_brightness (XfpmState *state, gint32 level, GList *tasks);
+
+static void
+xfpm_state_set_brightness_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  XfpmState *state = XFPM_STATE (user_data);
+  GList *tasks, *li;
+  GError *error = NULL;
+
+  xfpm_backlight_set_level_finish (XFPM_BACKLIGHT (source_object), res, &error);
+
+  tasks = state->priv->brightness_writing;
+  state->priv->brightness_writing = NULL;
+  state->priv->brightness_in_flight = FALSE;
+
+  for ( li = tasks; li != NULL; li = li->next )
+  {
+    if ( error != NULL )
+      g_task_return_error (li->data, g_error_copy (error));
+    else
+      g_task_return_boolean (li->data, TRUE);
+
+    g_object_unref (li->data);
+  }
+
+  g_list_free (tasks);
+
+  if ( error != NULL )
+    g_error_free (error);
+
+  /* The newest level asked for meanwhile */
+  if ( state->priv->brightness_pending >= 0 )
+  {
+    tasks = state->priv->brightness_waiting;
+    state->priv->brightness_waiting = NULL;
+
+    xfpm_state_write_brightness (state, state->priv->brightness_pending, tasks);
+    state->priv->brightness_pending = -1;
+  }
+
+  g_object_unref (state);
+}
+
+static void
+xfpm_state_write_brightness (XfpmState *state, gint32 level, GList *tasks)
+{
+  state->priv->brightness_in_flight = TRUE;
+  state->priv->brightness_writing = tasks;
+  state->priv->brightness_issued++;
+
+  xfpm_state_set_value (state, XFPM_STATE_BRIGHTNESS_WRITES,
+                        g_variant_new ("(uu)", state->priv->brightness_issued,
+                                       state->priv->brightness_dropped));
+
+  xfpm_backlight_set_level (state->priv->backlight, level,
+                            xfpm_state_set_brightness_cb, g_object_ref (state));
+}
+
+/**
+ * xfpm_state_set_brightness:
+ *
+ * Sets the backlight level without blocking, the new level is
+ * published once it was written. Only one level is written at a time,
+ * calls made meanwhile are coalesced to the newest level and finish
+ * once that one is written.
+ **/
+void
+xfpm_state_set_brightness (XfpmState *state, gint32 level,
+                           GAsyncReadyCallback callback, gpointer user_data)
+{
+  GTask *task;
+
+  g_return_if_fail (XFPM_IS_STATE (state));
+
+  task = g_task_new (state, NULL, callback, user_data);
+
+  if ( state->priv->backlight == NULL )
+  {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                             "No brightness control available");
+    g_object_unref (task);
+    return;
+  }
+
+  if ( !state->priv->brightness_in_flight )
+  {
+    xfpm_state_write_brightness (state, level, g_list_prepend (NULL, task));
+    return;
+  }
+
+  if ( state->priv->brightness_pending >= 0 )
+  {
+    state->priv->brightness_dropped++;
+
+    xfpm_state_set_value (state, XFPM_STATE_BRIGHTNESS_WRITES,
+                          g_variant_new ("(uu)", state->priv->brightness_issued,
+                                         state->priv->brightness_dropped));
+  }
+
+  state->priv->brightness_pending = MAX (level, 0);
+  state->priv->brightness_waiting = g_list_prepend (state->priv->brightness_waiting, task);
+}
+
+gboolean
+xfpm_state_set_brightness_finish (XfpmState *state, GAsyncResult *result, GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, state), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+gboolean
+xfpm_state_step_brightness (XfpmState *state, gboolean up)
+{
+  g_return_val_if_fail (XFPM_IS_STATE (state), FALSE);
+
+  if ( state->priv->backlight == NULL )
+    return FALSE;
+
+  return xfpm_backlight_step (state->priv->backlight, up);
+}
+
+/**
+ * xfpm_state_get_top_consumers:
+ * @count: how many processes to return at most
+ *
+ * The processes that use the most power, see
+ * xfpm_energy_get_top_consumers(). Sampling goes on for a while after
+ * each call, clients showing the list call this periodically.
+ *
+ * Returns: a floating (da(usdd))
+ **/
+GVariant *
+xfpm_state_get_top_consumers (XfpmState *state, guint count)
+{
+  g_return_val_if_fail (XFPM_IS_STATE (state), NULL);
+
+  if ( state->priv->energy == NULL )
+    state->priv->energy = xfpm_energy_new ();
+
+  return xfpm_energy_get_top_consumers (state->priv->energy, count);
+}
@@ -0,0 +1,95 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef __XFPM_STATE_H
+#define __XFPM_STATE_H
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "xfpm-backlight.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Format of the state published on org.xfce.Power.Manager, GetState
+ * returns everything, StateChanged only what changed since the
+ * previous serial. Bump the version on incompatible changes.
+ */
+#define XFPM_STATE_VERSION                 1
+
+#define XFPM_STATE_DEVICES                 "devices"            /* a{oa{sv}} */
+#define XFPM_STATE_REMOVED_DEVICES         "removed-devices"    /* ao, deltas only */
+#define XFPM_STATE_DISPLAY_DEVICE          "display-device"     /* o */
+#define XFPM_STATE_ON_BATTERY              "on-battery"         /* b */
+#define XFPM_STATE_LID_IS_PRESENT          "lid-is-present"     /* b */
+#define XFPM_STATE_BRIGHTNESS              "brightness"         /* i */
+#define XFPM_STATE_BRIGHTNESS_MAX          "brightness-max"     /* i, 0 without a backlight */
+#define XFPM_STATE_BRIGHTNESS_WRITES       "brightness-writes"  /* (uu), levels written and coalesced */
+#define XFPM_STATE_INHIBITORS              "inhibitors"         /* as */
+#define XFPM_STATE_PRESENTATION_MODE       "presentation-mode"  /* b */
+
+/* Not a UPower device, the CPU energy counters with the rates of
+ * xfpm-rapl.h as doubles, present only if the system has them */
+#define XFPM_STATE_RAPL_DEVICE             "/org/xfce/PowerManager/devices/rapl"
+
+#define XFPM_TYPE_STATE        (xfpm_state_get_type () )
+#define XFPM_STATE(o)          (G_TYPE_CHECK_INSTANCE_CAST((o), XFPM_TYPE_STATE, XfpmState))
+#define XFPM_IS_STATE(o)       (G_TYPE_CHECK_INSTANCE_TYPE((o), XFPM_TYPE_STATE))
+
+typedef struct XfpmStatePrivate XfpmStatePrivate;
+
+typedef struct
+{
+  GObject               parent;
+  XfpmStatePrivate     *priv;
+} XfpmState;
+
+typedef struct
+{
+  GObjectClass          parent_class;
+
+  void                (*state_changed)    (XfpmState *state,
+                                           guint64    serial,
+                                           GVariant  *changes);
+} XfpmStateClass;
+
+GType              xfpm_state_get_type          (void) G_GNUC_CONST;
+XfpmState         *xfpm_state_new               (void);
+void               xfpm_state_start             (XfpmState     *state,
+                                                 XfpmBacklight *backlight);
+GVariant          *xfpm_state_get_snapshot      (XfpmState     *state,
+                                                 guint64       *serial);
+void               xfpm_state_set_brightness    (XfpmState     *state,
+                                                 gint32         level,
+                                                 GAsyncReadyCallback callback,
+                                                 gpointer       user_data);
+gboolean           xfpm_state_set_brightness_finish (XfpmState  *state,
+                                                 GAsyncResult  *result,
+                                                 GError       **error);
+gboolean           xfpm_state_step_brightness   (XfpmState     *state,
+                                                 gboolean       up);
+GVariant          *xfpm_state_get_top_consumers (XfpmState     *state,
+                                                 guint          count);
+
+G_END_DECLS
+
+#endif /* __XFPM_STATE_H */
@@ -0,0 +1,453 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Writes the sysfs attributes the power manager changes per power
+ * source, so it needs a single pkexec round trip for each batch:
+ *
+ *   cpufreq --policy NAME:GOVERNOR:EPP:MAX_FREQ
+ *     The governor, energy performance preference and maximum frequency
+ *     of a cpufreq policy, e.g. policy0:powersave:power:1800000
+ *
+ *   runtime-pm --device BUS/NAME,CONTROL,DELAY
+ *     The runtime power management control and autosuspend delay of a
+ *     PCI or USB device, e.g. pci/0000:00:14.0,auto,
+ *
+ * The option can be repeated, an empty field leaves that setting alone.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <glib.h>
+
+#define EXIT_CODE_SUCCESS           0
+#define EXIT_CODE_FAILED            1
+#define EXIT_CODE_ARGUMENTS_INVALID 3
+#define EXIT_CODE_INVALID_USER      4
+
+#define CPUFREQ_SYSFS_LOCATION      "devices/system/cpu/cpufreq"
+
+typedef gint (*SysfsHelperApplyFunc) (const gchar *root, const gchar *arg);
+
+static gchar *
+sysfs_helper_read (const gchar *dir, const gchar *name)
+{
+  gchar *filename;
+  gchar *contents = NULL;
+
+  filename = g_build_filename (dir, name, NULL);
+  if ( g_file_get_contents (filename, &contents, NULL, NULL) )
+    g_strstrip (contents);
+  g_free (filename);
+
+  return contents;
+}
+
+static gboolean
+sysfs_helper_write (const gchar *dir, const gchar *name, const gchar *value)
+{
+  gchar *current;
+  gchar *filename;
+  FILE *file;
+  gboolean ret = TRUE;
+
+  /* Nothing to do, and intel_pstate refuses some rewrites with EBUSY */
+  current = sysfs_helper_read (dir, name);
+  if ( g_strcmp0 (current, value) == 0 )
+  {
+    g_free (current);
+    return TRUE;
+  }
+  g_free (current);
+
+  filename = g_build_filename (dir, name, NULL);
+
+  file = fopen (filename, "w");
+  if ( file == NULL )
+  {
+    g_print ("Could not open %s\n", filename);
+    g_free (filename);
+    return FALSE;
+  }
+
+  if ( fputs (value, file) < 0 )
+    ret = FALSE;
+  if ( fclose (file) != 0 )
+    ret = FALSE;
+
+  if ( !ret )
+    g_print ("Could not write %s to %s\n", value, filename);
+
+  g_free (filename);
+  return ret;
+}
+
+/*
+ * The value has to be one of the words the kernel lists as available,
+ * anything else is refused before it gets anywhere near sysfs.
+ */
+static gboolean
+cpufreq_is_available (const gchar *dir, const gchar *list_name, const gchar *value)
+{
+  gchar *list;
+  gchar **words;
+  gboolean found = FALSE;
+  guint i;
+
+  list = sysfs_helper_read (dir, list_name);
+  if ( list == NULL )
+    return FALSE;
+
+  words = g_strsplit_set (list, " \t\n", -1);
+  for ( i = 0; !found && words[i] != NULL; i++ )
+    found = *words[i] != '\0' && g_strcmp0 (words[i], value) == 0;
+
+  g_strfreev (words);
+  g_free (list);
+
+  return found;
+}
+
+static gboolean
+cpufreq_freq_in_range (const gchar *dir, guint64 freq)
+{
+  gchar *min_str;
+  gchar *max_str;
+  gboolean ret = FALSE;
+
+  min_str = sysfs_helper_read (dir, "cpuinfo_min_freq");
+  max_str = sysfs_helper_read (dir, "cpuinfo_max_freq");
+
+  if ( min_str != NULL && max_str != NULL )
+    ret = freq >= g_ascii_strtoull (min_str, NULL, 10) &&
+          freq <= g_ascii_strtoull (max_str, NULL, 10);
+
+  g_free (min_str);
+  g_free (max_str);
+
+  return ret;
+}
+
+static gboolean
+cpufreq_is_policy_name (const gchar *name)
+{
+  const gchar *p;
+
+  if ( !g_str_has_prefix (name, "policy") || name[6] == '\0' )
+    return FALSE;
+
+  for ( p = name + 6; *p != '\0'; p++ )
+    if ( !g_ascii_isdigit (*p) )
+      return FALSE;
+
+  return TRUE;
+}
+
+/*
+ * Validates every field first so a bad argument doesn't leave the
+ * policy half written. The governor goes first, intel_pstate only
+ * accepts a preference other than performance under powersave.
+ */
+static gint
+cpufreq_apply (const gchar *root, const gchar *arg)
+{
+  gchar **fields;
+  gchar *dir = NULL;
+  const gchar *governor;
+  const gchar *epp;
+  const gchar *max_freq;
+  guint64 freq = 0;
+  gchar *end = NULL;
+  gint retval = EXIT_CODE_SUCCESS;
+
+  fields = g_strsplit (arg, ":", 4);
+
+  if ( g_strv_length (fields) != 4 || !cpufreq_is_policy_name (fields[0]) )
+  {
+    g_print ("Invalid policy argument %s\n", arg);
+    retval = EXIT_CODE_ARGUMENTS_INVALID;
+    goto out;
+  }
+
+  governor = fields[1];
+  epp = fields[2];
+  max_freq = fields[3];
+
+  dir = g_build_filename (root, CPUFREQ_SYSFS_LOCATION, fields[0], NULL);
+  if ( !g_file_test (dir, G_FILE_TEST_IS_DIR) )
+  {
+    g_print ("No cpufreq policy %s\n", fields[0]);
+    retval = EXIT_CODE_ARGUMENTS_INVALID;
+    goto out;
+  }
+
+  if ( *governor != '\0' &&
+       !cpufreq_is_available (dir, "scaling_available_governors", governor) )
+  {
+    g_print ("Governor %s is not available for %s\n", governor, fields[0]);
+    retval = EXIT_CODE_ARGUMENTS_INVALID;
+    goto out;
+  }
+
+  if ( *epp != '\0' &&
+       !cpufreq_is_available (dir, "energy_performance_available_preferences", epp) )
+  {
+    g_print ("Energy performance preference %s is not available for %s\n", epp, fields[0]);
+    retval = EXIT_CODE_ARGUMENTS_INVALID;
+    goto out;
+  }
+
+  if ( *max_freq != '\0' )
+  {
+    freq = g_ascii_strtoull (max_freq, &end, 10);
+    if ( *end != '\0' || !cpufreq_freq_in_range (dir, freq) )
+    {
+      g_print ("Frequency %s is out of range for %s\n", max_freq, fields[0]);
+      retval = EXIT_CODE_ARGUMENTS_INVALID;
+      goto out;
+    }
+  }
+
+  if ( *governor != '\0' && !sysfs_helper_write (dir, "scaling_governor", governor) )
+    retval = EXIT_CODE_FAILED;
+
+  if ( *epp != '\0' && !sysfs_helper_write (dir, "energy_performance_preference", epp) )
+    retval = EXIT_CODE_FAILED;
+
+  if ( *max_freq != '\0' )
+  {
+    gchar value[32];
+
+    g_snprintf (value, sizeof (value), "%" G_GUINT64_FORMAT, freq);
+    if ( !sysfs_helper_write (dir, "scaling_max_freq", value) )
+      retval = EXIT_CODE_FAILED;
+  }
+
+out:
+  g_strfreev (fields);
+  g_free (dir);
+  return retval;
+}
+
+/*
+ * Only bus/usb/devices/X and bus/pci/devices/X, a name can't climb
+ * out of the bus directory.
+ */
+static gchar *
+runtime_pm_get_power_dir (const gchar *root, const gchar *device)
+{
+  const gchar *name;
+  gchar *bus;
+  gchar *dir;
+
+  name = strchr (device, '/');
+  if ( name == NULL )
+    return NULL;
+
+  bus = g_strndup (device, name - device);
+  name++;
+
+  if ( (g_strcmp0 (bus, "pci") != 0 && g_strcmp0 (bus, "usb") != 0) ||
+       *name == '\0' || strchr (name, '/') != NULL ||
+       g_strcmp0 (name, ".") == 0 || g_strcmp0 (name, "..") == 0 )
+  {
+    g_free (bus);
+    return NULL;
+  }
+
+  dir = g_build_filename (root, "bus", bus, "devices", name, "power", NULL);
+  g_free (bus);
+
+  return dir;
+}
+
+static gint
+runtime_pm_apply (const gchar *root, const gchar *arg)
+{
+  gchar **fields;
+  gchar *dir = NULL;
+  const gchar *control;
+  const gchar *delay;
+  gchar *end = NULL;
+  gint retval = EXIT_CODE_SUCCESS;
+
+  fields = g_strsplit (arg, ",", 3);
+
+  if ( g_strv_length (fields) != 3 ||
+       (dir = runtime_pm_get_power_dir (root, fields[0])) == NULL )
+  {
+    g_print ("Invalid device argument %s\n", arg);
+    retval = EXIT_CODE_ARGUMENTS_INVALID;
+    goto out;
+  }
+
+  control = fields[1];
+  delay = fields[2];
+
+  if ( !g_file_test (dir, G_FILE_TEST_IS_DIR) )
+  {
+    g_print ("No device %s\n", fields[0]);
+    retval = EXIT_CODE_ARGUMENTS_INVALID;
+    goto out;
+  }
+
+  if ( *control != '\0' && g_strcmp0 (control, "auto") != 0 && g_strcmp0 (control, "on") != 0 )
+  {
+    g_print ("Invalid power control %s for %s\n", control, fields[0]);
+    retval = EXIT_CODE_ARGUMENTS_INVALID;
+    goto out;
+  }
+
+  if ( *delay != '\0' )
+  {
+    /* -1 is valid, it keeps the device from autosuspending */
+    g_ascii_strtoll (delay, &end, 10);
+    if ( *end != '\0' )
+    {
+      g_print ("Invalid autosuspend delay %s for %s\n", delay, fields[0]);
+      retval = EXIT_CODE_ARGUMENTS_INVALID;
+      goto out;
+    }
+  }
+
+  /* Set the delay first, so the device doesn't suspend on the old one */
+  if ( *delay != '\0' && !sysfs_helper_write (dir, "autosuspend_delay_ms", delay) )
+    retval = EXIT_CODE_FAILED;
+
+  if ( *control != '\0' && !sysfs_helper_write (dir, "control", control) )
+    retval = EXIT_CODE_FAILED;
+
+out:
+  g_strfreev (fields);
+  g_free (dir);
+  return retval;
+}
+
+static const struct
+{
+  const gchar          *command;
+  const gchar          *option;
+  const gchar          *description;
+  SysfsHelperApplyFunc  apply;
+} commands[] =
+{
+  { "cpufreq", "policy",
+    "Set a cpufreq policy, given as NAME:GOVERNOR:EPP:MAX_FREQ", cpufreq_apply },
+  { "runtime-pm", "device",
+    "Set the runtime power management of a device, given as BUS/NAME,CONTROL,DELAY", runtime_pm_apply },
+};
+
+gint
+main (gint argc, gchar *argv[])
+{
+  GOptionContext *context;
+  GOptionEntry options[2];
+  gint uid;
+  gint euid;
+  gint retval = EXIT_CODE_SUCCESS;
+  const gchar *pkexec_uid_str;
+  const gchar *root;
+  gchar **values = NULL;
+  guint command;
+  guint i;
+
+  for (command = 0; command < G_N_ELEMENTS (commands); command++)
+    if (argc > 1 && g_strcmp0 (argv[1], commands[command].command) == 0)
+      break;
+
+  if (command == G_N_ELEMENTS (commands)) {
+    puts ("Usage: xfpm-power-sysfs-helper cpufreq|runtime-pm OPTION...");
+    return EXIT_CODE_ARGUMENTS_INVALID;
+  }
+
+  memset (options, 0, sizeof (options));
+  options[0].long_name = commands[command].option;
+  options[0].arg = G_OPTION_ARG_STRING_ARRAY;
+  options[0].arg_data = &values;
+  options[0].description = commands[command].description;
+
+  /* the command takes the place of the program name */
+  argc--;
+  argv++;
+
+  context = g_option_context_new (NULL);
+  g_option_context_set_summary (context, "XFCE Power Manager Sysfs Helper");
+  g_option_context_add_main_entries (context, options, NULL);
+  g_option_context_parse (context, &argc, &argv, NULL);
+  g_option_context_free (context);
+
+  /* no input */
+  if (values == NULL) {
+    puts ("No valid option was specified");
+    return EXIT_CODE_ARGUMENTS_INVALID;
+  }
+
+  /*
+   * pkexec clears the environment, so a sysfs root can only come from
+   * someone running us directly, e.g. against a fixture tree, and then
+   * we can only write what they could write anyway.
+   */
+  root = g_getenv ("XFPM_SYSFS_ROOT");
+  if (root == NULL || *root == '\0') {
+    root = "/sys";
+
+    /* get calling process */
+    uid = getuid ();
+    euid = geteuid ();
+    if (uid != 0 || euid != 0) {
+      puts ("This program can only be used by the root user");
+      g_strfreev (values);
+      return EXIT_CODE_ARGUMENTS_INVALID;
+    }
+
+    /* check we're not being spoofed */
+    pkexec_uid_str = g_getenv ("PKEXEC_UID");
+    if (pkexec_uid_str == NULL) {
+      puts ("This program must only be run through pkexec");
+      g_strfreev (values);
+      return EXIT_CODE_INVALID_USER;
+    }
+  }
+
+  /* keep going on failure, an offline policy or an unplugged device
+   * shouldn't stop the others */
+  for (i = 0; values[i] != NULL; i++) {
+    gint ret = commands[command].apply (root, values[i]);
+
+    if (ret != EXIT_CODE_SUCCESS && retval == EXIT_CODE_SUCCESS)
+      retval = ret;
+  }
+
+  g_strfreev (values);
+  return retval;
+}
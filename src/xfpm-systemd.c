@@ -49,6 +49,8 @@ struct XfpmSystemdPrivate
     gboolean         can_restart;
     gboolean         can_suspend;
     gboolean         can_hibernate;
+    /* Asked once at startup, logind blocks on the swap checks */
+    gboolean         can_suspend_then_hibernate;
 #ifdef ENABLE_POLKIT
     XfpmPolkit      *polkit;
 #endif
@@ -70,6 +72,7 @@ G_DEFINE_TYPE_WITH_PRIVATE (XfpmSystemd, xfpm_systemd, G_TYPE_OBJECT)
 #define SYSTEMD_DBUS_INTERFACE          "org.freedesktop.login1.Manager"
 #define SYSTEMD_REBOOT_ACTION           "Reboot"
 #define SYSTEMD_POWEROFF_ACTION         "PowerOff"
+#define SYSTEMD_CAN_SUSPEND_THEN_HIBERNATE "CanSuspendThenHibernate"
 #define SYSTEMD_REBOOT_TEST             "org.freedesktop.login1.reboot"
 #define SYSTEMD_POWEROFF_TEST           "org.freedesktop.login1.power-off"
 #define SYSTEMD_SUSPEND_TEST            "org.freedesktop.login1.suspend"
@@ -129,6 +132,55 @@ xfpm_systemd_can_method (XfpmSystemd  *systemd,
     return FALSE;
 }
 
+static void
+xfpm_systemd_can_suspend_then_hibernate_cb (GObject      *source,
+                                            GAsyncResult *res,
+                                            gpointer      user_data)
+{
+    XfpmSystemd *systemd = XFPM_SYSTEMD (user_data);
+    GVariant    *var;
+    const gchar *answer;
+
+    var = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), res, NULL);
+    if (var != NULL)
+    {
+        g_variant_get (var, "(&s)", &answer);
+        systemd->priv->can_suspend_then_hibernate = g_strcmp0 (answer, "yes") == 0;
+        g_variant_unref (var);
+    }
+
+    g_object_unref (systemd);
+}
+
+static void
+xfpm_systemd_bus_ready_cb (GObject      *source,
+                           GAsyncResult *res,
+                           gpointer      user_data)
+{
+    XfpmSystemd     *systemd = XFPM_SYSTEMD (user_data);
+    GDBusConnection *bus;
+
+    bus = g_bus_get_finish (res, NULL);
+    if (bus == NULL)
+    {
+        g_object_unref (systemd);
+        return;
+    }
+
+    g_dbus_connection_call (bus,
+                            SYSTEMD_DBUS_NAME,
+                            SYSTEMD_DBUS_PATH,
+                            SYSTEMD_DBUS_INTERFACE,
+                            SYSTEMD_CAN_SUSPEND_THEN_HIBERNATE,
+                            NULL,
+                            G_VARIANT_TYPE ("(s)"),
+                            G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+                            xfpm_systemd_can_suspend_then_hibernate_cb,
+                            systemd);
+
+    g_object_unref (bus);
+}
+
 static void
 xfpm_systemd_init (XfpmSystemd *systemd)
 {
@@ -151,6 +203,8 @@ xfpm_systemd_init (XfpmSystemd *systemd)
     xfpm_systemd_can_method (systemd,
                              &systemd->priv->can_hibernate,
                              SYSTEMD_HIBERNATE_TEST);
+
+    g_bus_get (G_BUS_TYPE_SYSTEM, NULL, xfpm_systemd_bus_ready_cb, g_object_ref (systemd));
 }
 
 static void xfpm_systemd_get_property (GObject *object,
@@ -261,6 +315,16 @@ void xfpm_systemd_reboot (XfpmSystemd *systemd, GError **error)
                              error);
 }
 
+/*
+ * Answered from what logind said at startup, the call can take a while
+ * and this is asked on the way to suspending. Until the answer is in
+ * we do the timed wake ourselves.
+ */
+gboolean xfpm_systemd_can_suspend_then_hibernate (XfpmSystemd *systemd)
+{
+    return systemd->priv->can_suspend_then_hibernate;
+}
+
 void xfpm_systemd_sleep (XfpmSystemd *systemd,
                          const gchar *method,
                          GError **error)
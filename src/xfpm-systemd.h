@@ -61,6 +61,8 @@ void                xfpm_systemd_sleep (XfpmSystemd *systemd,
                                         const gchar *method,
                                         GError **error);
 
+gboolean            xfpm_systemd_can_suspend_then_hibernate (XfpmSystemd *systemd);
+
 G_END_DECLS
 
 #endif /* __XFPM_SYSTEMD_H */
@@ -0,0 +1,621 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Watches the thermal zones and the CPU throttle counters and, while
+ * the system runs too hot, switches to a cooler power profile, lowers
+ * the brightness or tells the user. The zones are read every few
+ * seconds, a trip point uevent from the kernel triggers a read right
+ * away.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_LINUX_NETLINK_H
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/filter.h>
+#endif
+
+#include <gio/gio.h>
+
+#include <libxfce4util/libxfce4util.h>
+
+#include "xfpm-thermal.h"
+#include "xfpm-notify.h"
+#include "xfpm-xfconf.h"
+#include "xfpm-debug.h"
+
+static void xfpm_thermal_finalize   (GObject *object);
+
+/* Seconds between two reads of the zones */
+#define THERMAL_POLL_INTERVAL   10
+
+/* Uevents closer together than this don't cause another read */
+#define THERMAL_MIN_READ_USEC   (G_USEC_PER_SEC)
+
+/* The actions stay at least this long, the fans need time to catch up */
+#define THERMAL_MIN_HOT_USEC    (60 * G_USEC_PER_SEC)
+
+/* Readings outside of this are broken sensors, in millidegrees */
+#define THERMAL_MAX_VALID       150000
+
+struct XfpmThermalPrivate
+{
+  XfpmXfconf          *conf;
+  XfpmNotify          *notify;
+  XfpmBacklight       *backlight;
+  XfpmPowerProfiles   *profiles;
+
+  gchar               *sys_root;
+  /* Reading a fake tree, no uevents come from there */
+  gboolean             fixture;
+
+  guint                poll_id;
+  GSocket             *uevent_socket;
+  GSource             *uevent_source;
+  gint64               last_read;
+
+  /* Sum of the throttle counters of all CPUs, -1 until read */
+  gint64               throttle_count;
+
+  gboolean             hot;
+  gint64               hot_since;
+
+  /* What was done when it got hot, undone when it cools down */
+  gboolean             profile_applied;
+  gint32               brightness_before;
+  gint32               brightness_set;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (XfpmThermal, xfpm_thermal, G_TYPE_OBJECT)
+
+static gint64
+xfpm_thermal_read_int (const gchar *dir, const gchar *name)
+{
+  gchar *filename;
+  gchar *contents = NULL;
+  gint64 value = -1;
+
+  filename = g_build_filename (dir, name, NULL);
+  if ( g_file_get_contents (filename, &contents, NULL, NULL) )
+    value = g_ascii_strtoll (contents, NULL, 10);
+
+  g_free (contents);
+  g_free (filename);
+
+  return value;
+}
+
+/*
+ * Hottest zone in millidegrees, -1 without any. Zones that are powered
+ * down, like a wifi card's, fail to read and are skipped.
+ */
+static gint64
+xfpm_thermal_read_temperature (XfpmThermal *thermal, gchar **hottest)
+{
+  GDir *dir;
+  gchar *path;
+  const gchar *name;
+  gint64 max = -1;
+
+  path = g_build_filename (thermal->priv->sys_root, "class", "thermal", NULL);
+  dir = g_dir_open (path, 0, NULL);
+
+  while ( dir != NULL && (name = g_dir_read_name (dir)) != NULL )
+  {
+    gchar *zone;
+    gint64 temp;
+
+    if ( !g_str_has_prefix (name, "thermal_zone") )
+      continue;
+
+    zone = g_build_filename (path, name, NULL);
+    temp = xfpm_thermal_read_int (zone, "temp");
+
+    if ( temp > max && temp < THERMAL_MAX_VALID )
+    {
+      gchar *filename = g_build_filename (zone, "type", NULL);
+
+      max = temp;
+      g_free (*hottest);
+      *hottest = NULL;
+      if ( g_file_get_contents (filename, hottest, NULL, NULL) )
+        g_strstrip (*hottest);
+      g_free (filename);
+    }
+
+    g_free (zone);
+  }
+
+  if ( dir != NULL )
+    g_dir_close (dir);
+  g_free (path);
+
+  return max;
+}
+
+/*
+ * Only x86 has these, they count the times a core or the package hit
+ * PROCHOT. -1 if there are none.
+ */
+static gint64
+xfpm_thermal_read_throttle_count (XfpmThermal *thermal)
+{
+  GDir *dir;
+  gchar *path;
+  const gchar *name;
+  gint64 sum = -1;
+
+  path = g_build_filename (thermal->priv->sys_root, "devices", "system", "cpu", NULL);
+  dir = g_dir_open (path, 0, NULL);
+
+  while ( dir != NULL && (name = g_dir_read_name (dir)) != NULL )
+  {
+    gchar *throttle;
+    gint64 core;
+    gint64 package;
+
+    if ( !g_str_has_prefix (name, "cpu") || !g_ascii_isdigit (name[3]) )
+      continue;
+
+    throttle = g_build_filename (path, name, "thermal_throttle", NULL);
+    core = xfpm_thermal_read_int (throttle, "core_throttle_count");
+    package = xfpm_thermal_read_int (throttle, "package_throttle_count");
+
+    if ( core >= 0 || package >= 0 )
+      sum = MAX (sum, 0) + MAX (core, 0) + MAX (package, 0);
+
+    g_free (throttle);
+  }
+
+  if ( dir != NULL )
+    g_dir_close (dir);
+  g_free (path);
+
+  return sum;
+}
+
+static void
+xfpm_thermal_lower_brightness (XfpmThermal *thermal)
+{
+  const XfpmConfig *config;
+  gint32 level;
+  gint32 max_level;
+  gint32 target;
+
+  if ( thermal->priv->backlight == NULL || !xfpm_backlight_has_hw (thermal->priv->backlight) )
+    return;
+
+  config = xfpm_xfconf_get_config (thermal->priv->conf);
+
+  level = xfpm_backlight_get_level (thermal->priv->backlight);
+  max_level = xfpm_backlight_get_max_level (thermal->priv->backlight);
+
+  /* The same steps as the brightness keys, but never off */
+  target = MAX (level - (gint32) config->thermal_brightness_steps *
+                MAX (max_level / (gint32) MAX (config->brightness_step_count, 1), 1), 1);
+
+  if ( target >= level )
+    return;
+
+  XFPM_DEBUG ("Lowering the brightness from %d to %d", level, target);
+
+  thermal->priv->brightness_before = level;
+  thermal->priv->brightness_set = target;
+  xfpm_backlight_set_level (thermal->priv->backlight, target, NULL, NULL);
+}
+
+static void
+xfpm_thermal_restore_brightness (XfpmThermal *thermal)
+{
+  if ( thermal->priv->brightness_set < 0 )
+    return;
+
+  /* Leave it alone if the user changed it in the meantime */
+  if ( xfpm_backlight_get_level (thermal->priv->backlight) == thermal->priv->brightness_set )
+  {
+    XFPM_DEBUG ("Restoring the brightness to %d", thermal->priv->brightness_before);
+    xfpm_backlight_set_level (thermal->priv->backlight, thermal->priv->brightness_before,
+                              NULL, NULL);
+  }
+
+  thermal->priv->brightness_before = -1;
+  thermal->priv->brightness_set = -1;
+}
+
+static void
+xfpm_thermal_set_hot (XfpmThermal *thermal, gboolean hot, gint64 temp, const gchar *zone)
+{
+  XfpmThermalActions actions;
+
+  thermal->priv->hot = hot;
+
+  if ( hot )
+  {
+    thermal->priv->hot_since = g_get_monotonic_time ();
+
+    actions = xfpm_xfconf_get_config (thermal->priv->conf)->thermal_actions;
+
+    if ( thermal->priv->profiles != NULL && (actions & XFPM_THERMAL_ACTION_PROFILE) )
+    {
+      xfpm_power_profiles_set_hot (thermal->priv->profiles, TRUE);
+      thermal->priv->profile_applied = TRUE;
+    }
+
+    if ( actions & XFPM_THERMAL_ACTION_BRIGHTNESS )
+      xfpm_thermal_lower_brightness (thermal);
+
+    if ( actions & XFPM_THERMAL_ACTION_NOTIFY )
+    {
+      gchar *message;
+
+      message = g_strdup_printf (_("The system is running hot, %s is at %d °C."),
+                                 zone != NULL ? zone : _("the CPU"),
+                                 (gint) (temp / 1000));
+
+      xfpm_notify_post (thermal->priv->notify,
+                        XFPM_NOTIFY_CATEGORY_GENERAL,
+                        "thermal",
+                        _("Power Manager"),
+                        message,
+                        "dialog-warning",
+                        XFPM_NOTIFY_NORMAL);
+      g_free (message);
+    }
+  }
+  else
+  {
+    if ( thermal->priv->profile_applied )
+    {
+      xfpm_power_profiles_set_hot (thermal->priv->profiles, FALSE);
+      thermal->priv->profile_applied = FALSE;
+    }
+
+    xfpm_thermal_restore_brightness (thermal);
+  }
+}
+
+/*
+ * Hot once the hottest zone reaches thermal-hot-temperature, or the
+ * CPU throttles within thermal-hysteresis of it. Cool again only below
+ * the hysteresis, without throttling and after a minute at the least.
+ */
+static void
+xfpm_thermal_read (XfpmThermal *thermal)
+{
+  const XfpmConfig *config;
+  gint64 temp;
+  gint64 throttle;
+  gint64 low;
+  gboolean throttled;
+  gchar *zone = NULL;
+
+  thermal->priv->last_read = g_get_monotonic_time ();
+
+  config = xfpm_xfconf_get_config (thermal->priv->conf);
+
+  temp = xfpm_thermal_read_temperature (thermal, &zone);
+  throttle = xfpm_thermal_read_throttle_count (thermal);
+
+  throttled = throttle > thermal->priv->throttle_count && thermal->priv->throttle_count >= 0;
+  thermal->priv->throttle_count = throttle;
+
+  low = ((gint64) config->thermal_hot_temperature -
+         MIN (config->thermal_hysteresis, config->thermal_hot_temperature)) * 1000;
+
+  XFPM_DEBUG ("Hottest zone %s at %" G_GINT64_FORMAT " m°C%s",
+              zone != NULL ? zone : "none", temp, throttled ? ", throttling" : "");
+
+  if ( !thermal->priv->hot )
+  {
+    if ( temp >= (gint64) config->thermal_hot_temperature * 1000 || (throttled && temp >= low) )
+    {
+      XFPM_DEBUG ("Running hot");
+      xfpm_thermal_set_hot (thermal, TRUE, temp, zone);
+    }
+  }
+  else if ( temp < low && !throttled &&
+            thermal->priv->last_read - thermal->priv->hot_since >= THERMAL_MIN_HOT_USEC )
+  {
+    XFPM_DEBUG ("Cooled down");
+    xfpm_thermal_set_hot (thermal, FALSE, temp, zone);
+  }
+
+  g_free (zone);
+}
+
+static gboolean
+xfpm_thermal_poll_cb (gpointer data)
+{
+  xfpm_thermal_read (XFPM_THERMAL (data));
+
+  return TRUE;
+}
+
+#ifdef HAVE_LINUX_NETLINK_H
+#define THERMAL_UEVENT_PREFIX  "change@/devices/virtual/thermal/thermal_zone"
+#define THERMAL_UEVENT_WORDS   ((sizeof (THERMAL_UEVENT_PREFIX) - 1) / 4)
+
+G_STATIC_ASSERT ((sizeof (THERMAL_UEVENT_PREFIX) - 1) % 4 == 0);
+
+/*
+ * change@/devices/virtual/thermal/thermal_zone0 followed by the
+ * environment, sent when a zone crosses a trip point and its governor
+ * tells user space.
+ */
+static gboolean
+xfpm_thermal_uevent_cb (GSocket *socket, GIOCondition condition, gpointer data)
+{
+  XfpmThermal *thermal = XFPM_THERMAL (data);
+  gchar buffer[4096];
+  gssize len;
+
+  len = g_socket_receive (socket, buffer, sizeof (buffer) - 1, NULL, NULL);
+  if ( len <= 0 )
+    return TRUE;
+
+  buffer[len] = '\0';
+
+  if ( g_str_has_prefix (buffer, THERMAL_UEVENT_PREFIX) &&
+       g_get_monotonic_time () - thermal->priv->last_read >= THERMAL_MIN_READ_USEC )
+  {
+    XFPM_DEBUG ("Thermal uevent for %s", buffer + strlen ("change@"));
+    xfpm_thermal_read (thermal);
+  }
+
+  return TRUE;
+}
+
+/*
+ * Every uevent of the system goes to the multicast group, let the
+ * kernel drop everything but thermal zone changes so we don't wake up
+ * for each USB or block device event. The filter compares the start of
+ * the message a word at a time, word loads are big endian.
+ */
+static gboolean
+xfpm_thermal_attach_uevent_filter (gint fd)
+{
+  struct sock_filter code[2 * THERMAL_UEVENT_WORDS + 2];
+  struct sock_fprog prog;
+  const guchar *prefix = (const guchar *) THERMAL_UEVENT_PREFIX;
+  guint i;
+
+  for ( i = 0; i < THERMAL_UEVENT_WORDS; i++ )
+  {
+    guint32 word = ((guint32) prefix[4 * i] << 24) | ((guint32) prefix[4 * i + 1] << 16) |
+                   ((guint32) prefix[4 * i + 2] << 8) | (guint32) prefix[4 * i + 3];
+    struct sock_filter load = BPF_STMT (BPF_LD | BPF_W | BPF_ABS, 4 * i);
+    /* On a mismatch jump over the remaining words to the reject */
+    struct sock_filter match = BPF_JUMP (BPF_JMP | BPF_JEQ | BPF_K, word,
+                                         0, 2 * (THERMAL_UEVENT_WORDS - 1 - i) + 1);
+
+    code[2 * i] = load;
+    code[2 * i + 1] = match;
+  }
+
+  code[2 * THERMAL_UEVENT_WORDS] = (struct sock_filter) BPF_STMT (BPF_RET | BPF_K, 0xffffffff);
+  code[2 * THERMAL_UEVENT_WORDS + 1] = (struct sock_filter) BPF_STMT (BPF_RET | BPF_K, 0);
+
+  prog.len = G_N_ELEMENTS (code);
+  prog.filter = code;
+
+  return setsockopt (fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof (prog)) == 0;
+}
+
+static void
+xfpm_thermal_watch_uevents (XfpmThermal *thermal)
+{
+  struct sockaddr_nl addr;
+  GError *error = NULL;
+  gint fd;
+
+  fd = socket (AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+  if ( fd < 0 )
+    return;
+
+  /* Unfiltered we'd be woken for every device on the system, polling
+   * alone is cheaper then */
+  if ( !xfpm_thermal_attach_uevent_filter (fd) )
+  {
+    XFPM_DEBUG ("Unable to filter kernel uevents, polling only");
+    close (fd);
+    return;
+  }
+
+  memset (&addr, 0, sizeof (addr));
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = 1;
+
+  if ( bind (fd, (struct sockaddr *) &addr, sizeof (addr)) < 0 )
+  {
+    XFPM_DEBUG ("Unable to listen to kernel uevents");
+    close (fd);
+    return;
+  }
+
+  thermal->priv->uevent_socket = g_socket_new_from_fd (fd, &error);
+  if ( thermal->priv->uevent_socket == NULL )
+  {
+    XFPM_DEBUG ("Unable to listen to kernel uevents: %s", error->message);
+    g_error_free (error);
+    close (fd);
+    return;
+  }
+
+  thermal->priv->uevent_source = g_socket_create_source (thermal->priv->uevent_socket,
+                                                         G_IO_IN, NULL);
+  g_source_set_callback (thermal->priv->uevent_source,
+                         (GSourceFunc) xfpm_thermal_uevent_cb, thermal, NULL);
+  g_source_attach (thermal->priv->uevent_source, NULL);
+}
+#endif
+
+static void
+xfpm_thermal_stop (XfpmThermal *thermal)
+{
+  if ( thermal->priv->poll_id != 0 )
+  {
+    g_source_remove (thermal->priv->poll_id);
+    thermal->priv->poll_id = 0;
+  }
+
+  if ( thermal->priv->uevent_source != NULL )
+  {
+    g_source_destroy (thermal->priv->uevent_source);
+    g_source_unref (thermal->priv->uevent_source);
+    thermal->priv->uevent_source = NULL;
+  }
+
+  g_clear_object (&thermal->priv->uevent_socket);
+}
+
+static void
+xfpm_thermal_start (XfpmThermal *thermal)
+{
+  if ( xfpm_xfconf_get_config (thermal->priv->conf)->thermal_hot_temperature == 0 )
+  {
+    XFPM_DEBUG ("Not watching the temperature");
+    return;
+  }
+
+  thermal->priv->poll_id = g_timeout_add_seconds (THERMAL_POLL_INTERVAL,
+                                                  xfpm_thermal_poll_cb, thermal);
+
+#ifdef HAVE_LINUX_NETLINK_H
+  if ( !thermal->priv->fixture )
+    xfpm_thermal_watch_uevents (thermal);
+#endif
+
+  xfpm_thermal_read (thermal);
+}
+
+static void
+xfpm_thermal_settings_changed_cb (XfpmXfconf *conf,
+                                  const gchar **keys,
+                                  XfpmThermal *thermal)
+{
+  guint i;
+
+  for ( i = 0; keys[i] != NULL; i++ )
+  {
+    if ( g_str_has_prefix (keys[i], "thermal-") )
+    {
+      /* Undo with the old actions, the next read applies the new ones */
+      if ( thermal->priv->hot )
+        xfpm_thermal_set_hot (thermal, FALSE, -1, NULL);
+
+      xfpm_thermal_stop (thermal);
+      xfpm_thermal_start (thermal);
+      return;
+    }
+  }
+}
+
+static void
+xfpm_thermal_class_init (XfpmThermalClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = xfpm_thermal_finalize;
+}
+
+static void
+xfpm_thermal_init (XfpmThermal *thermal)
+{
+  const gchar *root;
+
+  thermal->priv = xfpm_thermal_get_instance_private (thermal);
+
+  /* Allows running against fixture trees */
+  root = g_getenv ("XFPM_SYSFS_ROOT");
+  thermal->priv->fixture = root != NULL && *root != '\0';
+  thermal->priv->sys_root = g_strdup (thermal->priv->fixture ? root : "/sys");
+
+  thermal->priv->throttle_count = -1;
+  thermal->priv->brightness_before = -1;
+  thermal->priv->brightness_set = -1;
+
+  thermal->priv->conf = xfpm_xfconf_new ();
+  thermal->priv->notify = xfpm_notify_new ();
+
+  g_signal_connect (thermal->priv->conf, "config-changed",
+                    G_CALLBACK (xfpm_thermal_settings_changed_cb), thermal);
+}
+
+static void
+xfpm_thermal_finalize (GObject *object)
+{
+  XfpmThermal *thermal;
+
+  thermal = XFPM_THERMAL (object);
+
+  xfpm_thermal_stop (thermal);
+
+  g_signal_handlers_disconnect_by_data (thermal->priv->conf, thermal);
+
+  if ( thermal->priv->backlight != NULL )
+    g_object_unref (thermal->priv->backlight);
+  if ( thermal->priv->profiles != NULL )
+    g_object_unref (thermal->priv->profiles);
+
+  g_object_unref (thermal->priv->conf);
+  g_object_unref (thermal->priv->notify);
+  g_free (thermal->priv->sys_root);
+
+  G_OBJECT_CLASS (xfpm_thermal_parent_class)->finalize (object);
+}
+
+/**
+ * xfpm_thermal_new:
+ * @backlight: the display backlight, or %NULL
+ * @profiles: the power profiles, or %NULL
+ *
+ * The actions that need an object left out are skipped.
+ **/
+XfpmThermal *
+xfpm_thermal_new (XfpmBacklight *backlight, XfpmPowerProfiles *profiles)
+{
+  XfpmThermal *thermal;
+
+  thermal = g_object_new (XFPM_TYPE_THERMAL, NULL);
+
+  if ( backlight != NULL )
+    thermal->priv->backlight = g_object_ref (backlight);
+  if ( profiles != NULL )
+    thermal->priv->profiles = g_object_ref (profiles);
+
+  xfpm_thermal_start (thermal);
+
+  return thermal;
+}
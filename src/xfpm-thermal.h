@@ -0,0 +1,54 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __XFPM_THERMAL_H
+#define __XFPM_THERMAL_H
+
+#include <glib-object.h>
+
+#include "xfpm-backlight.h"
+#include "xfpm-power-profiles.h"
+
+G_BEGIN_DECLS
+
+#define XFPM_TYPE_THERMAL        (xfpm_thermal_get_type () )
+#define XFPM_THERMAL(o)          (G_TYPE_CHECK_INSTANCE_CAST((o), XFPM_TYPE_THERMAL, XfpmThermal))
+#define XFPM_IS_THERMAL(o)       (G_TYPE_CHECK_INSTANCE_TYPE((o), XFPM_TYPE_THERMAL))
+
+typedef struct XfpmThermalPrivate XfpmThermalPrivate;
+
+typedef struct
+{
+  GObject               parent;
+  XfpmThermalPrivate   *priv;
+} XfpmThermal;
+
+typedef struct
+{
+  GObjectClass          parent_class;
+} XfpmThermalClass;
+
+GType              xfpm_thermal_get_type        (void) G_GNUC_CONST;
+XfpmThermal       *xfpm_thermal_new             (XfpmBacklight     *backlight,
+                                                 XfpmPowerProfiles *profiles);
+
+G_END_DECLS
+
+#endif /* __XFPM_THERMAL_H */
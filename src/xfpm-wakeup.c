@@ -0,0 +1,361 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Tells which device ended a sleep by comparing the kernel's wakeup
+ * source counters from before and after it. Only /sys/class/wakeup
+ * (Linux 5.4 and later) is read, the older debugfs list is root-only
+ * and out of reach for the session daemon. Without it the sleep
+ * history says "wakeup=unknown".
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <glib.h>
+
+#include "xfpm-wakeup.h"
+#include "xfpm-debug.h"
+
+static void xfpm_wakeup_finalize   (GObject *object);
+
+/* Sources named in the history, the first one is the culprit */
+#define WAKEUP_MAX_SOURCES      3
+
+typedef struct
+{
+  gchar   *name;
+  guint64  events;
+  guint64  wakeups;
+} XfpmWakeupSource;
+
+struct XfpmWakeupPrivate
+{
+  gchar               *sys_root;
+
+  /* Counters when the sleep was requested, keyed by the sysfs entry
+   * as the names aren't unique */
+  GHashTable          *sources;
+  gint64               wakeup_count;
+  gint64               fail_count;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (XfpmWakeup, xfpm_wakeup, G_TYPE_OBJECT)
+
+static void
+xfpm_wakeup_source_free (gpointer data)
+{
+  XfpmWakeupSource *source = data;
+
+  g_free (source->name);
+  g_free (source);
+}
+
+static gint64
+xfpm_wakeup_read_int (const gchar *dir, const gchar *name)
+{
+  gchar *filename;
+  gchar *contents = NULL;
+  gint64 value = -1;
+
+  filename = g_build_filename (dir, name, NULL);
+  if ( g_file_get_contents (filename, &contents, NULL, NULL) )
+    value = g_ascii_strtoll (contents, NULL, 10);
+
+  g_free (contents);
+  g_free (filename);
+
+  return value;
+}
+
+static gchar *
+xfpm_wakeup_read_string (const gchar *dir, const gchar *name)
+{
+  gchar *filename;
+  gchar *contents = NULL;
+
+  filename = g_build_filename (dir, name, NULL);
+  if ( g_file_get_contents (filename, &contents, NULL, NULL) )
+    g_strstrip (contents);
+  g_free (filename);
+
+  return contents;
+}
+
+static GHashTable *
+xfpm_wakeup_read_sources (XfpmWakeup *wakeup)
+{
+  GHashTable *sources;
+  GDir *dir;
+  gchar *path;
+  const gchar *entry;
+
+  sources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, xfpm_wakeup_source_free);
+
+  path = g_build_filename (wakeup->priv->sys_root, "class", "wakeup", NULL);
+  dir = g_dir_open (path, 0, NULL);
+
+  if ( dir == NULL )
+  {
+    g_free (path);
+    return sources;
+  }
+
+  while ( (entry = g_dir_read_name (dir)) != NULL )
+  {
+    XfpmWakeupSource *source;
+    gchar *source_dir;
+    gchar *name;
+
+    source_dir = g_build_filename (path, entry, NULL);
+    name = xfpm_wakeup_read_string (source_dir, "name");
+
+    if ( name != NULL )
+    {
+      source = g_new0 (XfpmWakeupSource, 1);
+      source->name = name;
+      source->events = MAX (xfpm_wakeup_read_int (source_dir, "event_count"), 0);
+      source->wakeups = MAX (xfpm_wakeup_read_int (source_dir, "wakeup_count"), 0);
+      g_hash_table_insert (sources, g_strdup (entry), source);
+    }
+
+    g_free (source_dir);
+  }
+
+  g_dir_close (dir);
+  g_free (path);
+
+  return sources;
+}
+
+static gint
+xfpm_wakeup_compare (gconstpointer a, gconstpointer b)
+{
+  const XfpmWakeupSource *source_a = *(XfpmWakeupSource * const *) a;
+  const XfpmWakeupSource *source_b = *(XfpmWakeupSource * const *) b;
+
+  if ( source_a->wakeups != source_b->wakeups )
+    return source_a->wakeups > source_b->wakeups ? -1 : 1;
+  if ( source_a->events != source_b->events )
+    return source_a->events > source_b->events ? -1 : 1;
+
+  return g_strcmp0 (source_a->name, source_b->name);
+}
+
+static void
+xfpm_wakeup_class_init (XfpmWakeupClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = xfpm_wakeup_finalize;
+}
+
+static void
+xfpm_wakeup_init (XfpmWakeup *wakeup)
+{
+  const gchar *root;
+
+  wakeup->priv = xfpm_wakeup_get_instance_private (wakeup);
+
+  /* Allows running against fixture trees */
+  root = g_getenv ("XFPM_SYSFS_ROOT");
+  wakeup->priv->sys_root = g_strdup (root != NULL && *root != '\0' ? root : "/sys");
+
+  wakeup->priv->wakeup_count = -1;
+  wakeup->priv->fail_count = -1;
+}
+
+static void
+xfpm_wakeup_finalize (GObject *object)
+{
+  XfpmWakeup *wakeup;
+
+  wakeup = XFPM_WAKEUP (object);
+
+  if ( wakeup->priv->sources != NULL )
+    g_hash_table_unref (wakeup->priv->sources);
+  g_free (wakeup->priv->sys_root);
+
+  G_OBJECT_CLASS (xfpm_wakeup_parent_class)->finalize (object);
+}
+
+XfpmWakeup *
+xfpm_wakeup_new (void)
+{
+  return g_object_new (XFPM_TYPE_WAKEUP, NULL);
+}
+
+/**
+ * xfpm_wakeup_mark:
+ *
+ * Takes the counters to compare against, right before the sleep is
+ * requested.
+ **/
+void
+xfpm_wakeup_mark (XfpmWakeup *wakeup)
+{
+  gchar *power;
+
+  g_return_if_fail (XFPM_IS_WAKEUP (wakeup));
+
+  if ( wakeup->priv->sources != NULL )
+    g_hash_table_unref (wakeup->priv->sources);
+  wakeup->priv->sources = xfpm_wakeup_read_sources (wakeup);
+
+  power = g_build_filename (wakeup->priv->sys_root, "power", NULL);
+  wakeup->priv->wakeup_count = xfpm_wakeup_read_int (power, "wakeup_count");
+  wakeup->priv->fail_count = xfpm_wakeup_read_int (power, "suspend_stats/fail");
+  g_free (power);
+}
+
+/**
+ * xfpm_wakeup_diff:
+ * @culprit: return location for the name of the source that most
+ *           likely woke the system, or %NULL
+ *
+ * Compares the counters against the ones taken by xfpm_wakeup_mark().
+ * The sources whose wakeup_count went up signalled while the system
+ * was suspending or asleep, only without any of those the ones that
+ * merely had events are named.
+ *
+ * Returns: the difference for the sleep history, e.g.
+ *          "wakeup_events=2 wakeup=XHC+1,PNP0C0D:00+1", or %NULL when
+ *          xfpm_wakeup_mark() wasn't called. Free with g_free().
+ **/
+gchar *
+xfpm_wakeup_diff (XfpmWakeup *wakeup, gchar **culprit)
+{
+  GHashTable *after;
+  GHashTableIter iter;
+  gpointer key, value;
+  GPtrArray *woke;
+  GString *str;
+  gchar *power;
+  gint64 count;
+  gboolean any_wakeups = FALSE;
+  guint i;
+
+  g_return_val_if_fail (XFPM_IS_WAKEUP (wakeup), NULL);
+
+  if ( culprit != NULL )
+    *culprit = NULL;
+
+  if ( wakeup->priv->sources == NULL )
+    return NULL;
+
+  after = xfpm_wakeup_read_sources (wakeup);
+  woke = g_ptr_array_new_with_free_func (xfpm_wakeup_source_free);
+
+  g_hash_table_iter_init (&iter, after);
+  while ( g_hash_table_iter_next (&iter, &key, &value) )
+  {
+    XfpmWakeupSource *now = value;
+    XfpmWakeupSource *before;
+    XfpmWakeupSource *delta;
+
+    /* New since the mark, e.g. a device plugged in on resume, the
+     * kernel hands out the number of a removed source again */
+    before = g_hash_table_lookup (wakeup->priv->sources, key);
+    if ( before != NULL && g_strcmp0 (before->name, now->name) != 0 )
+      before = NULL;
+
+    delta = g_new0 (XfpmWakeupSource, 1);
+    delta->name = g_strdup (now->name);
+    delta->events = now->events - (before != NULL ? MIN (before->events, now->events) : 0);
+    delta->wakeups = now->wakeups - (before != NULL ? MIN (before->wakeups, now->wakeups) : 0);
+
+    if ( delta->wakeups > 0 || delta->events > 0 )
+    {
+      any_wakeups |= delta->wakeups > 0;
+      g_ptr_array_add (woke, delta);
+    }
+    else
+    {
+      xfpm_wakeup_source_free (delta);
+    }
+  }
+
+  g_ptr_array_sort (woke, xfpm_wakeup_compare);
+
+  str = g_string_new (NULL);
+  power = g_build_filename (wakeup->priv->sys_root, "power", NULL);
+
+  count = xfpm_wakeup_read_int (power, "wakeup_count");
+  if ( count >= 0 && wakeup->priv->wakeup_count >= 0 )
+    g_string_append_printf (str, "wakeup_events=%" G_GINT64_FORMAT,
+                            count - wakeup->priv->wakeup_count);
+  else
+    g_string_append (str, "wakeup_events=-1");
+
+  g_string_append (str, " wakeup=");
+  for ( i = 0; i < woke->len && i < WAKEUP_MAX_SOURCES; i++ )
+  {
+    XfpmWakeupSource *source = g_ptr_array_index (woke, i);
+    gchar *name;
+
+    if ( any_wakeups && source->wakeups == 0 )
+      break;
+
+    /* One token per field in the history */
+    name = g_strdelimit (g_strdup (source->name), " \t=", '_');
+    g_string_append_printf (str, "%s%s+%" G_GUINT64_FORMAT, i > 0 ? "," : "", name,
+                            any_wakeups ? source->wakeups : source->events);
+
+    if ( i == 0 && culprit != NULL )
+      *culprit = g_strdup (source->name);
+
+    g_free (name);
+  }
+  if ( i == 0 )
+    g_string_append (str, "unknown");
+
+  /* A failed suspend names the device whose callback refused */
+  count = xfpm_wakeup_read_int (power, "suspend_stats/fail");
+  if ( count > wakeup->priv->fail_count && wakeup->priv->fail_count >= 0 )
+  {
+    gchar *failed = xfpm_wakeup_read_string (power, "suspend_stats/last_failed_dev");
+
+    if ( failed != NULL && *failed != '\0' )
+    {
+      g_strdelimit (failed, " \t=", '_');
+      g_string_append_printf (str, " failed_dev=%s", failed);
+    }
+    g_free (failed);
+  }
+
+  XFPM_DEBUG ("Wakeup sources: %s", str->str);
+
+  g_free (power);
+  g_ptr_array_free (woke, TRUE);
+  g_hash_table_unref (after);
+  g_hash_table_unref (wakeup->priv->sources);
+  wakeup->priv->sources = NULL;
+
+  return g_string_free (str, FALSE);
+}
@@ -0,0 +1,436 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <glib.h>
+
+#include <libxfce4util/libxfce4util.h>
+
+#include "xfpm-workload.h"
+#include "xfpm-inhibit.h"
+#include "xfpm-xfconf.h"
+#include "xfpm-config.h"
+#include "xfpm-debug.h"
+
+static void xfpm_workload_finalize   (GObject *object);
+
+/* Seconds between two samples */
+#define WORKLOAD_SAMPLE_INTERVAL  20
+
+/* Consecutive samples above a threshold before we inhibit, and below
+ * the low watermark before we release the inhibitor again */
+#define WORKLOAD_BUSY_SAMPLES     2
+#define WORKLOAD_IDLE_SAMPLES     3
+
+/* The low watermark is this percentage of the threshold */
+#define WORKLOAD_LOW_WATERMARK    75
+
+typedef enum
+{
+  WORKLOAD_IDLE,
+  WORKLOAD_BETWEEN,
+  WORKLOAD_BUSY
+} WorkloadLevel;
+
+struct XfpmWorkloadPrivate
+{
+  XfpmXfconf      *conf;
+  XfpmInhibit     *inhibit;
+
+  /* Directory used in place of /proc */
+  gchar           *root;
+
+  guint            timeout_id;
+  guint            cookie;
+
+  guint            busy_samples;
+  guint            idle_samples;
+
+  guint64          net_bytes;
+  gint64           net_time;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (XfpmWorkload, xfpm_workload, G_TYPE_OBJECT)
+
+static gchar *
+xfpm_workload_read_file (XfpmWorkload *workload, const gchar *name)
+{
+  gchar *path;
+  gchar *contents = NULL;
+
+  path = g_build_filename (workload->priv->root, name, NULL);
+
+  if ( !g_file_get_contents (path, &contents, NULL, NULL) )
+    contents = NULL;
+
+  g_free (path);
+
+  return contents;
+}
+
+/* avg10 of the "some" line of /proc/pressure/<resource> */
+static gboolean
+xfpm_workload_read_pressure (XfpmWorkload *workload, const gchar *resource, gdouble *avg10)
+{
+  gchar *name;
+  gchar *contents;
+  gchar *p;
+  gchar *end;
+  gboolean ret = FALSE;
+
+  name = g_build_filename ("pressure", resource, NULL);
+  contents = xfpm_workload_read_file (workload, name);
+  g_free (name);
+
+  if ( contents == NULL )
+    return FALSE;
+
+  p = strstr (contents, "some avg10=");
+  if ( p != NULL )
+  {
+    p += strlen ("some avg10=");
+    *avg10 = g_ascii_strtod (p, &end);
+    ret = end != p;
+  }
+
+  g_free (contents);
+
+  return ret;
+}
+
+/* One minute load average in percent of the online processors */
+static gboolean
+xfpm_workload_read_loadavg (XfpmWorkload *workload, gdouble *load)
+{
+  gchar *contents;
+  gchar *end;
+  gboolean ret;
+
+  contents = xfpm_workload_read_file (workload, "loadavg");
+
+  if ( contents == NULL )
+    return FALSE;
+
+  *load = g_ascii_strtod (contents, &end) * 100.0 / g_get_num_processors ();
+  ret = end != contents;
+
+  g_free (contents);
+
+  return ret;
+}
+
+/* Received plus sent bytes of all the interfaces but loopback */
+static gboolean
+xfpm_workload_read_net_bytes (XfpmWorkload *workload, guint64 *bytes)
+{
+  gchar *contents;
+  gchar **lines;
+  guint i;
+
+  contents = xfpm_workload_read_file (workload, "net/dev");
+
+  if ( contents == NULL )
+    return FALSE;
+
+  *bytes = 0;
+  lines = g_strsplit (contents, "\n", -1);
+
+  /* The two header lines don't have a colon */
+  for ( i = 0; lines[i] != NULL; i++ )
+  {
+    gchar *colon;
+    gchar *p;
+    gchar *end;
+    guint field;
+
+    colon = strchr (lines[i], ':');
+    if ( colon == NULL )
+      continue;
+
+    *colon = '\0';
+    if ( g_strcmp0 (g_strstrip (lines[i]), "lo") == 0 )
+      continue;
+
+    /* rx bytes is the first field, tx bytes the ninth */
+    p = colon + 1;
+    for ( field = 0; field <= 8; field++ )
+    {
+      guint64 value = g_ascii_strtoull (p, &end, 10);
+
+      if ( end == p )
+        break;
+
+      if ( field == 0 || field == 8 )
+        *bytes += value;
+
+      p = end;
+    }
+  }
+
+  g_strfreev (lines);
+  g_free (contents);
+
+  return TRUE;
+}
+
+static WorkloadLevel
+xfpm_workload_classify (gdouble value, guint threshold)
+{
+  if ( value >= threshold )
+    return WORKLOAD_BUSY;
+
+  if ( value * 100 < (gdouble) threshold * WORKLOAD_LOW_WATERMARK )
+    return WORKLOAD_IDLE;
+
+  return WORKLOAD_BETWEEN;
+}
+
+/*
+ * The sample is busy if any of the enabled metrics is above its
+ * threshold, and idle only if all of them are below the low watermark.
+ * Metrics the kernel doesn't provide are ignored.
+ */
+static WorkloadLevel
+xfpm_workload_sample (XfpmWorkload *workload, const XfpmConfig *config, gchar **reason)
+{
+  WorkloadLevel level = WORKLOAD_IDLE;
+  WorkloadLevel metric;
+  gdouble value;
+  guint64 bytes;
+  gint64 now;
+
+#define CHECK_METRIC(desc, threshold, val)                          \
+  G_STMT_START {                                                    \
+    metric = xfpm_workload_classify (val, threshold);               \
+    XFPM_DEBUG ("%s %.1f threshold %u", desc, val, threshold);      \
+    if ( metric > level )                                           \
+    {                                                               \
+      level = metric;                                               \
+      if ( metric == WORKLOAD_BUSY && *reason == NULL )             \
+        *reason = g_strdup_printf ("%s %.0f", desc, val);           \
+    }                                                               \
+  } G_STMT_END
+
+  if ( config->workload_cpu_pressure > 0 &&
+       xfpm_workload_read_pressure (workload, "cpu", &value) )
+    CHECK_METRIC ("cpu pressure", config->workload_cpu_pressure, value);
+
+  if ( config->workload_io_pressure > 0 &&
+       xfpm_workload_read_pressure (workload, "io", &value) )
+    CHECK_METRIC ("io pressure", config->workload_io_pressure, value);
+
+  if ( config->workload_load_average > 0 &&
+       xfpm_workload_read_loadavg (workload, &value) )
+    CHECK_METRIC ("load", config->workload_load_average, value);
+
+  /* The rate needs two samples, the first one only sets the baseline */
+  if ( config->workload_network_rate > 0 &&
+       xfpm_workload_read_net_bytes (workload, &bytes) )
+  {
+    now = g_get_monotonic_time ();
+
+    if ( workload->priv->net_time != 0 && bytes >= workload->priv->net_bytes && now > workload->priv->net_time )
+    {
+      value = (bytes - workload->priv->net_bytes) / 1024.0
+              / ((now - workload->priv->net_time) / (gdouble) G_USEC_PER_SEC);
+      CHECK_METRIC ("network KiB/s", config->workload_network_rate, value);
+    }
+
+    workload->priv->net_bytes = bytes;
+    workload->priv->net_time = now;
+  }
+
+#undef CHECK_METRIC
+
+  return level;
+}
+
+static void
+xfpm_workload_release (XfpmWorkload *workload)
+{
+  if ( workload->priv->cookie != 0 )
+  {
+    XFPM_DEBUG ("Workload is gone, releasing the inhibitor");
+    xfpm_inhibit_remove_internal (workload->priv->inhibit, workload->priv->cookie);
+    workload->priv->cookie = 0;
+  }
+}
+
+static gboolean
+xfpm_workload_sample_cb (gpointer data)
+{
+  XfpmWorkload *workload = XFPM_WORKLOAD (data);
+  const XfpmConfig *config;
+  WorkloadLevel level;
+  gchar *reason = NULL;
+
+  config = xfpm_xfconf_get_config (workload->priv->conf);
+  level = xfpm_workload_sample (workload, config, &reason);
+
+  switch ( level )
+  {
+    case WORKLOAD_BUSY:
+      workload->priv->idle_samples = 0;
+      if ( ++workload->priv->busy_samples >= WORKLOAD_BUSY_SAMPLES && workload->priv->cookie == 0 )
+      {
+        gchar *name = g_strdup_printf (_("Power manager (%s)"), reason);
+
+        XFPM_DEBUG ("System is busy, %s", reason);
+        workload->priv->cookie = xfpm_inhibit_add_internal (workload->priv->inhibit, name);
+        g_free (name);
+      }
+      break;
+    case WORKLOAD_IDLE:
+      workload->priv->busy_samples = 0;
+      if ( ++workload->priv->idle_samples >= WORKLOAD_IDLE_SAMPLES )
+        xfpm_workload_release (workload);
+      break;
+    default:
+      /* Between the watermarks, keep whatever we have */
+      workload->priv->busy_samples = 0;
+      workload->priv->idle_samples = 0;
+      break;
+  }
+
+  g_free (reason);
+
+  return TRUE;
+}
+
+static void
+xfpm_workload_refresh (XfpmWorkload *workload)
+{
+  gboolean enabled;
+
+  enabled = xfpm_xfconf_get_config (workload->priv->conf)->workload_inhibit;
+
+  if ( enabled && workload->priv->timeout_id == 0 )
+  {
+    XFPM_DEBUG ("Starting workload sampling in %s", workload->priv->root);
+
+    workload->priv->busy_samples = 0;
+    workload->priv->idle_samples = 0;
+    workload->priv->net_time = 0;
+
+    xfpm_workload_sample_cb (workload);
+    workload->priv->timeout_id = g_timeout_add_seconds (WORKLOAD_SAMPLE_INTERVAL,
+                                                        xfpm_workload_sample_cb,
+                                                        workload);
+  }
+  else if ( !enabled && workload->priv->timeout_id != 0 )
+  {
+    XFPM_DEBUG ("Stopping workload sampling");
+
+    g_source_remove (workload->priv->timeout_id);
+    workload->priv->timeout_id = 0;
+    xfpm_workload_release (workload);
+  }
+}
+
+static void
+xfpm_workload_settings_changed_cb (XfpmXfconf *conf, const gchar **keys, XfpmWorkload *workload)
+{
+  guint i;
+
+  /* Thresholds are read on every sample, only the switch matters here */
+  for ( i = 0; keys[i] != NULL; i++ )
+  {
+    if ( g_strcmp0 (keys[i], WORKLOAD_INHIBIT) == 0 )
+    {
+      xfpm_workload_refresh (workload);
+      return;
+    }
+  }
+}
+
+static void
+xfpm_workload_class_init (XfpmWorkloadClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = xfpm_workload_finalize;
+}
+
+static void
+xfpm_workload_init (XfpmWorkload *workload)
+{
+  const gchar *root;
+
+  workload->priv = xfpm_workload_get_instance_private (workload);
+
+  /* Allows running the sampler against fixture files */
+  root = g_getenv ("XFPM_PROC_ROOT");
+  workload->priv->root = g_strdup (root != NULL && *root != '\0' ? root : "/proc");
+
+  workload->priv->conf = xfpm_xfconf_new ();
+  workload->priv->inhibit = xfpm_inhibit_new ();
+
+  g_signal_connect (workload->priv->conf, "config-changed",
+                    G_CALLBACK (xfpm_workload_settings_changed_cb), workload);
+
+  xfpm_workload_refresh (workload);
+}
+
+static void
+xfpm_workload_finalize (GObject *object)
+{
+  XfpmWorkload *workload;
+
+  workload = XFPM_WORKLOAD (object);
+
+  if ( workload->priv->timeout_id != 0 )
+    g_source_remove (workload->priv->timeout_id);
+
+  xfpm_workload_release (workload);
+
+  g_signal_handlers_disconnect_by_data (workload->priv->conf, workload);
+
+  g_object_unref (workload->priv->conf);
+  g_object_unref (workload->priv->inhibit);
+  g_free (workload->priv->root);
+
+  G_OBJECT_CLASS (xfpm_workload_parent_class)->finalize (object);
+}
+
+XfpmWorkload *
+xfpm_workload_new (void)
+{
+  return g_object_new (XFPM_TYPE_WORKLOAD, NULL);
+}
+
+gboolean
+xfpm_workload_is_busy (XfpmWorkload *workload)
+{
+  g_return_val_if_fail (XFPM_IS_WORKLOAD (workload), FALSE);
+
+  return workload->priv->cookie != 0;
+}
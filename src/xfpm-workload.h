@@ -0,0 +1,51 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __XFPM_WORKLOAD_H
+#define __XFPM_WORKLOAD_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define XFPM_TYPE_WORKLOAD        (xfpm_workload_get_type () )
+#define XFPM_WORKLOAD(o)          (G_TYPE_CHECK_INSTANCE_CAST((o), XFPM_TYPE_WORKLOAD, XfpmWorkload))
+#define XFPM_IS_WORKLOAD(o)       (G_TYPE_CHECK_INSTANCE_TYPE((o), XFPM_TYPE_WORKLOAD))
+
+typedef struct XfpmWorkloadPrivate XfpmWorkloadPrivate;
+
+typedef struct
+{
+  GObject               parent;
+  XfpmWorkloadPrivate  *priv;
+} XfpmWorkload;
+
+typedef struct
+{
+  GObjectClass          parent_class;
+} XfpmWorkloadClass;
+
+GType              xfpm_workload_get_type        (void) G_GNUC_CONST;
+XfpmWorkload      *xfpm_workload_new             (void);
+gboolean           xfpm_workload_is_busy         (XfpmWorkload *workload);
+
+G_END_DECLS
+
+#endif /* __XFPM_WORKLOAD_H */
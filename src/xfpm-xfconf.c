@@ -43,13 +43,33 @@
 
 static void xfpm_xfconf_finalize   (GObject *object);
 
+/* How long to collect changed keys before applying them together */
+#define XFPM_XFCONF_TRANSACTION_TIMEOUT 100
+
 struct XfpmXfconfPrivate
 {
   XfconfChannel   *channel;
   XfconfChannel   *session_channel;
   GValue          *values;
+
+  XfpmConfig      *config;
+  GSList          *retired;
+  guint            retired_id;
+  gboolean         loading;
+
+  GHashTable      *pending;
+  guint            transaction_id;
+  GPtrArray       *changed;
+};
+
+enum
+{
+  CONFIG_CHANGED,
+  LAST_SIGNAL
 };
 
+static guint signals [LAST_SIGNAL] = { 0 };
+
 enum
 {
   PROP_0,
@@ -93,11 +113,210 @@ enum
   PROP_LOGIND_HANDLE_HIBERNATE_KEY,
   PROP_LOGIND_HANDLE_LID_SWITCH,
   PROP_HEARTBEAT_COMMAND,
+  PROP_PROFILE_ON_AC,
+  PROP_PROFILE_ON_BATTERY,
+  PROP_PROFILE_ON_CRITICAL,
+  PROP_PROFILE_ON_HOT,
+  PROP_WORKLOAD_INHIBIT,
+  PROP_WORKLOAD_CPU_PRESSURE,
+  PROP_WORKLOAD_IO_PRESSURE,
+  PROP_WORKLOAD_LOAD_AVERAGE,
+  PROP_WORKLOAD_NETWORK_RATE,
+  PROP_CPU_GOVERNOR_ON_AC,
+  PROP_CPU_GOVERNOR_ON_BATTERY,
+  PROP_CPU_EPP_ON_AC,
+  PROP_CPU_EPP_ON_BATTERY,
+  PROP_CPU_MAX_FREQ_ON_AC,
+  PROP_CPU_MAX_FREQ_ON_BATTERY,
+  PROP_RUNTIME_PM_ON_AC,
+  PROP_RUNTIME_PM_ON_BATTERY,
+  PROP_RUNTIME_PM_AUTOSUSPEND_DELAY,
+  PROP_RUNTIME_PM_DENY_LIST,
+  PROP_HIBERNATE_IMAGE_TUNING,
+  PROP_HIBERNATE_KEEP_CACHE,
+  PROP_SUSPEND_THEN_HIBERNATE,
+  PROP_SUSPEND_THEN_HIBERNATE_INTERVAL,
+  PROP_SHORT_SLEEP_THRESHOLD,
+  PROP_THERMAL_HOT_TEMPERATURE,
+  PROP_THERMAL_HYSTERESIS,
+  PROP_THERMAL_ACTIONS,
+  PROP_THERMAL_BRIGHTNESS_STEPS,
+  PROP_METRICS_TEXTFILE,
+  PROP_METRICS_INTERVAL,
   N_PROPERTIES
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (XfpmXfconf, xfpm_xfconf, G_TYPE_OBJECT)
 
+static void
+xfpm_xfconf_config_free (gpointer data)
+{
+  XfpmConfig *config = data;
+
+  if ( config == NULL )
+    return;
+
+  g_free (config->profile_on_ac);
+  g_free (config->profile_on_battery);
+  g_free (config->profile_on_critical);
+  g_free (config->profile_on_hot);
+  g_free (config->cpu_governor_on_ac);
+  g_free (config->cpu_governor_on_battery);
+  g_free (config->cpu_epp_on_ac);
+  g_free (config->cpu_epp_on_battery);
+  g_free (config->runtime_pm_deny_list);
+  g_free (config->metrics_textfile);
+  g_free (config);
+}
+
+static gboolean
+xfpm_xfconf_free_retired (gpointer data)
+{
+  XfpmXfconf *conf = XFPM_XFCONF (data);
+
+  g_slist_free_full (conf->priv->retired, xfpm_xfconf_config_free);
+  conf->priv->retired = NULL;
+  conf->priv->retired_id = 0;
+
+  return FALSE;
+}
+
+static guint
+xfpm_xfconf_value_uint (XfpmXfconf *conf, guint prop_id)
+{
+  GValue *value = conf->priv->values + prop_id;
+
+  return G_VALUE_HOLDS_UINT (value) ? g_value_get_uint (value) : 0;
+}
+
+static gboolean
+xfpm_xfconf_value_bool (XfpmXfconf *conf, guint prop_id)
+{
+  GValue *value = conf->priv->values + prop_id;
+
+  return G_VALUE_HOLDS_BOOLEAN (value) ? g_value_get_boolean (value) : FALSE;
+}
+
+static gchar *
+xfpm_xfconf_value_string (XfpmXfconf *conf, guint prop_id)
+{
+  GValue *value = conf->priv->values + prop_id;
+
+  return G_VALUE_HOLDS_STRING (value) ? g_value_dup_string (value) : NULL;
+}
+
+static XfpmThermalActions
+xfpm_xfconf_value_thermal_actions (XfpmXfconf *conf, guint prop_id)
+{
+  XfpmThermalActions actions = 0;
+  gchar *value;
+  gchar **list;
+  guint i;
+
+  value = xfpm_xfconf_value_string (conf, prop_id);
+  if ( value == NULL )
+    return 0;
+
+  list = g_strsplit (value, ",", -1);
+  for ( i = 0; list[i] != NULL; i++ )
+  {
+    g_strstrip (list[i]);
+
+    if ( g_strcmp0 (list[i], "profile") == 0 )
+      actions |= XFPM_THERMAL_ACTION_PROFILE;
+    else if ( g_strcmp0 (list[i], "brightness") == 0 )
+      actions |= XFPM_THERMAL_ACTION_BRIGHTNESS;
+    else if ( g_strcmp0 (list[i], "notify") == 0 )
+      actions |= XFPM_THERMAL_ACTION_NOTIFY;
+  }
+
+  g_strfreev (list);
+  g_free (value);
+
+  return actions;
+}
+
+/*
+ * Build a new snapshot from the current values and publish it, the old
+ * one is freed once we are back in the main loop since a handler up the
+ * stack may still be reading it.
+ */
+static void
+xfpm_xfconf_update_config (XfpmXfconf *conf)
+{
+  XfpmConfig *config;
+  XfpmConfig *old;
+
+  config = g_new0 (XfpmConfig, 1);
+
+  old = conf->priv->config;
+  config->generation = old != NULL ? old->generation + 1 : 1;
+
+  config->general_notification             = xfpm_xfconf_value_bool (conf, PROP_GENERAL_NOTIFICATION);
+  config->lock_screen_on_sleep             = xfpm_xfconf_value_bool (conf, PROP_LOCK_SCREEN_ON_SLEEP);
+  config->critical_level                   = xfpm_xfconf_value_uint (conf, PROP_CRITICAL_LEVEL);
+  config->critical_action                  = xfpm_xfconf_value_uint (conf, PROP_CRITICAL_BATTERY_ACTION);
+  config->power_button                     = xfpm_xfconf_value_uint (conf, PROP_POWER_BUTTON);
+  config->sleep_button                     = xfpm_xfconf_value_uint (conf, PROP_SLEEP_BUTTON);
+  config->hibernate_button                 = xfpm_xfconf_value_uint (conf, PROP_HIBERNATE_BUTTON);
+  config->battery_button                   = xfpm_xfconf_value_uint (conf, PROP_BATTERY_BUTTON);
+  config->lid_action_on_ac                 = xfpm_xfconf_value_uint (conf, PROP_LID_ACTION_ON_AC);
+  config->lid_action_on_battery            = xfpm_xfconf_value_uint (conf, PROP_LID_ACTION_ON_BATTERY);
+  config->inactivity_on_ac                 = xfpm_xfconf_value_uint (conf, PROP_IDLE_ON_AC);
+  config->inactivity_on_battery            = xfpm_xfconf_value_uint (conf, PROP_IDLE_ON_BATTERY);
+  config->inactivity_sleep_mode_on_ac      = xfpm_xfconf_value_uint (conf, PROP_IDLE_SLEEP_MODE_ON_AC);
+  config->inactivity_sleep_mode_on_battery = xfpm_xfconf_value_uint (conf, PROP_IDLE_SLEEP_MODE_ON_BATTERY);
+#ifdef WITH_NETWORK_MANAGER
+  config->network_manager_sleep            = xfpm_xfconf_value_bool (conf, PROP_NETWORK_MANAGER_SLEEP);
+#endif
+  config->logind_handle_power_key          = xfpm_xfconf_value_bool (conf, PROP_LOGIND_HANDLE_POWER_KEY);
+  config->logind_handle_suspend_key        = xfpm_xfconf_value_bool (conf, PROP_LOGIND_HANDLE_SUSPEND_KEY);
+  config->logind_handle_hibernate_key      = xfpm_xfconf_value_bool (conf, PROP_LOGIND_HANDLE_HIBERNATE_KEY);
+  config->logind_handle_lid_switch         = xfpm_xfconf_value_bool (conf, PROP_LOGIND_HANDLE_LID_SWITCH);
+  config->workload_inhibit                 = xfpm_xfconf_value_bool (conf, PROP_WORKLOAD_INHIBIT);
+  config->workload_cpu_pressure            = xfpm_xfconf_value_uint (conf, PROP_WORKLOAD_CPU_PRESSURE);
+  config->workload_io_pressure             = xfpm_xfconf_value_uint (conf, PROP_WORKLOAD_IO_PRESSURE);
+  config->workload_load_average            = xfpm_xfconf_value_uint (conf, PROP_WORKLOAD_LOAD_AVERAGE);
+  config->workload_network_rate            = xfpm_xfconf_value_uint (conf, PROP_WORKLOAD_NETWORK_RATE);
+  config->profile_on_ac                    = xfpm_xfconf_value_string (conf, PROP_PROFILE_ON_AC);
+  config->profile_on_battery               = xfpm_xfconf_value_string (conf, PROP_PROFILE_ON_BATTERY);
+  config->profile_on_critical              = xfpm_xfconf_value_string (conf, PROP_PROFILE_ON_CRITICAL);
+  config->profile_on_hot                   = xfpm_xfconf_value_string (conf, PROP_PROFILE_ON_HOT);
+  config->cpu_governor_on_ac               = xfpm_xfconf_value_string (conf, PROP_CPU_GOVERNOR_ON_AC);
+  config->cpu_governor_on_battery          = xfpm_xfconf_value_string (conf, PROP_CPU_GOVERNOR_ON_BATTERY);
+  config->cpu_epp_on_ac                    = xfpm_xfconf_value_string (conf, PROP_CPU_EPP_ON_AC);
+  config->cpu_epp_on_battery               = xfpm_xfconf_value_string (conf, PROP_CPU_EPP_ON_BATTERY);
+  config->cpu_max_freq_on_ac               = xfpm_xfconf_value_uint (conf, PROP_CPU_MAX_FREQ_ON_AC);
+  config->cpu_max_freq_on_battery          = xfpm_xfconf_value_uint (conf, PROP_CPU_MAX_FREQ_ON_BATTERY);
+  config->runtime_pm_on_ac                 = xfpm_xfconf_value_bool (conf, PROP_RUNTIME_PM_ON_AC);
+  config->runtime_pm_on_battery            = xfpm_xfconf_value_bool (conf, PROP_RUNTIME_PM_ON_BATTERY);
+  config->runtime_pm_autosuspend_delay     = xfpm_xfconf_value_uint (conf, PROP_RUNTIME_PM_AUTOSUSPEND_DELAY);
+  config->runtime_pm_deny_list             = xfpm_xfconf_value_string (conf, PROP_RUNTIME_PM_DENY_LIST);
+  config->hibernate_image_tuning           = xfpm_xfconf_value_bool (conf, PROP_HIBERNATE_IMAGE_TUNING);
+  config->hibernate_keep_cache             = xfpm_xfconf_value_uint (conf, PROP_HIBERNATE_KEEP_CACHE);
+  config->suspend_then_hibernate           = xfpm_xfconf_value_bool (conf, PROP_SUSPEND_THEN_HIBERNATE);
+  config->suspend_then_hibernate_interval  = xfpm_xfconf_value_uint (conf, PROP_SUSPEND_THEN_HIBERNATE_INTERVAL);
+  config->short_sleep_threshold            = xfpm_xfconf_value_uint (conf, PROP_SHORT_SLEEP_THRESHOLD);
+  config->brightness_step_count            = xfpm_xfconf_value_uint (conf, PROP_BRIGHTNESS_STEP_COUNT);
+  config->thermal_hot_temperature          = xfpm_xfconf_value_uint (conf, PROP_THERMAL_HOT_TEMPERATURE);
+  config->thermal_hysteresis               = xfpm_xfconf_value_uint (conf, PROP_THERMAL_HYSTERESIS);
+  config->thermal_actions                  = xfpm_xfconf_value_thermal_actions (conf, PROP_THERMAL_ACTIONS);
+  config->thermal_brightness_steps         = xfpm_xfconf_value_uint (conf, PROP_THERMAL_BRIGHTNESS_STEPS);
+  config->metrics_textfile                 = xfpm_xfconf_value_string (conf, PROP_METRICS_TEXTFILE);
+  config->metrics_interval                 = xfpm_xfconf_value_uint (conf, PROP_METRICS_INTERVAL);
+
+  g_atomic_pointer_set (&conf->priv->config, config);
+
+  if ( old != NULL )
+  {
+    conf->priv->retired = g_slist_prepend (conf->priv->retired, old);
+    if ( conf->priv->retired_id == 0 )
+      conf->priv->retired_id = g_idle_add (xfpm_xfconf_free_retired, conf);
+  }
+
+  XFPM_DEBUG ("Configuration generation %u", config->generation);
+}
+
 static void
 xfpm_xfconf_set_property (GObject *object,
                           guint prop_id,
@@ -120,6 +339,14 @@ xfpm_xfconf_set_property (GObject *object,
   if ( g_param_values_cmp (pspec, value, dst) != 0)
   {
     g_value_copy (value, dst);
+
+    /* Publish the new snapshot before anyone is notified, a transaction
+     * publishes once for all the keys it applies */
+    if ( conf->priv->changed != NULL )
+      g_ptr_array_add (conf->priv->changed, (gpointer) pspec->name);
+    else if ( !conf->priv->loading )
+      xfpm_xfconf_update_config (conf);
+
     g_object_notify (object, pspec->name);
   }
 }
@@ -147,36 +374,99 @@ static void
 xfpm_xfconf_load (XfpmXfconf *conf, gboolean channel_valid)
 {
   GParamSpec **specs;
+  GHashTable *stored = NULL;
   GValue value = { 0, };
   guint nspecs;
   guint i;
 
   specs = g_object_class_list_properties (G_OBJECT_GET_CLASS (conf), &nspecs);
 
+  /* One round trip for the whole channel instead of one per property */
+  if (channel_valid)
+    stored = xfconf_channel_get_properties (conf->priv->channel, NULL);
+
+  conf->priv->loading = TRUE;
+
   for ( i = 0; i < nspecs; i++)
   {
     gchar *prop_name;
+    GValue *stored_value = NULL;
+
     prop_name = g_strdup_printf ("%s%s", XFPM_PROPERTIES_PREFIX, specs[i]->name);
     g_value_init (&value, specs[i]->value_type);
 
-    if (channel_valid)
-    {
-      if ( !xfconf_channel_get_property (conf->priv->channel, prop_name, &value) )
-      {
-        XFPM_DEBUG ("Using default configuration for %s", specs[i]->name);
-        g_param_value_set_default (specs[i], &value);
-      }
-    }
-    else
+    if (stored != NULL)
+      stored_value = g_hash_table_lookup (stored, prop_name);
+
+    if ( stored_value == NULL || !g_value_transform (stored_value, &value) )
     {
       XFPM_DEBUG ("Using default configuration for %s", specs[i]->name);
       g_param_value_set_default (specs[i], &value);
     }
+
     g_free (prop_name);
     g_object_set_property (G_OBJECT (conf), specs[i]->name, &value);
     g_value_unset (&value);
   }
   g_free (specs);
+
+  if (stored != NULL)
+    g_hash_table_destroy (stored);
+
+  conf->priv->loading = FALSE;
+  xfpm_xfconf_update_config (conf);
+}
+
+static void
+xfpm_xfconf_value_free (gpointer data)
+{
+  GValue *value = data;
+
+  g_value_unset (value);
+  g_free (value);
+}
+
+/*
+ * Apply all the keys changed during the transaction window: notify::
+ * is emitted once per key after a single snapshot update, followed by
+ * one config-changed carrying the names of the keys that changed.
+ */
+static gboolean
+xfpm_xfconf_apply_transaction (gpointer data)
+{
+  XfpmXfconf *conf = XFPM_XFCONF (data);
+  GHashTableIter iter;
+  gpointer key, value;
+  GPtrArray *changed;
+
+  conf->priv->transaction_id = 0;
+  conf->priv->changed = changed = g_ptr_array_new ();
+
+  g_object_freeze_notify (G_OBJECT (conf));
+
+  g_hash_table_iter_init (&iter, conf->priv->pending);
+  while ( g_hash_table_iter_next (&iter, &key, &value) )
+    g_object_set_property (G_OBJECT (conf), key, value);
+
+  g_hash_table_remove_all (conf->priv->pending);
+
+  conf->priv->changed = NULL;
+
+  if ( changed->len > 0 )
+    xfpm_xfconf_update_config (conf);
+
+  g_object_thaw_notify (G_OBJECT (conf));
+
+  if ( changed->len > 0 )
+  {
+    XFPM_DEBUG ("Applying %u changed keys", changed->len);
+    g_ptr_array_add (changed, NULL);
+    g_signal_emit (G_OBJECT (conf), signals [CONFIG_CHANGED], 0, changed->pdata);
+  }
+
+  g_ptr_array_free (changed, TRUE);
+
+  return FALSE;
 }
 
 static void
@@ -201,9 +491,19 @@ xfpm_xfconf_property_changed_cb (XfconfChannel *channel, gchar *property,
        g_strcmp0 (property, XFPM_PROPERTIES_PREFIX BRIGHTNESS_SWITCH_SAVE) == 0 )
     return;
 
+  if ( !g_object_class_find_property (G_OBJECT_GET_CLASS (conf), property + strlen (XFPM_PROPERTIES_PREFIX)) )
+    return;
+
   XFPM_DEBUG ("Property modified: %s\n", property);
 
-  g_object_set_property (G_OBJECT (conf), property + strlen (XFPM_PROPERTIES_PREFIX), value);
+  /* The last value of a key within the window wins */
+  g_hash_table_replace (conf->priv->pending,
+                        g_strdup (property + strlen (XFPM_PROPERTIES_PREFIX)),
+                        g_boxed_copy (G_TYPE_VALUE, value));
+
+  if ( conf->priv->transaction_id == 0 )
+    conf->priv->transaction_id = g_timeout_add (XFPM_XFCONF_TRANSACTION_TIMEOUT,
+                                                xfpm_xfconf_apply_transaction, conf);
 }
 
 static void
@@ -241,6 +541,22 @@ xfpm_xfconf_class_init (XfpmXfconfClass *klass)
 
   object_class->finalize = xfpm_xfconf_finalize;
 
+  /**
+   * XfpmXfconf::config-changed:
+   * @keys: %NULL terminated array with the names of the changed properties
+   *
+   * Emitted once per batch of settings changes, after the new values
+   * are in place and notify:: has been emitted for each of them.
+   **/
+  signals [CONFIG_CHANGED] =
+    g_signal_new ("config-changed",
+                  XFPM_TYPE_XFCONF,
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (XfpmXfconfClass, config_changed),
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__BOXED,
+                  G_TYPE_NONE, 1, G_TYPE_STRV);
+
   /**
    * XfpmXfconf::general-notification
    **/
@@ -642,6 +958,391 @@ xfpm_xfconf_class_init (XfpmXfconfClass *klass)
                                                          NULL, NULL,
                                                          NULL,
                                                          G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::profile-on-ac
+   *
+   * power-profiles-daemon profile to switch to, an empty string
+   * leaves the profile picked by the user alone.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_PROFILE_ON_AC,
+                                   g_param_spec_string  (PROFILE_ON_AC,
+                                                         NULL, NULL,
+                                                         "",
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::profile-on-battery
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_PROFILE_ON_BATTERY,
+                                   g_param_spec_string  (PROFILE_ON_BATTERY,
+                                                         NULL, NULL,
+                                                         "",
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::profile-on-critical
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_PROFILE_ON_CRITICAL,
+                                   g_param_spec_string  (PROFILE_ON_CRITICAL,
+                                                         NULL, NULL,
+                                                         "power-saver",
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::profile-on-hot
+   *
+   * Profile while the system is too hot, when the thermal actions
+   * include "profile".
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_PROFILE_ON_HOT,
+                                   g_param_spec_string  (PROFILE_ON_HOT,
+                                                         NULL, NULL,
+                                                         "power-saver",
+                                                         G_PARAM_READWRITE));
+  /**
+   * XfpmXfconf::workload-inhibit
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_WORKLOAD_INHIBIT,
+                                   g_param_spec_boolean (WORKLOAD_INHIBIT,
+                                                         NULL, NULL,
+                                                         FALSE,
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::workload-cpu-pressure
+   *
+   * Percentage of time some task stalled on cpu over the last 10 seconds,
+   * 0 disables the check.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_WORKLOAD_CPU_PRESSURE,
+                                   g_param_spec_uint (WORKLOAD_CPU_PRESSURE,
+                                                      NULL, NULL,
+                                                      0,
+                                                      100,
+                                                      40,
+                                                      G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::workload-io-pressure
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_WORKLOAD_IO_PRESSURE,
+                                   g_param_spec_uint (WORKLOAD_IO_PRESSURE,
+                                                      NULL, NULL,
+                                                      0,
+                                                      100,
+                                                      30,
+                                                      G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::workload-load-average
+   *
+   * One minute load average in percent of the number of processors.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_WORKLOAD_LOAD_AVERAGE,
+                                   g_param_spec_uint (WORKLOAD_LOAD_AVERAGE,
+                                                      NULL, NULL,
+                                                      0,
+                                                      G_MAXUINT,
+                                                      75,
+                                                      G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::workload-network-rate
+   *
+   * Received plus sent KiB/s over all interfaces but loopback.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_WORKLOAD_NETWORK_RATE,
+                                   g_param_spec_uint (WORKLOAD_NETWORK_RATE,
+                                                      NULL, NULL,
+                                                      0,
+                                                      G_MAXUINT,
+                                                      512,
+                                                      G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::cpu-governor-on-ac
+   *
+   * cpufreq governor to switch all CPUs to, an empty string keeps
+   * the one they had when the power manager started.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_CPU_GOVERNOR_ON_AC,
+                                   g_param_spec_string  (CPU_GOVERNOR_ON_AC,
+                                                         NULL, NULL,
+                                                         "",
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::cpu-governor-on-battery
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_CPU_GOVERNOR_ON_BATTERY,
+                                   g_param_spec_string  (CPU_GOVERNOR_ON_BATTERY,
+                                                         NULL, NULL,
+                                                         "",
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::cpu-epp-on-ac
+   *
+   * Energy performance preference hint, e.g. balance_power, for
+   * drivers that have one.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_CPU_EPP_ON_AC,
+                                   g_param_spec_string  (CPU_EPP_ON_AC,
+                                                         NULL, NULL,
+                                                         "",
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::cpu-epp-on-battery
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_CPU_EPP_ON_BATTERY,
+                                   g_param_spec_string  (CPU_EPP_ON_BATTERY,
+                                                         NULL, NULL,
+                                                         "",
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::cpu-max-freq-on-ac
+   *
+   * Frequency limit in percent of the hardware maximum, 0 keeps the
+   * limit the CPUs had when the power manager started.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_CPU_MAX_FREQ_ON_AC,
+                                   g_param_spec_uint (CPU_MAX_FREQ_ON_AC,
+                                                      NULL, NULL,
+                                                      0,
+                                                      100,
+                                                      0,
+                                                      G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::cpu-max-freq-on-battery
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_CPU_MAX_FREQ_ON_BATTERY,
+                                   g_param_spec_uint (CPU_MAX_FREQ_ON_BATTERY,
+                                                      NULL, NULL,
+                                                      0,
+                                                      100,
+                                                      0,
+                                                      G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::runtime-pm-on-ac
+   *
+   * Let PCI and USB devices suspend themselves when idle.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_RUNTIME_PM_ON_AC,
+                                   g_param_spec_boolean (RUNTIME_PM_ON_AC,
+                                                         NULL, NULL,
+                                                         FALSE,
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::runtime-pm-on-battery
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_RUNTIME_PM_ON_BATTERY,
+                                   g_param_spec_boolean (RUNTIME_PM_ON_BATTERY,
+                                                         NULL, NULL,
+                                                         TRUE,
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::runtime-pm-autosuspend-delay
+   *
+   * Idle milliseconds before a device suspends, 0 keeps the driver's.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_RUNTIME_PM_AUTOSUSPEND_DELAY,
+                                   g_param_spec_uint (RUNTIME_PM_AUTOSUSPEND_DELAY,
+                                                      NULL, NULL,
+                                                      0,
+                                                      G_MAXINT,
+                                                      0,
+                                                      G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::runtime-pm-deny-list
+   *
+   * Comma separated devices runtime PM stays off for: hid, audio,
+   * a vendor:product id or a sysfs device name.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_RUNTIME_PM_DENY_LIST,
+                                   g_param_spec_string  (RUNTIME_PM_DENY_LIST,
+                                                         NULL, NULL,
+                                                         "hid,audio",
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::hibernate-image-tuning
+   *
+   * Size the hibernation image from the memory in use instead of
+   * the kernel's 2/5 of RAM.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_HIBERNATE_IMAGE_TUNING,
+                                   g_param_spec_boolean (HIBERNATE_IMAGE_TUNING,
+                                                         NULL, NULL,
+                                                         TRUE,
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::hibernate-keep-cache
+   *
+   * Percentage of the reclaimable page cache kept in the image.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_HIBERNATE_KEEP_CACHE,
+                                   g_param_spec_uint (HIBERNATE_KEEP_CACHE,
+                                                      NULL, NULL,
+                                                      0,
+                                                      100,
+                                                      10,
+                                                      G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::suspend-then-hibernate
+   *
+   * Wake up from suspend on battery and hibernate when the charge
+   * gets close to the critical level.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_SUSPEND_THEN_HIBERNATE,
+                                   g_param_spec_boolean (SUSPEND_THEN_HIBERNATE,
+                                                         NULL, NULL,
+                                                         FALSE,
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::suspend-then-hibernate-interval
+   *
+   * Minutes between the battery checks while suspended.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_SUSPEND_THEN_HIBERNATE_INTERVAL,
+                                   g_param_spec_uint (SUSPEND_THEN_HIBERNATE_INTERVAL,
+                                                      NULL, NULL,
+                                                      5,
+                                                      1440,
+                                                      60,
+                                                      G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::short-sleep-threshold
+   *
+   * Sleeps shorter than this many seconds are reported with the
+   * device that ended them, 0 to never notify.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_SHORT_SLEEP_THRESHOLD,
+                                   g_param_spec_uint (SHORT_SLEEP_THRESHOLD,
+                                                      NULL, NULL,
+                                                      0,
+                                                      3600,
+                                                      60,
+                                                      G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::thermal-hot-temperature
+   *
+   * Hottest thermal zone in °C above which the system counts as too
+   * hot, 0 to not watch the temperature.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_THERMAL_HOT_TEMPERATURE,
+                                   g_param_spec_uint (THERMAL_HOT_TEMPERATURE,
+                                                      NULL, NULL,
+                                                      0,
+                                                      150,
+                                                      90,
+                                                      G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::thermal-hysteresis
+   *
+   * How many °C below the hot temperature the system has to cool
+   * down before the thermal actions are undone.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_THERMAL_HYSTERESIS,
+                                   g_param_spec_uint (THERMAL_HYSTERESIS,
+                                                      NULL, NULL,
+                                                      1,
+                                                      50,
+                                                      10,
+                                                      G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::thermal-actions
+   *
+   * Comma separated list of "profile", "brightness" and "notify".
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_THERMAL_ACTIONS,
+                                   g_param_spec_string  (THERMAL_ACTIONS,
+                                                         NULL, NULL,
+                                                         "profile,notify",
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::thermal-brightness-steps
+   *
+   * Brightness steps to go down while the system is too hot.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_THERMAL_BRIGHTNESS_STEPS,
+                                   g_param_spec_uint (THERMAL_BRIGHTNESS_STEPS,
+                                                      NULL, NULL,
+                                                      1,
+                                                      10,
+                                                      2,
+                                                      G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::metrics-textfile
+   *
+   * File for the node_exporter textfile collector, ending in .prom,
+   * empty to not write one.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_METRICS_TEXTFILE,
+                                   g_param_spec_string  (METRICS_TEXTFILE,
+                                                         NULL, NULL,
+                                                         "",
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * XfpmXfconf::metrics-interval
+   *
+   * Seconds between two checks of the metrics that have no change
+   * notification, everything else is written as it changes.
+   **/
+  g_object_class_install_property (object_class,
+                                   PROP_METRICS_INTERVAL,
+                                   g_param_spec_uint (METRICS_INTERVAL,
+                                                      NULL, NULL,
+                                                      5,
+                                                      3600,
+                                                      30,
+                                                      G_PARAM_READWRITE));
 }
 
 static void
@@ -654,6 +1355,8 @@ xfpm_xfconf_init (XfpmXfconf *conf)
   conf->priv = xfpm_xfconf_get_instance_private (conf);
 
   conf->priv->values = g_new0 (GValue, N_PROPERTIES);
+  conf->priv->pending = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                               g_free, xfpm_xfconf_value_free);
 
   if ( !xfconf_init (&error) )
   {
@@ -706,6 +1409,15 @@ xfpm_xfconf_finalize(GObject *object)
 
   g_free (conf->priv->values);
 
+  if ( conf->priv->transaction_id != 0 )
+    g_source_remove (conf->priv->transaction_id);
+  g_hash_table_destroy (conf->priv->pending);
+
+  if ( conf->priv->retired_id != 0 )
+    g_source_remove (conf->priv->retired_id);
+  g_slist_free_full (conf->priv->retired, xfpm_xfconf_config_free);
+  xfpm_xfconf_config_free (conf->priv->config);
+
   G_OBJECT_CLASS (xfpm_xfconf_parent_class)->finalize(object);
 }
 
@@ -732,3 +1444,14 @@ xfpm_xfconf_get_channel (XfpmXfconf *conf)
 {
   return conf->priv->channel;
 }
+
+/**
+ * xfpm_xfconf_get_config:
+ *
+ * Returns: the current settings snapshot, owned by @conf.
+ **/
+const XfpmConfig *
+xfpm_xfconf_get_config (XfpmXfconf *conf)
+{
+  return g_atomic_pointer_get (&conf->priv->config);
+}
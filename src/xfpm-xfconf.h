@@ -24,6 +24,8 @@
 #include <glib-object.h>
 #include <xfconf/xfconf.h>
 
+#include "xfpm-enum-glib.h"
+
 G_BEGIN_DECLS
 
 #define XFPM_TYPE_XFCONF        (xfpm_xfconf_get_type () )
@@ -41,11 +43,100 @@ typedef struct
 typedef struct
 {
   GObjectClass          parent_class;
+
+  /* signals */
+  void                (*config_changed)   (XfpmXfconf   *conf,
+                                           const gchar **keys);
 } XfpmXfconfClass;
 
+/* thermal-actions, split up when the settings change */
+typedef enum
+{
+  XFPM_THERMAL_ACTION_PROFILE    = 1 << 0,
+  XFPM_THERMAL_ACTION_BRIGHTNESS = 1 << 1,
+  XFPM_THERMAL_ACTION_NOTIFY     = 1 << 2
+} XfpmThermalActions;
+
+/*
+ * Typed copy of the settings read on every power event, so the
+ * handlers don't have to go through a property lookup by name.
+ * A snapshot is never modified, a new one with a higher generation
+ * replaces it when any setting changes. The pointer returned by
+ * xfpm_xfconf_get_config stays valid until we return to the main loop.
+ */
+typedef struct
+{
+  guint                 generation;
+
+  gboolean              general_notification;
+  gboolean              lock_screen_on_sleep;
+  guint                 critical_level;
+  XfpmShutdownRequest   critical_action;
+
+  XfpmShutdownRequest   power_button;
+  XfpmShutdownRequest   sleep_button;
+  XfpmShutdownRequest   hibernate_button;
+  XfpmShutdownRequest   battery_button;
+
+  XfpmLidTriggerAction  lid_action_on_ac;
+  XfpmLidTriggerAction  lid_action_on_battery;
+
+  guint                 inactivity_on_ac;
+  guint                 inactivity_on_battery;
+  XfpmShutdownRequest   inactivity_sleep_mode_on_ac;
+  XfpmShutdownRequest   inactivity_sleep_mode_on_battery;
+
+  gboolean              network_manager_sleep;
+
+  gboolean              logind_handle_power_key;
+  gboolean              logind_handle_suspend_key;
+  gboolean              logind_handle_hibernate_key;
+  gboolean              logind_handle_lid_switch;
+
+  gboolean              workload_inhibit;
+  guint                 workload_cpu_pressure;
+  guint                 workload_io_pressure;
+  guint                 workload_load_average;
+  guint                 workload_network_rate;
+
+  /* Power profile names, empty to leave the profile alone */
+  gchar                *profile_on_ac;
+  gchar                *profile_on_battery;
+  gchar                *profile_on_critical;
+  gchar                *profile_on_hot;
+
+  gchar                *cpu_governor_on_ac;
+  gchar                *cpu_governor_on_battery;
+  gchar                *cpu_epp_on_ac;
+  gchar                *cpu_epp_on_battery;
+  guint                 cpu_max_freq_on_ac;
+  guint                 cpu_max_freq_on_battery;
+
+  gboolean              runtime_pm_on_ac;
+  gboolean              runtime_pm_on_battery;
+  guint                 runtime_pm_autosuspend_delay;
+  gchar                *runtime_pm_deny_list;
+
+  gboolean              hibernate_image_tuning;
+  guint                 hibernate_keep_cache;
+  gboolean              suspend_then_hibernate;
+  guint                 suspend_then_hibernate_interval;
+  guint                 short_sleep_threshold;
+
+  guint                 brightness_step_count;
+  guint                 thermal_hot_temperature;
+  guint                 thermal_hysteresis;
+  XfpmThermalActions    thermal_actions;
+  guint                 thermal_brightness_steps;
+
+  gchar                *metrics_textfile;
+  guint                 metrics_interval;
+} XfpmConfig;
+
 GType              xfpm_xfconf_get_type             (void) G_GNUC_CONST;
 XfpmXfconf        *xfpm_xfconf_new                  (void);
 XfconfChannel     *xfpm_xfconf_get_channel          (XfpmXfconf *conf);
+const XfpmConfig  *xfpm_xfconf_get_config           (XfpmXfconf *conf);
 
 G_END_DECLS
 
@@ -0,0 +1,406 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Adds and removes devices on the systray button the way the daemon's
+ * state does, and checks the object path index and the cached display
+ * device after every delta. XfpmState is a stand-in defined below that
+ * the test feeds snapshots and deltas through. Needs a display, the
+ * test is skipped without one.
+ */
+#include "../panel-plugins/power-manager-plugin/power-manager-button.c"
+
+#define TEST_DISPLAY_DEVICE   "/org/freedesktop/UPower/devices/DisplayDevice"
+#define TEST_DEVICE_PREFIX    "/org/freedesktop/UPower/devices/battery_BAT"
+#define TEST_DEVICES_MAX      12
+#define TEST_ROUNDS           2000
+
+/* The daemon's state */
+
+static XfpmState *test_state = NULL;
+static guint64 test_serial = 0;
+
+G_DEFINE_TYPE (XfpmState, xfpm_state, G_TYPE_OBJECT)
+
+static void
+xfpm_state_class_init (XfpmStateClass *klass)
+{
+  g_signal_new ("state-changed",
+                XFPM_TYPE_STATE,
+                G_SIGNAL_RUN_LAST,
+                G_STRUCT_OFFSET (XfpmStateClass, state_changed),
+                NULL, NULL,
+                g_cclosure_marshal_generic,
+                G_TYPE_NONE, 2, G_TYPE_UINT64, G_TYPE_VARIANT);
+}
+
+static void
+xfpm_state_init (XfpmState *state)
+{
+}
+
+XfpmState *
+xfpm_state_new (void)
+{
+  return g_object_ref (test_state);
+}
+
+/* No devices yet, the display device comes before its device does */
+GVariant *
+xfpm_state_get_snapshot (XfpmState *state, guint64 *serial)
+{
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", XFPM_STATE_DISPLAY_DEVICE,
+                         g_variant_new_object_path (TEST_DISPLAY_DEVICE));
+  g_variant_builder_add (&builder, "{sv}", XFPM_STATE_DEVICES,
+                         g_variant_new_array (G_VARIANT_TYPE ("{oa{sv}}"), NULL, 0));
+
+  if ( serial != NULL )
+    *serial = test_serial;
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+void
+xfpm_state_set_brightness (XfpmState *state, gint32 level,
+                           GAsyncReadyCallback callback, gpointer user_data)
+{
+  GTask *task;
+
+  task = g_task_new (state, NULL, callback, user_data);
+  g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                           "No brightness control available");
+  g_object_unref (task);
+}
+
+gboolean
+xfpm_state_set_brightness_finish (XfpmState *state, GAsyncResult *result, GError **error)
+{
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+gboolean
+xfpm_state_step_brightness (XfpmState *state, gboolean up)
+{
+  return FALSE;
+}
+
+GVariant *
+xfpm_state_get_top_consumers (XfpmState *state, guint count)
+{
+  return g_variant_new ("(d@a(usdd))", -1.0,
+                        g_variant_new_array (G_VARIANT_TYPE ("(usdd)"), NULL, 0));
+}
+
+/* Deltas */
+
+static GVariant *
+test_device_props (gdouble percentage)
+{
+  GVariantBuilder props;
+
+  g_variant_builder_init (&props, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&props, "{sv}", "kind", g_variant_new_uint32 (UP_DEVICE_KIND_BATTERY));
+  g_variant_builder_add (&props, "{sv}", "state", g_variant_new_uint32 (UP_DEVICE_STATE_DISCHARGING));
+  g_variant_builder_add (&props, "{sv}", "percentage", g_variant_new_double (percentage));
+  g_variant_builder_add (&props, "{sv}", "is-present", g_variant_new_boolean (TRUE));
+
+  return g_variant_builder_end (&props);
+}
+
+static gchar *
+test_device_path (guint n)
+{
+  /* The display device is one of the paths that come and go */
+  if ( n == 0 )
+    return g_strdup (TEST_DISPLAY_DEVICE);
+
+  return g_strdup_printf (TEST_DEVICE_PREFIX "%u", n);
+}
+
+/* Sends @added with @percentage and drops @removed, either may be -1 */
+static void
+test_send_delta (gint added, gdouble percentage, gint removed)
+{
+  GVariantBuilder changes;
+  gchar *path;
+
+  g_variant_builder_init (&changes, G_VARIANT_TYPE_VARDICT);
+
+  if ( added >= 0 )
+  {
+    GVariantBuilder devices;
+
+    path = test_device_path (added);
+    g_variant_builder_init (&devices, G_VARIANT_TYPE ("a{oa{sv}}"));
+    g_variant_builder_add (&devices, "{o@a{sv}}", path, test_device_props (percentage));
+    g_variant_builder_add (&changes, "{sv}", XFPM_STATE_DEVICES, g_variant_builder_end (&devices));
+    g_free (path);
+  }
+
+  if ( removed >= 0 )
+  {
+    GVariantBuilder paths;
+
+    path = test_device_path (removed);
+    g_variant_builder_init (&paths, G_VARIANT_TYPE ("ao"));
+    g_variant_builder_add (&paths, "o", path);
+    g_variant_builder_add (&changes, "{sv}", XFPM_STATE_REMOVED_DEVICES, g_variant_builder_end (&paths));
+    g_free (path);
+  }
+
+  g_signal_emit_by_name (test_state, "state-changed", ++test_serial,
+                         g_variant_builder_end (&changes));
+}
+
+/* What the button should have, rebuilt from scratch */
+typedef struct
+{
+  gboolean    present[TEST_DEVICES_MAX];
+  gdouble     percentage[TEST_DEVICES_MAX];
+} TestModel;
+
+static void
+test_button_check (PowerManagerButton *button, const TestModel *model)
+{
+  PowerManagerButtonPrivate *priv = button->priv;
+  BatteryDevice *expected = NULL;
+  gdouble highest = 0;
+  guint count = 0;
+  GList *item;
+  guint n;
+
+  g_assert_cmpuint (g_hash_table_size (priv->device_index), ==, g_list_length (priv->devices));
+
+  for ( item = priv->devices; item != NULL; item = item->next )
+  {
+    BatteryDevice *battery_device = item->data;
+
+    g_assert_true (g_hash_table_lookup (priv->device_index, battery_device->object_path) == item);
+    g_assert_true (battery_device->button == button);
+  }
+
+  for ( n = 0; n < TEST_DEVICES_MAX; n++ )
+  {
+    gchar *path = test_device_path (n);
+    GList *link = g_hash_table_lookup (priv->device_index, path);
+
+    if ( model->present[n] )
+    {
+      g_assert_nonnull (link);
+      count++;
+
+      if ( n == 0 )
+        expected = link->data;
+      else if ( !model->present[0] && model->percentage[n] > highest )
+      {
+        expected = link->data;
+        highest = model->percentage[n];
+      }
+    }
+    else
+    {
+      g_assert_null (link);
+    }
+
+    g_free (path);
+  }
+
+  g_assert_cmpuint (g_list_length (priv->devices), ==, count);
+
+  /* UPower's display device when it is there, the fullest battery
+   * otherwise */
+  g_assert_true (priv->display_battery_device == expected);
+
+  if ( model->present[0] )
+    g_assert_true (priv->display_device == expected->device);
+  else
+    g_assert_null (priv->display_device);
+}
+
+static PowerManagerButton *
+test_button_new (void)
+{
+  PowerManagerButton *button;
+
+  test_serial = 0;
+  test_state = g_object_new (XFPM_TYPE_STATE, NULL);
+
+  button = g_object_new (POWER_MANAGER_TYPE_BUTTON, NULL);
+  g_object_ref_sink (button);
+
+  /* Builds the panel icon and takes the snapshot */
+  power_manager_button_show (button);
+
+  return button;
+}
+
+static void
+test_button_free (PowerManagerButton *button)
+{
+  gtk_widget_destroy (GTK_WIDGET (button));
+  g_object_unref (button);
+
+  g_object_unref (test_state);
+  test_state = NULL;
+}
+
+static void
+test_button_add_remove (void)
+{
+  PowerManagerButton *button;
+  TestModel model = { { FALSE }, { 0 } };
+
+  button = test_button_new ();
+  test_button_check (button, &model);
+
+  test_send_delta (3, 40, -1);
+  model.present[3] = TRUE;
+  model.percentage[3] = 40;
+  test_button_check (button, &model);
+
+  test_send_delta (5, 80, -1);
+  model.present[5] = TRUE;
+  model.percentage[5] = 80;
+  test_button_check (button, &model);
+
+  /* The display device takes over from the fullest battery */
+  test_send_delta (0, 60, -1);
+  model.present[0] = TRUE;
+  model.percentage[0] = 60;
+  test_button_check (button, &model);
+
+  /* And hands back when it goes */
+  test_send_delta (-1, 0, 0);
+  model.present[0] = FALSE;
+  test_button_check (button, &model);
+
+  /* Removing the fallback picks the next one */
+  test_send_delta (-1, 0, 5);
+  model.present[5] = FALSE;
+  test_button_check (button, &model);
+
+  /* Removing what isn't there does nothing */
+  test_send_delta (-1, 0, 7);
+  test_button_check (button, &model);
+
+  test_button_free (button);
+}
+
+/* Distinct for every device, so the fullest battery is never a tie */
+static gdouble
+test_random_percentage (guint n)
+{
+  return n * 8 + g_test_rand_int_range (1, 8);
+}
+
+static void
+test_button_churn (void)
+{
+  PowerManagerButton *button;
+  TestModel model = { { FALSE }, { 0 } };
+  GVariant *snapshot;
+  guint round;
+
+  button = test_button_new ();
+
+  for ( round = 0; round < TEST_ROUNDS; round++ )
+  {
+    guint n = g_test_rand_int_range (0, TEST_DEVICES_MAX);
+
+    if ( model.present[n] && g_test_rand_bit () )
+    {
+      test_send_delta (-1, 0, n);
+      model.present[n] = FALSE;
+    }
+    else if ( model.present[n] )
+    {
+      BatteryDevice *before = button->priv->display_battery_device;
+
+      /* An update, the display device is only looked up again when
+       * devices come and go */
+      model.percentage[n] = test_random_percentage (n);
+      test_send_delta (n, model.percentage[n], -1);
+
+      g_assert_true (button->priv->display_battery_device == before);
+      g_assert_cmpuint (g_hash_table_size (button->priv->device_index), ==,
+                        g_list_length (button->priv->devices));
+      continue;
+    }
+    else
+    {
+      model.present[n] = TRUE;
+      model.percentage[n] = test_random_percentage (n);
+      test_send_delta (n, model.percentage[n], -1);
+    }
+
+    test_button_check (button, &model);
+
+    /* Let the queued refreshes run against the devices left */
+    if ( round % 64 == 0 )
+      while ( g_main_context_iteration (NULL, FALSE) )
+        ;
+  }
+
+  /* A snapshot without any devices drops them all */
+  snapshot = g_variant_ref_sink (g_variant_new_parsed ("{%s: <@a{oa{sv}} {}>}",
+                                                       XFPM_STATE_DEVICES));
+  power_manager_button_apply_state (button, snapshot, TRUE);
+  g_variant_unref (snapshot);
+
+  memset (&model, 0, sizeof (model));
+  test_button_check (button, &model);
+
+  test_button_free (button);
+}
+
+int
+main (int argc, char **argv)
+{
+  GTestDBus *bus;
+  gint ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  if ( !gtk_init_check (&argc, &argv) )
+  {
+    g_printerr ("No display, skipping\n");
+    return 77;
+  }
+
+  /* Missing icons in the test environment only warn */
+  g_log_set_always_fatal (G_LOG_FATAL_MASK | G_LOG_LEVEL_CRITICAL);
+
+  /* The button connects to xfconf on the session bus */
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+
+  g_test_add_func ("/button/devices/add-remove", test_button_add_remove);
+  g_test_add_func ("/button/devices/churn", test_button_churn);
+
+  ret = g_test_run ();
+
+  g_test_dbus_down (bus);
+  g_object_unref (bus);
+
+  return ret;
+}
@@ -0,0 +1,234 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * The settings snapshot against the properties it is built from, and
+ * what a power event pays to read its settings either way.
+ *
+ * Run with -m perf for the timings, the numbers are reported through
+ * g_test_minimized_result:
+ *   ./test-config -m perf --verbose
+ */
+#include "../src/xfpm-xfconf.c"
+
+#define EVENT_ROUNDS        1000
+#define EVENT_ROUNDS_PERF   2000000
+
+/* One for the whole run, like in the daemon: the channels keep their
+ * handlers for as long as xfconf is up */
+static XfpmXfconf *test_conf;
+
+static void
+test_config_matches (void)
+{
+  const XfpmConfig *config;
+  gboolean notify;
+  guint critical_level, critical_action, lid_action, inactivity, sleep_mode;
+
+  config = xfpm_xfconf_get_config (test_conf);
+
+  g_object_get (G_OBJECT (test_conf),
+                GENERAL_NOTIFICATION_CFG, &notify,
+                CRITICAL_POWER_LEVEL, &critical_level,
+                CRITICAL_BATT_ACTION_CFG, &critical_action,
+                LID_SWITCH_ON_AC_CFG, &lid_action,
+                ON_AC_INACTIVITY_TIMEOUT, &inactivity,
+                INACTIVITY_SLEEP_MODE_ON_AC, &sleep_mode,
+                NULL);
+
+  g_assert_cmpint (config->general_notification, ==, notify);
+  g_assert_cmpuint (config->critical_level, ==, critical_level);
+  g_assert_cmpuint (config->critical_action, ==, critical_action);
+  g_assert_cmpuint (config->lid_action_on_ac, ==, lid_action);
+  g_assert_cmpuint (config->inactivity_on_ac, ==, inactivity);
+  g_assert_cmpuint (config->inactivity_sleep_mode_on_ac, ==, sleep_mode);
+}
+
+static void
+test_config_set (void)
+{
+  const XfpmConfig *old, *config;
+  guint critical_level;
+
+  old = xfpm_xfconf_get_config (test_conf);
+  critical_level = old->critical_level == 5 ? 6 : 5;
+
+  g_object_set (G_OBJECT (test_conf), CRITICAL_POWER_LEVEL, critical_level, NULL);
+
+  config = xfpm_xfconf_get_config (test_conf);
+  g_assert_true (config != old);
+  g_assert_cmpuint (config->generation, ==, old->generation + 1);
+  g_assert_cmpuint (config->critical_level, ==, critical_level);
+
+  /* The replaced one is still there until the next idle */
+  g_assert_cmpuint (old->critical_level, !=, critical_level);
+
+  /* Setting the same value again keeps the snapshot */
+  g_object_set (G_OBJECT (test_conf), CRITICAL_POWER_LEVEL, critical_level, NULL);
+  g_assert_true (xfpm_xfconf_get_config (test_conf) == config);
+}
+
+static void
+test_config_transaction (void)
+{
+  const XfpmConfig *old, *config;
+  GValue value = { 0, };
+  guint generation;
+
+  old = xfpm_xfconf_get_config (test_conf);
+  generation = old->generation;
+
+  g_value_init (&value, G_TYPE_UINT);
+
+  /* Two keys and a key changed twice in one window, one new snapshot */
+  g_value_set_uint (&value, 7);
+  xfpm_xfconf_property_changed_cb (NULL, XFPM_PROPERTIES_PREFIX CRITICAL_POWER_LEVEL, &value, test_conf);
+  g_value_set_uint (&value, 8);
+  xfpm_xfconf_property_changed_cb (NULL, XFPM_PROPERTIES_PREFIX CRITICAL_POWER_LEVEL, &value, test_conf);
+  g_value_set_uint (&value, 600);
+  xfpm_xfconf_property_changed_cb (NULL, XFPM_PROPERTIES_PREFIX ON_AC_INACTIVITY_TIMEOUT, &value, test_conf);
+
+  g_assert_true (xfpm_xfconf_get_config (test_conf) == old);
+  g_assert_cmpuint (test_conf->priv->transaction_id, !=, 0);
+
+  g_source_remove (test_conf->priv->transaction_id);
+  xfpm_xfconf_apply_transaction (test_conf);
+
+  config = xfpm_xfconf_get_config (test_conf);
+  g_assert_cmpuint (config->generation, ==, generation + 1);
+  g_assert_cmpuint (config->critical_level, ==, 8);
+  g_assert_cmpuint (config->inactivity_on_ac, ==, 600);
+
+  g_value_unset (&value);
+}
+
+/* The settings xfpm_battery_check_charge, xfpm_battery_notify_state,
+ * the lid handler and the idle alarm read per event, the way they
+ * read them before the snapshot */
+static guint
+test_config_event_by_name (XfpmXfconf *conf)
+{
+  gboolean notify;
+  guint critical_level, critical_action, lid_action, inactivity, sleep_mode;
+
+  g_object_get (G_OBJECT (conf), GENERAL_NOTIFICATION_CFG, &notify, NULL);
+  g_object_get (G_OBJECT (conf), CRITICAL_POWER_LEVEL, &critical_level, NULL);
+  g_object_get (G_OBJECT (conf), CRITICAL_BATT_ACTION_CFG, &critical_action, NULL);
+  g_object_get (G_OBJECT (conf), LID_SWITCH_ON_AC_CFG, &lid_action, NULL);
+  g_object_get (G_OBJECT (conf),
+                ON_AC_INACTIVITY_TIMEOUT, &inactivity,
+                INACTIVITY_SLEEP_MODE_ON_AC, &sleep_mode,
+                NULL);
+
+  return notify + critical_level + critical_action + lid_action + inactivity + sleep_mode;
+}
+
+/* And the way they read them now */
+static guint
+test_config_event_snapshot (XfpmXfconf *conf)
+{
+  const XfpmConfig *config;
+
+  config = xfpm_xfconf_get_config (conf);
+
+  return config->general_notification + config->critical_level + config->critical_action
+         + config->lid_action_on_ac + config->inactivity_on_ac + config->inactivity_sleep_mode_on_ac;
+}
+
+/* Nanoseconds per event */
+static gdouble
+test_config_time_events (XfpmXfconf *conf, guint (*event) (XfpmXfconf *), guint rounds)
+{
+  volatile guint sink = 0;
+  gint64 start;
+  guint i;
+
+  start = g_get_monotonic_time ();
+
+  for ( i = 0; i < rounds; i++ )
+    sink += event (conf);
+
+  return (g_get_monotonic_time () - start) * 1000.0 / rounds;
+}
+
+static void
+test_config_event_cost (void)
+{
+  guint rounds;
+  gdouble by_name, snapshot;
+
+  rounds = g_test_perf () ? EVENT_ROUNDS_PERF : EVENT_ROUNDS;
+
+  /* Both paths see the same settings */
+  g_assert_cmpuint (test_config_event_by_name (test_conf), ==, test_config_event_snapshot (test_conf));
+
+  /* Warm up the pspec pool and the caches */
+  test_config_time_events (test_conf, test_config_event_by_name, EVENT_ROUNDS);
+  test_config_time_events (test_conf, test_config_event_snapshot, EVENT_ROUNDS);
+
+  by_name = test_config_time_events (test_conf, test_config_event_by_name, rounds);
+  snapshot = test_config_time_events (test_conf, test_config_event_snapshot, rounds);
+
+  if ( g_test_perf () )
+  {
+    g_test_minimized_result (by_name, "g_object_get by name: %.1f ns per event", by_name);
+    g_test_minimized_result (snapshot, "xfpm_xfconf_get_config: %.1f ns per event", snapshot);
+  }
+  else
+  {
+    g_test_message ("%u events, %.1f ns by name, %.1f ns from the snapshot",
+                    rounds, by_name, snapshot);
+  }
+}
+
+int
+main (int argc, char **argv)
+{
+  GTestDBus *bus;
+  gint ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  /* There is no xfconfd on the test bus, the channels only warn */
+  g_log_set_always_fatal (G_LOG_FATAL_MASK | G_LOG_LEVEL_CRITICAL);
+
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+
+  test_conf = xfpm_xfconf_new ();
+
+  /* The first snapshot comes with the initial load */
+  g_assert_nonnull (xfpm_xfconf_get_config (test_conf));
+
+  g_test_add_func ("/config/matches", test_config_matches);
+  g_test_add_func ("/config/set", test_config_set);
+  g_test_add_func ("/config/transaction", test_config_transaction);
+  g_test_add_func ("/config/event-cost", test_config_event_cost);
+
+  ret = g_test_run ();
+
+  g_object_unref (test_conf);
+  xfconf_shutdown ();
+
+  g_test_dbus_down (bus);
+  g_object_unref (bus);
+
+  return ret;
+}
@@ -0,0 +1,434 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Runs the power profile policy against a mock power-profiles-daemon
+ * on a private bus. XfpmPower and the settings are stand-ins defined
+ * below.
+ */
+#include "../src/xfpm-power-profiles.c"
+
+static XfpmConfig test_config;
+
+/* Settings */
+
+G_DEFINE_TYPE (XfpmXfconf, xfpm_xfconf, G_TYPE_OBJECT)
+
+static void
+xfpm_xfconf_class_init (XfpmXfconfClass *klass)
+{
+  g_signal_new ("config-changed",
+                XFPM_TYPE_XFCONF,
+                G_SIGNAL_RUN_LAST,
+                G_STRUCT_OFFSET (XfpmXfconfClass, config_changed),
+                NULL, NULL,
+                g_cclosure_marshal_VOID__BOXED,
+                G_TYPE_NONE, 1, G_TYPE_STRV);
+}
+
+static void
+xfpm_xfconf_init (XfpmXfconf *conf)
+{
+}
+
+XfpmXfconf *
+xfpm_xfconf_new (void)
+{
+  return g_object_new (XFPM_TYPE_XFCONF, NULL);
+}
+
+const XfpmConfig *
+xfpm_xfconf_get_config (XfpmXfconf *conf)
+{
+  return &test_config;
+}
+
+/* Power sources */
+
+enum
+{
+  PROP_POWER_0,
+  PROP_ON_BATTERY,
+  PROP_ON_LOW_BATTERY
+};
+
+static gboolean test_on_battery;
+
+G_DEFINE_TYPE (XfpmPower, xfpm_power, G_TYPE_OBJECT)
+
+static void
+xfpm_power_get_property (GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+  switch (prop_id)
+  {
+    case PROP_ON_BATTERY:
+      g_value_set_boolean (value, test_on_battery);
+      break;
+    case PROP_ON_LOW_BATTERY:
+      g_value_set_boolean (value, FALSE);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+xfpm_power_class_init (XfpmPowerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->get_property = xfpm_power_get_property;
+
+  g_signal_new ("on-battery-changed",
+                XFPM_TYPE_POWER,
+                G_SIGNAL_RUN_LAST,
+                G_STRUCT_OFFSET (XfpmPowerClass, on_battery_changed),
+                NULL, NULL,
+                g_cclosure_marshal_VOID__BOOLEAN,
+                G_TYPE_NONE, 1, G_TYPE_BOOLEAN);
+
+  g_signal_new ("low-battery-changed",
+                XFPM_TYPE_POWER,
+                G_SIGNAL_RUN_LAST,
+                G_STRUCT_OFFSET (XfpmPowerClass, low_battery_changed),
+                NULL, NULL,
+                g_cclosure_marshal_VOID__BOOLEAN,
+                G_TYPE_NONE, 1, G_TYPE_BOOLEAN);
+
+  g_object_class_install_property (object_class, PROP_ON_BATTERY,
+                                   g_param_spec_boolean ("on-battery", NULL, NULL,
+                                                         FALSE, G_PARAM_READABLE));
+  g_object_class_install_property (object_class, PROP_ON_LOW_BATTERY,
+                                   g_param_spec_boolean ("on-low-battery", NULL, NULL,
+                                                         FALSE, G_PARAM_READABLE));
+}
+
+static void
+xfpm_power_init (XfpmPower *power)
+{
+}
+
+XfpmPower *
+xfpm_power_get (void)
+{
+  static XfpmPower *power = NULL;
+
+  if ( power != NULL )
+    return g_object_ref (power);
+
+  power = g_object_new (XFPM_TYPE_POWER, NULL);
+  g_object_add_weak_pointer (G_OBJECT (power), (gpointer *) &power);
+
+  return power;
+}
+
+/* The mock daemon */
+
+static const gchar test_ppd_xml[] =
+  "<node>"
+  "  <interface name='" PPD_INTERFACE "'>"
+  "    <property name='ActiveProfile' type='s' access='readwrite'/>"
+  "    <property name='Profiles' type='aa{sv}' access='read'/>"
+  "  </interface>"
+  "</node>";
+
+/* One bus and daemon for every test, GIO keeps the system bus
+ * connection around for the process */
+typedef struct
+{
+  GTestDBus           *bus;
+  GDBusConnection     *connection;
+  gboolean             owned;
+
+  gchar               *active;
+  guint                sets;
+} TestPpd;
+
+static TestPpd test_ppd;
+
+static void
+test_ppd_emit_active (void)
+{
+  GVariantBuilder changed;
+
+  g_variant_builder_init (&changed, G_VARIANT_TYPE ("a{sv}"));
+  g_variant_builder_add (&changed, "{sv}", "ActiveProfile", g_variant_new_string (test_ppd.active));
+
+  g_dbus_connection_emit_signal (test_ppd.connection, NULL, PPD_PATH,
+                                 "org.freedesktop.DBus.Properties", "PropertiesChanged",
+                                 g_variant_new ("(sa{sv}as)", PPD_INTERFACE, &changed, NULL),
+                                 NULL);
+}
+
+static GVariant *
+test_ppd_get_property (GDBusConnection *connection, const gchar *sender,
+                       const gchar *object_path, const gchar *interface_name,
+                       const gchar *property_name, GError **error, gpointer user_data)
+{
+  GVariantBuilder profiles;
+  const gchar *names[] = { "power-saver", "balanced", "performance" };
+  guint i;
+
+  if ( g_strcmp0 (property_name, "ActiveProfile") == 0 )
+    return g_variant_new_string (test_ppd.active);
+
+  g_variant_builder_init (&profiles, G_VARIANT_TYPE ("aa{sv}"));
+  for ( i = 0; i < G_N_ELEMENTS (names); i++ )
+  {
+    g_variant_builder_open (&profiles, G_VARIANT_TYPE ("a{sv}"));
+    g_variant_builder_add (&profiles, "{sv}", "Profile", g_variant_new_string (names[i]));
+    g_variant_builder_close (&profiles);
+  }
+
+  return g_variant_builder_end (&profiles);
+}
+
+/* Like the daemon, the change is signalled before the call returns */
+static gboolean
+test_ppd_set_property (GDBusConnection *connection, const gchar *sender,
+                       const gchar *object_path, const gchar *interface_name,
+                       const gchar *property_name, GVariant *value,
+                       GError **error, gpointer user_data)
+{
+  g_free (test_ppd.active);
+  test_ppd.active = g_variant_dup_string (value, NULL);
+  test_ppd.sets++;
+
+  test_ppd_emit_active ();
+
+  return TRUE;
+}
+
+static const GDBusInterfaceVTable test_ppd_vtable =
+{
+  NULL,
+  test_ppd_get_property,
+  test_ppd_set_property
+};
+
+static void
+test_ppd_name_acquired_cb (GDBusConnection *connection, const gchar *name, gpointer user_data)
+{
+  test_ppd.owned = TRUE;
+}
+
+static gboolean
+test_profiles_timeout_cb (gpointer user_data)
+{
+  g_assert_not_reached ();
+  return FALSE;
+}
+
+/* Runs the main loop until @condition holds, or fails after a few seconds */
+#define test_profiles_wait_for(condition)                                         \
+  G_STMT_START {                                                                  \
+    guint timeout_id = g_timeout_add_seconds (5, test_profiles_timeout_cb, NULL); \
+    while ( !(condition) )                                                        \
+      g_main_context_iteration (NULL, TRUE);                                      \
+    g_source_remove (timeout_id);                                                 \
+  } G_STMT_END
+
+static void
+test_ppd_start (void)
+{
+  GDBusNodeInfo *info;
+  GError *error = NULL;
+
+  test_ppd.bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (test_ppd.bus);
+
+  /* The module looks for the daemon on the system bus */
+  g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address (test_ppd.bus), TRUE);
+
+  test_ppd.connection = g_dbus_connection_new_for_address_sync (g_test_dbus_get_bus_address (test_ppd.bus),
+                                                                G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                                G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                                NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  info = g_dbus_node_info_new_for_xml (test_ppd_xml, &error);
+  g_assert_no_error (error);
+
+  g_dbus_connection_register_object (test_ppd.connection, PPD_PATH, info->interfaces[0],
+                                     &test_ppd_vtable, NULL, NULL, &error);
+  g_assert_no_error (error);
+  g_dbus_node_info_unref (info);
+
+  g_bus_own_name_on_connection (test_ppd.connection, PPD_NAME, G_BUS_NAME_OWNER_FLAGS_NONE,
+                                test_ppd_name_acquired_cb, NULL, NULL, NULL);
+  test_profiles_wait_for (test_ppd.owned);
+}
+
+static void
+test_ppd_stop (void)
+{
+  g_dbus_connection_close_sync (test_ppd.connection, NULL, NULL);
+  g_object_unref (test_ppd.connection);
+
+  g_test_dbus_down (test_ppd.bus);
+  g_object_unref (test_ppd.bus);
+
+  g_free (test_ppd.active);
+}
+
+typedef struct
+{
+  XfpmPower           *power;
+  XfpmPowerProfiles   *profiles;
+} TestProfiles;
+
+/* Until every set we made returned and its echo came back */
+static void
+test_profiles_settle (TestProfiles *test)
+{
+  test_profiles_wait_for (test->profiles->priv->pending == 0);
+
+  while ( g_main_context_iteration (NULL, FALSE) )
+    ;
+}
+
+static void
+test_profiles_set_on_battery (TestProfiles *test, gboolean on_battery)
+{
+  test_on_battery = on_battery;
+  g_signal_emit_by_name (test->power, "on-battery-changed", on_battery);
+  test_profiles_settle (test);
+}
+
+static void
+test_profiles_set_hot (TestProfiles *test, gboolean hot)
+{
+  xfpm_power_profiles_set_hot (test->profiles, hot);
+  test_profiles_settle (test);
+}
+
+static void
+test_profiles_setup (TestProfiles *test, gconstpointer data)
+{
+  g_free (test_ppd.active);
+  test_ppd.active = g_strdup ("balanced");
+  test_ppd.sets = 0;
+
+  memset (&test_config, 0, sizeof (test_config));
+  test_config.profile_on_ac = (gchar *) "balanced";
+  test_config.profile_on_battery = (gchar *) "power-saver";
+  test_config.profile_on_hot = (gchar *) "power-saver";
+
+  test_on_battery = FALSE;
+
+  test->power = xfpm_power_get ();
+  test->profiles = xfpm_power_profiles_new ();
+  test_profiles_wait_for (test->profiles->priv->proxy != NULL);
+  test_profiles_settle (test);
+}
+
+static void
+test_profiles_teardown (TestProfiles *test, gconstpointer data)
+{
+  g_object_unref (test->profiles);
+  g_object_unref (test->power);
+}
+
+static void
+test_profiles_on_battery (TestProfiles *test, gconstpointer data)
+{
+  /* Already balanced on AC, nothing to set */
+  g_assert_cmpuint (test_ppd.sets, ==, 0);
+
+  test_profiles_set_on_battery (test, TRUE);
+
+  g_assert_cmpstr (test_ppd.active, ==, "power-saver");
+  g_assert_cmpuint (test_ppd.sets, ==, 1);
+  g_assert_null (test->profiles->priv->manual);
+
+  test_profiles_set_on_battery (test, FALSE);
+
+  g_assert_cmpstr (test_ppd.active, ==, "balanced");
+}
+
+/* Two sets in flight, the echo of the first is not the user's */
+static void
+test_profiles_overlapping_sets (TestProfiles *test, gconstpointer data)
+{
+  xfpm_power_profiles_set_hot (test->profiles, TRUE);
+  xfpm_power_profiles_set_hot (test->profiles, FALSE);
+
+  g_assert_cmpuint (test->profiles->priv->pending, ==, 2);
+
+  test_profiles_settle (test);
+
+  g_assert_cmpstr (test_ppd.active, ==, "balanced");
+  g_assert_cmpuint (test_ppd.sets, ==, 2);
+  g_assert_null (test->profiles->priv->manual);
+
+  /* The policy still overrides */
+  test_profiles_set_hot (test, TRUE);
+  g_assert_cmpstr (test_ppd.active, ==, "power-saver");
+
+  test_profiles_set_hot (test, FALSE);
+  g_assert_cmpstr (test_ppd.active, ==, "balanced");
+}
+
+/* Nothing of ours in flight, the change is the user's and sticks */
+static void
+test_profiles_manual (TestProfiles *test, gconstpointer data)
+{
+  g_free (test_ppd.active);
+  test_ppd.active = g_strdup ("performance");
+  test_ppd_emit_active ();
+
+  test_profiles_wait_for (test->profiles->priv->manual != NULL);
+  g_assert_cmpstr (test->profiles->priv->manual, ==, "performance");
+
+  /* Running hot still wins, the user's choice comes back after */
+  test_profiles_set_hot (test, TRUE);
+  g_assert_cmpstr (test_ppd.active, ==, "power-saver");
+
+  test_profiles_set_hot (test, FALSE);
+  g_assert_cmpstr (test_ppd.active, ==, "performance");
+  g_assert_cmpstr (test->profiles->priv->manual, ==, "performance");
+
+  /* Until the power source changes */
+  test_profiles_set_on_battery (test, TRUE);
+  g_assert_cmpstr (test_ppd.active, ==, "power-saver");
+  g_assert_null (test->profiles->priv->manual);
+}
+
+int
+main (int argc, char **argv)
+{
+  gint ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/power-profiles/on-battery", TestProfiles, NULL,
+              test_profiles_setup, test_profiles_on_battery, test_profiles_teardown);
+  g_test_add ("/power-profiles/overlapping-sets", TestProfiles, NULL,
+              test_profiles_setup, test_profiles_overlapping_sets, test_profiles_teardown);
+  g_test_add ("/power-profiles/manual", TestProfiles, NULL,
+              test_profiles_setup, test_profiles_manual, test_profiles_teardown);
+
+  test_ppd_start ();
+  ret = g_test_run ();
+  test_ppd_stop ();
+
+  return ret;
+}
@@ -0,0 +1,214 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * The sampler is static, the module is built into the test so it can be
+ * stepped without waiting for its timeout.
+ */
+#include "../src/xfpm-rapl.c"
+
+#include "xfpm-test-fixture.h"
+
+#define PACKAGE_ZONE    "class/powercap/intel-rapl:0"
+#define CORE_ZONE       "class/powercap/intel-rapl:0:0"
+
+/* Just below where the package counter wraps */
+#define PACKAGE_RANGE   "262143328850"
+#define PACKAGE_START   "262143000000"
+
+static gchar *
+test_rapl_setup (void)
+{
+  gchar *root;
+
+  root = xfpm_test_fixture_new ();
+
+  xfpm_test_fixture_write (root, PACKAGE_ZONE "/name", "package-0\n");
+  xfpm_test_fixture_write (root, PACKAGE_ZONE "/max_energy_range_uj", PACKAGE_RANGE "\n");
+  xfpm_test_fixture_write (root, PACKAGE_ZONE "/energy_uj", PACKAGE_START "\n");
+
+  xfpm_test_fixture_write (root, CORE_ZONE "/name", "core\n");
+  xfpm_test_fixture_write (root, CORE_ZONE "/max_energy_range_uj", PACKAGE_RANGE "\n");
+  xfpm_test_fixture_write (root, CORE_ZONE "/energy_uj", "1000000\n");
+
+  /* Neither a package nor a subzone we report */
+  xfpm_test_fixture_write (root, "class/powercap/intel-rapl:0:1/name", "dram\n");
+  xfpm_test_fixture_write (root, "class/powercap/intel-rapl:0:1/energy_uj", "0\n");
+
+  g_setenv ("XFPM_SYSFS_ROOT", root, TRUE);
+
+  return root;
+}
+
+/* One sample, as if @seconds went by since the last one */
+static void
+test_rapl_step (XfpmRapl *rapl, gdouble seconds)
+{
+  rapl->priv->last_time = g_get_monotonic_time () - (gint64) (seconds * G_USEC_PER_SEC);
+  xfpm_rapl_sample_cb (rapl);
+}
+
+static gdouble
+test_rapl_get (XfpmRapl *rapl, const gchar *property)
+{
+  gdouble watts;
+
+  g_object_get (G_OBJECT (rapl), property, &watts, NULL);
+
+  return watts;
+}
+
+/* The rates are rounded to tenths, and a step takes a bit longer than asked */
+#define test_rapl_assert_rate(rapl, property, watts) \
+  g_assert_cmpfloat (ABS (test_rapl_get ((rapl), (property)) - (watts)), <, 0.05)
+
+static void
+test_rapl_zones (void)
+{
+  XfpmRapl *rapl;
+  gchar *root;
+
+  root = test_rapl_setup ();
+  rapl = xfpm_rapl_new ();
+
+  g_assert_true (xfpm_rapl_is_available (rapl));
+  g_assert_cmpuint (rapl->priv->zones->len, ==, 2);
+
+  /* Nothing measured before the first sample */
+  g_assert_cmpfloat (test_rapl_get (rapl, XFPM_RAPL_ENERGY_RATE), ==, -1);
+  g_assert_cmpfloat (test_rapl_get (rapl, XFPM_RAPL_CORE_ENERGY_RATE), ==, -1);
+
+  g_object_unref (rapl);
+  xfpm_test_fixture_free (root);
+}
+
+static void
+test_rapl_rate (void)
+{
+  XfpmRapl *rapl;
+  gchar *root;
+
+  root = test_rapl_setup ();
+  xfpm_test_fixture_write (root, PACKAGE_ZONE "/energy_uj", "1000000\n");
+  rapl = xfpm_rapl_new ();
+
+  /* 6 J on the package and 2 J on the cores in 2 s */
+  xfpm_test_fixture_write (root, PACKAGE_ZONE "/energy_uj", "7000000\n");
+  xfpm_test_fixture_write (root, CORE_ZONE "/energy_uj", "3000000\n");
+  test_rapl_step (rapl, 2);
+
+  test_rapl_assert_rate (rapl, XFPM_RAPL_ENERGY_RATE, 3.0);
+  test_rapl_assert_rate (rapl, XFPM_RAPL_CORE_ENERGY_RATE, 1.0);
+
+  /* No uncore zone in the tree */
+  g_assert_cmpfloat (test_rapl_get (rapl, XFPM_RAPL_UNCORE_ENERGY_RATE), ==, -1);
+
+  g_object_unref (rapl);
+  xfpm_test_fixture_free (root);
+}
+
+static void
+test_rapl_wraparound (void)
+{
+  XfpmRapl *rapl;
+  gchar *root;
+
+  root = test_rapl_setup ();
+  rapl = xfpm_rapl_new ();
+
+  /* 328850 µJ up to the range and 2671150 µJ past it, 3 J in 1 s */
+  xfpm_test_fixture_write (root, PACKAGE_ZONE "/energy_uj", "2671150\n");
+  xfpm_test_fixture_write (root, CORE_ZONE "/energy_uj", "1000000\n");
+  test_rapl_step (rapl, 1);
+
+  test_rapl_assert_rate (rapl, XFPM_RAPL_ENERGY_RATE, 3.0);
+  test_rapl_assert_rate (rapl, XFPM_RAPL_CORE_ENERGY_RATE, 0.0);
+
+  /* And counting on from the wrapped value */
+  xfpm_test_fixture_write (root, PACKAGE_ZONE "/energy_uj", "7671150\n");
+  test_rapl_step (rapl, 1);
+
+  test_rapl_assert_rate (rapl, XFPM_RAPL_ENERGY_RATE, 5.0);
+
+  g_object_unref (rapl);
+  xfpm_test_fixture_free (root);
+}
+
+static void
+test_rapl_reset (void)
+{
+  XfpmRapl *rapl;
+  gchar *root;
+
+  root = test_rapl_setup ();
+
+  /* Without a range going backwards can't be a wrap */
+  xfpm_test_fixture_write (root, CORE_ZONE "/max_energy_range_uj", "0\n");
+  rapl = xfpm_rapl_new ();
+
+  xfpm_test_fixture_write (root, CORE_ZONE "/energy_uj", "3000000\n");
+  test_rapl_step (rapl, 1);
+  test_rapl_assert_rate (rapl, XFPM_RAPL_CORE_ENERGY_RATE, 2.0);
+
+  /* Reset, e.g. by a resume, the round is skipped and the last rate stays */
+  xfpm_test_fixture_write (root, CORE_ZONE "/energy_uj", "1000\n");
+  test_rapl_step (rapl, 1);
+  test_rapl_assert_rate (rapl, XFPM_RAPL_CORE_ENERGY_RATE, 2.0);
+
+  /* The next round measures from the reset value */
+  xfpm_test_fixture_write (root, CORE_ZONE "/energy_uj", "4001000\n");
+  test_rapl_step (rapl, 1);
+  test_rapl_assert_rate (rapl, XFPM_RAPL_CORE_ENERGY_RATE, 4.0);
+
+  g_object_unref (rapl);
+  xfpm_test_fixture_free (root);
+}
+
+static void
+test_rapl_no_zones (void)
+{
+  XfpmRapl *rapl;
+  gchar *root;
+
+  root = xfpm_test_fixture_new ();
+  g_setenv ("XFPM_SYSFS_ROOT", root, TRUE);
+
+  rapl = xfpm_rapl_new ();
+
+  g_assert_false (xfpm_rapl_is_available (rapl));
+  g_assert_cmpuint (rapl->priv->timeout_id, ==, 0);
+
+  g_object_unref (rapl);
+  xfpm_test_fixture_free (root);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/rapl/zones", test_rapl_zones);
+  g_test_add_func ("/rapl/rate", test_rapl_rate);
+  g_test_add_func ("/rapl/wraparound", test_rapl_wraparound);
+  g_test_add_func ("/rapl/reset", test_rapl_reset);
+  g_test_add_func ("/rapl/no-zones", test_rapl_no_zones);
+
+  return g_test_run ();
+}
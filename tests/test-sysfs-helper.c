@@ -0,0 +1,267 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Runs the built xfpm-power-sysfs-helper against a fixture tree, the
+ * way the daemon runs it with XFPM_SYSFS_ROOT set.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sys/wait.h>
+
+#include <glib.h>
+
+#include "xfpm-test-fixture.h"
+
+#define EXIT_CODE_SUCCESS           0
+#define EXIT_CODE_ARGUMENTS_INVALID 3
+
+#define POLICY0     "devices/system/cpu/cpufreq/policy0"
+#define USB_POWER   "bus/usb/devices/1-1/power"
+
+static gchar *
+test_sysfs_setup (void)
+{
+  gchar *root;
+
+  root = xfpm_test_fixture_new ();
+
+  xfpm_test_fixture_write (root, POLICY0 "/scaling_available_governors", "performance powersave\n");
+  xfpm_test_fixture_write (root, POLICY0 "/scaling_governor", "performance\n");
+  xfpm_test_fixture_write (root, POLICY0 "/energy_performance_available_preferences",
+                           "default performance balance_performance balance_power power\n");
+  xfpm_test_fixture_write (root, POLICY0 "/energy_performance_preference", "balance_performance\n");
+  xfpm_test_fixture_write (root, POLICY0 "/cpuinfo_min_freq", "400000\n");
+  xfpm_test_fixture_write (root, POLICY0 "/cpuinfo_max_freq", "4200000\n");
+  xfpm_test_fixture_write (root, POLICY0 "/scaling_max_freq", "4200000\n");
+
+  xfpm_test_fixture_write (root, USB_POWER "/control", "on\n");
+  xfpm_test_fixture_write (root, USB_POWER "/autosuspend_delay_ms", "2000\n");
+
+  return root;
+}
+
+/* Exit status of the helper, with what it printed in @output */
+static gint
+test_sysfs_run (const gchar *root, const gchar *command, const gchar *option,
+                const gchar *value, gchar **output)
+{
+  gchar *argv[5];
+  gchar **envp;
+  GError *error = NULL;
+  gint status;
+
+  argv[0] = (gchar *) SYSFS_HELPER;
+  argv[1] = (gchar *) command;
+  argv[2] = (gchar *) option;
+  argv[3] = (gchar *) value;
+  argv[4] = NULL;
+
+  envp = g_environ_setenv (g_get_environ (), "XFPM_SYSFS_ROOT", root, TRUE);
+
+  g_spawn_sync (NULL, argv, envp, G_SPAWN_STDERR_TO_DEV_NULL,
+                NULL, NULL, output, NULL, &status, &error);
+  g_assert_no_error (error);
+
+  g_strfreev (envp);
+
+  g_assert_true (WIFEXITED (status));
+
+  return WEXITSTATUS (status);
+}
+
+static void
+test_sysfs_assert_file (const gchar *root, const gchar *path, const gchar *expected)
+{
+  gchar *contents;
+
+  contents = xfpm_test_fixture_read (root, path);
+  g_assert_cmpstr (contents, ==, expected);
+  g_free (contents);
+}
+
+static void
+test_cpufreq_apply (void)
+{
+  gchar *root;
+  gchar *output = NULL;
+
+  root = test_sysfs_setup ();
+
+  g_assert_cmpint (test_sysfs_run (root, "cpufreq", "--policy",
+                                   "policy0:powersave:power:1800000", &output),
+                   ==, EXIT_CODE_SUCCESS);
+
+  test_sysfs_assert_file (root, POLICY0 "/scaling_governor", "powersave");
+  test_sysfs_assert_file (root, POLICY0 "/energy_performance_preference", "power");
+  test_sysfs_assert_file (root, POLICY0 "/scaling_max_freq", "1800000");
+
+  g_free (output);
+  xfpm_test_fixture_free (root);
+}
+
+static void
+test_cpufreq_empty_fields (void)
+{
+  gchar *root;
+  gchar *output = NULL;
+
+  root = test_sysfs_setup ();
+
+  /* Empty fields leave the setting alone */
+  g_assert_cmpint (test_sysfs_run (root, "cpufreq", "--policy", "policy0::power:", &output),
+                   ==, EXIT_CODE_SUCCESS);
+
+  test_sysfs_assert_file (root, POLICY0 "/scaling_governor", "performance");
+  test_sysfs_assert_file (root, POLICY0 "/energy_performance_preference", "power");
+  test_sysfs_assert_file (root, POLICY0 "/scaling_max_freq", "4200000");
+
+  g_free (output);
+  xfpm_test_fixture_free (root);
+}
+
+static void
+test_cpufreq_invalid (void)
+{
+  const gchar *invalid[] =
+  {
+    /* Not in the available lists */
+    "policy0:ondemand::",
+    "policy0::turbo:",
+    /* Outside cpuinfo_min_freq and cpuinfo_max_freq, or no number */
+    "policy0:::100000",
+    "policy0:::9000000",
+    "policy0:::1800000kHz",
+    /* Not a policy, or not one of ours */
+    "policy1:powersave::",
+    "../../../../policy0:powersave::",
+    "policy0/..:powersave::",
+    "cpu0:powersave::",
+    "policy0:powersave",
+  };
+  gchar *root;
+  guint i;
+
+  root = test_sysfs_setup ();
+
+  for ( i = 0; i < G_N_ELEMENTS (invalid); i++ )
+  {
+    gchar *output = NULL;
+
+    g_assert_cmpint (test_sysfs_run (root, "cpufreq", "--policy", invalid[i], &output),
+                     ==, EXIT_CODE_ARGUMENTS_INVALID);
+    g_assert_cmpstr (output, !=, "");
+    g_free (output);
+  }
+
+  /* Nothing was touched */
+  test_sysfs_assert_file (root, POLICY0 "/scaling_governor", "performance");
+  test_sysfs_assert_file (root, POLICY0 "/energy_performance_preference", "balance_performance");
+  test_sysfs_assert_file (root, POLICY0 "/scaling_max_freq", "4200000");
+
+  xfpm_test_fixture_free (root);
+}
+
+static void
+test_cpufreq_all_or_nothing (void)
+{
+  gchar *root;
+  gchar *output = NULL;
+
+  root = test_sysfs_setup ();
+
+  /* A valid governor doesn't get written when the preference is bad */
+  g_assert_cmpint (test_sysfs_run (root, "cpufreq", "--policy", "policy0:powersave:turbo:", &output),
+                   ==, EXIT_CODE_ARGUMENTS_INVALID);
+
+  test_sysfs_assert_file (root, POLICY0 "/scaling_governor", "performance");
+
+  g_free (output);
+  xfpm_test_fixture_free (root);
+}
+
+static void
+test_runtime_pm_apply (void)
+{
+  gchar *root;
+  gchar *output = NULL;
+
+  root = test_sysfs_setup ();
+
+  g_assert_cmpint (test_sysfs_run (root, "runtime-pm", "--device", "usb/1-1,auto,-1", &output),
+                   ==, EXIT_CODE_SUCCESS);
+
+  test_sysfs_assert_file (root, USB_POWER "/control", "auto");
+  test_sysfs_assert_file (root, USB_POWER "/autosuspend_delay_ms", "-1");
+
+  g_free (output);
+  xfpm_test_fixture_free (root);
+}
+
+static void
+test_runtime_pm_invalid (void)
+{
+  const gchar *invalid[] =
+  {
+    "usb/1-1,off,",
+    "usb/1-1,,soon",
+    "usb/..,auto,",
+    "usb/1-1/../../..,auto,",
+    "platform/1-1,auto,",
+    "usb/2-1,auto,",
+    "usb/1-1",
+  };
+  gchar *root;
+  guint i;
+
+  root = test_sysfs_setup ();
+
+  for ( i = 0; i < G_N_ELEMENTS (invalid); i++ )
+  {
+    gchar *output = NULL;
+
+    g_assert_cmpint (test_sysfs_run (root, "runtime-pm", "--device", invalid[i], &output),
+                     ==, EXIT_CODE_ARGUMENTS_INVALID);
+    g_free (output);
+  }
+
+  test_sysfs_assert_file (root, USB_POWER "/control", "on");
+  test_sysfs_assert_file (root, USB_POWER "/autosuspend_delay_ms", "2000");
+
+  xfpm_test_fixture_free (root);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/sysfs-helper/cpufreq/apply", test_cpufreq_apply);
+  g_test_add_func ("/sysfs-helper/cpufreq/empty-fields", test_cpufreq_empty_fields);
+  g_test_add_func ("/sysfs-helper/cpufreq/invalid", test_cpufreq_invalid);
+  g_test_add_func ("/sysfs-helper/cpufreq/all-or-nothing", test_cpufreq_all_or_nothing);
+  g_test_add_func ("/sysfs-helper/runtime-pm/apply", test_runtime_pm_apply);
+  g_test_add_func ("/sysfs-helper/runtime-pm/invalid", test_runtime_pm_invalid);
+
+  return g_test_run ();
+}
@@ -0,0 +1,399 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Drives xfpm_thermal_read() over a fixture tree. The settings,
+ * notifications, power profiles and backlight are stand-ins defined
+ * below that record what the module asked for.
+ */
+#include "../src/xfpm-thermal.c"
+
+#include "xfpm-test-fixture.h"
+
+#define ZONE0       "class/thermal/thermal_zone0"
+#define ZONE1       "class/thermal/thermal_zone1"
+#define THROTTLE0   "devices/system/cpu/cpu0/thermal_throttle"
+
+static XfpmConfig test_config;
+
+static gint test_notifications;
+static gint test_profile_hot;
+static gint32 test_brightness;
+
+/* Settings */
+
+G_DEFINE_TYPE (XfpmXfconf, xfpm_xfconf, G_TYPE_OBJECT)
+
+static void
+xfpm_xfconf_class_init (XfpmXfconfClass *klass)
+{
+  g_signal_new ("config-changed",
+                XFPM_TYPE_XFCONF,
+                G_SIGNAL_RUN_LAST,
+                G_STRUCT_OFFSET (XfpmXfconfClass, config_changed),
+                NULL, NULL,
+                g_cclosure_marshal_VOID__BOXED,
+                G_TYPE_NONE, 1, G_TYPE_STRV);
+}
+
+static void
+xfpm_xfconf_init (XfpmXfconf *conf)
+{
+}
+
+XfpmXfconf *
+xfpm_xfconf_new (void)
+{
+  return g_object_new (XFPM_TYPE_XFCONF, NULL);
+}
+
+const XfpmConfig *
+xfpm_xfconf_get_config (XfpmXfconf *conf)
+{
+  return &test_config;
+}
+
+/* Notifications */
+
+G_DEFINE_TYPE (XfpmNotify, xfpm_notify, G_TYPE_OBJECT)
+
+static void
+xfpm_notify_class_init (XfpmNotifyClass *klass)
+{
+}
+
+static void
+xfpm_notify_init (XfpmNotify *notify)
+{
+}
+
+XfpmNotify *
+xfpm_notify_new (void)
+{
+  return g_object_new (XFPM_TYPE_NOTIFY, NULL);
+}
+
+void
+xfpm_notify_post (XfpmNotify *notify, XfpmNotifyCategory category, const gchar *key,
+                  const gchar *title, const gchar *text, const gchar *icon_name,
+                  XfpmNotifyUrgency urgency)
+{
+  g_assert_cmpstr (key, ==, "thermal");
+  test_notifications++;
+}
+
+/* Power profiles */
+
+G_DEFINE_TYPE (XfpmPowerProfiles, xfpm_power_profiles, G_TYPE_OBJECT)
+
+static void
+xfpm_power_profiles_class_init (XfpmPowerProfilesClass *klass)
+{
+}
+
+static void
+xfpm_power_profiles_init (XfpmPowerProfiles *profiles)
+{
+}
+
+void
+xfpm_power_profiles_set_hot (XfpmPowerProfiles *profiles, gboolean hot)
+{
+  test_profile_hot = hot;
+}
+
+/* A backlight with levels 0 to 100 */
+
+G_DEFINE_TYPE (XfpmBacklight, xfpm_backlight, G_TYPE_OBJECT)
+
+static void
+xfpm_backlight_class_init (XfpmBacklightClass *klass)
+{
+}
+
+static void
+xfpm_backlight_init (XfpmBacklight *backlight)
+{
+}
+
+gboolean
+xfpm_backlight_has_hw (XfpmBacklight *backlight)
+{
+  return TRUE;
+}
+
+gint32
+xfpm_backlight_get_level (XfpmBacklight *backlight)
+{
+  return test_brightness;
+}
+
+gint32
+xfpm_backlight_get_max_level (XfpmBacklight *backlight)
+{
+  return 100;
+}
+
+void
+xfpm_backlight_set_level (XfpmBacklight *backlight, gint32 level,
+                          GAsyncReadyCallback callback, gpointer user_data)
+{
+  test_brightness = level;
+}
+
+typedef struct
+{
+  gchar               *root;
+  XfpmBacklight       *backlight;
+  XfpmPowerProfiles   *profiles;
+  XfpmThermal         *thermal;
+} TestThermal;
+
+static void
+test_thermal_set_temperature (TestThermal *test, gint celsius)
+{
+  gchar *value;
+
+  value = g_strdup_printf ("%d\n", celsius * 1000);
+  xfpm_test_fixture_write (test->root, ZONE0 "/temp", value);
+  g_free (value);
+}
+
+static void
+test_thermal_throttle (TestThermal *test)
+{
+  gchar *contents;
+  gchar *value;
+
+  contents = xfpm_test_fixture_read (test->root, THROTTLE0 "/package_throttle_count");
+  value = g_strdup_printf ("%" G_GINT64_FORMAT "\n", g_ascii_strtoll (contents, NULL, 10) + 1);
+  xfpm_test_fixture_write (test->root, THROTTLE0 "/package_throttle_count", value);
+
+  g_free (value);
+  g_free (contents);
+}
+
+/* As if the system had been hot for longer than the minimum */
+static void
+test_thermal_expire (TestThermal *test)
+{
+  test->thermal->priv->hot_since -= THERMAL_MIN_HOT_USEC;
+}
+
+static void
+test_thermal_setup (TestThermal *test, gconstpointer data)
+{
+  test->root = xfpm_test_fixture_new ();
+
+  xfpm_test_fixture_write (test->root, ZONE0 "/type", "x86_pkg_temp\n");
+  xfpm_test_fixture_write (test->root, ZONE0 "/temp", "50000\n");
+  /* A broken sensor is never the hottest */
+  xfpm_test_fixture_write (test->root, ZONE1 "/type", "acpitz\n");
+  xfpm_test_fixture_write (test->root, ZONE1 "/temp", "255000\n");
+  xfpm_test_fixture_write (test->root, "class/thermal/cooling_device0/type", "Fan\n");
+
+  xfpm_test_fixture_write (test->root, THROTTLE0 "/core_throttle_count", "0\n");
+  xfpm_test_fixture_write (test->root, THROTTLE0 "/package_throttle_count", "0\n");
+
+  g_setenv ("XFPM_SYSFS_ROOT", test->root, TRUE);
+
+  memset (&test_config, 0, sizeof (test_config));
+  test_config.thermal_hot_temperature = 90;
+  test_config.thermal_hysteresis = 10;
+  test_config.thermal_actions = XFPM_THERMAL_ACTION_PROFILE |
+                                XFPM_THERMAL_ACTION_BRIGHTNESS |
+                                XFPM_THERMAL_ACTION_NOTIFY;
+  test_config.thermal_brightness_steps = 2;
+  test_config.brightness_step_count = 10;
+
+  test_notifications = 0;
+  test_profile_hot = -1;
+  test_brightness = 100;
+
+  test->backlight = g_object_new (XFPM_TYPE_BACKLIGHT, NULL);
+  test->profiles = g_object_new (XFPM_TYPE_POWER_PROFILES, NULL);
+  test->thermal = xfpm_thermal_new (test->backlight, test->profiles);
+}
+
+static void
+test_thermal_teardown (TestThermal *test, gconstpointer data)
+{
+  g_object_unref (test->thermal);
+  g_object_unref (test->profiles);
+  g_object_unref (test->backlight);
+  xfpm_test_fixture_free (test->root);
+}
+
+static void
+test_thermal_hot (TestThermal *test, gconstpointer data)
+{
+  g_assert_false (test->thermal->priv->hot);
+  g_assert_cmpuint (test->thermal->priv->poll_id, !=, 0);
+
+  test_thermal_set_temperature (test, 89);
+  xfpm_thermal_read (test->thermal);
+  g_assert_false (test->thermal->priv->hot);
+
+  test_thermal_set_temperature (test, 90);
+  xfpm_thermal_read (test->thermal);
+  g_assert_true (test->thermal->priv->hot);
+
+  /* Every action once, two steps of a tenth each */
+  g_assert_cmpint (test_profile_hot, ==, TRUE);
+  g_assert_cmpint (test_notifications, ==, 1);
+  g_assert_cmpint (test_brightness, ==, 80);
+
+  /* Staying hot doesn't repeat them */
+  test_thermal_set_temperature (test, 95);
+  xfpm_thermal_read (test->thermal);
+  g_assert_cmpint (test_notifications, ==, 1);
+  g_assert_cmpint (test_brightness, ==, 80);
+}
+
+static void
+test_thermal_hysteresis (TestThermal *test, gconstpointer data)
+{
+  test_thermal_set_temperature (test, 92);
+  xfpm_thermal_read (test->thermal);
+  g_assert_true (test->thermal->priv->hot);
+
+  /* Below the hot temperature, but not by the hysteresis */
+  test_thermal_set_temperature (test, 81);
+  test_thermal_expire (test);
+  xfpm_thermal_read (test->thermal);
+  g_assert_true (test->thermal->priv->hot);
+
+  /* Cool enough, but not hot for long enough */
+  test->thermal->priv->hot_since = g_get_monotonic_time ();
+  test_thermal_set_temperature (test, 79);
+  xfpm_thermal_read (test->thermal);
+  g_assert_true (test->thermal->priv->hot);
+
+  test_thermal_expire (test);
+  xfpm_thermal_read (test->thermal);
+  g_assert_false (test->thermal->priv->hot);
+
+  /* Everything put back */
+  g_assert_cmpint (test_profile_hot, ==, FALSE);
+  g_assert_cmpint (test_brightness, ==, 100);
+}
+
+static void
+test_thermal_throttle_hot (TestThermal *test, gconstpointer data)
+{
+  /* Throttling well below the hot temperature is the CPU's business */
+  test_thermal_set_temperature (test, 70);
+  test_thermal_throttle (test);
+  xfpm_thermal_read (test->thermal);
+  g_assert_false (test->thermal->priv->hot);
+
+  /* Within the hysteresis it counts as hot */
+  test_thermal_set_temperature (test, 85);
+  test_thermal_throttle (test);
+  xfpm_thermal_read (test->thermal);
+  g_assert_true (test->thermal->priv->hot);
+
+  /* Not cooled down while it still throttles */
+  test_thermal_set_temperature (test, 70);
+  test_thermal_throttle (test);
+  test_thermal_expire (test);
+  xfpm_thermal_read (test->thermal);
+  g_assert_true (test->thermal->priv->hot);
+
+  /* The counter stopped going up */
+  xfpm_thermal_read (test->thermal);
+  g_assert_false (test->thermal->priv->hot);
+}
+
+static void
+test_thermal_user_brightness (TestThermal *test, gconstpointer data)
+{
+  test_thermal_set_temperature (test, 95);
+  xfpm_thermal_read (test->thermal);
+  g_assert_cmpint (test_brightness, ==, 80);
+
+  /* The user's choice wins over ours */
+  test_brightness = 50;
+
+  test_thermal_set_temperature (test, 60);
+  test_thermal_expire (test);
+  xfpm_thermal_read (test->thermal);
+  g_assert_false (test->thermal->priv->hot);
+  g_assert_cmpint (test_brightness, ==, 50);
+}
+
+static void
+test_thermal_actions (TestThermal *test, gconstpointer data)
+{
+  test_config.thermal_actions = XFPM_THERMAL_ACTION_NOTIFY;
+
+  test_thermal_set_temperature (test, 95);
+  xfpm_thermal_read (test->thermal);
+  g_assert_true (test->thermal->priv->hot);
+
+  g_assert_cmpint (test_notifications, ==, 1);
+  g_assert_cmpint (test_profile_hot, ==, -1);
+  g_assert_cmpint (test_brightness, ==, 100);
+}
+
+static void
+test_thermal_settings_changed (TestThermal *test, gconstpointer data)
+{
+  const gchar *keys[] = { THERMAL_ACTIONS, NULL };
+
+  test_thermal_set_temperature (test, 95);
+  xfpm_thermal_read (test->thermal);
+  g_assert_cmpint (test_profile_hot, ==, TRUE);
+
+  /* Undone with the old actions, the read after the restart applies
+   * the new ones */
+  test_config.thermal_actions = XFPM_THERMAL_ACTION_BRIGHTNESS;
+  g_signal_emit_by_name (test->thermal->priv->conf, "config-changed", keys);
+
+  g_assert_true (test->thermal->priv->hot);
+  g_assert_cmpint (test_profile_hot, ==, FALSE);
+  g_assert_cmpint (test_brightness, ==, 80);
+
+  /* Switched off, nothing is read any more */
+  test_config.thermal_hot_temperature = 0;
+  g_signal_emit_by_name (test->thermal->priv->conf, "config-changed", keys);
+
+  g_assert_false (test->thermal->priv->hot);
+  g_assert_cmpint (test_brightness, ==, 100);
+  g_assert_cmpuint (test->thermal->priv->poll_id, ==, 0);
+}
+
+#define ADD_TEST(path, func) \
+  g_test_add ((path), TestThermal, NULL, test_thermal_setup, (func), test_thermal_teardown)
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  ADD_TEST ("/thermal/hot", test_thermal_hot);
+  ADD_TEST ("/thermal/hysteresis", test_thermal_hysteresis);
+  ADD_TEST ("/thermal/throttle", test_thermal_throttle_hot);
+  ADD_TEST ("/thermal/user-brightness", test_thermal_user_brightness);
+  ADD_TEST ("/thermal/actions", test_thermal_actions);
+  ADD_TEST ("/thermal/settings-changed", test_thermal_settings_changed);
+
+  return g_test_run ();
+}
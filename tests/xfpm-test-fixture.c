@@ -0,0 +1,123 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Fake sysfs trees for the modules that take XFPM_SYSFS_ROOT.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "xfpm-test-fixture.h"
+
+/* An empty directory to build the tree in, free with xfpm_test_fixture_free() */
+gchar *
+xfpm_test_fixture_new (void)
+{
+  GError *error = NULL;
+  gchar *root;
+
+  root = g_dir_make_tmp ("xfpm-test-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  return root;
+}
+
+/*
+ * Creates the parent directories as needed. An existing file is
+ * rewritten in place, like sysfs does, so a descriptor the module
+ * under test keeps open sees the new contents.
+ */
+void
+xfpm_test_fixture_write (const gchar *root, const gchar *path, const gchar *contents)
+{
+  gchar *filename;
+  gchar *dirname;
+  FILE *file;
+
+  filename = g_build_filename (root, path, NULL);
+  dirname = g_path_get_dirname (filename);
+
+  g_assert_cmpint (g_mkdir_with_parents (dirname, 0755), ==, 0);
+
+  file = fopen (filename, "w");
+  g_assert_nonnull (file);
+  g_assert_cmpint (fputs (contents, file), >=, 0);
+  g_assert_cmpint (fclose (file), ==, 0);
+
+  g_free (dirname);
+  g_free (filename);
+}
+
+/* Stripped contents of @path, %NULL if it doesn't exist */
+gchar *
+xfpm_test_fixture_read (const gchar *root, const gchar *path)
+{
+  gchar *filename;
+  gchar *contents = NULL;
+
+  filename = g_build_filename (root, path, NULL);
+  if ( g_file_get_contents (filename, &contents, NULL, NULL) )
+    g_strstrip (contents);
+  g_free (filename);
+
+  return contents;
+}
+
+static void
+xfpm_test_fixture_remove (const gchar *path)
+{
+  GDir *dir;
+  const gchar *entry;
+
+  /* Links are removed, not followed */
+  dir = g_file_test (path, G_FILE_TEST_IS_SYMLINK) ? NULL : g_dir_open (path, 0, NULL);
+  if ( dir != NULL )
+  {
+    while ( (entry = g_dir_read_name (dir)) != NULL )
+    {
+      gchar *child = g_build_filename (path, entry, NULL);
+
+      xfpm_test_fixture_remove (child);
+      g_free (child);
+    }
+
+    g_dir_close (dir);
+    g_rmdir (path);
+  }
+  else
+  {
+    g_unlink (path);
+  }
+}
+
+/* Removes the tree and frees @root */
+void
+xfpm_test_fixture_free (gchar *root)
+{
+  xfpm_test_fixture_remove (root);
+  g_free (root);
+}
@@ -0,0 +1,38 @@
+/*
+ * * Copyright (C) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __XFPM_TEST_FIXTURE_H
+#define __XFPM_TEST_FIXTURE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gchar             *xfpm_test_fixture_new        (void) G_GNUC_MALLOC;
+void               xfpm_test_fixture_write      (const gchar *root,
+                                                 const gchar *path,
+                                                 const gchar *contents);
+gchar             *xfpm_test_fixture_read       (const gchar *root,
+                                                 const gchar *path) G_GNUC_MALLOC;
+void               xfpm_test_fixture_free       (gchar       *root);
+
+G_END_DECLS
+
+#endif /* __XFPM_TEST_FIXTURE_H */